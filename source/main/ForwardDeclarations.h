@@ -46,6 +46,7 @@ namespace RoR
 	}
 }
 
+struct VehicleSnapshot;
 struct node_t;
 struct beam_t;
 struct shock_t;
@@ -95,6 +96,7 @@ class Airbrake;
 class Airfoil;
 class Autopilot;
 class Axle;
+class BatchedLabel;
 class Beam;
 class BeamEngine;
 class BeamFactory;
@@ -130,6 +132,8 @@ class IHeightFinder;
 class InputEngine;
 class IThreadTask;
 class IWater;
+class LabelBatch;
+class LabelBatcher;
 class Landusemap;
 class MapTextureCreator;
 class MaterialFunctionMapper;
@@ -175,6 +179,9 @@ class TruckEditor;
 class TruckHUD;
 class Turbojet;
 class Turboprop;
+class VehicleSnapshotBuffer;
+class VehicleStateDecoder;
+class VehicleStateEncoder;
 class VideoCamera;
 class Water;
 
@@ -24,7 +24,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-Sound::Sound(ALuint buffer, SoundManager *soundManager, int sourceIndex) :
+Sound::Sound(SoundManager::audio_buffer_t *buffer, SoundManager *soundManager, int sourceIndex) :
 	  buffer(buffer)
 	, sound_manager(soundManager)
 	, source_index(sourceIndex)
@@ -37,13 +37,14 @@ Sound::Sound(ALuint buffer, SoundManager *soundManager, int sourceIndex) :
 	, loop(false)
 	, should_play(false)
 	, hardware_index(-1)
+	, bucket(0, 0)
 {
 }
 
 void Sound::computeAudibility(Vector3 pos)
 {
-	// disable sound?
-	if (!enabled)
+	// disable sound? or are the samples not loaded yet?
+	if (!enabled || (buffer && buffer->state != SoundManager::BUFFER_READY))
 	{
 		audibility = 0.0f;
 		return;
@@ -52,9 +53,7 @@ void Sound::computeAudibility(Vector3 pos)
 	// first check if the sound is finished!
 	if (!loop && should_play && hardware_index != -1)
 	{
-		int value = 0;
-		alGetSourcei((ALuint)sound_manager->getHardwareSource(hardware_index), AL_SOURCE_STATE, &value);
-		if (value != AL_PLAYING)
+		if (!sound_manager->isHardwareSourcePlaying(hardware_index))
 		{
 			should_play = false;
 		}
@@ -85,9 +84,7 @@ bool Sound::isPlaying()
 {
 	if (hardware_index != -1)
 	{
-		int value = 0;
-		alGetSourcei((ALuint)sound_manager->getHardwareSource(hardware_index), AL_SOURCE_STATE, &value);
-		return (value == AL_PLAYING);
+		return sound_manager->isHardwareSourcePlaying(hardware_index);
 	}
 	return false;
 }
@@ -117,18 +114,21 @@ void Sound::stop()
 
 void Sound::setGain(float gain)
 {
+	if (gain == this->gain) return;
 	this->gain = gain;
 	sound_manager->recomputeSource(source_index, REASON_GAIN, gain, NULL);
 }
 
 void Sound::setLoop(bool loop)
 {
+	if (loop == this->loop) return;
 	this->loop = loop;
 	sound_manager->recomputeSource(source_index, REASON_LOOP, (loop) ? 1.0f : 0.0f, NULL);
 }
 
 void Sound::setPitch(float pitch)
 {
+	if (pitch == this->pitch) return;
 	this->pitch = pitch;
 	sound_manager->recomputeSource(source_index, REASON_PTCH, pitch, NULL);
 }
@@ -23,6 +23,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "SoundManager.h"
+
 #include <AL/al.h>
 
 class Sound : public ZeroedMemoryAllocator
@@ -30,7 +32,7 @@ class Sound : public ZeroedMemoryAllocator
 	friend class SoundManager;
 
 public:
-	Sound(ALuint buffer, SoundManager* soundManager, int sourceIndex);
+	Sound(SoundManager::audio_buffer_t* buffer, SoundManager* soundManager, int sourceIndex);
 
 	void setPitch(float pitch);
 	void setGain(float gain);
@@ -58,7 +60,12 @@ private:
 
 	// this value is changed dynamically, depending on whether the input is played or not.
 	int hardware_index;
-	ALuint buffer;
+	// spatial bucket of the SoundManager this source is in
+	std::pair<int, int> bucket;
+	// shared samples, NULL for the null backend
+	SoundManager::audio_buffer_t* buffer;
+	// own read position in the file for streamed buffers
+	Ogre::DataStreamPtr stream;
 	
 	Ogre::Vector3 position;
 	Ogre::Vector3 velocity;
@@ -22,6 +22,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Sound.h"
 #include "SoundManager.h"
 #include "Settings.h"
+#include "ThreadPool.h"
+#include "Utils.h"
 
 // some gcc fixes
 #if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
@@ -48,16 +50,50 @@ const float SoundManager::MAX_DISTANCE       = 500.0f;
 const float SoundManager::ROLLOFF_FACTOR     = 1.0f;
 const float SoundManager::REFERENCE_DISTANCE = 7.5f;
 
+const float SoundManager::VOICE_ALLOCATION_RATE  = 20.0f;
+const float SoundManager::VOICE_STEAL_HYSTERESIS = 1.2f;
+const float SoundManager::BUCKET_SIZE            = 100.0f;
+
 SoundManager::SoundManager() :
-	  audio_buffers_in_use_count(0)
+	  resident_bytes(0)
+	, pending_decodes(0)
 	, audio_sources_in_use_count(0)
 	, hardware_sources_in_use_count(0)
 	, hardware_sources_num(0)
 	, sound_context(NULL)
 	, audio_device(NULL)
+	, null_backend(false)
+	, voice_heap_size(0)
+	, voice_allocation_timer(0.0f)
 {
 	String device = SSETTING("AudioDevice", "");
 
+	for (int i=0; i < MAX_HARDWARE_SOURCES; i++)
+	{
+		hardware_sources[i] = 0;
+		hardware_sources_map[i] = -1;
+		voice_heap_pos[i] = -1;
+		null_sources_playing[i] = false;
+		voice_streams[i].active = false;
+		voice_streams[i].end_reached = false;
+		voice_streams[i].position = 0;
+		for (int b=0; b < STREAM_BUFFERS; b++)
+		{
+			voice_streams[i].buffers[b] = 0;
+		}
+	}
+
+	pthread_mutex_init(&decode_mutex, NULL);
+
+	if (device == "null")
+	{
+		null_backend = true;
+		hardware_sources_num = MAX_HARDWARE_SOURCES;
+		master_volume = FSETTING("Sound Volume", 100.0f) / 100.0f;
+		LOG("SoundManager: using the null audio backend, no sound will be played");
+		return;
+	}
+
 	if (device == "")
 		audio_device = alcOpenDevice(NULL);
 	else
@@ -102,19 +138,48 @@ SoundManager::SoundManager() :
 	alDopplerFactor(1.0f);
 	alDopplerVelocity(343.0f);
 
-	for (int i=0; i < MAX_HARDWARE_SOURCES; i++)
-	{
-		hardware_sources_map[i] = -1;
-	}
-
 	master_volume = FSETTING("Sound Volume", 100.0f) / 100.0f;
 }
 
 SoundManager::~SoundManager()
 {
+	// the worker threads must be done with the buffers
+	while (true)
+	{
+		MUTEX_LOCK(&decode_mutex);
+		int pending = pending_decodes;
+		MUTEX_UNLOCK(&decode_mutex);
+		if (!pending) break;
+		sleepMilliSeconds(1);
+	}
+	pthread_mutex_destroy(&decode_mutex);
+
+	LOG("SoundManager: " + getMemoryUsage());
+
+	if (null_backend)
+	{
+		LOG("SoundManager destroyed.");
+		return;
+	}
+
 	// delete the sources and buffers
 	alDeleteSources(MAX_HARDWARE_SOURCES, hardware_sources);
-	alDeleteBuffers(MAX_AUDIO_BUFFERS, audio_buffers);
+	for (int i=0; i < MAX_HARDWARE_SOURCES; i++)
+	{
+		if (voice_streams[i].buffers[0])
+		{
+			alDeleteBuffers(STREAM_BUFFERS, voice_streams[i].buffers);
+		}
+	}
+	for (std::map<String, audio_buffer_t*>::iterator it = audio_buffers.begin(); it != audio_buffers.end(); ++it)
+	{
+		if (it->second->buffer)
+		{
+			alDeleteBuffers(1, &it->second->buffer);
+		}
+		delete it->second;
+	}
+	audio_buffers.clear();
 
 	// destroy the sound context and device
 	sound_context = alcGetCurrentContext();
@@ -130,9 +195,11 @@ SoundManager::~SoundManager()
 
 void SoundManager::setCamera(Ogre::Vector3 position, Ogre::Vector3 direction, Ogre::Vector3 up, Ogre::Vector3 velocity)
 {
-	if (!audio_device) return;
+	if (isDisabled()) return;
+	// the next voice allocation pass takes care of the sources
 	camera_position = position;
-	recomputeAllSources();
+
+	if (null_backend) return;
 
 	float orientation[6];
 	// direction
@@ -154,221 +221,784 @@ bool compareByAudibility(std::pair<int, float> a, std::pair<int, float> b)
 	return a.second > b.second;
 }
 
-// called when the camera moves
-void SoundManager::recomputeAllSources()
+void SoundManager::update(float dt)
 {
-	if (!audio_device) return;
+	if (isDisabled()) return;
 
-	for (int i=0; i < audio_sources_in_use_count; i++)
-	{
-		audio_sources[i]->computeAudibility(camera_position);
-		audio_sources_most_audible[i].first = i;
-		audio_sources_most_audible[i].second = audio_sources[i]->audibility;
-	}
-	// sort first 'num_hardware_sources' sources by audibility
-	// see: https://en.wikipedia.org/wiki/Selection_algorithm
-	if ((audio_sources_in_use_count - 1) > hardware_sources_num)
+	if (!null_backend)
 	{
-		std::nth_element(audio_sources_most_audible, audio_sources_most_audible+hardware_sources_num, audio_sources_most_audible+audio_sources_in_use_count-1, compareByAudibility);
+		uploadDecodedBuffers();
+		updateStreams();
 	}
-	// retire out of range sources first
-	for (int i=0; i < audio_sources_in_use_count; i++)
+
+	voice_allocation_timer += dt;
+	if (voice_allocation_timer < 1.0f / VOICE_ALLOCATION_RATE) return;
+	voice_allocation_timer = 0.0f;
+
+	updateVoices();
+}
+
+void SoundManager::updateVoices()
+{
+	voice_candidates.clear();
+
+	// retire the voices of sources out of range first, so their buckets can be skipped as a whole below
+	for (int hardware_index=0; hardware_index < hardware_sources_num; hardware_index++)
 	{
-		if (audio_sources[audio_sources_most_audible[i].first]->hardware_index != -1 && (i >= hardware_sources_num || audio_sources_most_audible[i].second == 0))
-			retire(audio_sources_most_audible[i].first);
+		int source_index = hardware_sources_map[hardware_index];
+		if (source_index == -1) continue;
+
+		Sound *s = audio_sources[source_index];
+		if (getBucketDistance(s->bucket) > MAX_DISTANCE)
+		{
+			s->audibility = 0.0f;
+			retire(source_index);
+		}
 	}
-	// assign new sources
-	for (int i=0; i < std::min(audio_sources_in_use_count, hardware_sources_num); i++)
+
+	for (std::map<bucket_key_t, std::vector<int> >::iterator it = source_buckets.begin(); it != source_buckets.end(); ++it)
 	{
-		if (audio_sources[audio_sources_most_audible[i].first]->hardware_index == -1 && audio_sources_most_audible[i].second > 0)
+		// whole bucket out of range, no need to look at its sources
+		if (getBucketDistance(it->first) > MAX_DISTANCE) continue;
+
+		for (size_t i=0; i < it->second.size(); i++)
 		{
-			for (int j=0; j < hardware_sources_num; j++)
+			int source_index = it->second[i];
+			Sound *s = audio_sources[source_index];
+
+			s->computeAudibility(camera_position);
+
+			if (s->hardware_index != -1)
 			{
-				if (hardware_sources_map[j] == -1)
-				{
-					assign(audio_sources_most_audible[i].first, j);
-					break;
-				}
+				if (s->audibility == 0.0f)
+					retire(source_index);
+				else
+					voiceHeapUpdate(s->hardware_index);
+			} else if (s->audibility > 0.0f)
+			{
+				voice_candidates.push_back(std::make_pair(source_index, s->audibility));
 			}
 		}
 	}
+
+	if (voice_candidates.empty()) return;
+
+	// only the 'hardware_sources_num' most audible candidates can get a voice
+	// see: https://en.wikipedia.org/wiki/Selection_algorithm
+	if ((int)voice_candidates.size() > hardware_sources_num)
+	{
+		std::nth_element(voice_candidates.begin(), voice_candidates.begin() + hardware_sources_num, voice_candidates.end(), compareByAudibility);
+		voice_candidates.resize(hardware_sources_num);
+	}
+	std::sort(voice_candidates.begin(), voice_candidates.end(), compareByAudibility);
+
+	for (size_t i=0; i < voice_candidates.size(); i++)
+	{
+		if (hardware_sources_in_use_count < hardware_sources_num)
+		{
+			assign(voice_candidates[i].first, getFreeHardwareSource());
+			continue;
+		}
+
+		// all voices are busy, take over the faintest one if this source is clearly louder
+		// the candidates are sorted, so all following ones are too faint as well
+		int faintest = voice_heap[0];
+		if (voice_candidates[i].second <= getVoiceAudibility(0) * VOICE_STEAL_HYSTERESIS) break;
+		retire(hardware_sources_map[faintest]);
+		assign(voice_candidates[i].first, faintest);
+	}
 }
 
 void SoundManager::recomputeSource(int source_index, int reason, float vfl, Vector3 *vvec)
 {
-	if (!audio_device) return;
-	audio_sources[source_index]->computeAudibility(camera_position);
+	if (isDisabled()) return;
+
+	Sound *s = audio_sources[source_index];
 
-	if (audio_sources[source_index]->audibility == 0.0f)
+	if (reason == Sound::REASON_POSN)
 	{
-		if (audio_sources[source_index]->hardware_index != -1)
-		{
-			// retire the source if it is currently assigned
-			retire(source_index);
-		}
-	} else
+		updateSourceBucket(source_index);
+	}
+
+	if (s->hardware_index == -1)
 	{
-		// this is a potentially audible m_audio_sources[source_index]
-		if (audio_sources[source_index]->hardware_index != -1)
+		// use a free voice right away, else the next voice allocation pass decides if it is worth stealing one
+		if (hardware_sources_in_use_count < hardware_sources_num)
 		{
-			// m_audio_sources[source_index] already playing
-			// update the AL settings
-			switch (reason)
+			s->computeAudibility(camera_position);
+			if (s->audibility > 0.0f)
 			{
-			case Sound::REASON_PLAY: alSourcePlay(hardware_sources[audio_sources[source_index]->hardware_index]); break;
-			case Sound::REASON_STOP: alSourceStop(hardware_sources[audio_sources[source_index]->hardware_index]); break;
-			case Sound::REASON_GAIN: alSourcef(hardware_sources[audio_sources[source_index]->hardware_index], AL_GAIN, vfl * master_volume); break;
-			case Sound::REASON_LOOP: alSourcei(hardware_sources[audio_sources[source_index]->hardware_index], AL_LOOPING, (vfl > 0.5) ? AL_TRUE : AL_FALSE); break;
-			case Sound::REASON_PTCH: alSourcef(hardware_sources[audio_sources[source_index]->hardware_index], AL_PITCH, vfl); break;
-			case Sound::REASON_POSN: alSource3f(hardware_sources[audio_sources[source_index]->hardware_index], AL_POSITION, vvec->x, vvec->y, vvec->z); break;
-			case Sound::REASON_VLCT: alSource3f(hardware_sources[audio_sources[source_index]->hardware_index], AL_VELOCITY, vvec->x, vvec->y, vvec->z); break;
-			default: break;
+				assign(source_index, getFreeHardwareSource());
 			}
-		} else
+		}
+		return;
+	}
+
+	s->computeAudibility(camera_position);
+
+	if (s->audibility == 0.0f)
+	{
+		// retire the source if it is currently assigned
+		retire(source_index);
+		return;
+	}
+
+	voiceHeapUpdate(s->hardware_index);
+
+	if (null_backend)
+	{
+		if (reason == Sound::REASON_PLAY) null_sources_playing[s->hardware_index] = true;
+		if (reason == Sound::REASON_STOP) null_sources_playing[s->hardware_index] = false;
+		return;
+	}
+
+	if (s->buffer->streamed)
+	{
+		// the stream is restarted from the beginning and loops by itself
+		switch (reason)
 		{
-			// try to make it play by the hardware
-			// check if there is one free m_audio_sources[source_index] in the pool
-			if (hardware_sources_in_use_count < hardware_sources_num)
-			{
-				for (int i=0; i < hardware_sources_num; i++)
-				{
-					if (hardware_sources_map[i] == -1)
-					{
-						assign(source_index, i);
-						break;
-					}
-				}
-			} else
-			{
-				// now, compute who is the faintest
-				// note: we know the table m_hardware_sources_map is full!
-				float fv = 1.0f;
-				int al_faintest = 0;
-				for (int i=0; i < hardware_sources_num; i++)
-				{
-					if (hardware_sources_map[i] >= 0 && audio_sources[hardware_sources_map[i]]->audibility < fv)
-					{
-						fv = audio_sources[hardware_sources_map[i]]->audibility;
-						al_faintest = i;
-					}
-				}
-				// check to ensure that the sound is louder than the faintest sound currently playing
-				if (fv < audio_sources[source_index]->audibility)
-				{
-					// this new m_audio_sources[source_index] is louder than the faintest!
-					retire(hardware_sources_map[al_faintest]);
-					assign(source_index, al_faintest);
-				}
-				// else this m_audio_sources[source_index] is too faint, we don't play it!
-			}
+		case Sound::REASON_PLAY: startStream(s->hardware_index); alSourcePlay(hardware_sources[s->hardware_index]); return;
+		case Sound::REASON_STOP: stopStream(s->hardware_index); return;
+		case Sound::REASON_LOOP: return;
+		default: break;
+		}
+	}
+
+	// source already playing
+	// update the AL settings
+	switch (reason)
+	{
+	case Sound::REASON_PLAY: alSourcePlay(hardware_sources[s->hardware_index]); break;
+	case Sound::REASON_STOP: alSourceStop(hardware_sources[s->hardware_index]); break;
+	case Sound::REASON_GAIN: alSourcef(hardware_sources[s->hardware_index], AL_GAIN, vfl * master_volume); break;
+	case Sound::REASON_LOOP: alSourcei(hardware_sources[s->hardware_index], AL_LOOPING, (vfl > 0.5) ? AL_TRUE : AL_FALSE); break;
+	case Sound::REASON_PTCH: alSourcef(hardware_sources[s->hardware_index], AL_PITCH, vfl); break;
+	case Sound::REASON_POSN: alSource3f(hardware_sources[s->hardware_index], AL_POSITION, vvec->x, vvec->y, vvec->z); break;
+	case Sound::REASON_VLCT: alSource3f(hardware_sources[s->hardware_index], AL_VELOCITY, vvec->x, vvec->y, vvec->z); break;
+	default: break;
+	}
+}
+
+int SoundManager::getFreeHardwareSource()
+{
+	for (int i=0; i < hardware_sources_num; i++)
+	{
+		if (hardware_sources_map[i] == -1)
+		{
+			return i;
 		}
 	}
+	return -1;
+}
+
+SoundManager::bucket_key_t SoundManager::getBucketKey(Vector3 pos)
+{
+	return bucket_key_t((int)floor(pos.x / BUCKET_SIZE), (int)floor(pos.z / BUCKET_SIZE));
+}
+
+void SoundManager::updateSourceBucket(int source_index)
+{
+	Sound *s = audio_sources[source_index];
+	bucket_key_t key = getBucketKey(s->position);
+	if (key == s->bucket) return;
+
+	std::vector<int> &old_bucket = source_buckets[s->bucket];
+	std::vector<int>::iterator it = std::find(old_bucket.begin(), old_bucket.end(), source_index);
+	if (it != old_bucket.end())
+	{
+		*it = old_bucket.back();
+		old_bucket.pop_back();
+	}
+	if (old_bucket.empty())
+	{
+		source_buckets.erase(s->bucket);
+	}
+
+	source_buckets[key].push_back(source_index);
+	s->bucket = key;
+}
+
+float SoundManager::getBucketDistance(const bucket_key_t &key)
+{
+	// horizontal distance from the camera to the closest point of the bucket
+	float x0 = key.first * BUCKET_SIZE;
+	float z0 = key.second * BUCKET_SIZE;
+	float dx = std::max(0.0f, std::max(x0 - camera_position.x, camera_position.x - (x0 + BUCKET_SIZE)));
+	float dz = std::max(0.0f, std::max(z0 - camera_position.z, camera_position.z - (z0 + BUCKET_SIZE)));
+	return sqrt(dx * dx + dz * dz);
+}
+
+float SoundManager::getVoiceAudibility(int heap_pos)
+{
+	return audio_sources[hardware_sources_map[voice_heap[heap_pos]]]->audibility;
+}
+
+void SoundManager::voiceHeapSwap(int a, int b)
+{
+	std::swap(voice_heap[a], voice_heap[b]);
+	voice_heap_pos[voice_heap[a]] = a;
+	voice_heap_pos[voice_heap[b]] = b;
+}
+
+void SoundManager::voiceHeapSiftUp(int pos)
+{
+	while (pos > 0)
+	{
+		int parent = (pos - 1) / 2;
+		if (getVoiceAudibility(parent) <= getVoiceAudibility(pos)) break;
+		voiceHeapSwap(parent, pos);
+		pos = parent;
+	}
+}
+
+void SoundManager::voiceHeapSiftDown(int pos)
+{
+	while (true)
+	{
+		int smallest = pos;
+		int left     = pos * 2 + 1;
+		int right    = pos * 2 + 2;
+		if (left  < voice_heap_size && getVoiceAudibility(left)  < getVoiceAudibility(smallest)) smallest = left;
+		if (right < voice_heap_size && getVoiceAudibility(right) < getVoiceAudibility(smallest)) smallest = right;
+		if (smallest == pos) break;
+		voiceHeapSwap(pos, smallest);
+		pos = smallest;
+	}
+}
+
+void SoundManager::voiceHeapPush(int hardware_index)
+{
+	voice_heap[voice_heap_size] = hardware_index;
+	voice_heap_pos[hardware_index] = voice_heap_size;
+	voice_heap_size++;
+	voiceHeapSiftUp(voice_heap_size - 1);
+}
+
+void SoundManager::voiceHeapRemove(int hardware_index)
+{
+	int pos = voice_heap_pos[hardware_index];
+	voice_heap_size--;
+	if (pos != voice_heap_size)
+	{
+		voiceHeapSwap(pos, voice_heap_size);
+		voiceHeapSiftUp(pos);
+		voiceHeapSiftDown(pos);
+	}
+	voice_heap_pos[hardware_index] = -1;
+}
+
+void SoundManager::voiceHeapUpdate(int hardware_index)
+{
+	int pos = voice_heap_pos[hardware_index];
+	voiceHeapSiftUp(pos);
+	voiceHeapSiftDown(voice_heap_pos[hardware_index]);
 }
 
 void SoundManager::assign(int source_index, int hardware_index)
 {
-	if (!audio_device) return;
+	if (isDisabled()) return;
 	audio_sources[source_index]->hardware_index = hardware_index;
 	hardware_sources_map[hardware_index] = source_index;
+	hardware_sources_in_use_count++;
+	voiceHeapPush(hardware_index);
+
+	if (null_backend)
+	{
+		null_sources_playing[hardware_index] = audio_sources[source_index]->should_play;
+		return;
+	}
 
 	// the hardware source is supposed to be stopped!
-	alSourcei(hardware_sources[hardware_index], AL_BUFFER, audio_sources[source_index]->buffer);
+	if (audio_sources[source_index]->buffer->streamed)
+	{
+		// the queue is filled by startStream()
+		alSourcei(hardware_sources[hardware_index], AL_BUFFER, 0);
+		alSourcei(hardware_sources[hardware_index], AL_LOOPING, AL_FALSE);
+	} else
+	{
+		alSourcei(hardware_sources[hardware_index], AL_BUFFER, audio_sources[source_index]->buffer->buffer);
+		alSourcei(hardware_sources[hardware_index], AL_LOOPING, (audio_sources[source_index]->loop)?AL_TRUE:AL_FALSE);
+	}
 	alSourcef(hardware_sources[hardware_index], AL_GAIN, audio_sources[source_index]->gain*master_volume);
-	alSourcei(hardware_sources[hardware_index], AL_LOOPING, (audio_sources[source_index]->loop)?AL_TRUE:AL_FALSE);
 	alSourcef(hardware_sources[hardware_index], AL_PITCH, audio_sources[source_index]->pitch);
 	alSource3f(hardware_sources[hardware_index], AL_POSITION, audio_sources[source_index]->position.x,audio_sources[source_index]->position.y,audio_sources[source_index]->position.z);
 	alSource3f(hardware_sources[hardware_index], AL_VELOCITY, audio_sources[source_index]->velocity.x,audio_sources[source_index]->velocity.y,audio_sources[source_index]->velocity.z);
 	if (audio_sources[source_index]->should_play)
 	{
+		if (audio_sources[source_index]->buffer->streamed)
+		{
+			startStream(hardware_index);
+		}
 		alSourcePlay(hardware_sources[hardware_index]);
 	}
-	hardware_sources_in_use_count++;
 }
 
 void SoundManager::retire(int source_index)
 {
-	if (!audio_device) return;
+	if (isDisabled()) return;
 	if (audio_sources[source_index]->hardware_index == -1) return;
-	alSourceStop(hardware_sources[audio_sources[source_index]->hardware_index]);
+	voiceHeapRemove(audio_sources[source_index]->hardware_index);
+	if (null_backend)
+		null_sources_playing[audio_sources[source_index]->hardware_index] = false;
+	else if (voice_streams[audio_sources[source_index]->hardware_index].active)
+		stopStream(audio_sources[source_index]->hardware_index);
+	else
+		alSourceStop(hardware_sources[audio_sources[source_index]->hardware_index]);
 	hardware_sources_map[audio_sources[source_index]->hardware_index] = -1;
 	audio_sources[source_index]->hardware_index = -1;
 	hardware_sources_in_use_count--;
 }
 
+bool SoundManager::isHardwareSourcePlaying(int hardware_index)
+{
+	if (null_backend)
+	{
+		// one-shot sounds end immediately, looped ones play until they get stopped
+		int source_index = hardware_sources_map[hardware_index];
+		return null_sources_playing[hardware_index] && source_index != -1 && audio_sources[source_index]->loop;
+	}
+
+	// a stream that ran dry is restarted by updateStreams()
+	if (voice_streams[hardware_index].active && !voice_streams[hardware_index].end_reached) return true;
+
+	int value = 0;
+	alGetSourcei(hardware_sources[hardware_index], AL_SOURCE_STATE, &value);
+	return (value == AL_PLAYING);
+}
+
 void SoundManager::pauseAllSounds()
 {
-	if (!audio_device) return;
+	if (!audio_device) return; // also covers the null backend
 	// no mutex needed
 	alListenerf(AL_GAIN, 0.0f);
 }
 
 void SoundManager::resumeAllSounds()
 {
-	if (!audio_device) return;
+	if (!audio_device) return; // also covers the null backend
 	// no mutex needed
 	alListenerf(AL_GAIN, master_volume);
 }
 
 void SoundManager::setMasterVolume(float v)
 {
-	if (!audio_device) return;
+	if (isDisabled()) return;
 	// no mutex needed
 	master_volume = v;
+	if (null_backend) return;
 	alListenerf(AL_GAIN, master_volume);
 }
 
 Sound* SoundManager::createSound(String filename)
 {
-	if (!audio_device) return NULL;
+	if (isDisabled()) return NULL;
 
-	if (audio_buffers_in_use_count >= MAX_AUDIO_BUFFERS)
+	if (free_source_indices.empty() && audio_sources_in_use_count >= MAX_AUDIO_BUFFERS)
 	{
 		LOG("SoundManager: Reached MAX_AUDIO_BUFFERS limit (" + TOSTRING(MAX_AUDIO_BUFFERS) + ")");
 		return NULL;
 	}
 
-	ALuint buffer = 0;
+	if (null_backend)
+	{
+		// nothing to load, the sound only takes part in the source management
+		return addSource(NULL);
+	}
+
+	audio_buffer_t *buffer = NULL;
 
 	// is the file already loaded?
-	for (int i=0; i < audio_buffers_in_use_count; i++)
+	std::map<String, audio_buffer_t*>::iterator it = audio_buffers.find(filename);
+	if (it != audio_buffers.end())
 	{
-		if (filename == audio_buffer_file_name[i])
-		{
-			buffer = audio_buffers[i];
-			break;
-		}
+		buffer = it->second;
+		if (buffer->state == BUFFER_FAILED) return NULL;
 	}
 
+	DataStreamPtr stream;
+
 	if (!buffer)
 	{
-		// load the file
-		alGenBuffers(1, &audio_buffers[audio_buffers_in_use_count]);
-		if (loadWAVFile(filename, audio_buffers[audio_buffers_in_use_count]))
+		LOG("Loading WAV file "+filename);
+
+		// the header is small, only the samples are read in the background
+		ResourceGroupManager *rgm=ResourceGroupManager::getSingletonPtr();
+		try
+		{
+			String group=rgm->findGroupContainingResource(filename);
+			stream=rgm->openResource(filename, group);
+		} catch (Ogre::Exception &e)
+		{
+			LOG("Could not open file "+filename+": "+e.getFullDescription());
+			return NULL;
+		}
+
+		buffer = new audio_buffer_t();
+		buffer->file_name   = filename;
+		buffer->state       = BUFFER_LOADING;
+		buffer->refcount    = 0;
+		buffer->buffer      = 0;
+
+		if (readWAVHeader(filename, stream, buffer))
 		{
 			// there was an error!
-			alDeleteBuffers(1, &audio_buffers[audio_buffers_in_use_count]);
-			audio_buffer_file_name[audio_buffers_in_use_count] = "";
+			delete buffer;
 			return NULL;
 		}
-		buffer = audio_buffers[audio_buffers_in_use_count];
-		audio_buffer_file_name[audio_buffers_in_use_count] = filename;
+
+		buffer->streamed = buffer->data_size > STREAM_THRESHOLD;
+		audio_buffers[filename] = buffer;
+
+		// zip streams share the file of their archive with the main thread, they can't be read anywhere else
+		bool thread_safe = isThreadSafeStream(stream);
+
+		if (buffer->streamed)
+		{
+			if (!thread_safe)
+			{
+				// read the file once, every voice streams from this copy
+				stream->seek(0);
+				buffer->file_data.resize(stream->size());
+				if (buffer->file_data.empty() || stream->read(&buffer->file_data[0], buffer->file_data.size()) != buffer->file_data.size())
+				{
+					LOG("Could not read file "+filename);
+					buffer->file_data.clear();
+					buffer->state = BUFFER_FAILED;
+					return NULL;
+				}
+				resident_bytes += buffer->file_data.size();
+			}
+			// nothing to decode, every voice reads the file on its own
+			buffer->state = BUFFER_READY;
+			LOG("SoundManager: streaming "+filename+" ("+TOSTRING(buffer->data_size / 1024)+" KB)");
+		} else if (gEnv->threadPool && thread_safe)
+		{
+			DecodeTask *task = new DecodeTask();
+			task->sound_manager = this;
+			task->buffer        = buffer;
+			task->stream        = stream;
+			// the stream is owned by the task from now on, its reference count is not thread safe
+			stream.setNull();
+
+			MUTEX_LOCK(&decode_mutex);
+			pending_decodes++;
+			MUTEX_UNLOCK(&decode_mutex);
+
+			gEnv->threadPool->enqueue(task);
+		} else
+		{
+			readSamples(stream, buffer);
+			uploadBuffer(buffer);
+			if (buffer->state == BUFFER_FAILED) return NULL;
+		}
 	}
 
-	audio_sources[audio_buffers_in_use_count] = new Sound(buffer, this, audio_buffers_in_use_count);
+	Sound *s = addSource(buffer);
 
-	return audio_sources[audio_buffers_in_use_count++];
+	if (buffer->streamed)
+	{
+		// every sound needs its own read position, so it gets its own stream
+		if (!buffer->file_data.empty())
+		{
+			stream = DataStreamPtr(OGRE_NEW MemoryDataStream(&buffer->file_data[0], buffer->file_data.size(), false, true));
+		} else if (stream.isNull())
+		{
+			ResourceGroupManager *rgm=ResourceGroupManager::getSingletonPtr();
+			stream=rgm->openResource(filename, rgm->findGroupContainingResource(filename));
+		}
+		s->stream = stream;
+	}
+
+	return s;
 }
 
-bool SoundManager::loadWAVFile(String filename, ALuint buffer)
+Sound* SoundManager::addSource(audio_buffer_t *buffer)
 {
-	if (!audio_device) return true;
-	LOG("Loading WAV file "+filename);
+	int source_index = 0;
+	if (!free_source_indices.empty())
+	{
+		source_index = free_source_indices.back();
+		free_source_indices.pop_back();
+	} else
+	{
+		source_index = audio_sources_in_use_count++;
+	}
 
-	// create the Stream
-	ResourceGroupManager *rgm=ResourceGroupManager::getSingletonPtr();
-	String group=rgm->findGroupContainingResource(filename);
-	DataStreamPtr stream=rgm->openResource(filename, group);
+	audio_sources[source_index] = new Sound(buffer, this, source_index);
+	if (buffer) buffer->refcount++;
 
+	// new sources start at the origin
+	audio_sources[source_index]->bucket = getBucketKey(Vector3::ZERO);
+	source_buckets[audio_sources[source_index]->bucket].push_back(source_index);
+
+	return audio_sources[source_index];
+}
+
+void SoundManager::destroySound(Sound *s)
+{
+	if (!s) return;
+
+	int source_index = s->source_index;
+	retire(source_index);
+
+	std::vector<int> &bucket = source_buckets[s->bucket];
+	std::vector<int>::iterator it = std::find(bucket.begin(), bucket.end(), source_index);
+	if (it != bucket.end())
+	{
+		*it = bucket.back();
+		bucket.pop_back();
+	}
+	if (bucket.empty())
+	{
+		source_buckets.erase(s->bucket);
+	}
+
+	audio_sources[source_index] = NULL;
+	free_source_indices.push_back(source_index);
+
+	releaseBuffer(s->buffer);
+	delete s;
+}
+
+void SoundManager::releaseBuffer(audio_buffer_t *buffer)
+{
+	if (!buffer) return;
+
+	buffer->refcount--;
+	if (buffer->refcount > 0) return;
+
+	// still being decoded, uploadDecodedBuffers() frees it
+	if (buffer->state == BUFFER_LOADING) return;
+
+	freeBuffer(buffer);
+}
+
+void SoundManager::freeBuffer(audio_buffer_t *buffer)
+{
+	if (buffer->buffer)
+	{
+		alDeleteBuffers(1, &buffer->buffer);
+		resident_bytes -= buffer->data_size;
+	}
+	resident_bytes -= buffer->file_data.size();
+	audio_buffers.erase(buffer->file_name);
+	delete buffer;
+}
+
+bool SoundManager::isThreadSafeStream(DataStreamPtr &stream)
+{
+	// these have their own file handle or no file at all
+	DataStream *s = stream.getPointer();
+	return dynamic_cast<FileStreamDataStream *>(s) || dynamic_cast<FileHandleDataStream *>(s) || dynamic_cast<MemoryDataStream *>(s);
+}
+
+void SoundManager::DecodeTask::run()
+{
+	SoundManager::readSamples(stream, buffer);
+	stream.setNull();
+}
+
+void SoundManager::DecodeTask::onComplete()
+{
+	sound_manager->decodeCompleted(buffer);
+	delete this;
+}
+
+void SoundManager::readSamples(DataStreamPtr stream, audio_buffer_t *buffer)
+{
+	buffer->samples.resize(buffer->data_size);
+	if (buffer->data_size == 0 || stream->read(&buffer->samples[0], buffer->data_size) != buffer->data_size)
+	{
+		// uploadBuffer() reports the error
+		buffer->samples.clear();
+	}
+}
+
+void SoundManager::decodeCompleted(audio_buffer_t *buffer)
+{
+	MUTEX_LOCK(&decode_mutex);
+	decoded_buffers.push_back(buffer);
+	pending_decodes--;
+	MUTEX_UNLOCK(&decode_mutex);
+}
+
+void SoundManager::uploadDecodedBuffers()
+{
+	MUTEX_LOCK(&decode_mutex);
+	upload_buffers.swap(decoded_buffers);
+	MUTEX_UNLOCK(&decode_mutex);
+
+	for (size_t i=0; i < upload_buffers.size(); i++)
+	{
+		audio_buffer_t *buffer = upload_buffers[i];
+
+		uploadBuffer(buffer);
+
+		if (buffer->refcount == 0)
+		{
+			// all its sounds were destroyed while it was decoded
+			freeBuffer(buffer);
+		}
+	}
+	upload_buffers.clear();
+}
+
+void SoundManager::uploadBuffer(audio_buffer_t *buffer)
+{
+	if (buffer->samples.empty())
+	{
+		LOG("Could not read file "+buffer->file_name);
+		buffer->state = BUFFER_FAILED;
+		return;
+	}
+
+	alGetError(); // Reset errors
+	alGenBuffers(1, &buffer->buffer);
+	alBufferData(buffer->buffer, buffer->format, &buffer->samples[0], (ALsizei)buffer->data_size, buffer->freq);
+	ALint error=alGetError();
+
+	// the samples live in OpenAL now
+	std::vector<char>().swap(buffer->samples);
+
+	if (error != AL_NO_ERROR)
+	{
+		LOG("OpenAL error while loading buffer for "+buffer->file_name+" : "+TOSTRING(error));
+		alDeleteBuffers(1, &buffer->buffer);
+		buffer->buffer = 0;
+		buffer->state = BUFFER_FAILED;
+		return;
+	}
+
+	buffer->state = BUFFER_READY;
+	resident_bytes += buffer->data_size;
+}
+
+void SoundManager::startStream(int hardware_index)
+{
+	voice_stream_t &vs = voice_streams[hardware_index];
+	ALuint source = hardware_sources[hardware_index];
+
+	if (!vs.buffers[0])
+	{
+		alGenBuffers(STREAM_BUFFERS, vs.buffers);
+	}
+
+	// unqueue everything of the previous run
+	alSourceStop(source);
+	alSourcei(source, AL_BUFFER, 0);
+
+	vs.position    = 0;
+	vs.end_reached = false;
+	vs.active      = true;
+
+	for (int i=0; i < STREAM_BUFFERS; i++)
+	{
+		if (!fillStreamBuffer(hardware_index, vs.buffers[i])) break;
+		alSourceQueueBuffers(source, 1, &vs.buffers[i]);
+	}
+}
+
+void SoundManager::stopStream(int hardware_index)
+{
+	alSourceStop(hardware_sources[hardware_index]);
+	alSourcei(hardware_sources[hardware_index], AL_BUFFER, 0);
+	voice_streams[hardware_index].active = false;
+}
+
+bool SoundManager::fillStreamBuffer(int hardware_index, ALuint buffer)
+{
+	voice_stream_t &vs = voice_streams[hardware_index];
+	Sound *s = audio_sources[hardware_sources_map[hardware_index]];
+	audio_buffer_t *b = s->buffer;
+
+	if (vs.position >= b->data_size)
+	{
+		if (!s->loop)
+		{
+			vs.end_reached = true;
+			return false;
+		}
+		vs.position = 0;
+	}
+
+	size_t size = std::min((size_t)STREAM_CHUNK_SIZE, b->data_size - vs.position);
+	stream_chunk.resize(STREAM_CHUNK_SIZE);
+
+	s->stream->seek(b->data_offset + vs.position);
+	size = s->stream->read(&stream_chunk[0], size);
+	if (size == 0)
+	{
+		// truncated file
+		vs.end_reached = true;
+		return false;
+	}
+	vs.position += size;
+
+	alBufferData(buffer, b->format, &stream_chunk[0], (ALsizei)size, b->freq);
+	return true;
+}
+
+void SoundManager::updateStreams()
+{
+	for (int i=0; i < hardware_sources_num; i++)
+	{
+		voice_stream_t &vs = voice_streams[i];
+		if (!vs.active) continue;
+
+		ALuint source = hardware_sources[i];
+
+		// refill the buffers that were played
+		ALint processed = 0;
+		alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+		while (processed-- > 0)
+		{
+			ALuint buffer = 0;
+			alSourceUnqueueBuffers(source, 1, &buffer);
+			if (!vs.end_reached && fillStreamBuffer(i, buffer))
+			{
+				alSourceQueueBuffers(source, 1, &buffer);
+			}
+		}
+
+		// the source stops when it runs dry, keep it going
+		ALint state = 0, queued = 0;
+		alGetSourcei(source, AL_SOURCE_STATE, &state);
+		alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+		if (state != AL_PLAYING && queued > 0)
+		{
+			alSourcePlay(source);
+		} else if (queued == 0)
+		{
+			vs.active = false;
+		}
+	}
+}
+
+String SoundManager::getMemoryUsage()
+{
+	int streamed = 0;
+	for (std::map<String, audio_buffer_t*>::iterator it = audio_buffers.begin(); it != audio_buffers.end(); ++it)
+	{
+		if (it->second->streamed) streamed++;
+	}
+
+	int streams = 0;
+	for (int i=0; i < hardware_sources_num; i++)
+	{
+		if (voice_streams[i].active) streams++;
+	}
+
+	int sources = audio_sources_in_use_count - (int)free_source_indices.size();
+	size_t streaming_bytes = streams * STREAM_BUFFERS * STREAM_CHUNK_SIZE;
+
+	return TOSTRING(audio_buffers.size()) + " buffers (" + TOSTRING(streamed) + " streamed), "
+		+ TOSTRING(sources) + " sources, "
+		+ TOSTRING(resident_bytes / 1024) + " KB resident, "
+		+ TOSTRING(streaming_bytes / 1024) + " KB in " + TOSTRING(streams) + " streams";
+}
+
+bool SoundManager::readWAVHeader(String filename, DataStreamPtr stream, audio_buffer_t *buffer)
+{
 	// load RIFF/WAVE
 	char magic[5];
 	magic[4]=0;
@@ -438,21 +1068,10 @@ bool SoundManager::loadWAVFile(String filename, ALuint buffer)
 
 	if (channels != 1) LOG("Invalid WAV file: the file needs to be mono, and nothing else. Will try to continue anyways ...");
 
-	// ok, creating buffer
-	void* bdata=malloc(dataSize);
-	if (!bdata) {LOG("Memory error reading file "+filename);return true;}
-	if (stream->read(bdata, dataSize) != dataSize) {LOG("Could not read file "+filename); free(bdata); return true;}
-
-	//LOG("alBufferData: format "+TOSTRING(format)+" size "+TOSTRING(dataSize)+" freq "+TOSTRING(freq));
-	alGetError(); // Reset errors
-	ALint error;
-	alBufferData(buffer, format, bdata, dataSize, freq);
-	error=alGetError();
-
-	free(bdata);
-	// stream will be closed by itself
-
-	if (error != AL_NO_ERROR) {LOG("OpenAL error while loading buffer for "+filename+" : "+TOSTRING(error));return true;}
+	buffer->format      = format;
+	buffer->freq        = freq;
+	buffer->data_offset = stream->tell();
+	buffer->data_size   = dataSize;
 
 	return false;
 }
@@ -23,9 +23,12 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "IThreadTask.h"
+
 #include "Ogre.h"
 #include <AL/al.h>
 #include <AL/alc.h>
+#include <pthread.h>
 
 class SoundManager : public ZeroedMemoryAllocator
 {
@@ -35,32 +38,151 @@ public:
     SoundManager();
 	~SoundManager();
 
+	/**
+	* Creates a sound source playing the given WAV resource. The samples are shared by all sounds of the same file;
+	* new files are decoded in the background and the sound stays silent until they are ready.
+	*/
 	Sound* createSound(Ogre::String filename);
 
+	/**
+	* Stops and deletes the sound, its samples are freed when no other sound uses them.
+	*/
+	void destroySound(Sound* s);
+
 	void setCamera(Ogre::Vector3 position, Ogre::Vector3 direction, Ogre::Vector3 up, Ogre::Vector3 velocity);
 	void pauseAllSounds();
 	void resumeAllSounds();
 	void setMasterVolume(float v);
 
-	bool isDisabled() { return audio_device == 0; }
+	/**
+	* Uploads the decoded buffers, refills the streams and runs the voice allocation pass at VOICE_ALLOCATION_RATE;
+	* call regularly from the audio thread.
+	*/
+	void update(float dt);
+
+	bool isDisabled() { return audio_device == 0 && !null_backend; }
+
+	/**
+	* Headless mode (AudioDevice=null): all source management runs, but nothing is sent to OpenAL.
+	* One-shot sounds count as finished right after they were started.
+	*/
+	bool isNullBackend() { return null_backend; }
 
 	int getNumHardwareSources() { return hardware_sources_num; }
 
+	/**
+	* Human readable summary of the buffer cache: number of buffers and sources, resident and streaming memory.
+	*/
+	Ogre::String getMemoryUsage();
+
 	static const float MAX_DISTANCE;
 	static const float ROLLOFF_FACTOR;
 	static const float REFERENCE_DISTANCE;
 	static const unsigned int MAX_HARDWARE_SOURCES = 32;
 	static const unsigned int MAX_AUDIO_BUFFERS = 8192;
+	static const float VOICE_ALLOCATION_RATE;  //!< voice allocation passes per second
+	static const float VOICE_STEAL_HYSTERESIS; //!< a source needs to be this much more audible than the faintest voice to take it over
+	static const float BUCKET_SIZE;            //!< edge length of the spatial source buckets
+	static const size_t STREAM_THRESHOLD = 1024 * 1024; //!< samples larger than this are streamed instead of loaded at once
+	static const size_t STREAM_CHUNK_SIZE = 64 * 1024;  //!< size of each queued streaming buffer
+	static const int STREAM_BUFFERS = 4;                //!< queued buffers per streaming voice
+
+	enum BufferState { BUFFER_LOADING, BUFFER_READY, BUFFER_FAILED };
+
+	/**
+	* Samples of one WAV file, shared by all sounds playing it.
+	*/
+	struct audio_buffer_t
+	{
+		Ogre::String file_name;
+		int    state;           //!< BufferState
+		int    refcount;        //!< number of sounds using it
+		bool   streamed;        //!< too large to keep resident, every voice streams it from the file
+		ALuint buffer;          //!< AL buffer of resident samples
+		ALenum format;
+		ALsizei freq;
+		size_t data_offset;     //!< position of the samples in the file
+		size_t data_size;
+		std::vector<char> file_data; //!< whole file of a streamed buffer from a zip archive, see isThreadSafeStream()
+		std::vector<char> samples; //!< decoded samples waiting for the upload by the audio thread
+	};
 
 private:
-	void recomputeAllSources();
+
+	/**
+	* Threading; reads the samples of a new buffer on a worker thread, they are uploaded to OpenAL by update().
+	*/
+	class DecodeTask : public IThreadTask
+	{
+	public:
+		SoundManager* sound_manager;
+		audio_buffer_t* buffer;
+		Ogre::DataStreamPtr stream; //!< opened by the main thread, the resource group manager is not thread safe; see isThreadSafeStream()
+
+		void run();
+		void onComplete();
+	};
+
+	// state of a voice playing a streamed buffer
+	struct voice_stream_t
+	{
+		ALuint buffers[STREAM_BUFFERS];
+		size_t position;        //!< read position within the samples
+		bool   active;
+		bool   end_reached;     //!< all samples of a not looped sound are queued
+	};
+
+	/**
+	* Parses the RIFF/WAVE header and fills in format, frequency and the position of the samples.
+	* @return true on error
+	*/
+	bool readWAVHeader(Ogre::String filename, Ogre::DataStreamPtr stream, audio_buffer_t* buffer);
+	static void readSamples(Ogre::DataStreamPtr stream, audio_buffer_t* buffer);
+	/**
+	* Only streams with their own file handle may be read by the audio thread or by workers.
+	* Ogre is built without thread support, so zip streams must be read by the main thread.
+	*/
+	static bool isThreadSafeStream(Ogre::DataStreamPtr &stream);
+	void decodeCompleted(audio_buffer_t* buffer);
+	void uploadDecodedBuffers();
+	void uploadBuffer(audio_buffer_t* buffer);
+	void releaseBuffer(audio_buffer_t* buffer);
+	void freeBuffer(audio_buffer_t* buffer);
+
+	void startStream(int hardware_index);
+	void stopStream(int hardware_index);
+	bool fillStreamBuffer(int hardware_index, ALuint buffer);
+	void updateStreams();
+
+	/**
+	* Voice allocation pass: recomputes the audibility of the sources near the camera, retires inaudible voices
+	* and hands free or stolen voices to the most audible waiting sources.
+	*/
+	void updateVoices();
 	void recomputeSource(int source_index, int reason, float vfl, Ogre::Vector3 *vvec);
 	ALuint getHardwareSource(int hardware_index) { return hardware_sources[hardware_index]; };
+	bool isHardwareSourcePlaying(int hardware_index);
 
 	void assign(int source_index, int hardware_index);
 	void retire(int source_index);
+	int getFreeHardwareSource();
 
-	bool loadWAVFile(Ogre::String filename, ALuint buffer);
+	// spatial buckets, sources in buckets out of MAX_DISTANCE are not looked at by updateVoices()
+	typedef std::pair<int, int> bucket_key_t;
+	bucket_key_t getBucketKey(Ogre::Vector3 pos);
+	void updateSourceBucket(int source_index);
+	float getBucketDistance(const bucket_key_t &key);
+
+	// min-heap of the active hardware sources, ordered by the audibility of their sources
+	void voiceHeapPush(int hardware_index);
+	void voiceHeapRemove(int hardware_index);
+	void voiceHeapUpdate(int hardware_index);
+	void voiceHeapSiftUp(int pos);
+	void voiceHeapSiftDown(int pos);
+	float getVoiceAudibility(int heap_pos);
+	void voiceHeapSwap(int a, int b);
+
+	Sound* addSource(audio_buffer_t* buffer);
 
 	// active audio sources (hardware sources)
 	int    hardware_sources_num;                       // total number of available hardware sources < MAX_HARDWARE_SOURCES
@@ -68,21 +190,40 @@ private:
 	int    hardware_sources_map[MAX_HARDWARE_SOURCES]; // stores the hardware index for each source. -1 = unmapped
 	ALuint hardware_sources[MAX_HARDWARE_SOURCES];     // this buffer contains valid AL handles up to m_hardware_sources_num
 
+	int    voice_heap[MAX_HARDWARE_SOURCES];       // hardware indices, the least audible one first
+	int    voice_heap_pos[MAX_HARDWARE_SOURCES];   // position of each hardware index in voice_heap
+	int    voice_heap_size;
+
+	voice_stream_t voice_streams[MAX_HARDWARE_SOURCES];
+	std::vector<char> stream_chunk;                // read buffer of fillStreamBuffer()
+
 	// audio sources
-	int    audio_sources_in_use_count;
+	int    audio_sources_in_use_count;             // highest used source index + 1
 	Sound* audio_sources[MAX_AUDIO_BUFFERS];
+	std::vector<int> free_source_indices;          // slots of destroyed sources, reused first
+	std::map<bucket_key_t, std::vector<int> > source_buckets;
 	// helper for calculating the most audible sources
-	std::pair<int, float> audio_sources_most_audible[MAX_AUDIO_BUFFERS];
+	std::vector< std::pair<int, float> > voice_candidates;
+	float  voice_allocation_timer;
 	
-	// audio buffers: Array of AL buffers and filenames
-	int          audio_buffers_in_use_count;
-	ALuint       audio_buffers[MAX_AUDIO_BUFFERS];
-	Ogre::String audio_buffer_file_name[MAX_AUDIO_BUFFERS];
+	// audio buffers by file name
+	std::map<Ogre::String, audio_buffer_t*> audio_buffers;
+	size_t resident_bytes;
+
+	// buffers decoded by the worker threads, waiting for the upload
+	pthread_mutex_t decode_mutex;
+	std::vector<audio_buffer_t*> decoded_buffers;
+	std::vector<audio_buffer_t*> upload_buffers;   // scratch buffer of uploadDecodedBuffers()
+	int pending_decodes;
 
 	Ogre::Vector3 camera_position;
 	ALCdevice*    audio_device;
 	ALCcontext*   sound_context;
 
+	// null backend state of the hardware sources
+	bool null_backend;
+	bool null_sources_playing[MAX_HARDWARE_SOURCES];
+
 	float master_volume;
 };
 
@@ -25,6 +25,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Settings.h"
 #include "Sound.h"
 #include "SoundManager.h"
+#include "Utils.h"
 
 // some gcc fixes
 #if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
@@ -44,6 +45,9 @@ SoundScriptManager::SoundScriptManager() :
 	, rolloff_factor(1.0f)
 	, reference_distance(7.5f)
 	, sound_manager(0)
+	, audio_thread_running(false)
+	, audio_thread_stop(false)
+	, dropped_commands(0)
 {
 	for (int i=0; i < SS_MAX_TRIG; i++)
 	{
@@ -71,6 +75,11 @@ SoundScriptManager::SoundScriptManager() :
 	// reset all states
 	state_map.clear();
 
+	pthread_mutex_init(&state_mutex, NULL);
+	pthread_mutex_init(&audio_mutex, NULL);
+	pthread_mutex_init(&queues_mutex, NULL);
+	pthread_key_create(&queue_key, NULL);
+
 	sound_manager = new SoundManager();
 
 	if (!sound_manager)
@@ -90,6 +99,267 @@ SoundScriptManager::SoundScriptManager() :
 	LOG("SoundScriptManager: Sound Manager started with " + TOSTRING(sound_manager->getNumHardwareSources())+" sources");
 	script_patterns.push_back("*.soundscript");
 	ResourceGroupManager::getSingleton()._registerScriptLoader(this);
+
+	if (pthread_create(&audio_thread, NULL, audioThreadEntry, this))
+	{
+		LOG("SoundScriptManager: Can not start the audio thread, sound is disabled");
+		disabled = true;
+		return;
+	}
+	audio_thread_running = true;
+}
+
+SoundScriptManager::~SoundScriptManager()
+{
+	if (audio_thread_running)
+	{
+		audio_thread_stop = true;
+		pthread_join(audio_thread, NULL);
+		audio_thread_running = false;
+	}
+
+	for (size_t i=0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+	queues.clear();
+
+	if (dropped_commands.load())
+	{
+		LOG("SoundScriptManager: " + TOSTRING(dropped_commands.load()) + " sound commands dropped due to full queues");
+	}
+
+	delete sound_manager;
+	sound_manager = 0;
+
+	pthread_key_delete(queue_key);
+	pthread_mutex_destroy(&queues_mutex);
+	pthread_mutex_destroy(&audio_mutex);
+	pthread_mutex_destroy(&state_mutex);
+}
+
+void *SoundScriptManager::audioThreadEntry(void *arg)
+{
+	SoundScriptManager *ssm = static_cast<SoundScriptManager *>(arg);
+
+	while (!ssm->audio_thread_stop)
+	{
+		MUTEX_LOCK(&ssm->audio_mutex);
+		ssm->processCommands();
+		ssm->sound_manager->update(AUDIO_TICK_MS / 1000.0f);
+		MUTEX_UNLOCK(&ssm->audio_mutex);
+
+		sleepMilliSeconds(AUDIO_TICK_MS);
+	}
+
+	return NULL;
+}
+
+SoundScriptManager::command_queue_t *SoundScriptManager::getThreadQueue()
+{
+	command_queue_t *queue = static_cast<command_queue_t *>(pthread_getspecific(queue_key));
+	if (!queue)
+	{
+		// first command from this thread
+		queue = new command_queue_t();
+		MUTEX_LOCK(&queues_mutex);
+		queues.push_back(queue);
+		MUTEX_UNLOCK(&queues_mutex);
+		pthread_setspecific(queue_key, queue);
+	}
+	return queue;
+}
+
+SoundScriptManager::sound_command_t SoundScriptManager::makeCommand(int type, int truck, int id, int linkType, int linkItemID)
+{
+	sound_command_t cmd;
+	cmd.type         = type;
+	cmd.truck        = truck;
+	cmd.id           = id;
+	cmd.link_type    = linkType;
+	cmd.link_item_id = linkItemID;
+	cmd.value        = 0.0f;
+	cmd.instance     = NULL;
+	return cmd;
+}
+
+void SoundScriptManager::queueCommand(const sound_command_t &cmd)
+{
+	command_queue_t *queue = getThreadQueue();
+
+	if (cmd.type == CMD_MODULATE || cmd.type == CMD_POSITION || cmd.type == CMD_CAMERA)
+	{
+		// superseded by the next update anyway, so just drop it
+		if (!queue->push(cmd))
+		{
+			dropped_commands.fetch_add(1, std::memory_order_relaxed);
+		}
+		return;
+	}
+
+	// the others change the state of the sounds, wait for the audio thread to make room
+	while (!queue->push(cmd) && audio_thread_running)
+	{
+		sleepMilliSeconds(1);
+	}
+}
+
+void SoundScriptManager::processCommands()
+{
+	commands.clear();
+
+	sound_command_t cmd;
+	MUTEX_LOCK(&queues_mutex);
+	for (size_t q=0; q < queues.size(); q++)
+	{
+		while (queues[q]->pop(cmd))
+		{
+			commands.push_back(cmd);
+		}
+	}
+	MUTEX_UNLOCK(&queues_mutex);
+
+	// find the last position, modulation and camera change per target
+	last_commands.clear();
+	for (size_t i=0; i < commands.size(); i++)
+	{
+		const sound_command_t &c = commands[i];
+		if (c.type == CMD_MODULATE || c.type == CMD_POSITION || c.type == CMD_CAMERA)
+		{
+			last_commands[command_key_t(c.type, c.truck, c.id, c.link_type, c.link_item_id, c.instance)] = i;
+		}
+	}
+
+	for (size_t i=0; i < commands.size(); i++)
+	{
+		const sound_command_t &c = commands[i];
+		if (c.type == CMD_MODULATE || c.type == CMD_POSITION || c.type == CMD_CAMERA)
+		{
+			if (last_commands[command_key_t(c.type, c.truck, c.id, c.link_type, c.link_item_id, c.instance)] != i) continue;
+		}
+		if (c.type == CMD_INSTANCE_DESTROY) continue;
+		executeCommand(c);
+	}
+
+	// other threads may have queued commands for these instances before they were destroyed
+	for (size_t i=0; i < commands.size(); i++)
+	{
+		if (commands[i].type == CMD_INSTANCE_DESTROY)
+		{
+			removeInstance(commands[i].instance);
+		}
+	}
+}
+
+void SoundScriptManager::removeFromGroup(SoundScriptInstance **group, int *free_count, int source, int stride, SoundScriptInstance *inst)
+{
+	for (int i=0; i < free_count[source]; i++)
+	{
+		if (group[source + i * stride] == inst)
+		{
+			// move the last instance of the group into the gap
+			free_count[source]--;
+			group[source + i * stride] = group[source + free_count[source] * stride];
+			group[source + free_count[source] * stride] = 0;
+			return;
+		}
+	}
+}
+
+void SoundScriptManager::removeInstance(SoundScriptInstance *inst)
+{
+	SoundScriptTemplate *templ = inst->templ;
+
+	removeFromGroup(trigs, free_trigs, templ->trigger_source, SS_MAX_TRIG, inst);
+	if (templ->gain_source != SS_MOD_NONE)
+	{
+		removeFromGroup(gains, free_gains, templ->gain_source, SS_MAX_MOD, inst);
+	}
+	if (templ->pitch_source != SS_MOD_NONE)
+	{
+		removeFromGroup(pitches, free_pitches, templ->pitch_source, SS_MAX_MOD, inst);
+	}
+
+	delete inst;
+}
+
+void SoundScriptManager::executeCommand(const sound_command_t &cmd)
+{
+	switch (cmd.type)
+	{
+	case CMD_TRIG_ONCE:
+	case CMD_TRIG_START:
+	case CMD_TRIG_STOP:
+		for (int i=0; i < free_trigs[cmd.id]; i++)
+		{
+			// cycle through all instance groups
+			SoundScriptInstance* inst = trigs[cmd.id + i * SS_MAX_TRIG];
+
+			if (inst && inst->truck == cmd.truck && inst->sound_link_type == cmd.link_type && inst->sound_link_item_id == cmd.link_item_id)
+			{
+				if (cmd.type == CMD_TRIG_ONCE)
+					inst->runOnce();
+				else if (cmd.type == CMD_TRIG_START)
+					inst->start();
+				else
+					inst->stop();
+			}
+		}
+		break;
+
+	case CMD_MODULATE:
+		for (int i=0; i < free_gains[cmd.id]; i++)
+		{
+			SoundScriptInstance* inst = gains[cmd.id + i * SS_MAX_MOD];
+			if (inst && inst->truck == cmd.truck && inst->sound_link_type == cmd.link_type && inst->sound_link_item_id == cmd.link_item_id)
+			{
+				// this one requires modulation
+				float gain = cmd.value*cmd.value*inst->templ->gain_square+cmd.value*inst->templ->gain_multiplier+inst->templ->gain_offset;
+				gain = std::max(0.0f, gain);
+				gain = std::min(gain, 1.0f);
+				inst->setGain(gain);
+			}
+		}
+
+		for (int i=0; i < free_pitches[cmd.id]; i++)
+		{
+			SoundScriptInstance* inst = pitches[cmd.id + i * SS_MAX_MOD];
+			if (inst && inst->truck == cmd.truck && inst->sound_link_type == cmd.link_type && inst->sound_link_item_id == cmd.link_item_id)
+			{
+				// this one requires modulation
+				float pitch = cmd.value*cmd.value*inst->templ->pitch_square+cmd.value*inst->templ->pitch_multiplier+inst->templ->pitch_offset;
+				pitch = std::max(0.0f, pitch);
+				inst->setPitch(pitch);
+			}
+		}
+		break;
+
+	case CMD_POSITION:
+		cmd.instance->setPosition(cmd.vec[0], cmd.vec[1]);
+		break;
+
+	case CMD_CAMERA:
+		sound_manager->setCamera(cmd.vec[0], cmd.vec[1], cmd.vec[2], cmd.vec[3]);
+		break;
+
+	case CMD_INSTANCE_ENABLE:
+		cmd.instance->setEnabled(cmd.value > 0.5f);
+		break;
+
+	case CMD_INSTANCE_START:
+		cmd.instance->start();
+		break;
+
+	case CMD_ENABLE:
+		if (cmd.value > 0.5f)
+			sound_manager->resumeAllSounds();
+		else
+			sound_manager->pauseAllSounds();
+		break;
+
+	default:
+		break;
+	}
 }
 
 void SoundScriptManager::trigOnce(Beam *truck, int trig, int linkType, int linkItemID)
@@ -106,16 +376,7 @@ void SoundScriptManager::trigOnce(int truck, int trig, int linkType, int linkIte
 {
 	if (disabled) return;
 
-	for (int i=0; i < free_trigs[trig]; i++)
-	{
-		// cycle through all instance groups
-		SoundScriptInstance* inst = trigs[trig+i*SS_MAX_TRIG];
-
-		if (inst && inst->truck == truck && inst->sound_link_type == linkType && inst->sound_link_item_id == linkItemID)
-		{
-			inst->runOnce();
-		}
-	}
+	queueCommand(makeCommand(CMD_TRIG_ONCE, truck, trig, linkType, linkItemID));
 }
 
 void SoundScriptManager::trigStart(Beam *truck, int trig, int linkType, int linkItemID)
@@ -131,18 +392,17 @@ void SoundScriptManager::trigStart(Beam *truck, int trig, int linkType, int link
 void SoundScriptManager::trigStart(int truck, int trig, int linkType, int linkItemID)
 {
 	if (disabled) return;
-	if (getTrigState(truck, trig, linkType, linkItemID)) return;
 
-	state_map[linkType][linkItemID][truck][trig] = true;
+	// only state changes are queued
+	MUTEX_LOCK(&state_mutex);
+	bool &state = state_map[linkType][linkItemID][truck][trig];
+	bool changed = !state;
+	state = true;
+	MUTEX_UNLOCK(&state_mutex);
 
-	for (int i=0; i < free_trigs[trig]; i++)
+	if (changed)
 	{
-		SoundScriptInstance* inst = trigs[trig+i*SS_MAX_TRIG];
-
-		if (inst && inst->truck == truck && inst->sound_link_type == linkType && inst->sound_link_item_id == linkItemID)
-		{
-			inst->start();
-		}
+		queueCommand(makeCommand(CMD_TRIG_START, truck, trig, linkType, linkItemID));
 	}
 }
 
@@ -159,18 +419,17 @@ void SoundScriptManager::trigStop(Beam *truck, int trig, int linkType, int linkI
 void SoundScriptManager::trigStop(int truck, int trig, int linkType, int linkItemID)
 {
 	if (disabled) return;
-	if (!getTrigState(truck, trig, linkType, linkItemID)) return;
-	
-	state_map[linkType][linkItemID][truck][trig] = false;
 
-	for (int i=0; i < free_trigs[trig]; i++)
-	{
-		SoundScriptInstance* inst = trigs[trig+i*SS_MAX_TRIG];
+	// only state changes are queued
+	MUTEX_LOCK(&state_mutex);
+	bool &state = state_map[linkType][linkItemID][truck][trig];
+	bool changed = state;
+	state = false;
+	MUTEX_UNLOCK(&state_mutex);
 
-		if (inst && inst->truck == truck && inst->sound_link_type == linkType && inst->sound_link_item_id == linkItemID)
-		{
-			inst->stop();
-		}
+	if (changed)
+	{
+		queueCommand(makeCommand(CMD_TRIG_STOP, truck, trig, linkType, linkItemID));
 	}
 }
 
@@ -208,7 +467,11 @@ bool SoundScriptManager::getTrigState(int truck, int trig, int linkType, int lin
 {
 	if (disabled) return false;
 
-	return state_map[linkType][linkItemID][truck][trig];
+	MUTEX_LOCK(&state_mutex);
+	bool state = state_map[linkType][linkItemID][truck][trig];
+	MUTEX_UNLOCK(&state_mutex);
+
+	return state;
 }
 
 void SoundScriptManager::modulate(Beam *truck, int mod, float value, int linkType, int linkItemID)
@@ -227,36 +490,74 @@ void SoundScriptManager::modulate(int truck, int mod, float value, int linkType,
 
 	if (mod >= SS_MAX_MOD) return;
 
-	for (int i=0; i < free_gains[mod]; i++)
-	{
-		SoundScriptInstance* inst = gains[mod + i * SS_MAX_MOD];
-		if (inst && inst->truck == truck && inst->sound_link_type == linkType && inst->sound_link_item_id == linkItemID)
-		{
-			// this one requires modulation
-			float gain=value*value*inst->templ->gain_square+value*inst->templ->gain_multiplier+inst->templ->gain_offset;
-			gain = std::max(0.0f, gain);
-			gain = std::min(gain, 1.0f);
-			inst->setGain(gain);
-		}
-	}
+	// nothing listens to this source
+	if (!free_gains[mod] && !free_pitches[mod]) return;
 
-	for (int i=0; i < free_pitches[mod]; i++)
-	{
-		SoundScriptInstance* inst = pitches[mod + i * SS_MAX_MOD];
-		if (inst && inst->truck == truck && inst->sound_link_type == linkType && inst->sound_link_item_id == linkItemID)
-		{
-			// this one requires modulation
-			float pitch=value*value*inst->templ->pitch_square+value*inst->templ->pitch_multiplier+inst->templ->pitch_offset;
-			pitch = std::max(0.0f, pitch);
-			inst->setPitch(pitch);
-		}
-	}
+	sound_command_t cmd = makeCommand(CMD_MODULATE, truck, mod, linkType, linkItemID);
+	cmd.value = value;
+	queueCommand(cmd);
+}
+
+void SoundScriptManager::setPosition(SoundScriptInstance *inst, Vector3 pos, Vector3 velocity)
+{
+	if (disabled || !inst) return;
+
+	sound_command_t cmd = makeCommand(CMD_POSITION, inst->truck, 0, inst->sound_link_type, inst->sound_link_item_id);
+	cmd.instance = inst;
+	cmd.vec[0]   = pos;
+	cmd.vec[1]   = velocity;
+	queueCommand(cmd);
+}
+
+void SoundScriptManager::setEnabled(SoundScriptInstance *inst, bool state)
+{
+	if (disabled || !inst) return;
+
+	sound_command_t cmd = makeCommand(CMD_INSTANCE_ENABLE, inst->truck, 0, inst->sound_link_type, inst->sound_link_item_id);
+	cmd.instance = inst;
+	cmd.value    = state ? 1.0f : 0.0f;
+	queueCommand(cmd);
+}
+
+void SoundScriptManager::start(SoundScriptInstance *inst)
+{
+	if (disabled || !inst) return;
+
+	sound_command_t cmd = makeCommand(CMD_INSTANCE_START, inst->truck, 0, inst->sound_link_type, inst->sound_link_item_id);
+	cmd.instance = inst;
+	queueCommand(cmd);
+}
+
+void SoundScriptManager::destroyInstance(SoundScriptInstance *inst)
+{
+	if (disabled || !inst) return;
+
+	sound_command_t cmd = makeCommand(CMD_INSTANCE_DESTROY, inst->truck, 0, inst->sound_link_type, inst->sound_link_item_id);
+	cmd.instance = inst;
+	queueCommand(cmd);
+}
+
+String SoundScriptManager::getMemoryUsage()
+{
+	if (disabled) return "sound is disabled";
+
+	MUTEX_LOCK(&audio_mutex);
+	String result = sound_manager->getMemoryUsage();
+	MUTEX_UNLOCK(&audio_mutex);
+
+	return result;
 }
 
 void SoundScriptManager::setCamera(Vector3 position, Vector3 direction, Vector3 up, Vector3 velocity)
 {
 	if (disabled) return;
-	sound_manager->setCamera(position, direction, up, velocity);
+
+	sound_command_t cmd = makeCommand(CMD_CAMERA, -1, 0, SL_DEFAULT, -1);
+	cmd.vec[0] = position;
+	cmd.vec[1] = direction;
+	cmd.vec[2] = up;
+	cmd.vec[3] = velocity;
+	queueCommand(cmd);
 }
 
 const StringVector& SoundScriptManager::getScriptPatterns(void) const
@@ -349,6 +650,9 @@ SoundScriptInstance* SoundScriptManager::createInstance(Ogre::String templatenam
 		return NULL; // reached limit!
 	}
 
+	// keep the audio thread out while the sounds are created and the lookup tables change
+	MUTEX_LOCK(&audio_mutex);
+
 	SoundScriptInstance* inst = new SoundScriptInstance(truck, templ, sound_manager, templ->file_name+"-"+TOSTRING(truck)+"-"+TOSTRING(instance_counter), soundLinkType, soundLinkItemId);
 	instance_counter++;
 
@@ -373,6 +677,8 @@ SoundScriptInstance* SoundScriptManager::createInstance(Ogre::String templatenam
 		inst->start();
 	}
 
+	MUTEX_UNLOCK(&audio_mutex);
+
 	return inst;
 }
 
@@ -451,10 +757,11 @@ void SoundScriptManager::skipToNextOpenBrace(DataStreamPtr& stream)
 
 void SoundScriptManager::setEnabled(bool state)
 {
-	if (state)
-		sound_manager->resumeAllSounds();
-	else
-		sound_manager->pauseAllSounds();
+	if (disabled) return;
+
+	sound_command_t cmd = makeCommand(CMD_ENABLE, -1, 0, SL_DEFAULT, -1);
+	cmd.value = state ? 1.0f : 0.0f;
+	queueCommand(cmd);
 }
 
 //=====================================================================
@@ -718,6 +1025,16 @@ SoundScriptInstance::SoundScriptInstance(int truck, SoundScriptTemplate *templ,
 	LOG("SoundScriptInstance: instance created: "+instancename);
 }
 
+SoundScriptInstance::~SoundScriptInstance()
+{
+	sound_manager->destroySound(start_sound);
+	sound_manager->destroySound(stop_sound);
+	for (int i=0; i < templ->free_sound; i++)
+	{
+		sound_manager->destroySound(sounds[i]);
+	}
+}
+
 void SoundScriptInstance::setPitch(float value)
 {
 	if (start_sound)
@@ -23,9 +23,13 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "LockFreeRingBuffer.h"
 #include "Singleton.h"
 
 #include <OgreScriptLoader.h>
+#include <atomic>
+#include <pthread.h>
+#include <tuple>
 
 enum {
 	MAX_SOUNDS_PER_SCRIPT = 16,
@@ -198,6 +202,10 @@ private:
 	int          free_sound;
 };
 
+/**
+* A sound script bound to a truck. Its methods drive OpenAL and must only be called by the audio thread
+* (or with the audio mutex held); other threads go through the SoundScriptManager commands.
+*/
 class SoundScriptInstance : public ZeroedMemoryAllocator
 {
 	friend class SoundScriptManager;
@@ -206,6 +214,7 @@ class SoundScriptInstance : public ZeroedMemoryAllocator
 public:
 
 	SoundScriptInstance(int truck, SoundScriptTemplate* templ, SoundManager* sm, Ogre::String instancename, int soundLinkType=SL_DEFAULT, int soundLinkItemId=-1);
+	~SoundScriptInstance();
 	void runOnce();
 	void setEnabled(bool e);
 	void setGain(float value);
@@ -241,6 +250,7 @@ class SoundScriptManager : public Ogre::ScriptLoader, public RoRSingleton<SoundS
 public:
 
 	SoundScriptManager();
+	~SoundScriptManager();
 
 	// ScriptLoader interface
     const Ogre::StringVector& getScriptPatterns(void) const;
@@ -248,10 +258,15 @@ public:
     Ogre::Real getLoadingOrder(void) const;
 
 	SoundScriptInstance* createInstance(Ogre::String templatename, int truck, Ogre::SceneNode *toAttach=NULL, int soundLinkType=SL_DEFAULT, int soundLinkItemId=-1);
+
+	/**
+	* Queues the deletion of the instance; the pointer must not be used any more afterwards.
+	*/
+	void destroyInstance(SoundScriptInstance *inst);
 	void clearNonBaseTemplates();
 	void unloadResourceGroup(Ogre::String groupname);
 
-	// functions
+	// functions; they queue a command for the audio thread and can be called from any thread
 	void trigOnce    (int truck, int trig, int linkType = SL_DEFAULT, int linkItemID=-1);
 	void trigOnce    (Beam *b,   int trig, int linkType = SL_DEFAULT, int linkItemID=-1);
 	void trigStart   (int truck, int trig, int linkType = SL_DEFAULT, int linkItemID=-1);
@@ -266,14 +281,71 @@ public:
 	void modulate    (Beam *b,   int mod, float value, int linkType = SL_DEFAULT, int linkItemID=-1);
 
 	void setEnabled(bool state);
+	void setEnabled(SoundScriptInstance *inst, bool state);
+	void setPosition(SoundScriptInstance *inst, Ogre::Vector3 pos, Ogre::Vector3 velocity);
+	void start(SoundScriptInstance *inst);
 
 	void setCamera(Ogre::Vector3 position, Ogre::Vector3 direction, Ogre::Vector3 up, Ogre::Vector3 velocity);
 	void setLoadingBaseSounds(bool value) { loading_base = value; };
 
 	bool isDisabled() { return disabled; }
 
+	/**
+	* Summary of the decoded audio buffers and their memory, see SoundManager::getMemoryUsage()
+	*/
+	Ogre::String getMemoryUsage();
+
+	enum SoundCommands {
+		CMD_TRIG_ONCE,
+		CMD_TRIG_START,
+		CMD_TRIG_STOP,
+		CMD_MODULATE,
+		CMD_POSITION,
+		CMD_CAMERA,
+		CMD_INSTANCE_ENABLE,
+		CMD_INSTANCE_START,
+		CMD_INSTANCE_DESTROY,
+		CMD_ENABLE
+	};
+
+	/**
+	* Compact sound command record; pushed by any thread, executed by the audio thread.
+	*/
+	struct sound_command_t
+	{
+		int type;                      //!< SoundCommands
+		int truck;
+		int id;                        //!< trigger or modulation source
+		int link_type;
+		int link_item_id;
+		float value;                   //!< modulation value or enabled state
+		SoundScriptInstance *instance; //!< CMD_POSITION and CMD_INSTANCE_*
+		Ogre::Vector3 vec[4];          //!< CMD_POSITION: position, velocity; CMD_CAMERA: position, direction, up, velocity
+	};
+
 private:
 
+	static const size_t COMMAND_QUEUE_SIZE = 2048;
+	static const unsigned int AUDIO_TICK_MS = 10;
+
+	typedef LockFreeRingBuffer < sound_command_t, COMMAND_QUEUE_SIZE > command_queue_t;
+	typedef std::tuple < int, int, int, int, int, SoundScriptInstance* > command_key_t;
+
+	command_queue_t *getThreadQueue();
+	void queueCommand(const sound_command_t &cmd);
+	sound_command_t makeCommand(int type, int truck, int id, int linkType, int linkItemID);
+
+	static void *audioThreadEntry(void *arg);
+
+	/**
+	* Audio thread; drains all command queues and executes them. Of several position, modulation or camera changes
+	* for the same target only the last one is executed. Instances are destroyed after all other commands.
+	*/
+	void processCommands();
+	void executeCommand(const sound_command_t &cmd);
+	void removeInstance(SoundScriptInstance *inst);
+	void removeFromGroup(SoundScriptInstance **group, int *free_count, int source, int stride, SoundScriptInstance *inst);
+
 	SoundScriptTemplate* createTemplate(Ogre::String name, Ogre::String groupname, Ogre::String filename);
 	void skipToNextCloseBrace(Ogre::DataStreamPtr& chunk);
 	void skipToNextOpenBrace(Ogre::DataStreamPtr& chunk);
@@ -301,8 +373,25 @@ private:
 	// state map
 	// soundLinks, soundItems, trucks, triggers
 	std::map <int, std::map <int, std::map <int, std::map <int, bool > > > > state_map;
+	pthread_mutex_t state_mutex;
 
 	SoundManager* sound_manager;
+
+	// audio thread, the only one talking to the SoundManager once started
+	pthread_t audio_thread;
+	bool audio_thread_running;
+	std::atomic<bool> audio_thread_stop;
+	pthread_mutex_t audio_mutex; //!< held by the audio thread while it works, and by the main thread while it creates instances
+
+	// one command queue per producing thread
+	pthread_key_t queue_key;
+	pthread_mutex_t queues_mutex;
+	std::vector < command_queue_t * > queues;
+	std::atomic<unsigned long> dropped_commands;
+
+	// scratch buffers of processCommands(), kept to avoid reallocation
+	std::vector < sound_command_t > commands;
+	std::map < command_key_t, size_t > last_commands;
 };
 
 #endif // __SoundScriptManager_H_
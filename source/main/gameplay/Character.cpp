@@ -51,7 +51,7 @@ Character::Character(int source, unsigned int streamid, int colourNumber, bool r
 	, mCamera(gEnv->mainCamera)
 	, mCharacterNode(0)
 	, mLastPosition(Vector3::ZERO)
-	, mMoveableText(0)
+	, mNetLabel(0)
 	, networkAuthLevel(0)
 	, networkUsername("")
 	, physicsEnabled(true)
@@ -97,9 +97,9 @@ Character::Character(int source, unsigned int streamid, int colourNumber, bool r
 Character::~Character()
 {
 	setVisible(false);
-	if (mMoveableText)
+	if (mNetLabel)
 	{
-		delete mMoveableText;
+		LabelBatcher::getSingleton().destroyLabel(mNetLabel);
 	}
 	if (mCharacterNode)
 	{
@@ -158,35 +158,19 @@ void Character::updateNetLabel()
 	}
 
 	//LOG(" * updateNetLabel : " + TOSTRING(this->source));
-	if (!mMoveableText)
+	if (!mNetLabel)
 	{
-		mMoveableText = new MovableText("netlabel-"+myName, networkUsername);
-		mCharacterNode->attachObject(mMoveableText);
-		mMoveableText->setFontName("CyberbitEnglish");
-		mMoveableText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-		mMoveableText->setAdditionalHeight(2);
-		mMoveableText->showOnTop(false);
-		mMoveableText->setCharacterHeight(8);
-		mMoveableText->setColor(ColourValue::Black);
+		// drawn together with all other labels by the LabelBatcher, positioned in updateNetLabelSize()
+		mNetLabel = LabelBatcher::getSingleton().createLabel(networkUsername, "CyberbitEnglish");
+		mNetLabel->setTextAlignment(BatchedLabel::H_CENTER, BatchedLabel::V_ABOVE);
+		mNetLabel->setScale(mCharacterNode->getScale().y);
+		mNetLabel->setCharacterHeight(8);
+		mNetLabel->setColor(ColourValue::Black);
+		mNetLabel->setPosition(mCharacterNode->getPosition() + Vector3(0.0f, 2.0f, 0.0f));
 	}
 
 	//LOG(" *label caption: " + String(networkUsername));
-	try
-	{
-		mMoveableText->setCaption(networkUsername);
-	} catch (...) {}
-	/*
-	if (networkAuthLevel & AUTH_ADMIN)
-	{
-		mMoveableText->setFontName("highcontrast_red");
-	} else if (networkAuthLevel & AUTH_RANKED)
-	{
-		mMoveableText->setFontName("highcontrast_green");
-	} else
-	{
-		mMoveableText->setFontName("highcontrast_black");
-	}
-	*/
+	mNetLabel->setCaption(networkUsername);
 
 	// update character colour
 	updateCharacterColour();
@@ -588,23 +572,25 @@ void Character::receiveStreamData(unsigned int &type, int &source, unsigned int
 
 void Character::updateNetLabelSize()
 {
-	if (!this || !gEnv->network || !mMoveableText) return;
+	if (!this || !gEnv->network || !mNetLabel) return;
+
+	mNetLabel->setVisible(getVisible());
 
-	mMoveableText->setVisible(getVisible());
+	if (!mNetLabel->isVisible()) return;
 
-	if (!mMoveableText->isVisible()) return; // why not getVisible()?
+	mNetLabel->setPosition(mCharacterNode->getPosition() + Vector3(0.0f, 2.0f, 0.0f));
 
 	float camDist = (mCharacterNode->getPosition() - mCamera->getPosition()).length();
 	float h = std::max(9.0f, camDist * 1.2f);
 
-	mMoveableText->setCharacterHeight(h);
+	mNetLabel->setCharacterHeight(h);
 
 	if (camDist > 1000.0f)
-		mMoveableText->setCaption(networkUsername + "  (" + TOSTRING((float)(ceil(camDist / 100) / 10.0f))+ " km)");
+		mNetLabel->setCaption(networkUsername + "  (" + TOSTRING((float)(ceil(camDist / 100) / 10.0f))+ " km)");
 	else if (camDist > 20.0f && camDist <= 1000.0f)
-		mMoveableText->setCaption(networkUsername + "  (" + TOSTRING((int)camDist)+ " m)");
+		mNetLabel->setCaption(networkUsername + "  (" + TOSTRING((int)camDist)+ " m)");
 	else
-		mMoveableText->setCaption(networkUsername);
+		mNetLabel->setCaption(networkUsername);
 }
 
 void Character::setBeamCoupling(bool enabled, Beam *truck /* = 0 */)
@@ -614,9 +600,9 @@ void Character::setBeamCoupling(bool enabled, Beam *truck /* = 0 */)
 		if (!truck) return;
 		beamCoupling = truck;
 		setPhysicsEnabled(false);
-		if (mMoveableText && mMoveableText->isVisible())
+		if (mNetLabel)
 		{
-			mMoveableText->setVisible(false);
+			mNetLabel->setVisible(false);
 		}
 		if (gEnv->network && !remote)
 		{
@@ -641,9 +627,9 @@ void Character::setBeamCoupling(bool enabled, Beam *truck /* = 0 */)
 	{
 		setPhysicsEnabled(true);
 		beamCoupling = 0;
-		if (mMoveableText && !mMoveableText->isVisible())
+		if (mNetLabel)
 		{
-			mMoveableText->setVisible(true);
+			mNetLabel->setVisible(true);
 		}
 		if (gEnv->network && !remote)
 		{
@@ -22,7 +22,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
-#include "MovableText.h"
+#include "LabelBatcher.h"
 #include "Streamable.h"
 
 class Character : public Streamable, public ZeroedMemoryAllocator
@@ -81,7 +81,7 @@ protected:
 
 	Ogre::AnimationStateSet *mAnimState;
 	Ogre::Camera *mCamera;
-	Ogre::MovableText *mMoveableText;
+	BatchedLabel *mNetLabel;
 	Ogre::SceneNode *mCharacterNode;
 	Ogre::String mLastAnimMode;
 	Ogre::String myName;
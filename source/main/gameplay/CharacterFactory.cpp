@@ -24,6 +24,9 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Character.h"
 
+#include <algorithm>
+#include <cfloat>
+
 using namespace Ogre;
 
 
@@ -136,3 +139,25 @@ void CharacterFactory::updateLabels()
 	}
 	unlockStreams();
 }
+
+float CharacterFactory::getRemoteDistance(Vector3 const &pos)
+{
+	float distance = FLT_MAX;
+
+	lockStreams();
+	std::map < int, std::map < unsigned int, Character *> > &streamables = getStreams();
+	std::map < int, std::map < unsigned int, Character *> >::iterator it1;
+	std::map < unsigned int, Character *>::iterator it2;
+
+	for (it1=streamables.begin(); it1!=streamables.end();it1++)
+	{
+		for (it2=it1->second.begin(); it2!=it1->second.end();it2++)
+		{
+			Character *c = dynamic_cast<Character*>(it2->second);
+			if (c && c->isRemote()) distance = std::min(distance, c->getPosition().distance(pos));
+		}
+	}
+	unlockStreams();
+
+	return distance;
+}
@@ -43,6 +43,9 @@ public:
 	void updateCharacters(float dt);
 	void updateLabels();
 
+	/// @return distance to the nearest remote character, FLT_MAX if there is none
+	float getRemoteDistance(Ogre::Vector3 const &pos);
+
 protected:
 
 	// functions used by friends
@@ -21,6 +21,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <Ogre.h>
 
+#include "Settings.h"
 #include "Utils.h"
 
 #ifdef USE_MYGUI
@@ -31,31 +32,57 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-Replay::Replay(Beam *b, int _numFrames)
+// shared by all replays, started with the first one
+static ReplayWriter *replayWriter = 0;
+static int replayWriterUsers = 0;
+
+Replay::Replay(Beam *b, int _numFrames) :
+	  encoder(b->getNodeCount(), b->getBeamCount())
+	, decoder(b->getNodeCount(), b->getBeamCount())
 {
 	numNodes = b->getNodeCount();
 	numBeams = b->getBeamCount();
-	numFrames = _numFrames;
+	numFrames = std::max(_numFrames, 1);
 
 	replayTimer = new Timer();
 
-	// DO NOT get memory here, get memory when we use it first time!
-	nodes = 0;
-	beams = 0;
-	times = 0;
+	curFrameTime = 0;
+	curOffset = 0;
 
-	outOfMemory = false;
+	writeNodes.resize(std::max(numNodes, 1));
+	writeBeams.resize(std::max(numBeams, 1));
+	writeTime = 0;
+	framesWritten = 0;
 
-	unsigned long bsize = (numNodes * numFrames * sizeof(node_simple_t) + numBeams * numFrames * sizeof(beam_simple_t) + numFrames * sizeof(unsigned long)) / 1024.0f;
-	LOG("replay buffer size: " + TOSTRING(bsize) + " kB");
+	toDisk = BSETTING("Replay to Disk", true);
+	curFile = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		fileNames[i] = SSETTING("Cache Path", "") + "replay_" + TOSTRING(b->trucknum) + "_" + TOSTRING(i) + ".rorreplay";
+		fileBytes[i] = 0;
+		fileFrames[i] = 0;
+		readFiles[i] = 0;
+	}
+	if (toDisk)
+	{
+		if (!replayWriter)
+			replayWriter = new ReplayWriter();
+		replayWriterUsers++;
+	}
 
-	writeIndex = 0;
-	firstRun = 1;
+	memoryBytes = 0;
+	bytesRecorded = 0;
+	statsBytes = 0;
+	statsTime = 0;
+	bytesPerSecond = 0.0f;
+
+	unsigned long bsize = (numNodes * numFrames * sizeof(node_simple_t) + numBeams * numFrames * sizeof(beam_simple_t) + numFrames * sizeof(unsigned long)) / 1024.0f;
+	LOG("replay buffer size: " + TOSTRING(bsize) + " kB uncompressed, " + (toDisk ? "recording to " + fileNames[0] : "recording to memory"));
 
 #ifdef USE_MYGUI
 	// windowing
 	int width = 300;
-	int height = 60;
+	int height = 80;
 	int x = (MyGUI::RenderManager::getInstance().getViewSize().width - width) / 2;
 	int y = 0;
 
@@ -64,128 +91,260 @@ Replay::Replay(Beam *b, int _numFrames)
 	panel->setAlpha(0.6);
 
 	pr = panel->createWidget<MyGUI::Progress>("Progress", 10, 10, 280, 20,  MyGUI::Align::Default);
-	pr->setProgressRange(_numFrames);
+	pr->setProgressRange(numFrames);
 	pr->setProgressPosition(0);
 
 
 	txt = panel->createWidget<MyGUI::StaticText>("StaticText", 10, 30, 280, 20,  MyGUI::Align::Default);
 	txt->setCaption(_L("Position:"));
 
+	stats = panel->createWidget<MyGUI::StaticText>("StaticText", 10, 50, 280, 20,  MyGUI::Align::Default);
+	stats->setCaption("");
+
 	panel->setVisible(false);
 #endif // MYGUI
 }
 
 Replay::~Replay()
 {
-	if (nodes)
+	if (curChunk)
 	{
-		free(nodes); nodes=0;
-		free(beams); beams=0;
-		free(times); times=0;
+		finishChunk();
 	}
-	delete replayTimer;
-}
 
-void *Replay::getWriteBuffer(int type)
-{
-	if (outOfMemory) return 0;
-	if (!nodes)
+	for (int i = 0; i < 2; i++)
 	{
-		// get memory
-		nodes = (node_simple_t*)calloc(numNodes * numFrames, sizeof(node_simple_t));
-		if (!nodes)
-		{
-			outOfMemory=true;
-			return 0;
-		}
-		beams = (beam_simple_t*)calloc(numBeams * numFrames, sizeof(beam_simple_t));	
-		if (!beams)
+		if (readFiles[i])
 		{
-			free(nodes); nodes=0;
-			outOfMemory=true;
-			return 0;
+			fclose(readFiles[i]);
+			readFiles[i] = 0;
 		}
-		times = (unsigned long*)calloc(numFrames, sizeof(unsigned long));
-		if (!times)
+	}
+
+	if (toDisk)
+	{
+		replayWriter->close(fileNames[0]);
+		replayWriter->close(fileNames[1]);
+		if (--replayWriterUsers == 0)
 		{
-			free(nodes); nodes=0;
-			free(beams); beams=0;
-			outOfMemory=true;
-			return 0;
+			// waits for everything queued
+			delete replayWriter;
+			replayWriter = 0;
 		}
 	}
-	void *ptr = 0;
-	times[writeIndex] = replayTimer->getMicroseconds();
+	delete replayTimer;
+}
+
+void *Replay::getWriteBuffer(int type)
+{
+	writeTime = replayTimer->getMicroseconds();
 	if (type == 0)
 	{
 		// nodes
-		ptr = (void *)(nodes + (writeIndex * numNodes));
+		return (void *)&writeNodes[0];
 	}else if (type == 1)
 	{
 		// beams
-		ptr = (void *)(beams + (writeIndex * numBeams));
+		return (void *)&writeBeams[0];
 	}
-	return ptr;
+	return 0;
 }
 
 void Replay::writeDone()
 {
-	if (outOfMemory) return;
-	writeIndex++;
-	if (writeIndex == numFrames)
+	if (!curChunk)
+	{
+		curChunk = ReplayChunkPtr(new ReplayChunk());
+		curChunk->first_frame = framesWritten;
+		encoder.beginChunk(curChunk->data, framesWritten);
+	}
+
+	size_t size = curChunk->data.size();
+	encoder.encodeFrame(curChunk->data, writeTime, &writeNodes[0], &writeBeams[0]);
+	bytesRecorded += curChunk->data.size() - size;
+	curChunk->num_frames++;
+	framesWritten++;
+
+	if (curChunk->num_frames == CHUNK_FRAMES)
+	{
+		finishChunk();
+	}
+
+	if (writeTime - statsTime >= 1000000)
 	{
-		firstRun = 0;
-		writeIndex = 0;
+		bytesPerSecond = (float)(bytesRecorded - statsBytes) * 1000000.0f / (float)(writeTime - statsTime);
+		statsBytes = bytesRecorded;
+		statsTime = writeTime;
 	}
 }
 
+void Replay::finishChunk()
+{
+	encoder.endChunk(curChunk->data);
+
+	if (toDisk)
+	{
+		if (fileFrames[curFile] >= numFrames)
+		{
+			// the current file covers the whole replay length, the other one can be started anew
+			curFile = 1 - curFile;
+			fileBytes[curFile] = 0;
+			fileFrames[curFile] = 0;
+			if (readFiles[curFile])
+			{
+				fclose(readFiles[curFile]);
+				readFiles[curFile] = 0;
+			}
+			for (std::deque<ReplayChunkPtr>::iterator it = chunks.begin(); it != chunks.end();)
+			{
+				if ((*it)->file == curFile)
+					it = chunks.erase(it);
+				else
+					it++;
+			}
+			readChunk.reset();
+		}
+
+		curChunk->file = curFile;
+		curChunk->offset = fileBytes[curFile];
+		replayWriter->write(fileNames[curFile], curChunk, fileBytes[curFile] == 0);
+		fileBytes[curFile] += curChunk->data.size();
+		fileFrames[curFile] += curChunk->num_frames;
+	}
+
+	chunks.push_back(curChunk);
+	curChunk.reset();
+
+	// drop what is out of range, and free what is on disk already
+	uint64_t window_start = (framesWritten > (uint64_t)numFrames) ? framesWritten - numFrames : 0;
+	while (!chunks.empty() && chunks.front()->first_frame + chunks.front()->num_frames <= window_start)
+	{
+		chunks.pop_front();
+	}
+	memoryBytes = 0;
+	for (std::deque<ReplayChunkPtr>::iterator it = chunks.begin(); it != chunks.end(); it++)
+	{
+		ReplayChunk &chunk = **it;
+		if (!chunk.data.empty() && chunk.written.load(std::memory_order_acquire))
+		{
+			std::vector<char>().swap(chunk.data);
+		}
+		memoryBytes += chunk.data.capacity();
+	}
+}
+
+ReplayChunkPtr Replay::findChunk(uint64_t frame)
+{
+	if (curChunk && frame >= curChunk->first_frame)
+		return curChunk;
+
+	// chunks are sorted and consecutive
+	size_t lo = 0, hi = chunks.size();
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (chunks[mid]->first_frame + chunks[mid]->num_frames <= frame)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < chunks.size() && chunks[lo]->first_frame <= frame)
+		return chunks[lo];
+	return ReplayChunkPtr();
+}
+
+bool Replay::loadChunk(ReplayChunkPtr chunk)
+{
+	FILE *&file = readFiles[chunk->file];
+	if (!file)
+	{
+		file = fopen(fileNames[chunk->file].c_str(), "rb");
+		if (!file)
+			return false;
+	}
+
+	replay_chunk_header_t header;
+	if (fseek(file, static_cast<long>(chunk->offset), SEEK_SET) != 0
+		|| fread(&header, sizeof(header), 1, file) != 1
+		|| header.first_frame != chunk->first_frame
+		|| header.size < sizeof(header))
+	{
+		return false;
+	}
+
+	readData.resize(header.size);
+	memcpy(&readData[0], &header, sizeof(header));
+	return fread(&readData[sizeof(header)], 1, header.size - sizeof(header), file) == header.size - sizeof(header);
+}
+
 //we take negative offsets only
 void *Replay::getReadBuffer(int offset, int type, unsigned long &time)
 {
 	if (offset >= 0) offset=-1;
 	if (offset <= -numFrames) offset = -numFrames + 1;
-	
-	int delta = writeIndex + offset;
-	if (delta < 0)
-		if (firstRun && type == 0)
-			return (void *)(nodes);
-		else if (firstRun && type == 1)
-			return (void *)(beams);
-		else
-			delta += numFrames;
-	
+
+	if (framesWritten == 0)
+		return 0;
+
+	uint64_t frame = (framesWritten >= (uint64_t)-offset) ? framesWritten + offset : 0;
+	if (!chunks.empty() && frame < chunks.front()->first_frame)
+		frame = chunks.front()->first_frame;
+
+	ReplayChunkPtr chunk = findChunk(frame);
+	if (!chunk)
+		return 0;
+
+	if (chunk != readChunk)
+	{
+		readChunk = chunk;
+		readData.clear();
+		decoder.reset();
+	}
+
+	// chunks are decoded from memory until they are written, then from the file
+	const std::vector<char> *data = &chunk->data;
+	if (data->empty())
+	{
+		if (readData.empty() && !loadChunk(chunk))
+		{
+			readChunk.reset();
+			readData.clear();
+			return 0;
+		}
+		data = &readData;
+	}
+
+	if (!decoder.seek(&(*data)[0], data->size(), static_cast<int>(frame - chunk->first_frame)))
+		return 0;
+
 	// set the time
-	time = times[delta];
+	time = static_cast<unsigned long>(decoder.getTime());
 	curFrameTime = time;
 	curOffset = offset;
 	updateGUI();
-	
-	if (outOfMemory) return 0;
 
 	// return buffer pointer
 	if (type == 0)
-		return (void *)(nodes + delta * numNodes);
+		return (void *)decoder.getNodes();
 	else if (type == 1)
-		return (void *)(beams + delta * numBeams);
+		return (void *)decoder.getBeams();
 	return 0;
 }
 
 void Replay::updateGUI()
 {
 #ifdef USE_MYGUI
-	if (outOfMemory)
-	{
-		txt->setCaption(_L("Out of Memory"));
-		pr->setProgressPosition(0);
-	} else
-	{
-		wchar_t tmp[128] = L"";
-		unsigned long t = curFrameTime;
-		UTFString format = _L("Position: %0.6f s, frame %i / %i");
-		swprintf(tmp, 128, format.asWStr_c_str(), ((float)t)/1000000.0f, curOffset, numFrames);
-		txt->setCaption(convertToMyGUIString(tmp, 128));
-		pr->setProgressPosition(abs(curOffset));
-	}
+	wchar_t tmp[128] = L"";
+	unsigned long t = curFrameTime;
+	UTFString format = _L("Position: %0.6f s, frame %i / %i");
+	swprintf(tmp, 128, format.asWStr_c_str(), ((float)t)/1000000.0f, curOffset, numFrames);
+	txt->setCaption(convertToMyGUIString(tmp, 128));
+	pr->setProgressPosition(abs(curOffset));
+
+	size_t memory = memoryBytes + (curChunk ? curChunk->data.capacity() : 0);
+	format = _L("Memory: %0.1f MB, recording %0.1f kB/s");
+	swprintf(tmp, 128, format.asWStr_c_str(), ((float)memory)/(1024.0f*1024.0f), bytesPerSecond/1024.0f);
+	stats->setCaption(convertToMyGUIString(tmp, 128));
 #endif // MYGUI
 }
 
@@ -211,5 +370,3 @@ bool Replay::getVisible()
 	return false;
 #endif //MYGUI
 }
-
-
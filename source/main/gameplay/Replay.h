@@ -23,28 +23,28 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "RoRPrerequisites.h"
 #include "OgrePrerequisites.h"
 #include "Beam.h"
+#include "ReplayStorage.h"
 
 #ifdef USE_MYGUI
 #include <MyGUI.h>
 #endif //MYGUI
 
-
-typedef struct node_simple_ {
-	Ogre::Vector3 pos;
-} node_simple_t;
-
-typedef struct beam_simple_ {
-	float scale;
-	bool broken;
-	bool disabled;
-} beam_simple_t;
-
+/**
+ * Records the last numFrames frames of a truck.
+ *
+ * Frames are encoded into chunks of CHUNK_FRAMES frames (see ReplayFrameEncoder), finished
+ * chunks are streamed to disk by the shared ReplayWriter and dropped from memory once written.
+ * The replay alternates between two files, each holding at least the whole replay length,
+ * so the older one can be started anew without losing frames still in range.
+ */
 class Replay : public ZeroedMemoryAllocator
 {
 public:
 	Replay(Beam *b, int nframes);
 	~Replay();
 
+	static const int CHUNK_FRAMES = 128;
+
 	void *getWriteBuffer(int type);
 	void *getReadBuffer(int offset, int type, unsigned long &time);
 	unsigned long getLastReadTime();
@@ -53,35 +53,58 @@ public:
 	void setVisible(bool value);
 	bool getVisible();
 
-	bool isValid() { return !outOfMemory; };
+	bool isValid() { return numNodes > 0; };
 protected:
 	Ogre::Timer *replayTimer;
 	int numNodes;
 	int numBeams;
 	int numFrames;
-	bool outOfMemory;
 
-
-	int writeIndex;
-	int firstRun;
 	unsigned long curFrameTime;
 	int curOffset;
 
-	// malloc'ed
-	node_simple_t *nodes;
-	beam_simple_t *beams;
-	unsigned long *times;
+	// recording
+	std::vector<node_simple_t> writeNodes;
+	std::vector<beam_simple_t> writeBeams;
+	unsigned long writeTime;
+	uint64_t framesWritten;
+	ReplayFrameEncoder encoder;
+	ReplayChunkPtr curChunk;            //!< being recorded, not in the index yet
+	std::deque<ReplayChunkPtr> chunks;  //!< chunk index, oldest first
+
+	// disk
+	bool toDisk;
+	Ogre::String fileNames[2];
+	int curFile;
+	int64_t fileBytes[2];
+	int fileFrames[2];
+	FILE *readFiles[2];
+
+	// playback
+	ReplayFrameDecoder decoder;
+	ReplayChunkPtr readChunk;
+	std::vector<char> readData;         //!< readChunk loaded from disk
+
+	// statistics
+	size_t memoryBytes;
+	uint64_t bytesRecorded;
+	uint64_t statsBytes;
+	unsigned long statsTime;
+	float bytesPerSecond;
 
 #ifdef USE_MYGUI
 	// windowing
 	MyGUI::WidgetPtr panel;
 	MyGUI::StaticTextPtr txt;
+	MyGUI::StaticTextPtr stats;
 	MyGUI::ProgressPtr pr;
 #endif //MYGUI
 
+	void finishChunk();
+	ReplayChunkPtr findChunk(uint64_t frame);
+	bool loadChunk(ReplayChunkPtr chunk);
+
 	void updateGUI();
 
 };
 #endif
-
-
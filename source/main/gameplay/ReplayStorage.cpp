@@ -0,0 +1,492 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ReplayStorage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Ogre;
+
+const float ReplayFrameEncoder::POSITION_STEP = 0.001f;
+
+static const char replayMagic[4] = { 'R', 'o', 'R', 'R' };
+
+static inline void putVarint(std::vector<char> &data, uint64_t v)
+{
+	while (v >= 0x80)
+	{
+		data.push_back(static_cast<char>((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
+	data.push_back(static_cast<char>(v));
+}
+
+static inline bool getVarint(const char *data, size_t size, size_t &pos, uint64_t &v)
+{
+	v = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (pos >= size)
+			return false;
+		unsigned char b = static_cast<unsigned char>(data[pos++]);
+		v |= static_cast<uint64_t>(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static inline uint32_t zigzag(int v)
+{
+	return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static inline int unzigzag(uint64_t v)
+{
+	return static_cast<int>(static_cast<uint32_t>(v) >> 1) ^ -static_cast<int>(v & 1);
+}
+
+static inline void putBytes(std::vector<char> &data, const void *src, size_t len)
+{
+	const char *p = static_cast<const char *>(src);
+	data.insert(data.end(), p, p + len);
+}
+
+/// the same arithmetic on both sides, so the encoder knows exactly what the decoder will see
+static inline Vector3 predict(const Vector3 &prev1, const Vector3 &prev2, int frame)
+{
+	return (frame >= 2) ? prev1 * 2.0f - prev2 : prev1;
+}
+
+static inline float reconstruct(float predicted, int residual)
+{
+	return predicted + static_cast<float>(residual) * ReplayFrameEncoder::POSITION_STEP;
+}
+
+/// indexes of set entries as gaps between them (run lengths of the bitset)
+static void putRuns(std::vector<char> &data, const std::vector<int> &indexes)
+{
+	putVarint(data, indexes.size());
+	int last = -1;
+	for (size_t i = 0; i < indexes.size(); i++)
+	{
+		putVarint(data, indexes[i] - last - 1);
+		last = indexes[i];
+	}
+}
+
+static bool getRuns(const char *data, size_t size, size_t &pos, int limit, std::vector<int> &indexes)
+{
+	uint64_t count = 0;
+	if (!getVarint(data, size, pos, count) || count > static_cast<uint64_t>(limit))
+		return false;
+	indexes.resize(static_cast<size_t>(count));
+	int64_t last = -1;
+	for (size_t i = 0; i < indexes.size(); i++)
+	{
+		uint64_t gap = 0;
+		if (!getVarint(data, size, pos, gap) || gap >= static_cast<uint64_t>(limit))
+			return false;
+		last += static_cast<int64_t>(gap) + 1;
+		if (last >= limit)
+			return false;
+		indexes[i] = static_cast<int>(last);
+	}
+	return true;
+}
+
+// ================================================================================
+// ReplayFrameEncoder
+// ================================================================================
+
+ReplayFrameEncoder::ReplayFrameEncoder(int num_nodes, int num_beams) :
+	  num_nodes(num_nodes)
+	, num_beams(num_beams)
+	, frame(0)
+	, last_time(0)
+	, prev1(num_nodes)
+	, prev2(num_nodes)
+	, prev_beams(num_beams)
+	, residuals(num_nodes * 3)
+{
+}
+
+void ReplayFrameEncoder::beginChunk(std::vector<char> &data, uint64_t first_frame)
+{
+	data.clear();
+	data.resize(sizeof(replay_chunk_header_t));
+
+	replay_chunk_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, replayMagic, sizeof(header.magic));
+	header.version     = FORMAT_VERSION;
+	header.num_nodes   = num_nodes;
+	header.num_beams   = num_beams;
+	header.first_frame = first_frame;
+	memcpy(&data[0], &header, sizeof(header));
+
+	frame = 0;
+	last_time = 0;
+	// the keyframe stores beams as changes to this
+	beam_simple_t zero;
+	memset(&zero, 0, sizeof(zero));
+	std::fill(prev_beams.begin(), prev_beams.end(), zero);
+}
+
+void ReplayFrameEncoder::encodeFrame(std::vector<char> &data, uint64_t time, const node_simple_t *nodes, const beam_simple_t *beams)
+{
+	uint64_t time_delta = (frame == 0) ? time : ((time > last_time) ? time - last_time : 0);
+	putVarint(data, time_delta);
+	last_time = (frame == 0) ? time : last_time + time_delta;
+
+	if (frame == 0)
+	{
+		for (int i = 0; i < num_nodes; i++)
+		{
+			putBytes(data, &nodes[i].pos.x, sizeof(float) * 3);
+			prev1[i] = nodes[i].pos;
+			prev2[i] = nodes[i].pos;
+		}
+	}
+	else
+	{
+		changed.clear();
+		for (int i = 0; i < num_nodes; i++)
+		{
+			Vector3 predicted = predict(prev1[i], prev2[i], frame);
+			Vector3 decoded;
+			bool moved = false;
+			for (int c = 0; c < 3; c++)
+			{
+				float d = (nodes[i].pos[c] - predicted[c]) / POSITION_STEP;
+				int r = 0;
+				if (std::isfinite(d))
+					r = static_cast<int>(std::max(std::min(floorf(d + 0.5f), 1.0e9f), -1.0e9f));
+				residuals[i * 3 + c] = r;
+				decoded[c] = reconstruct(predicted[c], r);
+				moved |= (r != 0);
+			}
+			prev2[i] = prev1[i];
+			prev1[i] = decoded;
+			if (moved)
+				changed.push_back(i);
+		}
+
+		// nodes that moved as predicted are skipped
+		putRuns(data, changed);
+		for (size_t n = 0; n < changed.size(); n++)
+		{
+			int i = changed[n];
+			putVarint(data, zigzag(residuals[i * 3 + 0]));
+			putVarint(data, zigzag(residuals[i * 3 + 1]));
+			putVarint(data, zigzag(residuals[i * 3 + 2]));
+		}
+	}
+
+	changed.clear();
+	for (int i = 0; i < num_beams; i++)
+	{
+		if (beams[i].scale != prev_beams[i].scale)
+			changed.push_back(i);
+	}
+	putRuns(data, changed);
+	for (size_t n = 0; n < changed.size(); n++)
+	{
+		putBytes(data, &beams[changed[n]].scale, sizeof(float));
+		prev_beams[changed[n]].scale = beams[changed[n]].scale;
+	}
+
+	changed.clear();
+	for (int i = 0; i < num_beams; i++)
+	{
+		if (beams[i].broken != prev_beams[i].broken)
+			changed.push_back(i);
+		prev_beams[i].broken = beams[i].broken;
+	}
+	putRuns(data, changed);
+
+	changed.clear();
+	for (int i = 0; i < num_beams; i++)
+	{
+		if (beams[i].disabled != prev_beams[i].disabled)
+			changed.push_back(i);
+		prev_beams[i].disabled = beams[i].disabled;
+	}
+	putRuns(data, changed);
+
+	frame++;
+}
+
+void ReplayFrameEncoder::endChunk(std::vector<char> &data)
+{
+	replay_chunk_header_t header;
+	memcpy(&header, &data[0], sizeof(header));
+	header.num_frames = frame;
+	header.size       = static_cast<uint32_t>(data.size());
+	memcpy(&data[0], &header, sizeof(header));
+}
+
+// ================================================================================
+// ReplayFrameDecoder
+// ================================================================================
+
+ReplayFrameDecoder::ReplayFrameDecoder(int num_nodes, int num_beams) :
+	  num_nodes(num_nodes)
+	, num_beams(num_beams)
+	, frame(-1)
+	, pos(0)
+	, last_time(0)
+	, prev2(num_nodes)
+	, nodes(std::max(num_nodes, 1))
+	, beams(std::max(num_beams, 1))
+{
+}
+
+bool ReplayFrameDecoder::seek(const char *data, size_t size, int target)
+{
+	if (frame < 0 || target < frame)
+	{
+		replay_chunk_header_t header;
+		if (size < sizeof(header))
+			return false;
+		memcpy(&header, data, sizeof(header));
+		if (memcmp(header.magic, replayMagic, sizeof(header.magic)) || header.version != ReplayFrameEncoder::FORMAT_VERSION
+			|| header.num_nodes != (uint32_t)num_nodes || header.num_beams != (uint32_t)num_beams)
+		{
+			return false;
+		}
+		frame = -1;
+		pos = sizeof(header);
+	}
+
+	while (frame < target)
+	{
+		if (!decodeFrame(data, size))
+		{
+			frame = -1;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ReplayFrameDecoder::decodeFrame(const char *data, size_t size)
+{
+	int next = frame + 1;
+
+	uint64_t time_delta = 0;
+	if (!getVarint(data, size, pos, time_delta))
+		return false;
+	last_time = (next == 0) ? time_delta : last_time + time_delta;
+
+	std::vector<int> changed;
+	if (next == 0)
+	{
+		if (size - pos < num_nodes * sizeof(float) * 3)
+			return false;
+		for (int i = 0; i < num_nodes; i++)
+		{
+			memcpy(&nodes[i].pos.x, data + pos, sizeof(float) * 3);
+			pos += sizeof(float) * 3;
+			prev2[i] = nodes[i].pos;
+		}
+		beam_simple_t zero;
+		memset(&zero, 0, sizeof(zero));
+		std::fill(beams.begin(), beams.end(), zero);
+	}
+	else
+	{
+		if (!getRuns(data, size, pos, num_nodes, changed))
+			return false;
+		size_t n = 0;
+		for (int i = 0; i < num_nodes; i++)
+		{
+			Vector3 predicted = predict(nodes[i].pos, prev2[i], next);
+			Vector3 decoded;
+			bool listed = (n < changed.size() && changed[n] == i);
+			for (int c = 0; c < 3; c++)
+			{
+				int r = 0;
+				if (listed)
+				{
+					uint64_t v = 0;
+					if (!getVarint(data, size, pos, v))
+						return false;
+					r = unzigzag(v);
+				}
+				decoded[c] = reconstruct(predicted[c], r);
+			}
+			if (listed)
+				n++;
+			prev2[i] = nodes[i].pos;
+			nodes[i].pos = decoded;
+		}
+	}
+
+	if (!getRuns(data, size, pos, num_beams, changed))
+		return false;
+	if (size - pos < changed.size() * sizeof(float))
+		return false;
+	for (size_t n = 0; n < changed.size(); n++)
+	{
+		memcpy(&beams[changed[n]].scale, data + pos, sizeof(float));
+		pos += sizeof(float);
+	}
+
+	if (!getRuns(data, size, pos, num_beams, changed))
+		return false;
+	for (size_t n = 0; n < changed.size(); n++)
+		beams[changed[n]].broken = !beams[changed[n]].broken;
+
+	if (!getRuns(data, size, pos, num_beams, changed))
+		return false;
+	for (size_t n = 0; n < changed.size(); n++)
+		beams[changed[n]].disabled = !beams[changed[n]].disabled;
+
+	frame = next;
+	return true;
+}
+
+// ================================================================================
+// ReplayWriter
+// ================================================================================
+
+ReplayWriter::ReplayWriter() :
+	  running(false)
+	, stop(false)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+
+	if (pthread_create(&thread, NULL, threadEntry, this))
+	{
+		LOG("Replay: Can not start the writer thread, replays are kept in memory");
+		return;
+	}
+	running = true;
+}
+
+ReplayWriter::~ReplayWriter()
+{
+	if (running)
+	{
+		MUTEX_LOCK(&mutex);
+		stop = true;
+		pthread_cond_signal(&cond);
+		MUTEX_UNLOCK(&mutex);
+		pthread_join(thread, NULL);
+	}
+
+	for (std::map<String, FILE *>::iterator it = files.begin(); it != files.end(); it++)
+	{
+		fclose(it->second);
+	}
+	files.clear();
+
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+}
+
+void ReplayWriter::write(String const &filename, ReplayChunkPtr chunk, bool truncate)
+{
+	if (!running)
+		return; // stays in memory
+
+	Job job;
+	job.filename = filename;
+	job.chunk    = chunk;
+	job.truncate = truncate;
+
+	MUTEX_LOCK(&mutex);
+	jobs.push_back(job);
+	pthread_cond_signal(&cond);
+	MUTEX_UNLOCK(&mutex);
+}
+
+void ReplayWriter::close(String const &filename)
+{
+	write(filename, ReplayChunkPtr(), false);
+}
+
+void *ReplayWriter::threadEntry(void *arg)
+{
+	static_cast<ReplayWriter *>(arg)->run();
+	return NULL;
+}
+
+void ReplayWriter::run()
+{
+	MUTEX_LOCK(&mutex);
+	while (true)
+	{
+		while (jobs.empty() && !stop)
+		{
+			pthread_cond_wait(&cond, &mutex);
+		}
+		if (jobs.empty())
+			break; // stopped, and everything is written
+
+		Job job = jobs.front();
+		jobs.pop_front();
+
+		MUTEX_UNLOCK(&mutex);
+		process(job);
+		MUTEX_LOCK(&mutex);
+	}
+	MUTEX_UNLOCK(&mutex);
+}
+
+void ReplayWriter::process(Job &job)
+{
+	std::map<String, FILE *>::iterator it = files.find(job.filename);
+	FILE *file = (it != files.end()) ? it->second : 0;
+
+	if (!job.chunk || job.truncate)
+	{
+		if (file)
+		{
+			fclose(file);
+			files.erase(it);
+			file = 0;
+		}
+		if (!job.chunk)
+			return;
+	}
+
+	if (!file)
+	{
+		file = fopen(job.filename.c_str(), job.truncate ? "wb" : "r+b");
+		if (!file)
+		{
+			LOG("Replay: Can not write to " + job.filename + ", keeping the replay in memory");
+			return;
+		}
+		files[job.filename] = file;
+	}
+
+	ReplayChunk &chunk = *job.chunk;
+	if (fseek(file, static_cast<long>(chunk.offset), SEEK_SET) == 0
+		&& fwrite(&chunk.data[0], 1, chunk.data.size(), file) == chunk.data.size()
+		&& fflush(file) == 0)
+	{
+		chunk.written.store(true, std::memory_order_release);
+	}
+}
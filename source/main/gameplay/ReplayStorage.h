@@ -0,0 +1,186 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ReplayStorage_H__
+#define __ReplayStorage_H__
+
+#include "RoRPrerequisites.h"
+
+#include <OgreVector3.h>
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <pthread.h>
+#include <stdint.h>
+#include <vector>
+
+typedef struct node_simple_ {
+	Ogre::Vector3 pos;
+} node_simple_t;
+
+typedef struct beam_simple_ {
+	float scale;
+	bool broken;
+	bool disabled;
+} beam_simple_t;
+
+/**
+ * A piece of a replay: one keyframe and the delta frames after it.
+ *
+ * The data start with a replay_chunk_header_t, so chunks written one after the other form a readable file.
+ */
+struct ReplayChunk
+{
+	ReplayChunk() : first_frame(0), num_frames(0), file(-1), offset(0), written(false) {};
+
+	uint64_t first_frame;
+	int num_frames;
+	int file;                   //!< file slot of the owning Replay, -1 = kept in memory
+	int64_t offset;             //!< position in the file
+	std::vector<char> data;     //!< encoded frames, freed once written
+	std::atomic<bool> written;  //!< set by the writer thread when data are on disk
+};
+
+typedef std::shared_ptr<ReplayChunk> ReplayChunkPtr;
+
+typedef struct replay_chunk_header_t
+{
+	char magic[4];              //!< "RoRR"
+	uint32_t version;
+	uint32_t num_nodes;
+	uint32_t num_beams;
+	uint64_t first_frame;
+	uint32_t num_frames;
+	uint32_t size;              //!< including this header
+} replay_chunk_header_t;
+
+/**
+ * Encodes replay frames.
+ *
+ * The first frame of a chunk stores the node positions as floats, the others store
+ * the difference to a linear prediction from the two previous frames, quantized to
+ * POSITION_STEP; only nodes with a non-zero difference are written. Beam scales are
+ * written only when they changed, broken and disabled flags only when they toggle.
+ * Changed beams are listed as run lengths.
+ */
+class ReplayFrameEncoder
+{
+public:
+
+	static const uint32_t FORMAT_VERSION = 1;
+	static const float POSITION_STEP; //!< meters
+
+	ReplayFrameEncoder(int num_nodes, int num_beams);
+
+	/// starts a chunk in data, the next frame is a keyframe
+	void beginChunk(std::vector<char> &data, uint64_t first_frame);
+
+	void encodeFrame(std::vector<char> &data, uint64_t time, const node_simple_t *nodes, const beam_simple_t *beams);
+
+	/// fills in the header of the chunk
+	void endChunk(std::vector<char> &data);
+
+protected:
+
+	int num_nodes, num_beams;
+	int frame;                              //!< frame in the chunk
+	uint64_t last_time;
+	std::vector<Ogre::Vector3> prev1, prev2; //!< positions as the decoder will see them
+	std::vector<beam_simple_t> prev_beams;
+	std::vector<int> residuals;             //!< scratch
+	std::vector<int> changed;               //!< scratch
+};
+
+class ReplayFrameDecoder
+{
+public:
+
+	ReplayFrameDecoder(int num_nodes, int num_beams);
+
+	/**
+	 * Decodes up to the given frame of a chunk; continues from the last decoded frame when possible.
+	 * @return false if the data are damaged
+	 */
+	bool seek(const char *data, size_t size, int frame);
+
+	int getFrame() const { return frame; };
+	uint64_t getTime() const { return last_time; };
+	const node_simple_t *getNodes() const { return &nodes[0]; };
+	const beam_simple_t *getBeams() const { return &beams[0]; };
+
+	/// forces the next seek() to start from the keyframe
+	void reset() { frame = -1; };
+
+protected:
+
+	int num_nodes, num_beams;
+	int frame;                              //!< last decoded frame, -1 = none
+	size_t pos;                             //!< read position after that frame
+	uint64_t last_time;
+	std::vector<Ogre::Vector3> prev2;
+	std::vector<node_simple_t> nodes;
+	std::vector<beam_simple_t> beams;
+
+	bool decodeFrame(const char *data, size_t size);
+};
+
+/**
+ * Background thread that writes replay chunks to files, shared by all replays.
+ */
+class ReplayWriter
+{
+public:
+
+	ReplayWriter();
+	~ReplayWriter(); //!< writes everything still queued
+
+	/**
+	 * @param truncate start the file anew before writing
+	 */
+	void write(Ogre::String const &filename, ReplayChunkPtr chunk, bool truncate);
+
+	/// closes the file after everything queued for it is written
+	void close(Ogre::String const &filename);
+
+protected:
+
+	struct Job
+	{
+		Ogre::String filename;
+		ReplayChunkPtr chunk;   //!< null = close
+		bool truncate;
+	};
+
+	std::deque<Job> jobs;
+	std::map<Ogre::String, FILE *> files;
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool running;
+	bool stop;
+
+	static void *threadEntry(void *arg);
+	void run();
+	void process(Job &job);
+};
+
+#endif // __ReplayStorage_H__
@@ -1300,6 +1300,9 @@ bool RoRFrameListener::frameStarted(const FrameEvent& evt)
 	{
 		BeamFactory::getSingleton().updateVisual(dt); // Updates flexbodies. When using ThreadPool, it pushes tasks and also waits for them to complete (in this single call)
 
+		// consume the particle emissions queued by the physics of all trucks
+		DustManager::getSingleton().update(curr_truck ? curr_truck->WheelSpeed : 0.0f);
+
 		// add some example AI
 		//if (loadedTerrain == "simple.terrn2")
 			//BeamFactory::getSingleton().updateAI(dt);
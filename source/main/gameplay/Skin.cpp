@@ -23,11 +23,10 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "OgreLogManager.h"
 #include "Ogre.h"
 #include "CacheSystem.h"
+#include "MaterialInstanceCache.h"
 
 using namespace Ogre;
 
-int Skin::counter = 0;
-
 
 Skin::Skin(ResourceManager* creator, const String& name, ResourceHandle handle, const String& group, bool isManual, ManualResourceLoader* loader) :
 	Ogre::Resource(creator, name, handle, group, isManual, loader)
@@ -136,14 +135,39 @@ void Skin::replaceMaterialTextures(Ogre::String materialName)
 	}
 }
 
+bool Skin::usesReplacedTextures(Ogre::String materialName)
+{
+	MaterialPtr mat = MaterialManager::getSingleton().getByName(materialName);
+	if (mat.isNull()) return false;
+
+	for (int t = 0; t < mat->getNumTechniques(); t++)
+	{
+		Technique *tech = mat->getTechnique(t);
+		if (!tech) continue;
+		for (int p=0; p < tech->getNumPasses(); p++)
+		{
+			Pass *pass = tech->getPass(p);
+			if (!pass) continue;
+			for (int tu = 0; tu < pass->getNumTextureUnitStates(); tu++)
+			{
+				TextureUnitState *tus = pass->getTextureUnitState(tu);
+				if (!tus) continue;
+				for (unsigned int fr=0; fr<tus->getNumFrames(); fr++)
+				{
+					if (replaceTextures.count(tus->getFrameTextureName(fr)))
+						return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
 void Skin::replaceMeshMaterials(Ogre::Entity *e)
 {
 	if (!e) return;
 
-	// make it unique FIRST, otherwise we change the base material ...
-	uniquifyMeshMaterials(e);
-
-	// then walk the entity and look for replacements
+	// walk the entity and look for replacements
 	for (int n=0; n<(int)e->getNumSubEntities();n++)
 	{
 		SubEntity *subent = e->getSubEntity(n);
@@ -153,29 +177,20 @@ void Skin::replaceMeshMaterials(Ogre::Entity *e)
 		{
 			materialName = it->second;
 			subent->setMaterialName(materialName);
-		} else
+		} else if (usesReplacedTextures(materialName))
 		{
-			// look for texture replacements
-			replaceMaterialTextures(subent->getMaterialName());
-		}
-	}
-}
+			// the textures are replaced in a copy, otherwise we change the base material ...
+			// the copy is shared by all entities using this skin
+			String newMaterialName = materialName + "_#UNIQUESKINMATERIAL#_" + name;
 
-void Skin::uniquifyMeshMaterials(Ogre::Entity *e)
-{
-	if (!e) return;
+			bool created = false;
+			MaterialPtr mat = MaterialInstanceCache::getSingleton().getShared(materialName, newMaterialName, created);
+			if (mat.isNull()) continue;
 
-	for (int n=0; n<(int)e->getNumSubEntities();n++)
-	{
-		SubEntity *subent = e->getSubEntity(n);
-		String oldMaterialName = subent->getMaterialName();
-		// MAGGIICCCC
-		String newMaterialName = oldMaterialName + "_#UNIQUESKINMATERIAL#_" + TOSTRING(counter++);
-
-		MaterialPtr mat = MaterialManager::getSingleton().getByName(oldMaterialName);
-		if (!mat.isNull())
-		{
-			mat->clone(newMaterialName);
+			if (created)
+			{
+				replaceMaterialTextures(newMaterialName);
+			}
 			subent->setMaterialName(newMaterialName);
 		}
 	}
@@ -56,7 +56,7 @@ public:
 	Ogre::String stripMaterialNameUniqueNess(Ogre::String matName);
 
 	// common
-	void uniquifyMeshMaterials(Ogre::Entity *e);
+	bool usesReplacedTextures(Ogre::String materialName);
 
 	void replaceMeshMaterials(Ogre::Entity *e);
 	void replaceMaterialTextures(Ogre::String materialName);
@@ -66,8 +66,6 @@ protected:
 	std::map<Ogre::String, Ogre::String> replaceTextures;
 	std::map<Ogre::String, Ogre::String> replaceMaterials;
 
-	static int counter;
-
 	void loadImpl(void);
 	void unloadImpl(void);
 	size_t calculateSize(void) const;
@@ -21,14 +21,23 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "DustManager.h"
 
+#include "BeamData.h"
 #include "DustPool.h"
 #include "Settings.h"
 
 using namespace Ogre;
 
-DustManager::DustManager() : mEnabled(false)
+// emissions of the same kind closer than this are merged into one emitter
+static const float EMISSION_COALESCE_DISTANCE_SQ = 0.5f * 0.5f;
+
+DustManager::DustManager() : 
+	  mEnabled(false)
+	, dropped_emissions(0)
 {
 	setSingleton(this);
+	pthread_key_create(&queue_key, NULL);
+	pthread_mutex_init(&queues_mutex, NULL);
+
 	mEnabled = BSETTING("Particles", true);
 
 	if (mEnabled)
@@ -54,6 +63,20 @@ DustManager::~DustManager()
 	}
 	// then clear the vector
 	dustpools.clear();
+
+	for (size_t i=0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+	queues.clear();
+
+	if (dropped_emissions.load())
+	{
+		LOG("DustManager: " + TOSTRING(dropped_emissions.load()) + " particle emissions dropped due to full queues");
+	}
+
+	pthread_key_delete(queue_key);
+	pthread_mutex_destroy(&queues_mutex);
 }
 
 DustPool *DustManager::getGroundModelDustPool(ground_model_t *g)
@@ -98,9 +121,88 @@ void DustManager::addNewDustPool(ground_model_t *g)
 }
 */
 
+DustManager::emission_queue_t *DustManager::getThreadQueue()
+{
+	emission_queue_t *queue = static_cast<emission_queue_t *>(pthread_getspecific(queue_key));
+	if (!queue)
+	{
+		// first emission from this thread
+		queue = new emission_queue_t();
+		MUTEX_LOCK(&queues_mutex);
+		queues.push_back(queue);
+		MUTEX_UNLOCK(&queues_mutex);
+		pthread_setspecific(queue_key, queue);
+	}
+	return queue;
+}
+
+void DustManager::queueEmission(const dust_emission_t &e)
+{
+	if (!mEnabled) return;
+	if (!getThreadQueue()->push(e))
+	{
+		// purely visual, so just drop it
+		dropped_emissions.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
 void DustManager::update(float wspeed)
 {
 	if (!mEnabled) return;
+
+	emissions.clear();
+	emission_weights.clear();
+	groundmodel_counts.clear();
+
+	dust_emission_t e;
+	MUTEX_LOCK(&queues_mutex);
+	for (size_t q=0; q < queues.size(); q++)
+	{
+		while (queues[q]->pop(e))
+		{
+			// coalesce with an accepted emission of the same kind nearby
+			bool merged = false;
+			for (size_t i=0; i < emissions.size(); i++)
+			{
+				dust_emission_t &a = emissions[i];
+				if (a.pool == e.pool && a.type == e.type && a.pos.squaredDistance(e.pos) < EMISSION_COALESCE_DISTANCE_SQ)
+				{
+					float w = (float)emission_weights[i];
+					a.pos  = (a.pos * w + e.pos) / (w + 1.0f);
+					a.vel  = (a.vel * w + e.vel) / (w + 1.0f);
+					a.rate = std::max(a.rate, e.rate);
+					emission_weights[i]++;
+					merged = true;
+					break;
+				}
+			}
+			if (merged) continue;
+
+			// rate limit per ground model
+			if (e.gm && e.gm->fx_particle_amount > 0)
+			{
+				size_t g = 0;
+				while (g < groundmodel_counts.size() && groundmodel_counts[g].first != e.gm) g++;
+				if (g == groundmodel_counts.size())
+				{
+					groundmodel_counts.push_back(std::make_pair(e.gm, 0));
+				}
+				if (groundmodel_counts[g].second >= e.gm->fx_particle_amount) continue;
+				groundmodel_counts[g].second++;
+			}
+
+			emissions.push_back(e);
+			emission_weights.push_back(1);
+		}
+	}
+	MUTEX_UNLOCK(&queues_mutex);
+
+	for (size_t i=0; i < emissions.size(); i++)
+	{
+		const dust_emission_t &a = emissions[i];
+		a.pool->store(a.type, a.pos, a.vel, a.col, a.rate);
+	}
+
 	std::map < Ogre::String , DustPool * >::iterator it;
 	for (it=dustpools.begin(); it!=dustpools.end();it++)
 	{
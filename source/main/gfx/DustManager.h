@@ -23,27 +23,69 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "LockFreeRingBuffer.h"
 #include "Singleton.h"
 
+#include <atomic>
+#include <pthread.h>
+
 class DustManager : public RoRSingletonNoCreation < DustManager >, public ZeroedMemoryAllocator
 {
 public:
 
+	/**
+	* Compact particle emission record; written by the physics threads, consumed by update().
+	*/
+	struct dust_emission_t
+	{
+		DustPool *pool;
+		ground_model_t *gm;  //!< Optional, used for rate limiting
+		Ogre::Vector3 pos;
+		Ogre::Vector3 vel;
+		Ogre::ColourValue col;
+		float rate;
+		int type;            //!< DustPool::DustTypes
+	};
+
 	DustManager();
 	~DustManager();
 
 	DustPool *getGroundModelDustPool(ground_model_t *g);
 	
+	/**
+	* Consumes all queued emissions and updates the dust pools; call once per frame from the main thread.
+	*/
 	void update(float wspeed);
 
+	/**
+	* Queues an emission into the ring buffer of the calling thread; lock-free, may be called from any thread.
+	*/
+	void queueEmission(const dust_emission_t &e);
+
 	void setVisible(bool visible);
 
 	DustPool *getDustPool(Ogre::String name);
 	
 protected:
 
+	static const size_t EMISSION_QUEUE_SIZE = 1024;
+	typedef LockFreeRingBuffer < dust_emission_t, EMISSION_QUEUE_SIZE > emission_queue_t;
+
+	emission_queue_t *getThreadQueue();
+
 	bool mEnabled;
 	std::map < Ogre::String , DustPool * > dustpools;
+
+	// one emission queue per producing thread
+	pthread_key_t queue_key;
+	pthread_mutex_t queues_mutex;
+	std::vector < emission_queue_t * > queues;
+	std::atomic<unsigned long> dropped_emissions;
+
+	// per-frame scratch buffers of update(), kept to avoid reallocation
+	std::vector < dust_emission_t > emissions;
+	std::vector < int > emission_weights;
+	std::vector < std::pair < ground_model_t *, int > > groundmodel_counts;
 };
 
 #endif // __DustManager_H_
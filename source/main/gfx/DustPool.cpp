@@ -19,6 +19,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "DustPool.h"
 
+#include "DustManager.h"
 #include "Ogre.h"
 #include "RoRPrerequisites.h"
 #include "TerrainManager.h"
@@ -57,13 +58,10 @@ DustPool::DustPool(const char* dname, int dsize) :
 
 	// hide after creation
 	//setVisible(false);
-	
-	pthread_mutex_init(&allocation_mutex, NULL);
 }
 
 DustPool::~DustPool()
 {
-	pthread_mutex_destroy(&allocation_mutex);
 }
 
 void DustPool::setVisible(bool s)
@@ -77,126 +75,77 @@ void DustPool::setVisible(bool s)
 	}
 }
 
-//Dust
-void DustPool::malloc(Vector3 pos, Vector3 vel, ColourValue col)
+void DustPool::queue(int type, const Vector3 &pos, const Vector3 &vel, const ColourValue &col, float rate, ground_model_t *gm)
+{
+	DustManager::dust_emission_t e;
+	e.pool = this;
+	e.gm   = gm;
+	e.pos  = pos;
+	e.vel  = vel;
+	e.col  = col;
+	e.rate = rate;
+	e.type = type;
+	DustManager::getSingleton().queueEmission(e);
+}
+
+void DustPool::store(int type, const Vector3 &pos, const Vector3 &vel, const ColourValue &col, float rate)
 {
-	MUTEX_LOCK(&allocation_mutex);
 	if (allocated < size)
 	{
 		positions[allocated]=pos;
 		velocities[allocated]=vel;
 		colours[allocated]=col;
-		types[allocated]=DUST_NORMAL;
+		types[allocated]=type;
+		rates[allocated]=rate;
 		//visible[allocated]=true;
 		allocated++;
 	}
-	MUTEX_UNLOCK(&allocation_mutex);
+}
+
+//Dust
+void DustPool::malloc(Vector3 pos, Vector3 vel, ColourValue col, ground_model_t *gm)
+{
+	queue(DUST_NORMAL, pos, vel, col, 0, gm);
 }
 
 //Clumps
-void DustPool::allocClump(Vector3 pos, Vector3 vel, ColourValue col)
+void DustPool::allocClump(Vector3 pos, Vector3 vel, ColourValue col, ground_model_t *gm)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		colours[allocated]=col;
-		types[allocated]=DUST_CLUMP;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_CLUMP, pos, vel, col, 0, gm);
 }
 
 //Rubber smoke
-void DustPool::allocSmoke(Vector3 pos, Vector3 vel)
+void DustPool::allocSmoke(Vector3 pos, Vector3 vel, ground_model_t *gm)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_RUBBER;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_RUBBER, pos, vel, ColourValue::White, 0, gm);
 }
 
 //
-void DustPool::allocSparks(Vector3 pos, Vector3 vel)
+void DustPool::allocSparks(Vector3 pos, Vector3 vel, ground_model_t *gm)
 {
 	if (vel.length() < 0.1) return; // try to prevent emitting sparks while standing
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_SPARKS;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_SPARKS, pos, vel, ColourValue::White, 0, gm);
 }
 
 //Water vapour
 void DustPool::allocVapour(Vector3 pos, Vector3 vel, float time)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_VAPOUR;
-		rates[allocated]=5.0-time;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_VAPOUR, pos, vel, ColourValue::White, 5.0-time, 0);
 }
 
 void DustPool::allocDrip(Vector3 pos, Vector3 vel, float time)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_DRIP;
-		rates[allocated]=5.0-time;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_DRIP, pos, vel, ColourValue::White, 5.0-time, 0);
 }
 
 void DustPool::allocSplash(Vector3 pos, Vector3 vel)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_SPLASH;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_SPLASH, pos, vel, ColourValue::White, 0, 0);
 }
 
 void DustPool::allocRipple(Vector3 pos, Vector3 vel)
 {
-	MUTEX_LOCK(&allocation_mutex);
-	if (allocated < size)
-	{
-		positions[allocated]=pos;
-		velocities[allocated]=vel;
-		types[allocated]=DUST_RIPPLE;
-		//visible[allocated]=true;
-		allocated++;
-	}
-	MUTEX_UNLOCK(&allocation_mutex);
+	queue(DUST_RIPPLE, pos, vel, ColourValue::White, 0, 0);
 }
 
 void DustPool::update(float gspeed)
@@ -22,10 +22,15 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
-#include <pthread.h>
-
+/**
+* A set of particle emitters of one kind.
+* The alloc*() functions may be called from any thread: they only queue an emission record at the DustManager,
+* which hands the records over to the pools once per frame (see DustManager::update()).
+*/
 class DustPool : public ZeroedMemoryAllocator
 {
+	friend class DustManager;
+
 public:
 
 	DustPool(const char* dname, int dsize);
@@ -33,13 +38,13 @@ public:
 
 	void setVisible(bool s);
 	//Dust
-	void malloc(Ogre::Vector3 pos, Ogre::Vector3 vel, Ogre::ColourValue col = Ogre::ColourValue(0.83, 0.71, 0.64, 1.0));
+	void malloc(Ogre::Vector3 pos, Ogre::Vector3 vel, Ogre::ColourValue col = Ogre::ColourValue(0.83, 0.71, 0.64, 1.0), ground_model_t *gm = 0);
 	//clumps
-	void allocClump(Ogre::Vector3 pos, Ogre::Vector3 vel, Ogre::ColourValue col = Ogre::ColourValue(0.83, 0.71, 0.64, 1.0));
+	void allocClump(Ogre::Vector3 pos, Ogre::Vector3 vel, Ogre::ColourValue col = Ogre::ColourValue(0.83, 0.71, 0.64, 1.0), ground_model_t *gm = 0);
 	//Rubber smoke
-	void allocSmoke(Ogre::Vector3 pos, Ogre::Vector3 vel);
+	void allocSmoke(Ogre::Vector3 pos, Ogre::Vector3 vel, ground_model_t *gm = 0);
 	//
-	void allocSparks(Ogre::Vector3 pos, Ogre::Vector3 vel);
+	void allocSparks(Ogre::Vector3 pos, Ogre::Vector3 vel, ground_model_t *gm = 0);
 	//Water vapour
 	void allocVapour(Ogre::Vector3 pos, Ogre::Vector3 vel, float time);
 
@@ -49,10 +54,15 @@ public:
 
 	void allocRipple(Ogre::Vector3 pos, Ogre::Vector3 vel);
 
-	void update(float gspeed);
-
 protected:
 
+	/**
+	* Called by DustManager only (main thread)
+	*/
+	void update(float gspeed);
+	void store(int type, const Ogre::Vector3 &pos, const Ogre::Vector3 &vel, const Ogre::ColourValue &col, float rate);
+	void queue(int type, const Ogre::Vector3 &pos, const Ogre::Vector3 &vel, const Ogre::ColourValue &col, float rate, ground_model_t *gm);
+
 	static const int MAX_DUSTS = 100;
 
 	enum DustTypes { DUST_NORMAL, DUST_RUBBER, DUST_DRIP, DUST_VAPOUR, DUST_SPLASH, DUST_RIPPLE, DUST_SPARKS, DUST_CLUMP };
@@ -67,8 +77,6 @@ protected:
 	int allocated;
 	int size;
 	int types[MAX_DUSTS];
-
-	pthread_mutex_t allocation_mutex;
 };
 
 #endif // __DustPool_H_
@@ -22,6 +22,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "HydraxWater.h"
 #include "OgreSubsystem.h"
 #include "RoRPrerequisites.h"
+#include "Settings.h"
 
 //#include "OgreTerrainSceneManager.h" // for some cast in order to get the terrain material = ILLEGAL to link to a plugin!
 #include "RadialGrid.h"
@@ -44,6 +45,10 @@ int HydraxWater::loadConfig(Ogre::String configfile)
 {
 	waternoise = new Hydrax::Noise::Real(/*Generic one*/);
 
+	// the waves may be updated at a lower rate than the rendering, 0 = every frame
+	Hydrax::Module::ProjectedGrid::Options gridOptions;
+	gridOptions.UpdateRate = FSETTING("Hydrax Update Rate", 0);
+
 	// Create our projected grid module  
 	Hydrax::Module::ProjectedGrid *module 
 		= new Hydrax::Module::ProjectedGrid(// Hydrax parent pointer
@@ -56,7 +61,7 @@ int HydraxWater::loadConfig(Ogre::String configfile)
 		// Normal mode
 		Hydrax::MaterialManager::NM_VERTEX,
 		// Projected grid options
-		Hydrax::Module::ProjectedGrid::Options());
+		gridOptions);
 
 	// Add some waves
 	waternoise->addWave(
@@ -227,6 +232,27 @@ Vector3 HydraxWater::getVelocity(Vector3 pos)
 	return Vector3(0, 0, 0);
 }
 
+void HydraxWater::getHeightWavesBatch(const Vector3 *pos, float *result, int count)
+{
+	for (int i=0; i<count; i++)
+	{
+		result[i] = getHeightWaves(pos[i]);
+	}
+}
+
+void HydraxWater::getVelocityBatch(const Vector3 *pos, Vector3 *result, int count)
+{
+	for (int i=0; i<count; i++)
+	{
+		result[i] = getVelocity(pos[i]);
+	}
+}
+
+void HydraxWater::updateWavePhases(float time)
+{
+	// hydrax has its own time keeping
+}
+
 void HydraxWater::updateReflectionPlane(float h)
 {
 }
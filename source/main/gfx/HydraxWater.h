@@ -45,6 +45,9 @@ public:
 	float getHeight();
 	float getHeightWaves(Ogre::Vector3 pos);
 	Ogre::Vector3 getVelocity(Ogre::Vector3 pos);
+	void getHeightWavesBatch(const Ogre::Vector3 *pos, float *result, int count);
+	void getVelocityBatch(const Ogre::Vector3 *pos, Ogre::Vector3 *result, int count);
+	void updateWavePhases(float time);
 
 	void setCamera(Ogre::Camera *cam);
 	void setFadeColour(Ogre::ColourValue ambient);
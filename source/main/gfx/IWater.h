@@ -33,6 +33,13 @@ public:
 	virtual float getHeightWaves(Ogre::Vector3 pos) = 0;
 	virtual Ogre::Vector3 getVelocity(Ogre::Vector3 pos) = 0;
 
+	// batch versions of getHeightWaves() and getVelocity(), 'result' must hold 'count' elements
+	virtual void getHeightWavesBatch(const Ogre::Vector3 *pos, float *result, int count) = 0;
+	virtual void getVelocityBatch(const Ogre::Vector3 *pos, Ogre::Vector3 *result, int count) = 0;
+
+	// precalculates the time dependent wave terms, shared by all queries until the next call (once per physics frame)
+	virtual void updateWavePhases(float time) = 0;
+
 	virtual void setCamera(Ogre::Camera *cam) = 0;
 	virtual void setFadeColour(Ogre::ColourValue ambient) = 0;
 	virtual void setHeight(float value) = 0;
@@ -0,0 +1,433 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "LabelBatcher.h"
+
+#include "Ogre.h"
+#include "OgreFontManager.h"
+#include "Settings.h"
+
+using namespace Ogre;
+
+/////////////// BatchedLabel
+
+BatchedLabel::BatchedLabel(const UTFString &caption, const String &fontName) :
+	  batch(0)
+	, caption(caption)
+	, charHeight(1.0f)
+	, color(ColourValue::Black)
+	, fontName(fontName)
+	, hAlign(H_LEFT)
+	, layoutDirty(true)
+	, onTop(false)
+	, position(Vector3::ZERO)
+	, radius(0.0f)
+	, scale(1.0f)
+	, vAlign(V_BELOW)
+	, visible(true)
+{
+}
+
+BatchedLabel::~BatchedLabel()
+{
+}
+
+void BatchedLabel::changed(bool relayout)
+{
+	layoutDirty |= relayout;
+	if (batch) batch->markDirty();
+}
+
+void BatchedLabel::setCaption(const UTFString &caption)
+{
+	if (caption != this->caption)
+	{
+		this->caption = caption;
+		changed(true);
+	}
+}
+
+void BatchedLabel::setPosition(const Vector3 &position)
+{
+	if (position != this->position)
+	{
+		this->position = position;
+		changed(false);
+	}
+}
+
+void BatchedLabel::setColor(const ColourValue &color)
+{
+	if (color != this->color)
+	{
+		this->color = color;
+		changed(false);
+	}
+}
+
+void BatchedLabel::setCharacterHeight(Real height)
+{
+	if (fabs(height - charHeight) > 0.00001f)
+	{
+		charHeight = height;
+		changed(true);
+	}
+}
+
+void BatchedLabel::setScale(Real scale)
+{
+	if (fabs(scale - this->scale) > 0.00001f)
+	{
+		this->scale = scale;
+		changed(false);
+	}
+}
+
+void BatchedLabel::setTextAlignment(HorizontalAlignment horizontalAlignment, VerticalAlignment verticalAlignment)
+{
+	if (hAlign != horizontalAlignment || vAlign != verticalAlignment)
+	{
+		hAlign = horizontalAlignment;
+		vAlign = verticalAlignment;
+		changed(true);
+	}
+}
+
+void BatchedLabel::setVisible(bool visible)
+{
+	if (visible != this->visible)
+	{
+		this->visible = visible;
+		changed(false);
+	}
+}
+
+void BatchedLabel::showOnTop(bool show)
+{
+	if (show == onTop) return;
+
+	// the depth check is part of the material, so the label moves to the other batch of its font
+	LabelBatch *target = LabelBatcher::getSingleton().getBatch(fontName, show);
+	batch->removeLabel(this);
+	target->addLabel(this);
+	onTop = show;
+}
+
+void BatchedLabel::layout(Font *font)
+{
+	// same glyph placement as MovableText::_setupGeometry()
+	glyphs.clear();
+	glyphs.reserve(caption.size() * 6 * 4);
+
+	const Real lineHeight = charHeight * 2.0f;
+	const Real spaceWidth = font->getGlyphAspectRatio('A') * lineHeight;
+
+	Real left = -1.0f;
+	Real top  =  1.0f;
+	Real maxSquaredRadius = 0.0f;
+
+	if (vAlign == V_ABOVE)
+	{
+		// raise the first line of the caption
+		top += charHeight;
+		for (UTFString::iterator i = caption.begin(); i != caption.end(); ++i)
+		{
+			if (*i == '\n')
+				top += lineHeight;
+		}
+	}
+
+	bool newLine = true;
+	Real len = 0.0f;
+	for (UTFString::iterator i = caption.begin(); i != caption.end(); ++i)
+	{
+		if (newLine)
+		{
+			len = 0.0f;
+			for (UTFString::iterator j = i; j != caption.end() && *j != '\n'; ++j)
+			{
+				if (*j == ' ')
+					len += spaceWidth;
+				else
+					len += font->getGlyphAspectRatio(*j) * lineHeight;
+			}
+			newLine = false;
+		}
+
+		if (*i == '\n')
+		{
+			left = -1.0f;
+			top -= lineHeight;
+			newLine = true;
+			continue;
+		}
+
+		if (*i == ' ')
+		{
+			left += spaceWidth;
+			continue;
+		}
+
+		const Font::UVRect &uv = font->getGlyphTexCoords(*i);
+		Real width = font->getGlyphAspectRatio(*i) * lineHeight;
+		Real x0 = (hAlign == H_CENTER) ? left - len / 2 : left;
+		Real x1 = x0 + width;
+		Real y0 = top;
+		Real y1 = top - lineHeight;
+
+		const float quad[6][4] =
+		{
+			{x0, y0, uv.left,  uv.top},
+			{x0, y1, uv.left,  uv.bottom},
+			{x1, y0, uv.right, uv.top},
+			{x1, y0, uv.right, uv.top},
+			{x0, y1, uv.left,  uv.bottom},
+			{x1, y1, uv.right, uv.bottom},
+		};
+		glyphs.insert(glyphs.end(), &quad[0][0], &quad[0][0] + 6 * 4);
+
+		maxSquaredRadius = std::max(maxSquaredRadius, std::max(x0 * x0, x1 * x1) + std::max(y0 * y0, y1 * y1));
+
+		left += width;
+	}
+
+	// the glyphs are 1 unit in front of the label position
+	radius = Math::Sqrt(maxSquaredRadius + 1.0f);
+	layoutDirty = false;
+}
+
+/////////////// LabelBatch
+
+LabelBatch::LabelBatch(const String &fontName, bool onTop, Real maxDistance) :
+	  camera(0)
+	, dirty(true)
+	, font(0)
+	, lastCamera(0)
+	, lastCameraOrientation(Quaternion::IDENTITY)
+	, lastCameraPosition(Vector3::ZERO)
+	, maxDistance(maxDistance)
+{
+	font = (Font *)FontManager::getSingleton().getByName(fontName).getPointer();
+	if (!font)
+		OGRE_EXCEPT(Exception::ERR_ITEM_NOT_FOUND, "Could not find font " + fontName, "LabelBatch::LabelBatch");
+	font->load();
+
+	// one material per font and depth mode, set up like the ones of MovableText
+	String materialName = "LabelBatch/" + fontName + (onTop ? "/OnTop" : "");
+	material = MaterialManager::getSingleton().getByName(materialName);
+	if (material.isNull())
+	{
+		material = font->getMaterial()->clone(materialName);
+		if (!material->isLoaded())
+			material->load();
+		material->setDepthCheckEnabled(!onTop);
+		material->setDepthBias(1.0, 1.0);
+		material->setFog(true);
+		material->setDepthWriteEnabled(onTop);
+		material->setLightingEnabled(false);
+	}
+
+	initialize(RenderOperation::OT_TRIANGLE_LIST, false);
+	setMaterial(materialName);
+	setCastShadows(false);
+
+	// the vertices are in world space, culling is done per label in fillHardwareBuffers()
+	mBox.setInfinite();
+}
+
+LabelBatch::~LabelBatch()
+{
+}
+
+void LabelBatch::addLabel(BatchedLabel *label)
+{
+	labels.push_back(label);
+	label->batch = this;
+	dirty = true;
+}
+
+void LabelBatch::removeLabel(BatchedLabel *label)
+{
+	std::vector<BatchedLabel*>::iterator it = std::find(labels.begin(), labels.end(), label);
+	if (it != labels.end())
+	{
+		labels.erase(it);
+	}
+	label->batch = 0;
+	dirty = true;
+}
+
+void LabelBatch::createVertexDeclaration()
+{
+	VertexDeclaration *decl = mRenderOp.vertexData->vertexDeclaration;
+	size_t offset = 0;
+	decl->addElement(0, offset, VET_FLOAT3, VES_POSITION);
+	offset += VertexElement::getTypeSize(VET_FLOAT3);
+	decl->addElement(0, offset, VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+	offset += VertexElement::getTypeSize(VET_FLOAT2);
+	decl->addElement(0, offset, VET_COLOUR, VES_DIFFUSE);
+}
+
+void LabelBatch::_notifyCurrentCamera(Camera *cam)
+{
+	SimpleRenderable::_notifyCurrentCamera(cam);
+	camera = cam;
+}
+
+void LabelBatch::_updateRenderQueue(RenderQueue *queue)
+{
+	if (!camera) return;
+
+	// the labels face the camera, so the buffer is only valid for the camera and pose it was written for
+	Vector3 cameraPosition = camera->getDerivedPosition();
+	Quaternion cameraOrientation = camera->getDerivedOrientation();
+	if (dirty || camera != lastCamera || cameraPosition != lastCameraPosition || cameraOrientation != lastCameraOrientation)
+	{
+		lastCamera = camera;
+		lastCameraPosition = cameraPosition;
+		lastCameraOrientation = cameraOrientation;
+		fillHardwareBuffers();
+		dirty = false;
+	}
+
+	if (mRenderOp.vertexData->vertexCount > 0)
+	{
+		SimpleRenderable::_updateRenderQueue(queue);
+	}
+}
+
+void LabelBatch::fillHardwareBuffers()
+{
+	const Real maxSquaredDistance = maxDistance * maxDistance;
+
+	visibleLabels.clear();
+	size_t vertexCount = 0;
+	for (std::vector<BatchedLabel*>::iterator it = labels.begin(); it != labels.end(); ++it)
+	{
+		BatchedLabel *label = *it;
+		if (!label->visible || label->caption.empty()) continue;
+
+		if (maxDistance > 0.0f && label->position.squaredDistance(lastCameraPosition) > maxSquaredDistance) continue;
+
+		if (label->layoutDirty)
+		{
+			label->layout(font);
+		}
+
+		if (!lastCamera->isVisible(Sphere(label->position, label->radius * label->scale * 0.5f))) continue;
+
+		visibleLabels.push_back(label);
+		vertexCount += label->glyphs.size() / 4;
+	}
+
+	prepareHardwareBuffers(vertexCount, 0);
+	if (!vertexCount) return;
+
+	// label space -> world space, like MovableText::getWorldTransforms()
+	const Vector3 right = lastCameraOrientation * Vector3::UNIT_X;
+	const Vector3 up    = lastCameraOrientation * Vector3::UNIT_Y;
+	const Vector3 front = lastCameraOrientation * Vector3::NEGATIVE_UNIT_Z;
+
+	HardwareVertexBufferSharedPtr vbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(0);
+	float *ptr = static_cast<float*>(vbuf->lock(0, vertexCount * vbuf->getVertexSize(), HardwareBuffer::HBL_DISCARD));
+	for (std::vector<BatchedLabel*>::iterator it = visibleLabels.begin(); it != visibleLabels.end(); ++it)
+	{
+		BatchedLabel *label = *it;
+		const Real s = label->scale * 0.5f;
+		const Vector3 axisX = right * s;
+		const Vector3 axisY = up * s;
+		const Vector3 origin = label->position + front * s;
+
+		RGBA color;
+		Root::getSingleton().convertColourValue(label->color, &color);
+
+		const float *glyph = &label->glyphs[0];
+		const float *end = glyph + label->glyphs.size();
+		for (; glyph != end; glyph += 4)
+		{
+			Vector3 pos = origin + axisX * glyph[0] + axisY * glyph[1];
+			*ptr++ = pos.x;
+			*ptr++ = pos.y;
+			*ptr++ = pos.z;
+			*ptr++ = glyph[2];
+			*ptr++ = glyph[3];
+			*reinterpret_cast<RGBA*>(ptr++) = color;
+		}
+	}
+	vbuf->unlock();
+}
+
+/////////////// LabelBatcher
+
+LabelBatcher::LabelBatcher() :
+	  maxDistance(FSETTING("Label Distance", 5000))
+	, node(0)
+{
+}
+
+LabelBatcher::~LabelBatcher()
+{
+	for (std::map<String, LabelBatch*>::iterator it = batches.begin(); it != batches.end(); ++it)
+	{
+		node->detachObject(it->second);
+		delete it->second;
+	}
+	batches.clear();
+	if (node)
+	{
+		gEnv->sceneManager->destroySceneNode(node);
+	}
+}
+
+LabelBatch *LabelBatcher::getBatch(const String &fontName, bool onTop)
+{
+	String key = fontName + (onTop ? "/OnTop" : "");
+	std::map<String, LabelBatch*>::iterator it = batches.find(key);
+	if (it != batches.end())
+	{
+		return it->second;
+	}
+
+	LabelBatch *batch = new LabelBatch(fontName, onTop, maxDistance);
+	if (!node)
+	{
+		node = gEnv->sceneManager->getRootSceneNode()->createChildSceneNode();
+	}
+	node->attachObject(batch);
+	batches[key] = batch;
+	return batch;
+}
+
+BatchedLabel *LabelBatcher::createLabel(const UTFString &caption, const String &fontName)
+{
+	LabelBatch *batch = getBatch(fontName, false);
+	BatchedLabel *label = new BatchedLabel(caption, fontName);
+	batch->addLabel(label);
+	return label;
+}
+
+void LabelBatcher::destroyLabel(BatchedLabel *label)
+{
+	if (!label) return;
+	if (label->batch)
+	{
+		label->batch->removeLabel(label);
+	}
+	delete label;
+}
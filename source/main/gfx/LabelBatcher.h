@@ -0,0 +1,149 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __LabelBatcher_H_
+#define __LabelBatcher_H_
+
+#include "RoRPrerequisites.h"
+
+#include "DynamicRenderable.h"
+#include "Singleton.h"
+
+/**
+* A camera facing text label, drawn by the LabelBatch of its font together with all other labels of that font.
+* Looks like a MovableText attached to a scene node at the label position, but has no buffers of its own.
+* Created and destroyed by the LabelBatcher.
+*/
+class BatchedLabel : public ZeroedMemoryAllocator
+{
+	friend class LabelBatch;
+	friend class LabelBatcher;
+
+public:
+
+	enum HorizontalAlignment {H_LEFT, H_CENTER};
+	enum VerticalAlignment   {V_BELOW, V_ABOVE};
+
+	void setCaption(const Ogre::UTFString &caption);
+	void setPosition(const Ogre::Vector3 &position);
+	void setColor(const Ogre::ColourValue &color);
+	void setCharacterHeight(Ogre::Real height);
+	void setScale(Ogre::Real scale); //!< same as the scale of the scene node a MovableText would be attached to
+	void setTextAlignment(HorizontalAlignment horizontalAlignment, VerticalAlignment verticalAlignment);
+	void setVisible(bool visible);
+	void showOnTop(bool show=true);
+
+	const Ogre::UTFString &getCaption() const { return caption; };
+	const Ogre::Vector3 &getPosition() const { return position; };
+	Ogre::Real getCharacterHeight() const { return charHeight; };
+	bool isVisible() const { return visible; };
+	bool getShowOnTop() const { return onTop; };
+
+private:
+
+	BatchedLabel(const Ogre::UTFString &caption, const Ogre::String &fontName);
+	~BatchedLabel();
+
+	// rebuilds the glyph quads, only called when the caption, size or alignment changed
+	void layout(Ogre::Font *font);
+
+	void changed(bool relayout);
+
+	LabelBatch *batch;
+	Ogre::String fontName;
+	Ogre::UTFString caption;
+	Ogre::Vector3 position;
+	Ogre::ColourValue color;
+	Ogre::Real charHeight;
+	Ogre::Real scale;
+	HorizontalAlignment hAlign;
+	VerticalAlignment vAlign;
+	bool visible;
+	bool onTop;
+
+	std::vector<float> glyphs; //!< x, y, u, v of 6 vertices per glyph, in label space
+	Ogre::Real radius;         //!< of the glyphs in label space
+	bool layoutDirty;
+};
+
+/**
+* All visible labels of one font in a single dynamic vertex buffer.
+* The buffer is only rewritten when a label or the camera changed, labels out of range or out of the view are left out.
+*/
+class LabelBatch : public DynamicRenderable
+{
+public:
+
+	LabelBatch(const Ogre::String &fontName, bool onTop, Ogre::Real maxDistance);
+	virtual ~LabelBatch();
+
+	void addLabel(BatchedLabel *label);
+	void removeLabel(BatchedLabel *label);
+
+	void markDirty() { dirty = true; };
+
+	void _notifyCurrentCamera(Ogre::Camera *cam);
+	void _updateRenderQueue(Ogre::RenderQueue *queue);
+
+protected:
+
+	void createVertexDeclaration();
+	void fillHardwareBuffers();
+
+private:
+
+	Ogre::Font *font;
+	Ogre::MaterialPtr material;
+	Ogre::Real maxDistance; //!< 0 = unlimited
+
+	std::vector<BatchedLabel*> labels;
+	std::vector<BatchedLabel*> visibleLabels; //!< scratch list of fillHardwareBuffers()
+
+	Ogre::Camera *camera;            //!< the camera the queue is updated for
+	Ogre::Camera *lastCamera;        //!< the camera the buffer was written for
+	Ogre::Vector3 lastCameraPosition;
+	Ogre::Quaternion lastCameraOrientation;
+	bool dirty;
+};
+
+/**
+* Owns all labels and the batches drawing them, one batch per font and depth mode.
+*/
+class LabelBatcher : public RoRSingleton<LabelBatcher>, public ZeroedMemoryAllocator
+{
+	friend class BatchedLabel;
+
+public:
+
+	LabelBatcher();
+	~LabelBatcher();
+
+	BatchedLabel *createLabel(const Ogre::UTFString &caption, const Ogre::String &fontName = "CyberbitEnglish");
+	void destroyLabel(BatchedLabel *label);
+
+private:
+
+	LabelBatch *getBatch(const Ogre::String &fontName, bool onTop);
+
+	std::map<Ogre::String, LabelBatch*> batches;
+	Ogre::SceneNode *node;
+	Ogre::Real maxDistance;
+};
+
+#endif // __LabelBatcher_H_
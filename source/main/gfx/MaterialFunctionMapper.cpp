@@ -19,13 +19,12 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "MaterialFunctionMapper.h"
 
+#include "MaterialInstanceCache.h"
 #include "Ogre.h"
 #include "Settings.h"
 
 using namespace Ogre;
 
-int MaterialFunctionMapper::simpleMaterialCounter = 0;
-
 void MaterialFunctionMapper::addMaterial(int flareid, materialmapping_t t)
 {
 	MaterialPtr m = Ogre::MaterialManager::getSingleton().getByName(t.material);
@@ -150,15 +149,16 @@ void MaterialFunctionMapper::replaceSimpleMeshMaterials(Ogre::Entity *e, Ogre::C
 	}
 	if (!BSETTING("SimpleMaterials", false)) return;
 
-	MaterialPtr mat = MaterialManager::getSingleton().getByName("tracks/simple");
-	if (mat.isNull()) return;
-
-	String newMatName = "tracks/simple/" + TOSTRING(simpleMaterialCounter);
-	MaterialPtr newmat = mat->clone(newMatName);
-
-	newmat->getTechnique(0)->getPass(0)->setAmbient(c);
+	// one material per colour, shared by all entities
+	String newMatName = "tracks/simple/" + TOSTRING(c.getAsRGBA());
+	bool created = false;
+	MaterialPtr newmat = MaterialInstanceCache::getSingleton().getShared("tracks/simple", newMatName, created);
+	if (newmat.isNull()) return;
 
-	simpleMaterialCounter++;
+	if (created)
+	{
+		newmat->getTechnique(0)->getPass(0)->setAmbient(c);
+	}
 	
 	MeshPtr m = e->getMesh();
 	if (!m.isNull())
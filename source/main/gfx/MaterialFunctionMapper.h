@@ -44,7 +44,6 @@ public:
 
 private:
 
-	static int simpleMaterialCounter;
 	std::map <int, std::vector<materialmapping_t> > materialBindings;
 };
 
@@ -0,0 +1,69 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "MaterialInstanceCache.h"
+
+#include <OgreMaterialManager.h>
+
+using namespace Ogre;
+
+MaterialInstanceCache::MaterialInstanceCache() :
+	  cloned(0)
+	, shared(0)
+{
+}
+
+MaterialPtr MaterialInstanceCache::getShared(String const & source_name, String const & instance_name, bool & created)
+{
+	created = false;
+
+	MaterialPtr instance = MaterialManager::getSingleton().getByName(instance_name);
+	if (!instance.isNull())
+	{
+		shared++;
+		return instance;
+	}
+
+	MaterialPtr source = MaterialManager::getSingleton().getByName(source_name);
+	if (source.isNull())
+	{
+		return MaterialPtr();
+	}
+
+	created = true;
+	cloned++;
+	return source->clone(instance_name);
+}
+
+MaterialPtr MaterialInstanceCache::clonePerInstance(String const & source_name, String const & instance_name)
+{
+	MaterialPtr source = MaterialManager::getSingleton().getByName(source_name);
+	if (source.isNull())
+	{
+		return MaterialPtr();
+	}
+
+	if (MaterialManager::getSingleton().resourceExists(instance_name))
+	{
+		MaterialManager::getSingleton().remove(instance_name);
+	}
+
+	cloned++;
+	return source->clone(instance_name);
+}
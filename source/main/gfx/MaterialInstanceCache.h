@@ -0,0 +1,62 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __MaterialInstanceCache_H_
+#define __MaterialInstanceCache_H_
+
+#include "RoRPrerequisites.h"
+
+#include "Singleton.h"
+
+/**
+* Creates the material clones vehicles need.
+* A clone which only depends on its source and on data shared by all vehicles of a kind (skin,
+* managed material definition, cab material) is shared by everyone asking for the same name.
+* Clones with per-vehicle runtime state (flare bindings, cab shadows) are made per vehicle.
+*/
+class MaterialInstanceCache : public RoRSingleton<MaterialInstanceCache>, public ZeroedMemoryAllocator
+{
+public:
+
+	MaterialInstanceCache();
+
+	/**
+	* Returns the shared clone 'instance_name' of 'source_name', it's cloned on first use.
+	* @param created Set to true if this call created the clone, the caller has to set it up then
+	* @return Null if the source material doesn't exist
+	*/
+	Ogre::MaterialPtr getShared(Ogre::String const & source_name, Ogre::String const & instance_name, bool & created);
+
+	/**
+	* Clones 'source_name' for a single vehicle; a leftover clone of the same name (from a
+	* removed vehicle which used the same slot) is replaced.
+	* @return Null if the source material doesn't exist
+	*/
+	Ogre::MaterialPtr clonePerInstance(Ogre::String const & source_name, Ogre::String const & instance_name);
+
+	unsigned int getClonedCount() { return cloned; };
+	unsigned int getSharedCount() { return shared; };
+
+private:
+
+	unsigned int cloned; //!< materials created
+	unsigned int shared; //!< requests answered with an existing clone
+};
+
+#endif // __MaterialInstanceCache_H_
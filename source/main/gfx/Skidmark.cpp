@@ -20,14 +20,146 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Skidmark.h"
 
 #include "BeamData.h"
-#include "IHeightFinder.h"
 #include "Ogre.h"
 
 using namespace Ogre;
 
-int Skidmark::instanceCounter = 0;
+const float SkidmarkManager::MAX_AGE = 300.0f;
 
-SkidmarkManager::SkidmarkManager()
+/////////////// SkidmarkBatch
+
+SkidmarkBatch::SkidmarkBatch(String materialname, int capacity) :
+	  capacity(capacity)
+	, head(0)
+	, count(0)
+	, used(0)
+	, dirtyFirst(-1)
+	, dirtyLast(-1)
+{
+	skidmark_quad_t empty;
+	for (int i=0; i < 4; i++) empty.corners[i] = Vector3::ZERO;
+	empty.v0 = empty.v1 = empty.time = 0.0f;
+	quads.resize(capacity, empty);
+
+	initialize(RenderOperation::OT_TRIANGLE_LIST, true);
+	setMaterial(materialname);
+	setRenderingDistance(2000); //2km sight range
+	setCastShadows(false);
+	mBox.setNull();
+
+	fillHardwareBuffers();
+}
+
+SkidmarkBatch::~SkidmarkBatch()
+{
+}
+
+void SkidmarkBatch::createVertexDeclaration()
+{
+	VertexDeclaration *decl = mRenderOp.vertexData->vertexDeclaration;
+	size_t offset = 0;
+	decl->addElement(0, offset, VET_FLOAT3, VES_POSITION);
+	offset += VertexElement::getTypeSize(VET_FLOAT3);
+	decl->addElement(0, offset, VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+}
+
+void SkidmarkBatch::fillHardwareBuffers()
+{
+	// allocates the buffers for the whole ring once, the indices never change
+	prepareHardwareBuffers(capacity * 4, capacity * 6);
+
+	unsigned short *idx = static_cast<unsigned short*>(mRenderOp.indexData->indexBuffer->lock(HardwareBuffer::HBL_DISCARD));
+	for (int i=0; i < capacity; i++)
+	{
+		unsigned short v = (unsigned short)(i * 4);
+		*idx++ = v;     *idx++ = v + 1; *idx++ = v + 2;
+		*idx++ = v + 2; *idx++ = v + 1; *idx++ = v + 3;
+	}
+	mRenderOp.indexData->indexBuffer->unlock();
+
+	writeQuads(0, capacity - 1);
+	mRenderOp.indexData->indexCount = used * 6;
+}
+
+void SkidmarkBatch::writeQuads(int first, int last)
+{
+	HardwareVertexBufferSharedPtr vbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(0);
+	size_t vertexSize = vbuf->getVertexSize();
+	HardwareBuffer::LockOptions lock = (first == 0 && last == capacity - 1) ? HardwareBuffer::HBL_DISCARD : HardwareBuffer::HBL_NORMAL;
+
+	float *ptr = static_cast<float*>(vbuf->lock(first * 4 * vertexSize, (last - first + 1) * 4 * vertexSize, lock));
+	for (int i=first; i <= last; i++)
+	{
+		const skidmark_quad_t &q = quads[i];
+		const float u[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+		const float v[4] = {q.v0, q.v0, q.v1, q.v1};
+		for (int c=0; c < 4; c++)
+		{
+			*ptr++ = q.corners[c].x;
+			*ptr++ = q.corners[c].y;
+			*ptr++ = q.corners[c].z;
+			*ptr++ = u[c];
+			*ptr++ = v[c];
+		}
+	}
+	vbuf->unlock();
+}
+
+void SkidmarkBatch::addQuad(const Vector3 *corners, float v0, float v1, float time)
+{
+	// a full ring overwrites the oldest quad
+	skidmark_quad_t &q = quads[head];
+	for (int i=0; i < 4; i++)
+	{
+		q.corners[i] = corners[i];
+		mBox.merge(corners[i]);
+	}
+	q.v0   = v0;
+	q.v1   = v1;
+	q.time = time;
+
+	dirtyFirst = (dirtyFirst == -1) ? head : std::min(dirtyFirst, head);
+	dirtyLast  = std::max(dirtyLast, head);
+
+	head  = (head + 1) % capacity;
+	count = std::min(count + 1, capacity);
+	used  = std::max(used, head == 0 ? capacity : head);
+}
+
+void SkidmarkBatch::update(float expire_time)
+{
+	// the oldest quad is at head - count
+	while (count > 0)
+	{
+		int tail = (head - count + capacity) % capacity;
+		if (quads[tail].time >= expire_time) break;
+
+		// collapse it, degenerate triangles are not rasterized
+		for (int i=0; i < 4; i++) quads[tail].corners[i] = Vector3::ZERO;
+		dirtyFirst = (dirtyFirst == -1) ? tail : std::min(dirtyFirst, tail);
+		dirtyLast  = std::max(dirtyLast, tail);
+		count--;
+	}
+
+	if (dirtyFirst == -1) return;
+
+	writeQuads(dirtyFirst, dirtyLast);
+	mRenderOp.indexData->indexCount = used * 6;
+	dirtyFirst = dirtyLast = -1;
+
+	if (!count)
+	{
+		mBox.setNull();
+	}
+	if (mParentNode)
+	{
+		mParentNode->needUpdate();
+	}
+}
+
+/////////////// SkidmarkManager
+
+SkidmarkManager::SkidmarkManager() : node(0), time(0.0f)
 {
 	LOG("SkidmarkManager created");
 	loadDefaultModels();
@@ -35,6 +167,17 @@ SkidmarkManager::SkidmarkManager()
 
 SkidmarkManager::~SkidmarkManager()
 {
+	for (size_t i=0; i < batches.size(); i++)
+	{
+		if (!batches[i]) continue;
+		node->detachObject(batches[i]);
+		delete batches[i];
+	}
+	batches.clear();
+	if (node)
+	{
+		gEnv->sceneManager->destroySceneNode(node);
+	}
 	LOG("SkidmarkManager destroyed");
 }
 
@@ -91,317 +234,169 @@ int SkidmarkManager::processLine(StringVector args,  String modelName)
 		return 1;
 	
 	// parse the data
-	skidmark_config_t cfg;
-	cfg.ground = args[0];
-	StringUtil::trim(cfg.ground);
-	cfg.texture = args[1];
-	StringUtil::trim(cfg.texture);
+	String ground = args[0];
+	StringUtil::trim(ground);
+	String texture = args[1];
+	StringUtil::trim(texture);
 
+	skidmark_config_t cfg;
+	cfg.texture = getTextureId(texture);
 	cfg.slipFrom = StringConverter::parseReal(args[2]);
 	cfg.slipTo = StringConverter::parseReal(args[3]);
 
-	if (!models.size() || models.find(modelName) == models.end())
-		models[modelName] = std::vector<skidmark_config_t>();
-
-	models[modelName].push_back(cfg);
+	models[modelName][ground].push_back(cfg);
 	return 0;
 }
 
-int SkidmarkManager::getTexture(String model, String ground, float slip, String &texture)
+int SkidmarkManager::getTextureId(String texture)
 {
-	if (models.find(model) == models.end()) return 1;
-	for (std::vector<skidmark_config_t>::iterator it=models[model].begin(); it!=models[model].end(); it++)
+	for (size_t i=0; i < textures.size(); i++)
 	{
-		if (it->ground == ground && it->slipFrom <= slip && it->slipTo > slip)
-		{
-			texture = it->texture;
-			return 0;
-		}
+		if (textures[i] == texture) return (int)i;
 	}
-	return 2;
+	textures.push_back(texture);
+	batches.push_back(0);
+	return (int)textures.size() - 1;
 }
 
-/////////////// Skidmark below
-
-// this is a hardcoded array which we use to map ground types to a certain texture with UV/ coords
-Vector2 Skidmark::tex_coords[4] = {Vector2(0,0), Vector2(0,1), Vector2(1,0), Vector2(1,1)};
-
-Skidmark::Skidmark(wheel_t *wheel, Ogre::SceneNode *snode, int lenght /* = 500 */, int bucketCount /* = 20 */) :
-	  mNode(snode)
-	, mDirty(true)
-	, lenght(lenght)
-	, bucketCount(bucketCount)
-	, wheel(wheel)
-	, minDistance(0.1f)
-	, maxDistance(std::max(0.5f, wheel->width*1.1f))
-	, minDistanceSquared(minDistance * minDistance)
-	, maxDistanceSquared(maxDistance * maxDistance)
+const SkidmarkManager::ground_config_t *SkidmarkManager::getGroundConfig(String model, String ground)
 {
-	if (lenght % 2)
-	{
-		lenght--;
-	}
+	std::map <String, std::map <String, ground_config_t> >::iterator it = models.find(model);
+	if (it == models.end()) return NULL;
+	std::map <String, ground_config_t>::iterator git = it->second.find(ground);
+	if (git == it->second.end()) return NULL;
+	return &git->second;
 }
 
-Skidmark::~Skidmark()
+int SkidmarkManager::getTexture(const ground_config_t *config, float slip)
 {
+	if (!config) return -1;
+	for (size_t i=0; i < config->size(); i++)
+	{
+		if ((*config)[i].slipFrom <= slip && (*config)[i].slipTo > slip)
+		{
+			return (*config)[i].texture;
+		}
+	}
+	return -1;
 }
 
-void Skidmark::addObject(Vector3 start, String texture)
+void SkidmarkManager::addQuad(int texture, const Vector3 *corners, float v0, float v1)
 {
-	//LOG("new skidmark section");
-	skidmark_t skid;
-	skid.pos=0;
-	skid.lastPointAv=start;
-	skid.facecounter=0;
-	skid.face[0] = Vector3::ZERO;
-	skid.face[1] = Vector3::ZERO;
-	skid.colour = ColourValue(Math::RangeRandom(0, 100)/100.0f, Math::RangeRandom(0, 100)/100.0f, Math::RangeRandom(0, 100)/100.0f, 0.8f);
-
-
-	// new material
-	char bname[256]="";
-	sprintf(bname, "mat-skidmark-%d", instanceCounter);
-	MaterialPtr mat=(MaterialPtr)(MaterialManager::getSingleton().create(bname, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME));
-	Pass *p = mat->getTechnique(0)->getPass(0);
-	
-	p->setSceneBlending(SBT_TRANSPARENT_ALPHA);
-	p->setLightingEnabled(false);
-	p->setDepthWriteEnabled(false);
-	p->setDepthBias(3, 3);
-	p->setCullingMode(CULL_NONE);
-
-	skid.points.resize(lenght);
-	skid.faceSizes.resize(lenght);
-	skid.groundTexture.resize(lenght);
-	skid.obj = gEnv->sceneManager->createManualObject("skidmark" + TOSTRING(instanceCounter++));
-	skid.obj->setDynamic(true);
-	skid.obj->setRenderingDistance(2000); //2km sight range
-	skid.obj->begin(bname, RenderOperation::OT_TRIANGLE_STRIP);
-	for (int i = 0; i < lenght; i++)
+	if (!batches[texture])
 	{
-		skid.points[i] = start;
-		skid.faceSizes[i] = 0;
-		skid.groundTexture[i] = "0.png";
-		skid.obj->position(start);
-		skid.obj->textureCoord(0,0);
-	}
-    skid.obj->end();
-	mNode->attachObject(skid.obj);
-
+		// new material
+		String bname = "mat-skidmark-" + textures[texture];
+		MaterialPtr mat=(MaterialPtr)(MaterialManager::getSingleton().create(bname, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME));
+		Pass *p = mat->getTechnique(0)->getPass(0);
+
+		p->setSceneBlending(SBT_TRANSPARENT_ALPHA);
+		p->setLightingEnabled(false);
+		p->setDepthWriteEnabled(false);
+		p->setDepthBias(3, 3);
+		p->setCullingMode(CULL_NONE);
+		p->createTextureUnitState(textures[texture]);
+
+		if (!node)
+		{
+			node = gEnv->sceneManager->getRootSceneNode()->createChildSceneNode();
+		}
 
-	objects.push(skid);
+		batches[texture] = new SkidmarkBatch(bname, BATCH_CAPACITY);
+		node->attachObject(batches[texture]);
+	}
 
-	limitObjects();
+	batches[texture]->addQuad(corners, v0, v1, time);
 }
 
-void Skidmark::limitObjects()
+void SkidmarkManager::update(float dt)
 {
-	if ((int)objects.size() > bucketCount)
+	time += dt;
+
+	for (size_t i=0; i < batches.size(); i++)
 	{
-		//LOG("deleting first skidmarks section to keep the limits");
-		objects.front().points.clear();
-		objects.front().faceSizes.clear();
-		gEnv->sceneManager->destroyManualObject(objects.front().obj);
-		objects.pop();
+		if (batches[i]) batches[i]->update(time - MAX_AGE);
 	}
 }
 
-void Skidmark::setPointInt(unsigned short index, const Vector3 &value, Real fsize, String texture)
+/////////////// Skidmark below
+
+Skidmark::Skidmark(wheel_t *wheel) :
+	  wheel(wheel)
+	, groundModel(0)
+	, groundConfig(0)
+	, texture(-1)
+	, texCoord(0.0f)
+	, minDistance(0.1f)
+	, maxDistance(std::max(0.5f, wheel->width*1.1f))
 {
-	objects.back().points[index] = value;
-	objects.back().faceSizes[index] = fsize;
-	objects.back().groundTexture[index] = texture;
+}
 
-	mDirty = true;
+Skidmark::~Skidmark()
+{
 }
 
 void Skidmark::updatePoint()
 {
-	Vector3 thisPoint = wheel->lastContactType?wheel->lastContactOuter:wheel->lastContactInner;
-	Vector3 axis = wheel->lastContactType?(wheel->refnode1->RelPosition - wheel->refnode0->RelPosition):(wheel->refnode0->RelPosition - wheel->refnode1->RelPosition);
-	Vector3 thisPointAV = thisPoint + axis * 0.5f;
-	Real distance = 0;
-	Real maxDist = maxDistance;
-	String texture = "none";
-	SkidmarkManager::getSingleton().getTexture("default", wheel->lastGroundModel->name, wheel->lastSlip, texture);
-	
-	// dont add points with no texture
-	if (texture == "none") return;
+	// the string lookup only happens when the wheel rolls onto another ground
+	if (wheel->lastGroundModel != groundModel)
+	{
+		groundModel = wheel->lastGroundModel;
+		groundConfig = SkidmarkManager::getSingleton().getGroundConfig("default", groundModel->name);
+	}
 
-	if (wheel->speed > 1) maxDist *= wheel->speed;
+	int newTexture = SkidmarkManager::getTexture(groundConfig, wheel->lastSlip);
 
-	if (!objects.size())
+	// no texture, the trail ends here
+	if (newTexture == -1)
 	{
-		// add first bucket
-		addObject(thisPoint, texture);
-	} else
-	{
-		// check existing buckets
-		skidmark_t skid = objects.back();
-
-		distance = skid.lastPointAv.distance(thisPointAV);
-		// too near to update?
-		if (distance < minDistance)
-		{
-			//LOG("E: too near for update");
-			return;
-		}
-		
-		// change ground texture if required
-		if (skid.pos > 0 && skid.groundTexture[0] != texture)
-		{
-			// new object with new texture
-			if (distance > maxDist)
-			{
-				// to far away for connection
-				addObject(thisPoint, texture);
-			} else
-			{
-				// add new bucket with connection to last bucket
-				Vector3 lp1 = objects.back().points[objects.back().pos-1];
-				Vector3 lp2 = objects.back().points[objects.back().pos-2];
-				addObject(lp1, texture);
-				addPoint(lp2, distance, texture);
-				addPoint(lp1, distance, texture);
-			}
-		} else
-		{
-			// no texture change required :D
-
-			// far enough for new bucket?
-			if (skid.pos >= (int)skid.points.size())
-			{
-				if (distance > maxDist)
-				{
-					// to far away for connection
-					addObject(thisPoint, texture);
-				} else
-				{
-					// add new bucket with connection to last bucket
-					Vector3 lp1 = objects.back().points[objects.back().pos-1];
-					Vector3 lp2 = objects.back().points[objects.back().pos-2];
-					addObject(lp1, texture);
-					addPoint(lp2, distance, texture);
-					addPoint(lp1, distance, texture);
-				}
-			}
-			else if (distance > maxDistance)
-			{
-				// just new bucket, no connection to last bucket
-				addObject(thisPoint, texture);
-			}
-		}
+		texture = -1;
+		return;
 	}
 
-	skidmark_t skid = objects.back();
-
-	float overaxis = 0.2f;
-	// tactics: we always choose the latest oint and then create two points
-	
-	// XXX: TO BE IMPROVED
-	//Vector3 groundNormal = Vector3::ZERO;
-	//hfinder->getNormalAt(thisPoint.x, thisPoint.y, thisPoint.z, &groundNormal);
+	Vector3 thisPoint = wheel->lastContactType?wheel->lastContactOuter:wheel->lastContactInner;
+	Vector3 axis = wheel->lastContactType?(wheel->refnode1->RelPosition - wheel->refnode0->RelPosition):(wheel->refnode0->RelPosition - wheel->refnode1->RelPosition);
+	Vector3 thisPointAV = thisPoint + axis * 0.5f;
 
-	//LOG("ground normal: "+TOSTRING(wheel->refnode1->RelPosition.dotProduct(groundNormal)));
+	Real distance = lastPointAv.distance(thisPointAV);
+	// too near to update?
+	if (texture != -1 && distance < minDistance) return;
 
-	// choose node wheel by the latest added point
+	float overaxis = 0.2f;
+	Vector3 newEdge[2];
+	// both contact sides give the edge points in the same order, from refnode1 to refnode0
 	if (!wheel->lastContactType)
 	{
 		// choose inner
-		//LOG("inner");
-		addPoint(wheel->lastContactInner - (axis * overaxis), distance, texture);
-		addPoint(wheel->lastContactInner + axis + (axis * overaxis), distance, texture);
+		newEdge[0] = wheel->lastContactInner - (axis * overaxis);
+		newEdge[1] = wheel->lastContactInner + axis + (axis * overaxis);
 	} else
 	{
 		// choose outer
-		//LOG("outer");
-		addPoint(wheel->lastContactOuter + axis + (axis * overaxis), distance, texture);
-		addPoint(wheel->lastContactOuter - (axis * overaxis), distance, texture);
+		newEdge[0] = wheel->lastContactOuter + axis + (axis * overaxis);
+		newEdge[1] = wheel->lastContactOuter - (axis * overaxis);
 	}
 
-	// save as last point (in the middle of the wheel)
-	objects.back().lastPointAv = thisPointAV;
-
-	/*
-	// debug code: adds boxes to the average point
-	SceneNode *sn = mNode->getParentSceneNode()->createChildSceneNode();
-	sn->attachObject(gEnv->ogreSceneManager->createEntity("addPointTRACK"+TOSTRING(objects.back().lastPointAv) +TOSTRING(axis), "beam.mesh"));
-	sn->setPosition(thisPointAV);
-	sn->setScale(0.1f, 0.01f, 0.1f);
-	*/
-
-}
+	Real maxDist = maxDistance;
+	if (wheel->speed > 1) maxDist *= wheel->speed;
 
-void Skidmark::addPoint(const Vector3 &value, Real fsize, String texture)
-{
-	if (objects.back().pos >= lenght)
+	if (texture == newTexture && distance <= maxDist)
 	{
-		//LOG("E: boundary protection hit");
-		return;
-	}
-	setPointInt(objects.back().pos, value, fsize, texture);
-	objects.back().pos++;
-}
-
-void Skidmark::update()
-{
-	if (!objects.size()) return;
-	skidmark_t skid = objects.back();
-	Vector3 vaabMin = skid.points[0];
-	Vector3 vaabMax = skid.points[0];
-	skid.obj->beginUpdate(0);
-	bool behindEnd = false;
-	Vector3 lastValid = Vector3::ZERO;
-	int to_counter=0;
-	float tcox_counter=0;
-
-	for (int i = 0; i < lenght; i++, to_counter++)
+		// continue the trail
+		float width = std::max(minDistance, newEdge[0].distance(newEdge[1]));
+		float newTexCoord = texCoord + distance / width;
+		Vector3 corners[4] = {edge[0], edge[1], newEdge[0], newEdge[1]};
+		SkidmarkManager::getSingleton().addQuad(texture, corners, texCoord, newTexCoord);
+		// keep the coordinates small, the texture repeats anyway
+		texCoord = newTexCoord - floor(newTexCoord);
+	} else
 	{
-		if (i>=skid.pos) behindEnd=true;
-
-		if (to_counter>3)
-			to_counter=0;
-
-		if (!behindEnd)
-			tcox_counter += skid.faceSizes[i] / minDistance;
-
-		while(tcox_counter>1)
-			tcox_counter--;
-
-		if (behindEnd)
-		{
-			skid.obj->position(lastValid);
-			skid.obj->textureCoord(0,0);
-		} else
-		{
-			skid.obj->position(skid.points[i]);
-
-			Vector2 tco = tex_coords[to_counter];
-			tco.x *= skid.faceSizes[i] / minDistance; // scale texture according face size
-			skid.obj->textureCoord(tco);
-
-			lastValid = skid.points[i];
-		}
-		
-		if (skid.points[i].x < vaabMin.x) vaabMin.x = skid.points[i].x;
-		if (skid.points[i].y < vaabMin.y) vaabMin.y = skid.points[i].y;
-		if (skid.points[i].z < vaabMin.z) vaabMin.z = skid.points[i].z;
-		if (skid.points[i].x > vaabMax.x) vaabMax.x = skid.points[i].x;
-		if (skid.points[i].y > vaabMax.y) vaabMax.y = skid.points[i].y;
-		if (skid.points[i].z > vaabMax.z) vaabMax.z = skid.points[i].z;
+		// start a new trail
+		texCoord = 0.0f;
 	}
-    skid.obj->end();
 
-	skid.obj->setBoundingBox(AxisAlignedBox(vaabMin, vaabMax));
-	
-	// Use infinite AAB to always stay visible
-	/*
-	// for debugging only
-	AxisAlignedBox aabInf;
-	aabInf.setInfinite();
-	skid.obj->setBoundingBox(aabInf);
-	*/
-
-	mDirty = false;
+	texture = newTexture;
+	edge[0] = newEdge[0];
+	edge[1] = newEdge[1];
+	lastPointAv = thisPointAV;
 }
@@ -22,78 +22,134 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "DynamicRenderable.h"
 #include "Singleton.h"
 
+/**
+* All skidmark quads of one texture in a single dynamic vertex buffer, used as a ring buffer:
+* new quads overwrite the oldest ones, quads older than SkidmarkManager::MAX_AGE are collapsed.
+*/
+class SkidmarkBatch : public DynamicRenderable
+{
+public:
+
+	SkidmarkBatch(Ogre::String materialname, int capacity);
+	virtual ~SkidmarkBatch();
+
+	/**
+	* @param corners Two points of the previous edge, then two points of the new edge
+	* @param v0 Texture coordinate along the trail at the previous edge
+	* @param v1 Texture coordinate along the trail at the new edge
+	*/
+	void addQuad(const Ogre::Vector3 *corners, float v0, float v1, float time);
+
+	/**
+	* Collapses the quads created before 'expire_time' and uploads all changed quads
+	*/
+	void update(float expire_time);
+
+protected:
+
+	void createVertexDeclaration();
+	void fillHardwareBuffers();
+
+private:
+
+	typedef struct _skidmark_quad
+	{
+		Ogre::Vector3 corners[4];
+		float v0, v1;
+		float time;
+	} skidmark_quad_t;
+
+	void writeQuads(int first, int last);
+
+	std::vector<skidmark_quad_t> quads;
+	int capacity;
+	int head;          //!< next slot to write
+	int count;         //!< live quads, ending at head
+	int used;          //!< slots written at least once, only those are drawn
+	int dirtyFirst;    //!< range of slots to upload, -1 = nothing to upload
+	int dirtyLast;
+};
+
 class SkidmarkManager : public RoRSingleton<SkidmarkManager>, public ZeroedMemoryAllocator
 {
 public:
 
 	SkidmarkManager();
 	~SkidmarkManager();
-	
-	int getTexture(Ogre::String model, Ogre::String ground, float slip, Ogre::String &texture);
-
-private:
 
 	typedef struct _skidmark_config
 	{
-		Ogre::String ground;
-		Ogre::String texture;
+		int texture;
 		float slipFrom;
 		float slipTo;
 	} skidmark_config_t;
 
+	typedef std::vector<skidmark_config_t> ground_config_t;
+
+	/**
+	* @return the slip ranges of the model on the ground, NULL if it has none
+	*/
+	const ground_config_t *getGroundConfig(Ogre::String model, Ogre::String ground);
+
+	/**
+	* @return the texture id for the slip, -1 if no skidmark should be drawn
+	*/
+	static int getTexture(const ground_config_t *config, float slip);
+
+	/**
+	* Adds a quad to the batch of the texture, see SkidmarkBatch::addQuad()
+	*/
+	void addQuad(int texture, const Ogre::Vector3 *corners, float v0, float v1);
+
+	/**
+	* Recycles old quads and uploads the new ones; call once per frame.
+	*/
+	void update(float dt);
+
+	static const int BATCH_CAPACITY = 8192; //!< quads per texture, 6 indices each need to fit into 16 bit
+	static const float MAX_AGE;             //!< seconds until a quad is recycled
+
+private:
+
 	int loadDefaultModels();
-	std::map <Ogre::String, std::vector<skidmark_config_t> > models;
 	int processLine(Ogre::StringVector args,  Ogre::String model);
+	int getTextureId(Ogre::String texture);
+
+	// model -> ground -> slip ranges
+	std::map <Ogre::String, std::map <Ogre::String, ground_config_t> > models;
+
+	std::vector<Ogre::String> textures;    //!< texture names by id
+	std::vector<SkidmarkBatch*> batches;   //!< by texture id, created on first use
+	Ogre::SceneNode *node;
+	float time;
 };
 
+/**
+* Follows the contact of one wheel and adds a quad to the SkidmarkManager for every step it makes.
+*/
 class Skidmark : public ZeroedMemoryAllocator
 {
 public:
 
-	/// Constructor - see setOperationType() for description of argument.
-	Skidmark( wheel_t *wheel, Ogre::SceneNode *snode, int lenght = 500, int bucketCount = 20);
+	Skidmark(wheel_t *wheel);
 	virtual ~Skidmark();
 
 	void updatePoint();
 
-	void update();
-
 private:
 
-	static int instanceCounter;
-
-	typedef struct _skidmark
-	{
-		Ogre::ManualObject *obj;
-		std::vector<Ogre::Vector3> points;
-		std::vector<Ogre::Real> faceSizes;
-		std::vector<Ogre::String> groundTexture;
-		Ogre::Vector3 lastPointAv;
-		int pos;
-		Ogre::ColourValue colour;
-		Ogre::Vector3 face[2];
-		int facecounter;
-	} skidmark_t;
-
-	Ogre::SceneNode *mNode;
-	
-	bool mDirty;
+	wheel_t *wheel;
+	ground_model_t *groundModel;                         //!< ground model of groundConfig
+	const SkidmarkManager::ground_config_t *groundConfig;
+	int texture;                                         //!< texture of the current trail, -1 = no trail
+	Ogre::Vector3 edge[2];                               //!< last edge of the current trail
+	Ogre::Vector3 lastPointAv;
+	float texCoord;
 	float maxDistance;
-	float maxDistanceSquared;
 	float minDistance;
-	float minDistanceSquared;
-	int bucketCount;
-	int lenght;
-	static Ogre::Vector2 tex_coords[4];
-	std::queue<skidmark_t> objects;
-	wheel_t *wheel;
-	
-	void limitObjects();
-	void addObject(Ogre::Vector3 start, Ogre::String texture);
-	void setPointInt(unsigned short index, const Ogre::Vector3 &value, Ogre::Real fsize, Ogre::String texture);
-	void addPoint(const Ogre::Vector3 &value, Ogre::Real fsize, Ogre::String texture);
 };
 
 #endif // __SkidMark_H_
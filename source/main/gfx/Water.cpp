@@ -20,6 +20,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Water.h"
 
 #include "Application.h"
+#include "ApproxMath.h"
 #include "OgreSubsystem.h"
 #include "ResourceBuffer.h"
 #include "RoRFrameListener.h"
@@ -121,7 +122,7 @@ Water::Water(const Ogre::ConfigFile &mTerrainConfig)
 		FILE *fd = fopen((SSETTING("Config Root", "")+"wavefield.cfg").c_str(), "r");
 		if (fd)
 		{
-			while (!feof(fd))
+			while (!feof(fd) && free_wavetrain < MAX_WAVETRAINS)
 			{
 				int res = fscanf(fd," %[^\n\r]",line);
 				if (line[0] == ';') continue;
@@ -139,8 +140,14 @@ Water::Water(const Ogre::ConfigFile &mTerrainConfig)
 		for (int i=0; i<free_wavetrain; i++)
 		{
 			wavetrains[i].wavespeed=1.25*sqrt(wavetrains[i].wavelength);
+			wavetrains[i].dirx=sin(wavetrains[i].direction);
+			wavetrains[i].dirz=cos(wavetrains[i].direction);
+			wavetrains[i].kx=Math::TWO_PI*wavetrains[i].dirx/wavetrains[i].wavelength;
+			wavetrains[i].kz=Math::TWO_PI*wavetrains[i].dirz/wavetrains[i].wavelength;
+			wavetrains[i].angularspeed=Math::TWO_PI*wavetrains[i].wavespeed/wavetrains[i].wavelength;
 			maxampl+=wavetrains[i].maxheight;
 		}
+		updateWavePhases(gEnv->mrTime);
 	}
 	//theCam=camera;
 	pTestNode=0;
@@ -357,12 +364,19 @@ void Water::showWave(Vector3 refpos)
 {
 	int px,pz;
 	if (!wbuffer) return;
+	Vector3 mapsize = gEnv->terrainManager->getMaxTerrainSize();
+	Vector3 positions[WAVEREZ+1];
+	float heights[WAVEREZ+1];
 	for (px=0; px<WAVEREZ+1; px++)
 	{
 		for (pz=0; pz<WAVEREZ+1; pz++)
 		{
-			Vector3 mapsize = gEnv->terrainManager->getMaxTerrainSize();
-			wbuffer[(pz*(WAVEREZ+1)+px)*8+1]=getHeightWaves(refpos+Vector3((mapsize.x * mScale)/2-(float)px*(mapsize.x * mScale)/WAVEREZ, 0, (float)pz*(mapsize.z * mScale)/WAVEREZ-(mapsize.z * mScale)/2));
+			positions[pz]=refpos+Vector3((mapsize.x * mScale)/2-(float)px*(mapsize.x * mScale)/WAVEREZ, 0, (float)pz*(mapsize.z * mScale)/WAVEREZ-(mapsize.z * mScale)/2);
+		}
+		getHeightWavesBatch(positions, heights, WAVEREZ+1);
+		for (pz=0; pz<WAVEREZ+1; pz++)
+		{
+			wbuffer[(pz*(WAVEREZ+1)+px)*8+1]=heights[pz];
 		}
 	}
 	//normals
@@ -547,13 +561,8 @@ float Water::getHeightWaves(Vector3 pos)
 			amp = wavetrains[i].maxheight;
 		// now the main thing:
 		// calculate the sinus with the values of the config file and add it to the result
-		result += amp * sin(Math::TWO_PI * ( \
-											(gEnv->mrTime * wavetrains[i].wavespeed \
-											+ sin(wavetrains[i].direction) * pos.x \
-											+ cos(wavetrains[i].direction) * pos.z \
-											) \
-											/ wavetrains[i].wavelength) \
-											);
+		// 2*pi * (time * wavespeed + sin(direction) * x + cos(direction) * z) / wavelength, see updateWavePhases()
+		result += amp * sin(wavetrains[i].phase + wavetrains[i].kx * pos.x + wavetrains[i].kz * pos.z);
 	}
 	// return the summed up waves
 	return result;
@@ -590,14 +599,163 @@ Vector3 Water::getVelocity(Vector3 pos)
 	{
 		float amp=wavetrains[i].amplitude*waveheight;
 		if (amp>wavetrains[i].maxheight) amp=wavetrains[i].maxheight;
-		float speed=6.28318*amp/(wavetrains[i].wavelength/wavetrains[i].wavespeed);
-		result.y+=speed*cos(6.28318*((gEnv->mrTime*wavetrains[i].wavespeed+sin(wavetrains[i].direction)*pos.x+cos(wavetrains[i].direction)*pos.z)/wavetrains[i].wavelength));
-		result+=Vector3(sin(wavetrains[i].direction), 0, cos(wavetrains[i].direction))*speed*sin(6.28318*((gEnv->mrTime*wavetrains[i].wavespeed+sin(wavetrains[i].direction)*pos.x+cos(wavetrains[i].direction)*pos.z)/wavetrains[i].wavelength));
+		float speed=amp*wavetrains[i].angularspeed;
+		float arg=wavetrains[i].phase+wavetrains[i].kx*pos.x+wavetrains[i].kz*pos.z;
+		result.y+=speed*cos(arg);
+		result+=Vector3(wavetrains[i].dirx, 0, wavetrains[i].dirz)*speed*sin(arg);
 	}
 
 	return result;
 }
 
+void Water::updateWavePhases(float time)
+{
+	for (int i=0; i<free_wavetrain; i++)
+	{
+		// wrap in double precision, the time grows unbounded
+		double cycles = (double)time * wavetrains[i].wavespeed / wavetrains[i].wavelength;
+		wavetrains[i].phase = (float)(Math::TWO_PI * (cycles - floor(cycles)));
+	}
+}
+
+void Water::getHeightWavesBatch(const Vector3 *pos, float *result, int count)
+{
+	if (!haswaves)
+	{
+		for (int i=0; i<count; i++)
+			result[i] = height;
+		return;
+	}
+#ifdef ROR_USE_SSE2
+	const __m128 centerx = _mm_set1_ps((mapSize.x * mScale) / 2);
+	const __m128 centerz = _mm_set1_ps((mapSize.z * mScale) / 2);
+	const __m128 base    = _mm_set1_ps(height);
+	const __m128 ceiling = _mm_set1_ps(height + maxampl);
+
+	for (int i=0; i<count; i+=4)
+	{
+		int n = std::min(4, count - i);
+		// gather four positions, padding with the last one
+		float px[4], py[4], pz[4];
+		for (int k=0; k<4; k++)
+		{
+			const Vector3 &p = pos[i + std::min(k, n - 1)];
+			px[k] = p.x; py[k] = p.y; pz[k] = p.z;
+		}
+		__m128 x = _mm_loadu_ps(px);
+		__m128 y = _mm_loadu_ps(py);
+		__m128 z = _mm_loadu_ps(pz);
+
+		// above the wave envelope the sea is flat, like in getHeightWaves()
+		__m128 above = _mm_cmpgt_ps(y, ceiling);
+		if (_mm_movemask_ps(above) == 0xF)
+		{
+			for (int k=0; k<n; k++)
+				result[i + k] = height;
+			continue;
+		}
+
+		// see getWaveHeight()
+		__m128 dx = _mm_sub_ps(x, centerx);
+		__m128 dy = _mm_sub_ps(y, base);
+		__m128 dz = _mm_sub_ps(z, centerz);
+		__m128 waveheight = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)), _mm_set1_ps(1.0f / 3000000.0f));
+
+		__m128 sum = base;
+		for (int t=0; t<free_wavetrain; t++)
+		{
+			__m128 amp = _mm_min_ps(_mm_mul_ps(waveheight, _mm_set1_ps(wavetrains[t].amplitude)), _mm_set1_ps(wavetrains[t].maxheight));
+			__m128 arg = _mm_add_ps(_mm_set1_ps(wavetrains[t].phase), _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(wavetrains[t].kx)), _mm_mul_ps(z, _mm_set1_ps(wavetrains[t].kz))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(amp, approx_sin4(arg)));
+		}
+
+		sum = _mm_or_ps(_mm_and_ps(above, base), _mm_andnot_ps(above, sum));
+
+		float out[4];
+		_mm_storeu_ps(out, sum);
+		for (int k=0; k<n; k++)
+			result[i + k] = out[k];
+	}
+#else
+	for (int i=0; i<count; i++)
+		result[i] = getHeightWaves(pos[i]);
+#endif // ROR_USE_SSE2
+}
+
+void Water::getVelocityBatch(const Vector3 *pos, Vector3 *result, int count)
+{
+	if (!haswaves)
+	{
+		for (int i=0; i<count; i++)
+			result[i] = Vector3::ZERO;
+		return;
+	}
+#ifdef ROR_USE_SSE2
+	const __m128 centerx = _mm_set1_ps((mapSize.x * mScale) / 2);
+	const __m128 centerz = _mm_set1_ps((mapSize.z * mScale) / 2);
+	const __m128 base    = _mm_set1_ps(height);
+	const __m128 ceiling = _mm_set1_ps(height + maxampl);
+
+	for (int i=0; i<count; i+=4)
+	{
+		int n = std::min(4, count - i);
+		// gather four positions, padding with the last one
+		float px[4], py[4], pz[4];
+		for (int k=0; k<4; k++)
+		{
+			const Vector3 &p = pos[i + std::min(k, n - 1)];
+			px[k] = p.x; py[k] = p.y; pz[k] = p.z;
+		}
+		__m128 x = _mm_loadu_ps(px);
+		__m128 y = _mm_loadu_ps(py);
+		__m128 z = _mm_loadu_ps(pz);
+
+		// above the wave envelope the water does not move, like in getVelocity()
+		__m128 below = _mm_cmple_ps(y, ceiling);
+		if (_mm_movemask_ps(below) == 0)
+		{
+			for (int k=0; k<n; k++)
+				result[i + k] = Vector3::ZERO;
+			continue;
+		}
+
+		// see getWaveHeight()
+		__m128 dx = _mm_sub_ps(x, centerx);
+		__m128 dy = _mm_sub_ps(y, base);
+		__m128 dz = _mm_sub_ps(z, centerz);
+		__m128 waveheight = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)), _mm_set1_ps(1.0f / 3000000.0f));
+
+		__m128 vx = _mm_setzero_ps();
+		__m128 vy = _mm_setzero_ps();
+		__m128 vz = _mm_setzero_ps();
+		for (int t=0; t<free_wavetrain; t++)
+		{
+			__m128 amp   = _mm_min_ps(_mm_mul_ps(waveheight, _mm_set1_ps(wavetrains[t].amplitude)), _mm_set1_ps(wavetrains[t].maxheight));
+			__m128 speed = _mm_mul_ps(amp, _mm_set1_ps(wavetrains[t].angularspeed));
+			__m128 arg   = _mm_add_ps(_mm_set1_ps(wavetrains[t].phase), _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(wavetrains[t].kx)), _mm_mul_ps(z, _mm_set1_ps(wavetrains[t].kz))));
+			__m128 hs    = _mm_mul_ps(speed, approx_sin4(arg));
+			vy = _mm_add_ps(vy, _mm_mul_ps(speed, approx_cos4(arg)));
+			vx = _mm_add_ps(vx, _mm_mul_ps(hs, _mm_set1_ps(wavetrains[t].dirx)));
+			vz = _mm_add_ps(vz, _mm_mul_ps(hs, _mm_set1_ps(wavetrains[t].dirz)));
+		}
+
+		vx = _mm_and_ps(below, vx);
+		vy = _mm_and_ps(below, vy);
+		vz = _mm_and_ps(below, vz);
+
+		float outx[4], outy[4], outz[4];
+		_mm_storeu_ps(outx, vx);
+		_mm_storeu_ps(outy, vy);
+		_mm_storeu_ps(outz, vz);
+		for (int k=0; k<n; k++)
+			result[i + k] = Vector3(outx[k], outy[k], outz[k]);
+	}
+#else
+	for (int i=0; i<count; i++)
+		result[i] = getVelocity(pos[i]);
+#endif // ROR_USE_SSE2
+}
+
 void Water::updateReflectionPlane(float h)
 {
 	//Ray ra=gEnv->ogreCamera->getCameraToViewportRay(0.5,0.5);
@@ -34,6 +34,9 @@ public:
 	float getHeight();
 	float getHeightWaves(Ogre::Vector3 pos);
 	Ogre::Vector3 getVelocity(Ogre::Vector3 pos);
+	void getHeightWavesBatch(const Ogre::Vector3 *pos, float *result, int count);
+	void getVelocityBatch(const Ogre::Vector3 *pos, Ogre::Vector3 *result, int count);
+	void updateWavePhases(float time);
 
 	void setCamera(Ogre::Camera *cam);
 	void setFadeColour(Ogre::ColourValue ambient);
@@ -64,6 +67,12 @@ private:
 		float wavelength;
 		float wavespeed;
 		float direction;
+		// derived from the above at load time
+		float dirx, dirz;    //!< sin(direction), cos(direction)
+		float kx, kz;        //!< 2*pi*(dirx, dirz)/wavelength
+		float angularspeed;  //!< 2*pi*wavespeed/wavelength
+		// set by updateWavePhases()
+		float phase;         //!< 2*pi*time*wavespeed/wavelength, wrapped to [0, 2*pi)
 	} wavetrain_t;
 
 	static const int WAVEREZ = 100;
@@ -78,6 +78,14 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
+	void Noise::getValues(const float *x, const float *y, float *result, const int &count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			result[i] = getValue(x[i], y[i]);
+		}
+	}
+
 	void Noise::saveCfg(Ogre::String &Data)
 	{
 		Data += "#Noise options\n";
@@ -120,6 +120,15 @@ namespace Hydrax{ namespace Noise
 		 */
 		virtual float getValue(const float &x, const float &y) = 0;
 
+		/** Get the noise values of several x/y points at once
+		    @param x X Coords
+			@param y Y Coords
+			@param result Noise values, count entries
+			@param count Number of points
+			@remarks Must be thread safe, the projected grid calls it from several worker threads
+		 */
+		virtual void getValues(const float *x, const float *y, float *result, const int &count);
+
 	protected:
 		/// Module name
 		Ogre::String mName;
@@ -30,6 +30,8 @@ http://graphics.cs.lth.se/theses/projects/projgrid/
 
 #include <Hydrax.h>
 
+#include "ThreadPool.h"
+
 #define _def_PackedNoise true
 
 namespace Hydrax{namespace Noise
@@ -37,26 +39,35 @@ namespace Hydrax{namespace Noise
 	Perlin::Perlin()
 		: Noise("Perlin", true)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * 0.085f)
+		, mFrontBuffer(0)
+		, mNoiseTaskState(NOISE_TASK_IDLE)
 		, mGPUNormalMapManager(0)
 	{
+		pthread_mutex_init(&mNoiseTaskMutex, NULL);
+		pthread_cond_init(&mNoiseTaskCond, NULL);
 	}
 
 	Perlin::Perlin(const Options &Options)
 		: Noise("Perlin", true)
 		, mOptions(Options)
 		, time(0)
-		, r_noise(0)
 		, magnitude(n_dec_magn * Options.Scale)
+		, mFrontBuffer(0)
+		, mNoiseTaskState(NOISE_TASK_IDLE)
 		, mGPUNormalMapManager(0)
 	{
+		pthread_mutex_init(&mNoiseTaskMutex, NULL);
+		pthread_cond_init(&mNoiseTaskCond, NULL);
 	}
 
 	Perlin::~Perlin()
 	{
 		remove();
 
+		pthread_cond_destroy(&mNoiseTaskCond);
+		pthread_mutex_destroy(&mNoiseTaskMutex);
+
 		HydraxLOG(getName() + " destroyed.");
 	}
 
@@ -69,10 +80,16 @@ namespace Hydrax{namespace Noise
 
 		Noise::create();
 		_initNoise();
+
+		// the first frame has no previous field to show
+		mFrontBuffer = 0;
+		_calculeNoise(time, mOptions, mFrontBuffer);
 	}
 
 	void Perlin::remove()
 	{
+		_waitForNoiseTask();
+
 		if (areGPUNormalMapResourcesCreated())
 		{
 			Noise::removeGPUNormalMapResources(mGPUNormalMapManager);
@@ -84,6 +101,7 @@ namespace Hydrax{namespace Noise
 		}
 
 		time = 0;
+		mNoiseTaskState = NOISE_TASK_IDLE;
 
 		Noise::remove();
 	}
@@ -367,12 +385,77 @@ namespace Hydrax{namespace Noise
 	void Perlin::update(const Ogre::Real &timeSinceLastFrame)
 	{
 		time += timeSinceLastFrame*mOptions.Animspeed;
-		_calculeNoise();
 
-		if (areGPUNormalMapResourcesCreated())
+		if (!gEnv->threadPool)
+		{
+			_calculeNoise(time, mOptions, mFrontBuffer);
+
+			if (areGPUNormalMapResourcesCreated())
+			{
+				_updateGPUNormalMapResources();
+			}
+			return;
+		}
+
+		MUTEX_LOCK(&mNoiseTaskMutex);
+		NoiseTaskState State = mNoiseTaskState;
+		if (State == NOISE_TASK_DONE)
+		{
+			mNoiseTaskState = NOISE_TASK_IDLE;
+		}
+		MUTEX_UNLOCK(&mNoiseTaskMutex);
+
+		if (State == NOISE_TASK_RUNNING)
 		{
-			_updateGPUNormalMapResources();
+			// the worker is behind, keep the current field for one more frame
+			return;
 		}
+
+		if (State == NOISE_TASK_DONE)
+		{
+			mFrontBuffer = 1 - mFrontBuffer;
+
+			if (areGPUNormalMapResourcesCreated())
+			{
+				_updateGPUNormalMapResources();
+			}
+		}
+
+		_startNoiseTask();
+	}
+
+	void Perlin::_startNoiseTask()
+	{
+		MUTEX_LOCK(&mNoiseTaskMutex);
+		mNoiseTaskState = NOISE_TASK_RUNNING;
+		MUTEX_UNLOCK(&mNoiseTaskMutex);
+
+		gEnv->threadPool->enqueue(new NoiseTask(this, time, mOptions, 1 - mFrontBuffer));
+	}
+
+	void Perlin::_waitForNoiseTask()
+	{
+		MUTEX_LOCK(&mNoiseTaskMutex);
+		while (mNoiseTaskState == NOISE_TASK_RUNNING)
+		{
+			pthread_cond_wait(&mNoiseTaskCond, &mNoiseTaskMutex);
+		}
+		MUTEX_UNLOCK(&mNoiseTaskMutex);
+	}
+
+	void Perlin::NoiseTask::run()
+	{
+		mPerlin->_calculeNoise(mTime, mOptions, mTarget);
+	}
+
+	void Perlin::NoiseTask::onComplete()
+	{
+		MUTEX_LOCK(&mPerlin->mNoiseTaskMutex);
+		mPerlin->mNoiseTaskState = NOISE_TASK_DONE;
+		pthread_cond_signal(&mPerlin->mNoiseTaskCond);
+		MUTEX_UNLOCK(&mPerlin->mNoiseTaskMutex);
+
+		delete this;
 	}
 
 	void Perlin::_updateGPUNormalMapResources()
@@ -384,6 +467,7 @@ namespace Hydrax{namespace Noise
 		for (int k = 0; k < 2; k++)
 		{
 			Offset = np_size_sq*k;
+			const int *Field = p_noise[mFrontBuffer];
 			PixelBuffer = mGPUNormalMapManager->getTexture(k)->getBuffer();
 
 			PixelBuffer->lock(Ogre::HardwareBuffer::HBL_DISCARD);
@@ -393,7 +477,7 @@ namespace Hydrax{namespace Noise
 
 			for (int u = 0; u < np_size_sq; u++)
 			{
-				Data[u] = 32768+p_noise[u+Offset];//std::cout << p_noise[u+Offset] << std::endl;
+				Data[u] = 32768+Field[u+Offset];//std::cout << p_noise[u+Offset] << std::endl;
 			}
 
 			PixelBuffer->unlock();
@@ -444,7 +528,7 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
-	void Perlin::_calculeNoise()
+	void Perlin::_calculeNoise(const double &Time, const Options &Options, const int &Target)
 	{
 		int i, o, v, u,
 			multitable[max_octaves],
@@ -459,18 +543,18 @@ namespace Hydrax{namespace Noise
 		double dImage, fraction;
 
 		// calculate the strength of each octave
-		for(i=0; i<mOptions.Octaves; i++)
+		for(i=0; i<Options.Octaves; i++)
 		{
-			f_multitable[i] = powf(mOptions.Falloff,1.0f*i);
+			f_multitable[i] = powf(Options.Falloff,1.0f*i);
 			sum += f_multitable[i];
 		}
 
-		for(i=0; i<mOptions.Octaves; i++)
+		for(i=0; i<Options.Octaves; i++)
 		{
 			f_multitable[i] /= sum;
 		}
 
-		for(i=0; i<mOptions.Octaves; i++)
+		for(i=0; i<Options.Octaves; i++)
 		{
 			multitable[i] = scale_magnitude*f_multitable[i];
 		}
@@ -478,9 +562,9 @@ namespace Hydrax{namespace Noise
 		double r_timemulti = 1.0;
 		const float PI_3 = Ogre::Math::PI/3;
 
-		for(o=0; o<mOptions.Octaves; o++)
+		for(o=0; o<Options.Octaves; o++)
 		{
-			fraction = modf(time*r_timemulti,&dImage);
+			fraction = modf(Time*r_timemulti,&dImage);
 			iImage = static_cast<int>(dImage);
 
 			amount[0] = scale_magnitude*f_multitable[o]*(pow(sin((fraction+2)*PI_3),2)/1.5);
@@ -499,22 +583,23 @@ namespace Hydrax{namespace Noise
 				   ((amount[2] * noise[i + n_size_sq * image[2]])>>scale_decimalbits));
 			}
 
-			r_timemulti *= mOptions.Timemulti;
+			r_timemulti *= Options.Timemulti;
 		}
 
 		if(_def_PackedNoise)
 		{
+			int *Field = p_noise[Target];
 			int octavepack = 0;
-			for(o=0; o<mOptions.Octaves; o+=n_packsize)
+			for(o=0; o<Options.Octaves; o+=n_packsize)
 			{
 				for(v=0; v<np_size; v++)
 				{
 					for(u=0; u<np_size; u++)
 					{
-						p_noise[v*np_size+u+octavepack*np_size_sq]  = o_noise[(o+3)*n_size_sq + (v&n_size_m1)*n_size + (u&n_size_m1)];
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 3, o);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 2, o+1);
-						p_noise[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 1, o+2);
+						Field[v*np_size+u+octavepack*np_size_sq]  = o_noise[(o+3)*n_size_sq + (v&n_size_m1)*n_size + (u&n_size_m1)];
+						Field[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 3, o);
+						Field[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 2, o+1);
+						Field[v*np_size+u+octavepack*np_size_sq] += _mapSample( u, v, 1, o+2);
 					}
 				}
 
@@ -523,7 +608,7 @@ namespace Hydrax{namespace Noise
 		}
 	}
 
-	int Perlin::_readTexelLinearDual(const int &u, const int &v,const int &o)
+	int Perlin::_readTexelLinearDual(const int *Field, const int &u, const int &v)
 	{
 		int iu, iup, iv, ivp, fu, fv,
 			ut01, ut23, ut;
@@ -537,8 +622,8 @@ namespace Hydrax{namespace Noise
 		fu = u & n_dec_magn_m1;
 		fv = v & n_dec_magn_m1;
 
-		ut01 = ((n_dec_magn-fu)*r_noise[iv + iu] + fu*r_noise[iv + iup])>>n_dec_bits;
-		ut23 = ((n_dec_magn-fu)*r_noise[ivp + iu] + fu*r_noise[ivp + iup])>>n_dec_bits;
+		ut01 = ((n_dec_magn-fu)*Field[iv + iu] + fu*Field[iv + iup])>>n_dec_bits;
+		ut23 = ((n_dec_magn-fu)*Field[ivp + iu] + fu*Field[ivp + iup])>>n_dec_bits;
 		ut = ((n_dec_magn-fv)*ut01 + fv*ut23) >> n_dec_bits;
 
 		return ut;
@@ -546,8 +631,8 @@ namespace Hydrax{namespace Noise
 
 	float Perlin::_getHeigthDual(float u, float v)
 	{
-		// Pointer to the current noise source octave
-		r_noise = p_noise;
+		// Pointer to the current noise source octave, a local so concurrent readers don't interfere
+		const int *r_noise = p_noise[mFrontBuffer];
 
 		int ui = u*magnitude,
 		    vi = v*magnitude,
@@ -557,7 +642,7 @@ namespace Hydrax{namespace Noise
 
 		for(i=0; i<hoct; i++)
 		{
-			value += _readTexelLinearDual(ui,vi,0);
+			value += _readTexelLinearDual(r_noise,ui,vi);
 			ui = ui << n_packsize;
 			vi = vi << n_packsize;
 			r_noise += np_size_sq;
@@ -32,6 +32,9 @@ http://graphics.cs.lth.se/theses/projects/projgrid/
 
 
 #include "Noise.h"
+#include "IThreadTask.h"
+
+#include <pthread.h>
 
 #define n_bits				5
 #define n_size				(1<<(n_bits-1))
@@ -189,6 +192,8 @@ namespace Hydrax{ namespace Noise
 
 		/** Call it each frame
 		    @param timeSinceLastFrame Time since last frame(delta)
+			@remarks The noise is computed on the thread pool, getValue() returns the field
+			         of the previous call until the next one is done
 		 */
 		void update(const Ogre::Real &timeSinceLastFrame);
 
@@ -226,25 +231,68 @@ namespace Hydrax{ namespace Noise
 		}
 
 	private:
+		/** Computes the packed noise of one point in time into one of the field buffers,
+		    runs on the thread pool while the previous field is used for rendering
+		 */
+		class NoiseTask : public IThreadTask
+		{
+		public:
+			NoiseTask(Perlin *p, const double &Time, const Options &Options, const int &Target)
+				: mPerlin(p)
+				, mTime(Time)
+				, mOptions(Options)
+				, mTarget(Target)
+			{
+			}
+
+			void run();
+			void onComplete();
+
+		private:
+			Perlin *mPerlin;
+			double mTime;
+			Options mOptions;
+			int mTarget;
+		};
+
+		/// NoiseTask state
+		enum NoiseTaskState
+		{
+			NOISE_TASK_IDLE,
+			NOISE_TASK_RUNNING,
+			NOISE_TASK_DONE
+		};
+
 		/** Initialize noise
 		 */
 		void _initNoise();
 
 		/** Calcule noise
+		    @param Time Animation time
+			@param Options Options to use, a copy since it may run on a worker thread
+			@param Target Field buffer to write (0 or 1)
+		 */
+		void _calculeNoise(const double &Time, const Options &Options, const int &Target);
+
+		/** Start a NoiseTask for the back field buffer
 		 */
-		void _calculeNoise();
+		void _startNoiseTask();
+
+		/** Block until the running NoiseTask (if any) has finished
+		 */
+		void _waitForNoiseTask();
 
 		/** Update gpu normal map resources
 		 */
 		void _updateGPUNormalMapResources();
 
 		/** Read texel linear dual
+		    @param Field Packed noise octave to read
 		    @param u u
 			@param v v
-			@param o Octave
 			@return int
 		 */
-	    int _readTexelLinearDual(const int &u, const int &v, const int &o);
+	    int _readTexelLinearDual(const int *Field, const int &u, const int &v);
 
 		/** Read texel linear
 		    @param u u
@@ -264,11 +312,20 @@ namespace Hydrax{ namespace Noise
 
 		/// Perlin noise variables
 		int noise[n_size_sq*noise_frames];
+		/// Only touched by _calculeNoise(), at most one NoiseTask runs at a time
 		int o_noise[n_size_sq*max_octaves];
-		int p_noise[np_size_sq*(max_octaves>>(n_packsize-1))];
-		int *r_noise;
+		/// Double buffered packed noise, p_noise[mFrontBuffer] is read while the other one is being computed
+		int p_noise[2][np_size_sq*(max_octaves>>(n_packsize-1))];
 		float magnitude;
 
+		/// Field buffer read by getValue() and uploaded to the GPU
+		int mFrontBuffer;
+
+		/// NoiseTask state, guarded by mNoiseTaskMutex
+		NoiseTaskState mNoiseTaskState;
+		pthread_mutex_t mNoiseTaskMutex;
+		pthread_cond_t mNoiseTaskCond;
+
 		/// Elapsed time
 		double time;
 
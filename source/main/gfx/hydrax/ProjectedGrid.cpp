@@ -30,6 +30,11 @@ http://www.cnblogs.com/ArenAK/archive/2007/11/07/951713.html
 
 #include <ProjectedGrid.h>
 
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <list>
+
 #define _def_MaxFarClipDistance 99999
 
 namespace Hydrax{namespace Module
@@ -55,6 +60,68 @@ namespace Hydrax{namespace Module
 		return "Rtt";
 	}
 
+	/** Project the grid rows [Begin, End) onto the base plane (x/z only)
+	 */
+	template <class VertexType>
+	void _PG_projectRows(VertexType *Vertices, const int &Begin, const int &End, const int &Complexity,
+		                 const Ogre::Vector4 &c0, const Ogre::Vector4 &c1, const Ogre::Vector4 &c2, const Ogre::Vector4 &c3)
+	{
+		float du  = 1.0f/(Complexity-1),
+			  dv  = 1.0f/(Complexity-1),
+			  u, v, _1_u, _1_v,
+			  x, z, divide;
+
+		for(int iv=Begin; iv<End; iv++)
+		{
+			v    = iv*dv;
+			_1_v = 1.0f-v;
+
+			VertexType *Row = Vertices + iv*Complexity;
+
+			for(int iu=0; iu<Complexity; iu++)
+			{
+				u    = iu*du;
+				_1_u = 1.0f-u;
+
+				x      = _1_v*(_1_u*c0.x + u*c1.x) + v*(_1_u*c2.x + u*c3.x);
+				z      = _1_v*(_1_u*c0.z + u*c1.z) + v*(_1_u*c2.z + u*c3.z);
+				divide = 1.0f/(_1_v*(_1_u*c0.w + u*c1.w) + v*(_1_u*c2.w + u*c3.w));
+
+				Row[iu].x = x*divide;
+				Row[iu].z = z*divide;
+			}
+		}
+	}
+
+	/** Calcule the heights of the vertices [Begin, End), the noise is sampled
+	    in batches so it can process several points at once
+	 */
+	template <class VertexType>
+	void _PG_calculeHeights(VertexType *Vertices, const int &Begin, const int &End, Noise::Noise *n,
+		                    const Ogre::Vector3 &WorldPos, const float &BaseHeight, const float &Strength)
+	{
+		const int BatchSize = 64;
+		float X[BatchSize], Z[BatchSize], H[BatchSize];
+
+		for (int i = Begin; i < End; i += BatchSize)
+		{
+			int Count = std::min(BatchSize, End - i);
+
+			for (int k = 0; k < Count; k++)
+			{
+				X[k] = WorldPos.x + Vertices[i+k].x;
+				Z[k] = WorldPos.z + Vertices[i+k].z;
+			}
+
+			n->getValues(X, Z, H, Count);
+
+			for (int k = 0; k < Count; k++)
+			{
+				Vertices[i+k].y = BaseHeight + H[k]*Strength;
+			}
+		}
+	}
+
 	ProjectedGrid::ProjectedGrid(Hydrax *h, Noise::Noise *n, const Ogre::Plane &BasePlane, const MaterialManager::NormalMode& NormalMode)
 		: Module("ProjectedGrid" + _PG_getNormalModeString(NormalMode),
 		         n, Mesh::Options(256, Size(0), _PG_getVertexTypeFromNormalMode(NormalMode)), NormalMode)
@@ -67,7 +134,11 @@ namespace Hydrax{namespace Module
 		, mProjectingCamera(0)
 		, mTmpRndrngCamera(0)
 		, mRenderingCamera(h->getCamera())
+		, mUpdateTime(0)
+		, mRowTaskCount(0)
 	{
+		pthread_mutex_init(&mRowTaskMutex, NULL);
+		pthread_cond_init(&mRowTaskCond, NULL);
 	}
 
 	ProjectedGrid::ProjectedGrid(Hydrax *h, Noise::Noise *n, const Ogre::Plane &BasePlane, const MaterialManager::NormalMode& NormalMode, const Options &Options)
@@ -82,7 +153,12 @@ namespace Hydrax{namespace Module
 		, mProjectingCamera(0)
 		, mTmpRndrngCamera(0)
 		, mRenderingCamera(h->getCamera())
+		, mUpdateTime(0)
+		, mRowTaskCount(0)
 	{
+		pthread_mutex_init(&mRowTaskMutex, NULL);
+		pthread_cond_init(&mRowTaskCond, NULL);
+
 		setOptions(Options);
 	}
 
@@ -90,6 +166,9 @@ namespace Hydrax{namespace Module
 	{
 		remove();
 
+		pthread_cond_destroy(&mRowTaskCond);
+		pthread_mutex_destroy(&mRowTaskMutex);
+
 		HydraxLOG(getName() + " destroyed.");
 	}
 
@@ -227,14 +306,19 @@ namespace Hydrax{namespace Module
 		}
 
         HydraxLOG("\tReading options...");
-		setOptions(
-			Options(CfgFileManager::_getIntValue(CfgFile,   "PG_Complexity"),
+		Options CfgOptions(
+			        CfgFileManager::_getIntValue(CfgFile,   "PG_Complexity"),
 			        CfgFileManager::_getFloatValue(CfgFile, "PG_Strength"),
 					CfgFileManager::_getFloatValue(CfgFile, "PG_Elevation"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_Smooth"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_ForceRecalculateGeometry"),
 					CfgFileManager::_getBoolValue(CfgFile,  "PG_ChoppyWaves"),
-					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength")));
+					CfgFileManager::_getFloatValue(CfgFile, "PG_ChoopyStrength"));
+
+		// Not part of the cfg file, it's set by the application
+		CfgOptions.UpdateRate = mOptions.UpdateRate;
+
+		setOptions(CfgOptions);
 
         HydraxLOG("\tOptions readed.");
 
@@ -248,7 +332,16 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
-		Module::update(timeSinceLastFrame);
+		// The noise may be updated at a lower rate than we render
+		bool NoiseUpdated = false;
+		mUpdateTime += timeSinceLastFrame;
+
+		if (mOptions.UpdateRate <= 0 || mUpdateTime >= 1.0f/mOptions.UpdateRate)
+		{
+			Module::update(mUpdateTime);
+			mUpdateTime = 0;
+			NoiseUpdated = true;
+		}
 
 		Ogre::Vector3 RenderingCameraPos = mRenderingCamera->getDerivedPosition();
 
@@ -285,37 +378,11 @@ namespace Hydrax{namespace Module
 
 			mRenderingCamera->setFarClipDistance(RenderingFarClipDistance);
 		}
-		else if (mLastMinMax)
+		else if (mLastMinMax && NoiseUpdated)
 		{
-			if (getNormalMode() == MaterialManager::NM_VERTEX)
-			{
-				Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+			mWorldPos = RenderingCameraPos;
 
-				if (mOptions.ChoppyWaves)
-				{
-					for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		            {
-			            Vertices[i] = mVerticesChoppyBuffer[i];
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-		            }
-				}
-				else
-				{
-					for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		            {
-						Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-		            }
-				}
-			}
-			else if (getNormalMode() == MaterialManager::NM_RTT)
-			{
-				Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		        {
-				    Vertices[i].y = -mBasePlane.d + mNoise->getValue(RenderingCameraPos.x + Vertices[i].x, RenderingCameraPos.z + Vertices[i].z)*mOptions.Strength;
-		        }
-			}
+			_runRows(PASS_HEIGHTS, 0, mOptions.Complexity);
 
 			// Smooth the heightdata
 		    if (mOptions.Smooth)
@@ -376,85 +443,11 @@ namespace Hydrax{namespace Module
 		t_corners2 = _calculeWorldPosition(Ogre::Vector2( 0.0f,+1.0f),m,_viewMat);
 		t_corners3 = _calculeWorldPosition(Ogre::Vector2(+1.0f,+1.0f),m,_viewMat);
 
-		float du  = 1.0f/(mOptions.Complexity-1),
-			  dv  = 1.0f/(mOptions.Complexity-1),
-			  u,v = 0.0f,
-			  // _1_u = (1.0f-u)
-			  _1_u, _1_v = 1.0f,
-			  divide;
+		mWorldPos = WorldPos;
 
-		Ogre::Vector4 result;
+		_runRows(PASS_PROJECT, 0, mOptions.Complexity);
 
-		int i = 0, iv, iu;
-
-		if (getNormalMode() == MaterialManager::NM_VERTEX)
-		{
-			Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
-
-			for(iv=0; iv<mOptions.Complexity; iv++)
-			{
-				u = 0.0f;
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);
-
-					divide = 1.0f/result.w;
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
-
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
-			}
-
-			if (mOptions.ChoppyWaves)
-			{
-				for(int i = 0; i < mOptions.Complexity*mOptions.Complexity; i++)
-		        {
-			        mVerticesChoppyBuffer[i] = Vertices[i];
-		        }
-			}
-		}
-		else if(getNormalMode() == MaterialManager::NM_RTT)
-		{
-			Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
-
-			for(iv=0; iv<mOptions.Complexity; iv++)
-			{
-				u = 0.0f;
-				_1_u = 1.0f;
-				for(iu=0; iu<mOptions.Complexity; iu++)
-				{
-					result.x = _1_v*(_1_u*t_corners0.x + u*t_corners1.x) + v*(_1_u*t_corners2.x + u*t_corners3.x);
-					result.z = _1_v*(_1_u*t_corners0.z + u*t_corners1.z) + v*(_1_u*t_corners2.z + u*t_corners3.z);
-					result.w = _1_v*(_1_u*t_corners0.w + u*t_corners1.w) + v*(_1_u*t_corners2.w + u*t_corners3.w);
-
-					divide = 1.0f/result.w;
-					result.x *= divide;
-					result.z *= divide;
-
-					Vertices[i].x = result.x;
-					Vertices[i].z = result.z;
-					Vertices[i].y = -mBasePlane.d + mNoise->getValue(WorldPos.x + result.x, WorldPos.z + result.z)*mOptions.Strength;
-
-					i++;
-					u += du;
-					_1_u = 1.0f-u;
-				}
-				v += dv;
-				_1_v = 1.0f-v;
-			}
-		}
+		int iv, iu;
 
 		// Smooth the heightdata
 		if (mOptions.Smooth)
@@ -504,6 +497,140 @@ namespace Hydrax{namespace Module
 		return true;
 	}
 
+	void ProjectedGrid::_runRows(const RowPass &Pass, const int &Begin, const int &End)
+	{
+		// Below this the task overhead isn't worth it
+		const int MinRowsPerTask = 16;
+
+		int Tasks = 1;
+
+		if (gEnv->threadPool)
+		{
+			Tasks = std::min(gEnv->threadPool->getSize() + 1, (End - Begin) / MinRowsPerTask);
+		}
+
+		if (Tasks <= 1)
+		{
+			_processRows(Pass, Begin, End);
+			return;
+		}
+
+		int RowsPerTask = (End - Begin + Tasks - 1) / Tasks;
+
+		std::list<IThreadTask*> TaskList;
+
+		for (int Row = Begin + RowsPerTask; Row < End; Row += RowsPerTask)
+		{
+			TaskList.push_back(new RowTask(this, Pass, Row, std::min(Row + RowsPerTask, End)));
+		}
+
+		MUTEX_LOCK(&mRowTaskMutex);
+		mRowTaskCount += (int)TaskList.size();
+		MUTEX_UNLOCK(&mRowTaskMutex);
+
+		gEnv->threadPool->enqueue(TaskList);
+
+		// The first block runs on this thread meanwhile
+		_processRows(Pass, Begin, std::min(Begin + RowsPerTask, End));
+
+		MUTEX_LOCK(&mRowTaskMutex);
+		while (mRowTaskCount > 0)
+		{
+			pthread_cond_wait(&mRowTaskCond, &mRowTaskMutex);
+		}
+		MUTEX_UNLOCK(&mRowTaskMutex);
+	}
+
+	void ProjectedGrid::RowTask::run()
+	{
+		mGrid->_processRows(mPass, mBegin, mEnd);
+	}
+
+	void ProjectedGrid::RowTask::onComplete()
+	{
+		MUTEX_LOCK(&mGrid->mRowTaskMutex);
+		if (--mGrid->mRowTaskCount == 0)
+		{
+			pthread_cond_signal(&mGrid->mRowTaskCond);
+		}
+		MUTEX_UNLOCK(&mGrid->mRowTaskMutex);
+
+		delete this;
+	}
+
+	void ProjectedGrid::_processRows(const RowPass &Pass, const int &Begin, const int &End)
+	{
+		const int First = Begin*mOptions.Complexity,
+			      Last  = End*mOptions.Complexity;
+
+		switch (Pass)
+		{
+		    case PASS_PROJECT:
+			{
+				if (getNormalMode() == MaterialManager::NM_VERTEX)
+				{
+					Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+
+					_PG_projectRows(Vertices, Begin, End, mOptions.Complexity, t_corners0, t_corners1, t_corners2, t_corners3);
+					_PG_calculeHeights(Vertices, First, Last, mNoise, mWorldPos, -mBasePlane.d, mOptions.Strength);
+
+					if (mOptions.ChoppyWaves)
+					{
+						for(int i = First; i < Last; i++)
+						{
+							mVerticesChoppyBuffer[i] = Vertices[i];
+						}
+					}
+				}
+				else if(getNormalMode() == MaterialManager::NM_RTT)
+				{
+					Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+
+					_PG_projectRows(Vertices, Begin, End, mOptions.Complexity, t_corners0, t_corners1, t_corners2, t_corners3);
+					_PG_calculeHeights(Vertices, First, Last, mNoise, mWorldPos, -mBasePlane.d, mOptions.Strength);
+				}
+			}
+			break;
+
+		    case PASS_HEIGHTS:
+			{
+				if (getNormalMode() == MaterialManager::NM_VERTEX)
+				{
+					Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
+
+					if (mOptions.ChoppyWaves)
+					{
+						for(int i = First; i < Last; i++)
+						{
+							Vertices[i] = mVerticesChoppyBuffer[i];
+						}
+					}
+
+					_PG_calculeHeights(Vertices, First, Last, mNoise, mWorldPos, -mBasePlane.d, mOptions.Strength);
+				}
+				else if(getNormalMode() == MaterialManager::NM_RTT)
+				{
+					Mesh::POS_VERTEX* Vertices = static_cast<Mesh::POS_VERTEX*>(mVertices);
+
+					_PG_calculeHeights(Vertices, First, Last, mNoise, mWorldPos, -mBasePlane.d, mOptions.Strength);
+				}
+			}
+			break;
+
+		    case PASS_NORMALS:
+			{
+				_calculeNormals(Begin, End);
+			}
+			break;
+
+		    case PASS_CHOPPY:
+			{
+				_performChoppyWaves(Begin, End);
+			}
+			break;
+		}
+	}
+
 	void ProjectedGrid::_calculeNormals()
 	{
 		if (getNormalMode() != MaterialManager::NM_VERTEX)
@@ -511,12 +638,17 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
+		_runRows(PASS_NORMALS, 1, mOptions.Complexity-1);
+	}
+
+	void ProjectedGrid::_calculeNormals(const int &Begin, const int &End)
+	{
 		int v, u;
 		Ogre::Vector3 vec1, vec2, normal;
 
 		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
-		for(v=1; v<(mOptions.Complexity-1); v++)
+		for(v=Begin; v<End; v++)
 		{
 			for(u=1; u<(mOptions.Complexity-1); u++)
 			{
@@ -546,33 +678,41 @@ namespace Hydrax{namespace Module
 			return;
 		}
 
-		int v, u,
-		    Underwater = 1;
+		mChoppyUnderwater = 1;
 
 		if (mHydrax->_isCurrentFrameUnderwater())
 		{
-			Underwater = -1;
+			mChoppyUnderwater = -1;
 		}
 
-		float Dis1,  Dis2;//,
-		   // Dis1_, Dis2_;
+		Ogre::Vector3 CameraDir;
+
+		CameraDir   = mRenderingCamera->getDerivedDirection();
+		mChoppyDir  = Ogre::Vector2(CameraDir.x, CameraDir.z).normalisedCopy();
+		mChoppyPerp = mChoppyDir.perpendicular();
+
+		if (mChoppyDir.x < 0 ) mChoppyDir.x = -mChoppyDir.x;
+		if (mChoppyDir.y < 0 ) mChoppyDir.y = -mChoppyDir.y;
+
+		if (mChoppyPerp.x < 0 ) mChoppyPerp.x = -mChoppyPerp.x;
+		if (mChoppyPerp.y < 0 ) mChoppyPerp.y = -mChoppyPerp.y;
 
-		Ogre::Vector3 CameraDir, Norm;
-		Ogre::Vector2 Dir, Perp, Norm2;
+		_runRows(PASS_CHOPPY, 1, mOptions.Complexity-1);
+	}
 
-		CameraDir = mRenderingCamera->getDerivedDirection();
-		Dir       = Ogre::Vector2(CameraDir.x, CameraDir.z).normalisedCopy();
-		Perp      = Dir.perpendicular();
+	void ProjectedGrid::_performChoppyWaves(const int &Begin, const int &End)
+	{
+		int v, u;
 
-		if (Dir.x < 0 ) Dir.x = -Dir.x;
-		if (Dir.y < 0 ) Dir.y = -Dir.y;
+		float Dis1,  Dis2;//,
+		   // Dis1_, Dis2_;
 
-		if (Perp.x < 0 ) Perp.x = -Perp.x;
-		if (Perp.y < 0 ) Perp.y = -Perp.y;
+		Ogre::Vector3 Norm;
+		Ogre::Vector2 Norm2;
 
 		Mesh::POS_NORM_VERTEX* Vertices = static_cast<Mesh::POS_NORM_VERTEX*>(mVertices);
 
-		for(v=1; v<(mOptions.Complexity-1); v++)
+		for(v=Begin; v<End; v++)
 		{
 			Dis1 =  (Ogre::Vector2(mVerticesChoppyBuffer[v*mOptions.Complexity + 1].x,
 					               mVerticesChoppyBuffer[v*mOptions.Complexity + 1].z) -
@@ -606,12 +746,12 @@ namespace Hydrax{namespace Module
 					   			     normalisedCopy();
 
 				Norm2 = Ogre::Vector2(Norm.x, Norm.z)  *
-					                 ( (Dir  * Dis1)   +
-					                   (Perp * Dis2))  *
+					                 ( (mChoppyDir  * Dis1)   +
+					                   (mChoppyPerp * Dis2))  *
 				 				      mOptions.ChoppyStrength;
 
-				Vertices[v*mOptions.Complexity + u].x = mVerticesChoppyBuffer[v*mOptions.Complexity + u].x + Norm2.x * Underwater;
-				Vertices[v*mOptions.Complexity + u].z = mVerticesChoppyBuffer[v*mOptions.Complexity + u].z + Norm2.y * Underwater;
+				Vertices[v*mOptions.Complexity + u].x = mVerticesChoppyBuffer[v*mOptions.Complexity + u].x + Norm2.x * mChoppyUnderwater;
+				Vertices[v*mOptions.Complexity + u].z = mVerticesChoppyBuffer[v*mOptions.Complexity + u].z + Norm2.y * mChoppyUnderwater;
 			}
 		}
 	}
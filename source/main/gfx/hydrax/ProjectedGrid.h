@@ -36,6 +36,9 @@ http://www.cnblogs.com/ArenAK/archive/2007/11/07/951713.html
 #include "Hydrax.h"
 #include "Mesh.h"
 #include "Module.h"
+#include "IThreadTask.h"
+
+#include <pthread.h>
 
 namespace Hydrax{ namespace Module
 {
@@ -62,6 +65,9 @@ namespace Hydrax{ namespace Module
 			bool ChoppyWaves;
 			/// Choppy waves strength
 			float ChoppyStrength;
+			/// Noise update rate in Hz, 0 to update it every frame
+			/// Note: The grid is still reprojected each frame the camera moves.
+			float UpdateRate;
 
 			/** Default constructor
 			 */
@@ -73,6 +79,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, UpdateRate(0)
 			{
 			}
 
@@ -87,6 +94,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, UpdateRate(0)
 			{
 			}
 
@@ -107,6 +115,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(false)
 				, ChoppyWaves(true)
 				, ChoppyStrength(3.75f)
+				, UpdateRate(0)
 			{
 			}
 
@@ -133,6 +142,7 @@ namespace Hydrax{ namespace Module
 				, ForceRecalculateGeometry(_ForceRecalculateGeometry)
 				, ChoppyWaves(_ChoppyWaves)
 				, ChoppyStrength(_ChoppyStrength)
+				, UpdateRate(0)
 			{
 			}
 		};
@@ -202,14 +212,73 @@ namespace Hydrax{ namespace Module
 		}
 
 	private:
+		/// Passes over the grid rows, every pass may be split across the thread pool
+		enum RowPass
+		{
+			/// Project the grid and calcule the heights (_renderGeometry)
+			PASS_PROJECT,
+			/// Only refresh the heights of the already projected grid
+			PASS_HEIGHTS,
+			/// Calcule the vertex normals
+			PASS_NORMALS,
+			/// Displace the vertices along their normals
+			PASS_CHOPPY
+		};
+
+		/** Runs one pass for a range of grid rows on the thread pool
+		 */
+		class RowTask : public IThreadTask
+		{
+		public:
+			RowTask(ProjectedGrid *g, const RowPass &Pass, const int &Begin, const int &End)
+				: mGrid(g)
+				, mPass(Pass)
+				, mBegin(Begin)
+				, mEnd(End)
+			{
+			}
+
+			void run();
+			void onComplete();
+
+		private:
+			ProjectedGrid *mGrid;
+			RowPass mPass;
+			int mBegin, mEnd;
+		};
+
+		/** Run a pass over the rows [Begin, End) and wait until it's done
+		    @param Pass Pass
+			@param Begin First row
+			@param End Last row + 1
+			@remarks Every row of a pass only writes its own vertices, rows depending
+			         on other rows (normals, choppy waves) read the result of the previous pass
+		 */
+		void _runRows(const RowPass &Pass, const int &Begin, const int &End);
+
+		/** Run a pass over the rows [Begin, End) on the current thread
+		    @param Pass Pass
+			@param Begin First row
+			@param End Last row + 1
+		 */
+		void _processRows(const RowPass &Pass, const int &Begin, const int &End);
+
 		/** Calcule current normals
 		 */
 		void _calculeNormals();
 
+		/** Calcule the normals of the rows [Begin, End)
+		 */
+		void _calculeNormals(const int &Begin, const int &End);
+
 		/** Perform choppy waves
 		 */
 		void _performChoppyWaves();
 
+		/** Perform choppy waves on the rows [Begin, End)
+		 */
+		void _performChoppyWaves(const int &Begin, const int &End);
+
 		/** Render geometry
 		    @param m Range
 			@param _viewMat View matrix
@@ -270,6 +339,21 @@ namespace Hydrax{ namespace Module
 		/// Our projected grid options
 		Options mOptions;
 
+		/// Camera position the heights of the current pass are sampled around
+		Ogre::Vector3 mWorldPos;
+
+		/// Choppy waves parameters of the current frame
+		Ogre::Vector2 mChoppyDir, mChoppyPerp;
+		int mChoppyUnderwater;
+
+		/// Time since the last noise update, see Options::UpdateRate
+		float mUpdateTime;
+
+		/// RowTasks still running, guarded by mRowTaskMutex
+		int mRowTaskCount;
+		pthread_mutex_t mRowTaskMutex;
+		pthread_cond_t mRowTaskCond;
+
 		/// Our Hydrax pointer
 		Hydrax* mHydrax;
 	};
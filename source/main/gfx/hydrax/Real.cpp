@@ -191,4 +191,21 @@ float Real::getValue(const float &x, const float &y)
     return H;
 }
 
+void Real::getValues(const float *x, const float *y, float *result, const int &count)
+{
+    int i, j;
+    /// 1st.- Perlin height
+    mPerlinNoise->getValues(x, y, result, count);
+    /// 2nd.- Waves height, vectorized
+    for(i=0;i<(int)mWaves.size();i++) {
+        mWaves.at(i).addValues(x, y, result, count);
+    }
+    /// 3rd.- Pressure points height
+    for(i=0;i<(int)mPressurePoints.size();i++) {
+        for(j=0;j<count;j++) {
+            result[j] += mPressurePoints.at(i).getValue(x[j],y[j]);
+        }
+    }
+}
+
 }}    // namespace Hydrax::Noise
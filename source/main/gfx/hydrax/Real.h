@@ -155,6 +155,14 @@ public:
      */
     float getValue(const float &x, const float &y);
 
+    /** Get the noise values of several x/y points at once
+        @param x X Coords
+        @param y Y Coords
+        @param result Noise values, count entries
+        @param count Number of points
+     */
+    void getValues(const float *x, const float *y, float *result, const int &count);
+
     /** Get current Real noise options
         @return Current Real noise options
      */
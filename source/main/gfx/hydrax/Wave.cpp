@@ -31,6 +31,8 @@ http://www.gnu.org/copyleft/lesser.txt.
 // ----------------------------------------------------------------------------
 #include <Hydrax.h>
 
+#include "ApproxMath.h"
+
 #define _def_PackedNoise true
 
 using namespace Hydrax::Noise;
@@ -63,3 +65,29 @@ float Wave::getValue(const float &x, const float &y)
     float X = mDir.x*x + mDir.y*y;
     return mA * sin(mF*mTime - mK*X + mP);
 }
+
+void Wave::addValues(const float *x, const float *y, float *result, const int &count)
+{
+    // the time dependent part is reduced in double precision once, mTime grows without bounds
+    const float Phase = static_cast<float>(fmod(mF*mTime + mP, 2.0*M_PI));
+    const float Kx = mK*mDir.x, Ky = mK*mDir.y;
+    int i = 0;
+
+#ifdef ROR_USE_SSE2
+    const __m128 phase4 = _mm_set1_ps(Phase);
+    const __m128 kx4 = _mm_set1_ps(Kx);
+    const __m128 ky4 = _mm_set1_ps(Ky);
+    const __m128 a4 = _mm_set1_ps(mA);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 arg = _mm_sub_ps(phase4, _mm_add_ps(_mm_mul_ps(kx4, _mm_loadu_ps(x + i)), _mm_mul_ps(ky4, _mm_loadu_ps(y + i))));
+        _mm_storeu_ps(result + i, _mm_add_ps(_mm_loadu_ps(result + i), _mm_mul_ps(a4, approx_sin4(arg))));
+    }
+#endif // ROR_USE_SSE2
+
+    for (; i < count; i++)
+    {
+        result[i] += mA * approx_sin(Phase - Kx*x[i] - Ky*y[i]);
+    }
+}
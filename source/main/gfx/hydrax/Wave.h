@@ -78,6 +78,15 @@ public:
      */
     float getValue(const float &x, const float &y);
 
+    /** Add the wave height of several x/y points
+        @param x X Coords
+        @param y Y Coords
+        @param result Heights the wave is added to, count entries
+        @param count Number of points
+        @remarks Uses an approximated sine, four points at once where SSE2 is available
+     */
+    void addValues(const float *x, const float *y, float *result, const int &count);
+
     /** Returns direction of the wave.
      * @return Direction.
      */
@@ -38,6 +38,7 @@
 #include "RoRFrameListener.h"
 #include "Scripting.h"
 #include "Settings.h"
+#include "SoundScriptManager.h"
 #include "TerrainManager.h"
 #include "Utils.h"
 
@@ -50,7 +51,7 @@ using namespace RoR;
 
 // the delimiters that decide where a word is finished
 const UTFString Console::wordDelimiters = " \\\"\'|.,`!;<>~{}()+&%$@";
-const char *builtInCommands[] = {"/help", "/log", "/pos", "/goto", "/terrainheight", "/ver", "/save", "/whisper", "/as", NULL};
+const char *builtInCommands[] = {"/help", "/log", "/pos", "/goto", "/terrainheight", "/ver", "/save", "/whisper", "/as", "/sound", NULL};
 
 // class
 Console::Console() : netChat(0), top_border(20), bottom_border(100), message_counter(0), mHistory(), mHistoryPosition(0), inputMode(false), linesChanged(false), scrollOffset(0), autoCompleteIndex(-1), linecount(10), scroll_size(5), angelscriptMode(false)
@@ -517,6 +518,9 @@ void Console::eventCommandAccept(MyGUI::Edit* _sender)
 				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/terrainheight#000000  - get height of terrain at current position"), "world.png");
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/save#000000 - saves the chat history to a file"), "table_save.png");
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/log#000000  - toggles log output on the console"), "table_save.png");
+#ifdef USE_OPENAL
+			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/sound#000000 - shows the memory used by the sound buffers"), "information.png");
+#endif // USE_OPENAL
 			if (gEnv->network)
 				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/whisper <username> <message>#000000 - send someone a private message"), "script_key.png");
 	#ifdef USE_ANGELSCRIPT
@@ -558,6 +562,15 @@ void Console::eventCommandAccept(MyGUI::Edit* _sender)
 			outputCurrentTerrainHeight();
 			return;
 
+		} else if (msg == "/sound")
+		{
+#ifdef USE_OPENAL
+			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, ChatSystem::commandColour + _L("sound buffers: ") + SoundScriptManager::getSingleton().getMemoryUsage(), "information.png");
+#else
+			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, ChatSystem::commandColour + _L("sound support is not compiled in"), "information.png");
+#endif // USE_OPENAL
+			return;
+
 		} else if (msg == "/ver")
 		{
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, ChatSystem::commandColour + getVersionString(false), "information.png");
@@ -39,6 +39,7 @@
 #include "GlobalEnvironment.h"
 #include "IHeightFinder.h"
 #include "Language.h"
+#include "Network.h"
 #include "OgreFontManager.h"
 #include "OgreSubsystem.h"
 #include "RoRVersion.h"
@@ -579,6 +580,10 @@ void OverlayWrapper::updateStats(bool detailed)
 			memoryText = memoryText + _L("Skeletons: ") + formatBytes(SkeletonManager::getSingleton().getMemoryUsage()) + U(" / ") + formatBytes(SkeletonManager::getSingleton().getMemoryBudget()) + U("\n");
 		if (MaterialManager::getSingleton().getMemoryUsage() > 1)
 			memoryText = memoryText + _L("Materials: ") + formatBytes(MaterialManager::getSingleton().getMemoryUsage()) + U(" / ") + formatBytes(MaterialManager::getSingleton().getMemoryBudget()) + U("\n");
+#ifdef USE_SOCKETW
+		if (gEnv->network)
+			memoryText = memoryText + _L("Network: ") + formatBytes(gEnv->network->getSpeedUp()) + U("/s up, ") + formatBytes(gEnv->network->getSpeedDown()) + U("/s down, ") + formatBytes(gEnv->network->getBytesCopied()) + U("/s copied\n");
+#endif // USE_SOCKETW
 		memoryText = memoryText + U("\n");
 
 		OverlayElement* memoryDbg = OverlayManager::getSingleton().getOverlayElement("Core/MemoryText");
@@ -68,12 +68,16 @@ _L("Hidden");
 
 using namespace Ogre;
 
+// list items are added in pages, long lists would take too long to fill
+static const size_t RESULTS_PAGE_SIZE = 100;
+
 SelectorWindow::SelectorWindow() :
 	  dtsum(0)
 	, keysBound(false)
 	, mSelectedSkin(0)
 	, mSelectedTruck(0)
 	, mSelectionDone(true)
+	, mResultsShown(0)
 	, ready(false)
 	, readytime(1.0f)
 	, visibleCounter(0)
@@ -100,6 +104,7 @@ SelectorWindow::SelectorWindow() :
 	
 	mModelList->eventListSelectAccept       += MyGUI::newDelegate(this, &SelectorWindow::eventListChangePositionModelListAccept);
 	mModelList->eventListChangePosition     += MyGUI::newDelegate(this, &SelectorWindow::eventListChangePositionModelList);
+	mModelList->eventListChangeScroll       += MyGUI::newDelegate(this, &SelectorWindow::eventListChangeScrollModelList);
 	mConfigComboBox->eventComboAccept       += MyGUI::newDelegate(this, &SelectorWindow::eventComboAcceptConfigComboBox);
 	mOkButton->eventMouseButtonClick        += MyGUI::newDelegate(this, &SelectorWindow::eventMouseButtonClickOkButton);
 	mCancelButton->eventMouseButtonClick    += MyGUI::newDelegate(this, &SelectorWindow::eventMouseButtonClickCancelButton);
@@ -211,6 +216,9 @@ void SelectorWindow::eventKeyButtonPressed_Main(MyGUI::WidgetPtr _sender, MyGUI:
 		else
 			newitem++;
 
+		if (newitem >= (int)mModelList->getItemCount())
+			addResultsPage();
+
 		if (iid == 0)
 		{
 			newitem = (int)mModelList->getItemCount() - 1;
@@ -271,6 +279,13 @@ void SelectorWindow::eventListChangePositionModelListAccept(MyGUI::ListPtr _send
 	selectionDone();
 }
 
+void SelectorWindow::eventListChangeScrollModelList(MyGUI::ListPtr _sender, size_t _position)
+{
+	// load more results when scrolled close to the end
+	if (_position + RESULTS_PAGE_SIZE / 2 >= mModelList->getItemCount())
+		addResultsPage();
+}
+
 void SelectorWindow::eventListChangePositionModelList(MyGUI::ListPtr _sender, size_t _index)
 {
 	if (!mMainWidget->getVisible()) return;
@@ -301,10 +316,14 @@ void SelectorWindow::eventComboAcceptConfigComboBox(MyGUI::ComboBoxPtr _sender,
 
 void SelectorWindow::getData()
 {
-	std::map<int, int> mCategoryUsage;
 	mTypeComboBox->removeAllItems();
 	mModelList->removeAllItems();
 	mEntries.clear();
+	mCategoryEntries.clear();
+	mResults.clear();
+	mResultsShown = 0;
+	mLastSearch = "";
+	mLastSearchResults.clear();
 
 	if (mLoaderType == LT_SKIN)
 	{
@@ -333,7 +352,8 @@ void SelectorWindow::getData()
 
 	int ts = getTimeStamp();
 	std::vector<CacheEntry> *entries = RoR::Application::GetCacheSystem()->getEntries();
-	for (std::vector<CacheEntry>::iterator it = entries->begin(); it!=entries->end(); it++)
+	int index = 0;
+	for (std::vector<CacheEntry>::iterator it = entries->begin(); it!=entries->end(); it++, index++)
 	{
 		// category hidden
 		if (it->categoryid == CacheSystem::CID_Unsorted)
@@ -369,27 +389,28 @@ void SelectorWindow::getData()
 		if (it->categoryid == -1)
 			it->categoryid = CacheSystem::CID_Unsorted;
 
-		mCategoryUsage[it->categoryid]++;
+		mCategoryEntries[it->categoryid].push_back(index);
 
 		// category all
-		mCategoryUsage[CacheSystem::CID_All]++;
+		mCategoryEntries[CacheSystem::CID_All].push_back(index);
 
 		// category fresh
 		if (ts - it->addtimestamp < CACHE_FILE_FRESHNESS)
-			mCategoryUsage[CacheSystem::CID_Fresh]++;
+			mCategoryEntries[CacheSystem::CID_Fresh].push_back(index);
 
-		mEntries.push_back(*it);
+		mEntries.push_back(index);
 	}
 	int tally_categories = 0, current_category = 0;
 	std::map<int, Category_Entry> *cats = RoR::Application::GetCacheSystem()->getCategories();
 	for (std::map<int, Category_Entry>::iterator itc = cats->begin(); itc!=cats->end(); itc++)
 	{
-		if (mCategoryUsage[itc->second.number] > 0)
+		if (mCategoryEntries.find(itc->second.number) != mCategoryEntries.end())
 			tally_categories++;
 	}
 	for (std::map<int, Category_Entry>::iterator itc = cats->begin(); itc!=cats->end(); itc++)
 	{
-		int num_elements = mCategoryUsage[itc->second.number];
+		std::map<int, std::vector<int> >::iterator found = mCategoryEntries.find(itc->second.number);
+		int num_elements = (found != mCategoryEntries.end()) ? (int)found->second.size() : 0;
 		if (num_elements > 0)
 		{
 			UTFString title = _L("unknown");
@@ -415,134 +436,37 @@ void SelectorWindow::getData()
 	}
 }
 
-bool SelectorWindow::searchCompare(String searchString, CacheEntry *ce)
-{
-	if (searchString.find(":") == String::npos)
-	{
-		// normal search
-
-		// the name
-		String dname_lower = ce->dname;
-		StringUtil::toLowerCase(dname_lower);
-		if (dname_lower.find(searchString) != String::npos)
-			return true;
-		
-		// the filename
-		String fname_lower = ce->fname;
-		StringUtil::toLowerCase(fname_lower);
-		if (fname_lower.find(searchString) != String::npos)
-			return true;
-
-		// the description
-		String desc = ce->description;
-		StringUtil::toLowerCase(desc);
-		if (desc.find(searchString) != String::npos)
-			return true;
-
-		// the authors
-		if (!ce->authors.empty())
-		{
-			std::vector<AuthorInfo>::const_iterator it;
-			for (it = ce->authors.begin(); it != ce->authors.end(); it++)
-			{
-				// author name
-				String aname = it->name;
-				StringUtil::toLowerCase(aname);
-				if (aname.find(searchString) != String::npos)
-					return true;
-
-				// author email
-				String aemail = it->email;
-				StringUtil::toLowerCase(aemail);
-				if (aemail.find(searchString) != String::npos)
-					return true;
-			}
-		}
-		return false;
-	} else
-	{
-		StringVector v = StringUtil::split(searchString, ":");
-		if (v.size() < 2) return false; //invalid syntax
-
-		if (v[0] == "hash")
-		{
-			String hash = ce->hash;
-			StringUtil::toLowerCase(hash);
-			return (hash.find(v[1]) != String::npos);
-		} else if (v[0] == "guid")
-		{
-			String guid = ce->guid;
-			StringUtil::toLowerCase(guid);
-			return (guid.find(v[1]) != String::npos);
-		} else if (v[0] == "author")
-		{
-			// the authors
-			if (!ce->authors.empty())
-			{
-				std::vector<AuthorInfo>::const_iterator it;
-				for (it = ce->authors.begin(); it != ce->authors.end(); it++)
-				{
-					// author name
-					String aname = it->name;
-					StringUtil::toLowerCase(aname);
-					if (aname.find(v[1]) != String::npos)
-						return true;
-
-					// author email
-					String aemail = it->email;
-					StringUtil::toLowerCase(aemail);
-					if (aemail.find(v[1]) != String::npos)
-						return true;
-				}
-			}
-			return false;
-		} else if (v[0] == "wheels")
-		{
-			String wheelsStr = TOUTFSTRING(ce->wheelcount) + "x" + TOUTFSTRING(ce->propwheelcount);
-			return (wheelsStr == v[1]);
-		} else if (v[0] == "file")
-		{
-			String fn = ce->fname;
-			StringUtil::toLowerCase(fn);
-			return (fn.find(v[1]) != String::npos);
-		}
-
-		
-	}
-	return false;
-}
-
 void SelectorWindow::onCategorySelected(int categoryID)
 {
 	if (mLoaderType == LT_SKIN) return;
 
-	String search_cmd = mSearchLineEdit->getCaption();
-	StringUtil::toLowerCase(search_cmd);
-
-	int counter = 0;
-	int ts      = getTimeStamp();
+	if (categoryID == CacheSystem::CID_SearchResults)
+	{
+		String search_cmd = mSearchLineEdit->getCaption();
+		StringUtil::toLowerCase(search_cmd);
 
-	mModelList->removeAllItems();
-	
-	for (auto it = mEntries.begin(); it != mEntries.end(); it++)
+		// while typing, only the previous results need to be searched
+		CacheSearchIndex *index = RoR::Application::GetCacheSystem()->getSearchIndex();
+		if (!mLastSearch.empty() && CacheSearchIndex::IsRefinement(mLastSearch, search_cmd))
+			index->Search(search_cmd, mLastSearchResults, mResults);
+		else
+			index->Search(search_cmd, mEntries, mResults);
+		mLastSearch = search_cmd;
+		mLastSearchResults = mResults;
+	} else
 	{
-		if (it->categoryid == categoryID || categoryID == CacheSystem::CID_All
-										|| categoryID == CacheSystem::CID_Fresh && (ts - it->addtimestamp < CACHE_FILE_FRESHNESS)
-										|| categoryID == CacheSystem::CID_SearchResults && searchCompare(search_cmd, &(*it)))
-		{
-			counter++;
-			String txt = TOSTRING(counter)+". " + it->dname;
-			try
-			{
-				mModelList->addItem(txt, it->number);
-			} catch(...)
-			{
-				mModelList->addItem("ENCODING ERROR", it->number);
-			}
-		}
+		std::map<int, std::vector<int> >::iterator found = mCategoryEntries.find(categoryID);
+		if (found != mCategoryEntries.end())
+			mResults = found->second;
+		else
+			mResults.clear();
 	}
 
-	if (counter > 0)
+	mModelList->removeAllItems();
+	mResultsShown = 0;
+	addResultsPage();
+
+	if (!mResults.empty())
 	{
 		try
 		{
@@ -556,6 +480,26 @@ void SelectorWindow::onCategorySelected(int categoryID)
 	}
 }
 
+void SelectorWindow::addResultsPage()
+{
+	if (mResultsShown >= mResults.size()) return;
+
+	std::vector<CacheEntry> *entries = RoR::Application::GetCacheSystem()->getEntries();
+	size_t end = std::min(mResults.size(), mResultsShown + RESULTS_PAGE_SIZE);
+	for (; mResultsShown < end; mResultsShown++)
+	{
+		CacheEntry &entry = (*entries)[mResults[mResultsShown]];
+		String txt = TOSTRING(mResultsShown + 1)+". " + entry.dname;
+		try
+		{
+			mModelList->addItem(txt, entry.number);
+		} catch(...)
+		{
+			mModelList->addItem("ENCODING ERROR", entry.number);
+		}
+	}
+}
+
 void SelectorWindow::onEntrySelected(int entryID)
 {
 	if (mLoaderType == LT_SKIN)
@@ -839,6 +783,10 @@ void SelectorWindow::show(LoaderType type)
 	mSelectedSkin = 0;
 	mSearchLineEdit->setCaption(_L("Search ..."));
 	RoR::Application::GetInputEngine()->resetKeys();
+	// pick up mods which were added/changed while the game was closed; may show the loading window
+	// only in the menu (terrain selection), re-indexing stalls the game
+	if (type == LT_Terrain)
+		RoR::Application::GetCacheSystem()->applyBackgroundRescan();
 	LoadingWindow::getSingleton().hide();
 	// focus main mMainWidget (for key input)
 	mTruckConfigs.clear();
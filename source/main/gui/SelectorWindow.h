@@ -56,6 +56,7 @@ private:
 	void eventKeyButtonPressed_Main(MyGUI::WidgetPtr _sender, MyGUI::KeyCode _key, MyGUI::Char _char);
 	void eventListChangePositionModelList(MyGUI::ListPtr _sender, size_t _index);
 	void eventListChangePositionModelListAccept(MyGUI::ListPtr _sender, size_t _index);
+	void eventListChangeScrollModelList(MyGUI::ListPtr _sender, size_t _position);
 	void eventMouseButtonClickCancelButton(MyGUI::WidgetPtr _sender);
 	void eventMouseButtonClickOkButton(MyGUI::WidgetPtr _sender);
 	void eventSearchTextChange(MyGUI::EditBox *_sender);
@@ -69,7 +70,7 @@ private:
 	void onCategorySelected(int categoryID);
 	void onEntrySelected(int entryID);
 	void selectionDone();
-	bool searchCompare(Ogre::String searchString, CacheEntry *ce);
+	void addResultsPage();
 
 	void updateControls(CacheEntry *entry);
 	void setPreviewImage(Ogre::String texture);
@@ -82,7 +83,12 @@ private:
 	bool mSelectionDone;
 	bool ready;
 	int visibleCounter;
-	std::vector<CacheEntry> mEntries;
+	std::vector<int> mEntries;                       //!< cache entries of the current loader type (positions in CacheSystem::getEntries())
+	std::map<int, std::vector<int> > mCategoryEntries; //!< category ID -> positions in cache entries
+	std::vector<int> mResults;                       //!< shown category or search results
+	size_t mResultsShown;                            //!< results added to the list so far
+	Ogre::String mLastSearch;
+	std::vector<int> mLastSearchResults;
 	std::vector<Ogre::String> mTruckConfigs;
 	std::vector<Skin *> mCurrentSkins;
 
@@ -1126,6 +1126,9 @@ void MainThread::MainMenuLoopUpdateEvents(float seconds_since_last_frame)
 
 void MainThread::LoadTerrain(Ogre::String const & a_terrain_file)
 {
+	// last chance to pick up changed mods before the game starts, the wait hides behind the terrain loading
+	RoR::Application::GetCacheSystem()->applyBackgroundRescan(true);
+
 	// check if the resource is loaded
 	Ogre::String terrain_file = a_terrain_file;
 	if (! RoR::Application::GetCacheSystem()->checkResourceLoaded(terrain_file)) // Input-output argument.
@@ -29,6 +29,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "GUIMenu.h"
 #include "GUIMp.h"
 #include "Language.h"
+#include "PacketBuffer.h"
 #include "RoRFrameListener.h"
 #include "RoRVersion.h"
 #include "Scripting.h"
@@ -104,6 +105,8 @@ Network::Network(String servername, long sport, RoRFrameListener *efl) :
 
 	speed_time=0;
 	speed_bytes_sent = speed_bytes_sent_tmp = speed_bytes_recv = speed_bytes_recv_tmp = 0;
+	speed_bytes_copied = 0;
+	speed_bytes_copied_total = PacketBuffer::getCopiedBytes();
 
 	rconauthed=0;
 	last_time=0;
@@ -336,6 +339,7 @@ int Network::sendMessageRaw(SWInetSocket *socket, char *buffer, unsigned int msg
 		int sendnum=socket->send(buffer+rlen, msgsize-rlen, &error);
 		if (sendnum<0)
 		{
+			MUTEX_UNLOCK(&msgsend_mutex);
 			LOG("NET send error: " + TOSTRING(sendnum));
 			return -1;
 		}
@@ -345,9 +349,38 @@ int Network::sendMessageRaw(SWInetSocket *socket, char *buffer, unsigned int msg
 	return 0;
 }
 
-int Network::sendmessage(SWInetSocket *socket, int type, unsigned int streamid, unsigned int len, char* content)
+int Network::sendPackets(SWInetSocket *socket, PacketBuffer **packets, size_t count)
 {
+	SWBaseSocket::SWBaseError error;
+	int fd = socket->get_fd(&error);
+	if (fd < 0)
+	{
+		LOG("NET send error: invalid socket");
+		return -1;
+	}
+
 	MUTEX_LOCK(&msgsend_mutex); //we use a mutex because a chat message can be sent asynchronously
+	send_batch.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		send_batch.add(packets[i]->getWireData(), packets[i]->getWireSize());
+	}
+	int result = send_batch.send(fd);
+	speed_bytes_sent_tmp += (int)send_batch.getSize();
+	send_batch.clear();
+	MUTEX_UNLOCK(&msgsend_mutex);
+
+	if (result < 0)
+	{
+		LOG("NET send error: " + TOSTRING(result));
+		return -1;
+	}
+	calcSpeed();
+	return 0;
+}
+
+int Network::sendmessage(SWInetSocket *socket, int type, unsigned int streamid, unsigned int len, char* content)
+{
 	SWBaseSocket::SWBaseError error;
 	header_t head;
 	memset(&head, 0, sizeof(header_t));
@@ -369,7 +402,9 @@ int Network::sendmessage(SWInetSocket *socket, int type, unsigned int streamid,
 	memset(buffer, 0, MAX_MESSAGE_LENGTH);
 	memcpy(buffer, (char *)&head, sizeof(header_t));
 	memcpy(buffer+sizeof(header_t), content, len);
+	PacketBuffer::countCopy(len);
 
+	MUTEX_LOCK(&msgsend_mutex); //we use a mutex because a chat message can be sent asynchronously
 	int rlen=0;
 	speed_bytes_sent_tmp += msgsize;
 	while (rlen<(int)msgsize)
@@ -377,6 +412,7 @@ int Network::sendmessage(SWInetSocket *socket, int type, unsigned int streamid,
 		int sendnum=socket->send(buffer+rlen, msgsize-rlen, &error);
 		if (sendnum<0)
 		{
+			MUTEX_UNLOCK(&msgsend_mutex);
 			LOG("NET send error: " + TOSTRING(sendnum));
 			return -1;
 		}
@@ -430,7 +466,52 @@ int Network::receivemessage(SWInetSocket *socket, header_t *head, char* content,
 	}
 	speed_bytes_recv_tmp += head->size + sizeof(header_t);
 
-	memcpy(content, buffer+sizeof(header_t), bufferlen);
+	// the content is truncated to bufferlen, the buffer has only MAX_MESSAGE_LENGTH - sizeof(header_t) bytes after the header
+	unsigned int copylen = std::min(bufferlen, (unsigned int)(MAX_MESSAGE_LENGTH - sizeof(header_t)));
+	memcpy(content, buffer+sizeof(header_t), copylen);
+	PacketBuffer::countCopy(copylen);
+	calcSpeed();
+	return 0;
+}
+
+int Network::receivePacket(SWInetSocket *socket, PacketBuffer *&packet)
+{
+	SWBaseSocket::SWBaseError error;
+	int fd = socket->get_fd(&error);
+	header_t head;
+
+	int result;
+	while ((result = recv_buffer.next(head)) == 0)
+	{
+		if (recv_buffer.fill(fd) < 0)
+		{
+			LOG("NET receive error");
+			return -1;
+		}
+	}
+	if (result < 0)
+	{
+		return result;
+	}
+
+	// stream data go into a buffer of their size, everything else may be read as a fixed size struct (registrations, user infos ...)
+	packet = PacketBuffer::allocate((head.command == MSG2_STREAM_DATA) ? head.size : MAX_MESSAGE_LENGTH - 1);
+	packet->getHeader() = head;
+	packet->clearTail();
+
+	// only the part which arrived with the header is copied, the rest is read right into the packet
+	int copied = recv_buffer.readPayload(fd, packet->getPayload(), head.size);
+	if (copied < 0)
+	{
+		packet->release();
+		packet = 0;
+		LOG("NET receive error");
+		return -1;
+	}
+	PacketBuffer::countCopy(copied);
+
+	speed_bytes_recv_tmp += head.size + sizeof(header_t);
+
 	calcSpeed();
 	return 0;
 }
@@ -446,6 +527,11 @@ int Network::getSpeedDown()
 	return speed_bytes_recv;
 }
 
+int Network::getBytesCopied()
+{
+	return speed_bytes_copied;
+}
+
 void Network::calcSpeed()
 {
 	int t = timer.getMilliseconds();
@@ -456,6 +542,9 @@ void Network::calcSpeed()
 		speed_bytes_sent_tmp = 0;
 		speed_bytes_recv = speed_bytes_recv_tmp;
 		speed_bytes_recv_tmp = 0;
+		size_t copied = PacketBuffer::getCopiedBytes();
+		speed_bytes_copied = (int)(copied - speed_bytes_copied_total);
+		speed_bytes_copied_total = copied;
 		speed_time = t;
 	}
 }
@@ -496,8 +585,8 @@ unsigned long Network::getNetTime()
 void Network::receivethreadstart()
 {
 	header_t header;
+	PacketBuffer *packet = 0;
 
-	char *buffer=(char*)malloc(MAX_MESSAGE_LENGTH);
 	//bool autoDl = (BSETTING("AutoDownload", false));
 	std::deque < stream_reg_t > streamCreationResults;
 	LOG("Receivethread starting");
@@ -514,8 +603,15 @@ void Network::receivethreadstart()
 	socket.set_timeout(0,0);
 	while (!shutdown)
 	{
+		// the consumers hold their own references
+		if (packet)
+		{
+			packet->release();
+			packet = 0;
+		}
+
 		//get one message
-		int err=receivemessage(&socket, &header, buffer, MAX_MESSAGE_LENGTH);
+		int err=receivePacket(&socket, packet);
 		//LOG("received data: " + TOSTRING(header.command) + ", source: "+TOSTRING(header.source) + ":"+TOSTRING(header.streamid) + ", size: "+TOSTRING(header.size));
 		if (err)
 		{
@@ -525,6 +621,8 @@ void Network::receivethreadstart()
 			netFatalError(errmsg);
 			return;
 		}
+		header = packet->getHeader();
+		char *buffer = packet->getPayload();
 
 		// check for stream registration errors and notify the remote client
 		if (BeamFactory::getSingletonPtr() && BeamFactory::getSingletonPtr()->getStreamRegistrationResults(&streamCreationResults))
@@ -586,7 +684,7 @@ void Network::receivethreadstart()
 		{
 			// NOTE: this is only a shortcut for server messages, other UIDs propagate over the standard way
 			ChatSystem *cs = ChatSystemFactory::getSingleton().getFirstChatSystem();
-			if (cs) cs->addReceivedPacket(header, buffer);
+			if (cs) cs->addReceivedPacket(packet);
 			continue;
 		}
 		else if (header.command == MSG2_NETQUALITY && header.source == -1)
@@ -601,6 +699,7 @@ void Network::receivethreadstart()
 		{
 			if (header.source == (int)myuid)
 			{
+				packet->release();
 				netFatalError(_L("disconnected: remote side closed the connection"), false);
 				return;
 			}
@@ -680,8 +779,10 @@ void Network::receivethreadstart()
 			continue;
 		}
 		//debugPacket("receive-1", &header, buffer);
-		NetworkStreamManager::getSingleton().pushReceivedStreamMessage(header, buffer);
+		NetworkStreamManager::getSingleton().pushReceivedStreamMessage(packet);
 	}
+	if (packet)
+		packet->release();
 }
 
 int Network::getClientInfos(client_t c[MAX_PEERS])
@@ -24,11 +24,14 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "RoRPrerequisites.h"
 
 #include "BeamData.h"
+#include "NetworkIO.h"
 #include "rornet.h"
 #include "SocketW.h"
 
 #include <pthread.h>
 
+class PacketBuffer;
+
 class Network : public ZeroedMemoryAllocator
 {
 public:
@@ -41,6 +44,15 @@ public:
 	int sendmessage(SWInetSocket *socket, int type, unsigned int streamid, unsigned int len, char* content);
 	int sendScriptMessage(char* content, unsigned int len);
 	int receivemessage(SWInetSocket *socket, header_t *header, char* content, unsigned int bufferlen);
+	/**
+	 * Sends all packets with one gather write, the packets are not released.
+	 */
+	int sendPackets(SWInetSocket *socket, PacketBuffer **packets, size_t count);
+	/**
+	 * Receives a message into a pooled buffer. Reads go through recv_buffer, so one read usually gets many messages.
+	 * @param packet [out] Holds one reference, must be released by the caller.
+	 */
+	int receivePacket(SWInetSocket *socket, PacketBuffer *&packet);
 
 	// methods
 	bool connect();
@@ -58,6 +70,7 @@ public:
 	int getNetQuality(bool ack=false);
 	int getSpeedDown();
 	int getSpeedUp();
+	int getBytesCopied(); //!< bytes/second memcpy'd by the network code
 	static unsigned long getNetTime();
 	unsigned int getUserID() { return myuid; };
 	user_info_t *getLocalUserData() { return &userdata; };
@@ -82,8 +95,12 @@ private:
 	int rconauthed;
 	int send_buffer_len;
 	int speed_bytes_sent, speed_bytes_sent_tmp, speed_bytes_recv, speed_bytes_recv_tmp;
+	int speed_bytes_copied;
+	size_t speed_bytes_copied_total;
 	int speed_time;
 	long mySport;
+	NetworkReceiveBuffer recv_buffer; //!< receive thread only
+	NetworkSendBatch send_batch;      //!< guarded by msgsend_mutex
 	oob_t send_oob;
 	pthread_cond_t send_work_cv;
 	pthread_mutex_t clients_mutex;
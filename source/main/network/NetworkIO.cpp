@@ -0,0 +1,199 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef USE_SOCKETW
+
+#include "NetworkIO.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif // _WIN32
+
+// chunks per system call, IOV_MAX is at least 16 everywhere and 1024 on most systems
+static const size_t maxChunksPerCall = 64;
+
+// room for many small messages or a few truck updates per read
+static const size_t receiveBufferSize = 64 * 1024 + MAX_MESSAGE_LENGTH + sizeof(header_t);
+
+#ifdef _WIN32
+static inline char *chunkData(WSABUF &c) { return c.buf; }
+static inline size_t chunkLen(WSABUF &c) { return c.len; }
+static inline void setChunk(WSABUF &c, const char *data, size_t len) { c.buf = (CHAR *)data; c.len = (ULONG)len; }
+#else
+static inline char *chunkData(struct iovec &c) { return (char *)c.iov_base; }
+static inline size_t chunkLen(struct iovec &c) { return c.iov_len; }
+static inline void setChunk(struct iovec &c, const char *data, size_t len) { c.iov_base = (void *)data; c.iov_len = len; }
+#endif // _WIN32
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // no SIGPIPE on closed connections, where supported
+#endif
+
+// ================================================================================
+// NetworkSendBatch
+// ================================================================================
+
+NetworkSendBatch::NetworkSendBatch() : bytes(0)
+{
+}
+
+void NetworkSendBatch::add(const char *data, unsigned int len)
+{
+	if (!len) return;
+	chunk_t chunk;
+	setChunk(chunk, data, len);
+	chunks.push_back(chunk);
+	bytes += len;
+}
+
+void NetworkSendBatch::clear()
+{
+	chunks.clear();
+	bytes = 0;
+}
+
+int NetworkSendBatch::send(int fd)
+{
+	size_t first = 0; // first chunk not completely sent
+	while (first < chunks.size())
+	{
+		size_t count = std::min(chunks.size() - first, maxChunksPerCall);
+		size_t sent = 0;
+#ifdef _WIN32
+		DWORD wsent = 0;
+		if (WSASend((SOCKET)fd, &chunks[first], (DWORD)count, &wsent, 0, NULL, NULL) != 0)
+		{
+			if (WSAGetLastError() == WSAEINTR) continue;
+			return -1;
+		}
+		sent = wsent;
+#else
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov    = &chunks[first];
+		msg.msg_iovlen = count;
+		ssize_t result = sendmsg(fd, &msg, MSG_NOSIGNAL);
+		if (result < 0)
+		{
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		sent = (size_t)result;
+#endif // _WIN32
+
+		// skip what went out, the socket may have taken only a part
+		while (sent > 0)
+		{
+			size_t len = chunkLen(chunks[first]);
+			if (sent >= len)
+			{
+				sent -= len;
+				first++;
+			} else
+			{
+				setChunk(chunks[first], chunkData(chunks[first]) + sent, len - sent);
+				sent = 0;
+			}
+		}
+	}
+	return 0;
+}
+
+// ================================================================================
+// NetworkReceiveBuffer
+// ================================================================================
+
+NetworkReceiveBuffer::NetworkReceiveBuffer() :
+	  data(receiveBufferSize)
+	, start(0)
+	, end(0)
+{
+}
+
+int NetworkReceiveBuffer::next(header_t &header)
+{
+	if (end - start < sizeof(header_t))
+		return 0;
+
+	memcpy(&header, &data[start], sizeof(header_t));
+	if (header.size >= MAX_MESSAGE_LENGTH)
+		return -3;
+
+	start += sizeof(header_t);
+	return 1;
+}
+
+int NetworkReceiveBuffer::readPayload(int fd, char *dest, unsigned int size)
+{
+	size_t buffered = std::min((size_t)size, end - start);
+	memcpy(dest, &data[start], buffered);
+	start += buffered;
+
+	size_t received = buffered;
+	while (received < size)
+	{
+#ifdef _WIN32
+		int result = recv((SOCKET)fd, dest + received, (int)(size - received), 0);
+		if (result == SOCKET_ERROR && WSAGetLastError() == WSAEINTR)
+			continue;
+#else
+		ssize_t result = recv(fd, dest + received, size - received, 0);
+		if (result < 0 && errno == EINTR)
+			continue;
+#endif // _WIN32
+		if (result <= 0)
+			return -1;
+		received += result;
+	}
+	return (int)buffered;
+}
+
+int NetworkReceiveBuffer::fill(int fd)
+{
+	// move the incomplete header to the front
+	if (start > 0)
+	{
+		memmove(&data[0], &data[start], end - start);
+		end -= start;
+		start = 0;
+	}
+
+	while (true)
+	{
+#ifdef _WIN32
+		int result = recv((SOCKET)fd, &data[end], (int)(data.size() - end), 0);
+		if (result == SOCKET_ERROR && WSAGetLastError() == WSAEINTR)
+			continue;
+#else
+		ssize_t result = recv(fd, &data[end], data.size() - end, 0);
+		if (result < 0 && errno == EINTR)
+			continue;
+#endif // _WIN32
+		if (result <= 0)
+			return -1;
+		end += result;
+		return 0;
+	}
+}
+
+#endif // USE_SOCKETW
@@ -0,0 +1,101 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef USE_SOCKETW
+#ifndef __NetworkIO_H_
+#define __NetworkIO_H_
+
+#include "rornet.h"
+
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/uio.h>
+#endif // _WIN32
+
+/**
+* Collects messages and writes them with as few system calls as possible (gather write).
+* The data are not copied, they must stay valid until send() returns.
+*/
+class NetworkSendBatch
+{
+public:
+
+	NetworkSendBatch();
+
+	void add(const char *data, unsigned int len);
+	void clear();
+
+	bool empty() const { return chunks.empty(); }
+	size_t getSize() const { return bytes; }
+
+	/// writes everything to a blocking socket, @return 0 or -1 on error
+	int send(int fd);
+
+protected:
+
+#ifdef _WIN32
+	typedef WSABUF chunk_t;
+#else
+	typedef struct iovec chunk_t;
+#endif // _WIN32
+
+	std::vector<chunk_t> chunks;
+	size_t bytes;
+};
+
+/**
+* Receive buffer for a blocking socket: each read takes whatever has arrived, and the
+* headers are parsed right in the buffer instead of reading header and payload separately.
+* Payloads which didn't arrive yet are read straight into their destination.
+*/
+class NetworkReceiveBuffer
+{
+public:
+
+	NetworkReceiveBuffer();
+
+	/**
+	* @param header [out] header of the next message, its payload must be taken with readPayload() before calling next() again
+	* @return 1 if a header was found, 0 if fill() is needed, -3 if the message is too big
+	*/
+	int next(header_t &header);
+
+	/**
+	* Moves the payload of the message returned by next() to dest: what is already buffered
+	* is copied, the rest is read from the socket right into dest.
+	* @return Number of bytes copied from the buffer, -1 on error or when the connection was closed
+	*/
+	int readPayload(int fd, char *dest, unsigned int size);
+
+	/// reads from the socket, blocks until something arrives, @return -1 on error or when the connection was closed
+	int fill(int fd);
+
+protected:
+
+	std::vector<char> data;
+	size_t start;    //!< first byte not parsed yet
+	size_t end;      //!< end of the received data
+};
+
+#endif // __NetworkIO_H_
+
+#endif // USE_SOCKETW
@@ -155,8 +155,9 @@ void NetworkStreamManager::removeUser(int sourceID)
 }
 #endif // USE_SOCKETW
 
-void NetworkStreamManager::pushReceivedStreamMessage(header_t header, char *buffer)
+void NetworkStreamManager::pushReceivedStreamMessage(PacketBuffer *packet)
 {
+	const header_t &header = packet->getHeader();
 	MUTEX_LOCK(&stream_mutex);
 	if (streams.find(header.source) == streams.end())
 	{
@@ -176,7 +177,7 @@ void NetworkStreamManager::pushReceivedStreamMessage(header_t header, char *buff
 		MUTEX_UNLOCK(&stream_mutex);
 		return;
 	}
-	streams[header.source][header.streamid]->addReceivedPacket(header, buffer);
+	streams[header.source][header.streamid]->addReceivedPacket(packet);
 	MUTEX_UNLOCK(&stream_mutex);
 }
 
@@ -199,10 +200,9 @@ void NetworkStreamManager::sendStreams(Network *net, SWInetSocket *socket)
 	send_start = false;
 	MUTEX_UNLOCK(&send_work_mutex);
 
+	// only collect the packets under the lock, sending may block
 	MUTEX_LOCK(&stream_mutex);
-	//char *buffer = 0;
-	//int bufferSize=0;
-
+	send_packets.clear();
 	std::map < int, std::map < unsigned int, Streamable *> >::iterator it;
 	for (it=streams.begin(); it!=streams.end(); it++)
 	{
@@ -210,30 +210,36 @@ void NetworkStreamManager::sendStreams(Network *net, SWInetSocket *socket)
 		for (it2=it->second.begin(); it2!=it->second.end(); it2++)
 		{
 			if (!it2->second) continue;
-			std::deque <Streamable::bufferedPacket_t> *packets = it2->second->getPacketQueue();
+			Streamable::packet_queue_t *packets = it2->second->getPacketQueue();
 
-			while (!packets->empty())
+			// oldest packet first
+			PacketBuffer *packet = 0;
+			while (packets->pop(packet))
 			{
-				// remove oldest packet in queue
-				Streamable::bufferedPacket_t packet = packets->front();
-
-				int etype = net->sendMessageRaw(socket, packet.packetBuffer, packet.size);
-				if (etype)
-				{
-					wchar_t emsg[256];
-					UTFString tmp = _L("Error %i while sending data packet");
-					swprintf(emsg, 256, tmp.asWStr_c_str(), etype);
-					net->netFatalError(UTFString(emsg));
-					MUTEX_UNLOCK(&stream_mutex);
-					return;
-				}
-
-				packets->pop_front();
+				send_packets.push_back(packet);
 			}
-
 		}
 	}
 	MUTEX_UNLOCK(&stream_mutex);
+
+	if (send_packets.empty())
+		return;
+
+	// everything queued since the last frame goes out in one write
+	int etype = net->sendPackets(socket, &send_packets[0], send_packets.size());
+	for (size_t i = 0; i < send_packets.size(); i++)
+	{
+		send_packets[i]->release();
+	}
+	send_packets.clear();
+
+	if (etype)
+	{
+		wchar_t emsg[256];
+		UTFString tmp = _L("Error %i while sending data packet");
+		swprintf(emsg, 256, tmp.asWStr_c_str(), etype);
+		net->netFatalError(UTFString(emsg));
+	}
 }
 #else
 void NetworkStreamManager::sendStreams(Network *net, void *socket)
@@ -273,21 +279,20 @@ void NetworkStreamManager::receiveStreams()
 		for (it2=it->second.begin(); it2!=it->second.end(); it2++)
 		{
 			if (!it2->second) continue;
-			it2->second->lockReceiveQueue();
-			std::deque <recvPacket_t> *packets = it2->second->getReceivePacketQueue();
+			Streamable::packet_queue_t *packets = it2->second->getReceivePacketQueue();
 
-			while (!packets->empty())
+			// remove oldest packet in queue
+			PacketBuffer *packet = 0;
+			while (packets->pop(packet))
 			{
-				// remove oldest packet in queue
-				recvPacket_t packet = packets->front();
+				header_t &header = packet->getHeader();
 
-				//Network::debugPacket("receive-2", &packet.header, (char *)packet.buffer);
+				//Network::debugPacket("receive-2", &header, packet->getPayload());
 
-				if (it2->second) it2->second->receiveStreamData(packet.header.command, packet.header.source, packet.header.streamid, (char*)packet.buffer, packet.header.size);
+				it2->second->receiveStreamData(header.command, header.source, header.streamid, packet->getPayload(), header.size);
 
-				packets->pop_front();
+				packet->release();
 			}
-			it2->second->unlockReceiveQueue();
 		}
 	}
 	MUTEX_UNLOCK(&stream_mutex);
@@ -34,6 +34,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "SocketW.h"
 #endif // USE_SOCKETW
 
+class PacketBuffer;
 class Streamable;
 class StreamableFactoryInterface;
 
@@ -77,10 +78,11 @@ protected:
 
 	std::map < int, std::map < unsigned int, Streamable *> > streams;
 	std::vector < StreamableFactoryInterface * > factories;
+	std::vector < PacketBuffer * > send_packets; //!< send thread only
 
 	unsigned int streamid;
 
-	void pushReceivedStreamMessage(header_t header, char *buffer);
+	void pushReceivedStreamMessage(PacketBuffer *packet);
 
 	void syncRemoteStreams();
 	void receiveStreams();
@@ -0,0 +1,99 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "PacketBuffer.h"
+
+#include <cstring>
+#include <pthread.h>
+#include <vector>
+
+// payload capacities; small packets (character, chat) take the first class, truck updates one of the middle ones
+static const unsigned int sizeClasses[] = { 512, 2048, 8192, MAX_MESSAGE_LENGTH };
+static const int numSizeClasses = sizeof(sizeClasses) / sizeof(sizeClasses[0]);
+static const size_t maxFreeBuffers = 64; //!< per size class, the rest is freed
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<PacketBuffer *> freeBuffers[numSizeClasses];
+
+std::atomic<size_t> PacketBuffer::copied_bytes(0);
+
+PacketBuffer::PacketBuffer(int size_class) :
+	  refs(1)
+	, size_class(size_class)
+	, capacity(sizeClasses[size_class])
+{
+	memory = new char[sizeof(header_t) + capacity + 1];
+	memory[sizeof(header_t) + capacity] = 0;
+}
+
+PacketBuffer::~PacketBuffer()
+{
+	delete[] memory;
+}
+
+PacketBuffer *PacketBuffer::allocate(unsigned int payload_size)
+{
+	int size_class = 0;
+	while (size_class < numSizeClasses && sizeClasses[size_class] < payload_size)
+		size_class++;
+	if (size_class == numSizeClasses)
+		return 0;
+
+	PacketBuffer *packet = 0;
+	pthread_mutex_lock(&pool_mutex);
+	if (!freeBuffers[size_class].empty())
+	{
+		packet = freeBuffers[size_class].back();
+		freeBuffers[size_class].pop_back();
+	}
+	pthread_mutex_unlock(&pool_mutex);
+
+	if (!packet)
+		packet = new PacketBuffer(size_class);
+
+	packet->refs.store(1, std::memory_order_relaxed);
+	memset(packet->memory, 0, sizeof(header_t));
+	packet->getHeader().size = payload_size;
+	// keep string payloads terminated
+	packet->getPayload()[payload_size] = 0;
+	return packet;
+}
+
+void PacketBuffer::release()
+{
+	if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	pthread_mutex_lock(&pool_mutex);
+	if (freeBuffers[size_class].size() < maxFreeBuffers)
+	{
+		freeBuffers[size_class].push_back(this);
+		pthread_mutex_unlock(&pool_mutex);
+		return;
+	}
+	pthread_mutex_unlock(&pool_mutex);
+	delete this;
+}
+
+void PacketBuffer::clearTail()
+{
+	unsigned int size = getHeader().size;
+	if (size < capacity)
+		memset(getPayload() + size, 0, capacity - size);
+}
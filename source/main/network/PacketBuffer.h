@@ -0,0 +1,82 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __PacketBuffer_H_
+#define __PacketBuffer_H_
+
+#include "rornet.h"
+
+#include <atomic>
+#include <cstddef>
+
+/**
+* A network message (header_t followed by the payload) in a pooled, reference counted buffer.
+*
+* The header and payload are stored contiguously, exactly as they go over the wire, so a packet
+* can be received into and sent from the buffer directly. Buffers come in a few size classes and
+* are recycled by release() instead of being freed; allocate() and release() may be called from any thread.
+*/
+class PacketBuffer
+{
+public:
+
+	/**
+	* @param payload_size Minimal payload capacity; the header is zeroed except for its size.
+	* @return Buffer with reference count 1, or 0 if payload_size exceeds MAX_MESSAGE_LENGTH.
+	*/
+	static PacketBuffer *allocate(unsigned int payload_size);
+
+	void addRef() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+	/// returns the buffer to the pool when the last reference is gone
+	void release();
+
+	header_t &getHeader() { return *(header_t *)memory; }
+	char *getPayload() { return memory + sizeof(header_t); }
+	unsigned int getPayloadCapacity() const { return capacity; }
+
+	char *getWireData() { return memory; }
+	unsigned int getWireSize() { return sizeof(header_t) + getHeader().size; }
+
+	/// zeroes the payload capacity behind the payload, for readers that cast the payload to a fixed size struct
+	void clearTail();
+
+	/// statistics: bytes copied by the network code (into or out of packet buffers)
+	static void countCopy(size_t bytes) { copied_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+	static size_t getCopiedBytes() { return copied_bytes.load(std::memory_order_relaxed); }
+
+protected:
+
+	PacketBuffer(int size_class);
+	~PacketBuffer();
+
+	std::atomic<int> refs;
+	int size_class;
+	unsigned int capacity;   //!< payload capacity, without header
+	char *memory;            //!< header + payload + terminating zero
+
+	static std::atomic<size_t> copied_bytes;
+
+private:
+
+	PacketBuffer(const PacketBuffer&);
+	PacketBuffer& operator=(const PacketBuffer&);
+};
+
+#endif // __PacketBuffer_H_
@@ -29,19 +29,23 @@ using namespace Ogre;
 Streamable::Streamable() : isOrigin(false), streamResultsChanged(false)
 {
 	//NetworkStreamManager::getSingleton().addStream(this);
-	pthread_mutex_init(&recv_work_mutex, NULL);
 }
 
 Streamable::~Streamable()
 {
+	PacketBuffer *packet = 0;
+	while (packets.pop(packet))
+		packet->release();
+	while (receivedPackets.pop(packet))
+		packet->release();
 }
 
-std::deque < Streamable::bufferedPacket_t > *Streamable::getPacketQueue()
+Streamable::packet_queue_t *Streamable::getPacketQueue()
 {
 	return &packets;
 }
 
-std::deque < recvPacket_t > *Streamable::getReceivePacketQueue()
+Streamable::packet_queue_t *Streamable::getReceivePacketQueue()
 {
 	return &receivedPackets;
 }
@@ -63,27 +67,21 @@ void Streamable::addPacket(int type, unsigned int len, char* content)
 	int uid = Network::getUID();
 	unsigned int streamid = this->streamid; //we stored the streamid upon stream registration in this class
 
-	bufferedPacket_t packet;
-	memset(&packet, 0, sizeof(bufferedPacket_t));
-
-	// allocate buffer
-	//packet.packetBuffer = (char*)calloc(len, sizeof(char));
-
-	char *buffer = (char*)(packet.packetBuffer);
+	PacketBuffer *packet = PacketBuffer::allocate(len);
+	if (!packet)
+		return;
 
 	// write header in buffer
-	header_t *head = (header_t *)buffer;
+	header_t *head = &packet->getHeader();
 	head->command  = type;
 	head->source   = uid;
 	head->size     = len;
 	head->streamid = streamid;
 
-	// then copy the contents
-	char *bufferContent = (char *)(buffer + sizeof(header_t));
+	// then copy the contents, the only copy until the data hit the socket
+	char *bufferContent = packet->getPayload();
 	memcpy(bufferContent, content, len);
-
-	// record the packet size
-	packet.size = len + sizeof(header_t);
+	PacketBuffer::countCopy(len);
 
 	/*
 	String header_hex = hexdump(buffer, sizeof(header_t));
@@ -102,42 +100,30 @@ void Streamable::addPacket(int type, unsigned int len, char* content)
 	LOG("S|HASH: " + String(hash));
 	*/
 
-	packets.push_back(packet);
+	if (!packets.push(packet))
+	{
+		packet->release();
+		return;
+	}
 
 	// trigger buffer clearing
 	NetworkStreamManager::getSingleton().triggerSend();
 #endif //SOCKETW
 }
 
-void Streamable::addReceivedPacket(header_t header, char *buffer)
+void Streamable::addReceivedPacket(PacketBuffer *packet)
 {
-	if (packets.size() > packetBufferSizeDiscardData && header.command == MSG2_STREAM_DATA)
+	if (receivedPackets.size() > packetBufferSizeDiscardData && packet->getHeader().command == MSG2_STREAM_DATA)
 		// discard unimportant data packets for some while
 		return;
 
-	if (receivedPackets.size() > packetBufferSize)
+	// the packet is shared with the receive thread, no copy
+	packet->addRef();
+	if (!receivedPackets.push(packet))
+	{
 		// buffer full, packet discarded
-		return;
-	MUTEX_LOCK(&recv_work_mutex);
-
-	// construct the data holding struct
-	recvPacket_t packet;
-	memset(&packet, 0, sizeof(packet)); // we need to do this, since we use String(buffer) at some point which will crash otherwise
-	packet.header = header;
-	memcpy(packet.buffer, buffer, header.size);
-
-	receivedPackets.push_back(packet);
-	MUTEX_UNLOCK(&recv_work_mutex);
-}
-
-void Streamable::lockReceiveQueue()
-{
-	MUTEX_LOCK(&recv_work_mutex);
-}
-
-void Streamable::unlockReceiveQueue()
-{
-	MUTEX_UNLOCK(&recv_work_mutex);
+		packet->release();
+	}
 }
 
 void Streamable::addStreamRegistrationResult(int sourceid, stream_register_t reg)
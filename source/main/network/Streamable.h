@@ -25,14 +25,11 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "LockFreeRingBuffer.h"
+#include "PacketBuffer.h"
 #include "rornet.h"
-#include <pthread.h>
 
-typedef struct recvPacket_t
-{
-	header_t header;
-	char *buffer[MAX_MESSAGE_LENGTH];
-} recvPacket_t;
+#include <pthread.h>
 
 /**
  * This class defines a standard interface and a buffer between the actual network code and the class that handles it.
@@ -66,15 +63,11 @@ protected:
 	static const unsigned int maxPacketLen     = 8192;
 
 	// custom types
-	typedef struct _bufferedPacket
-	{
-		char packetBuffer[maxPacketLen];
-		unsigned int size;
-	} bufferedPacket_t;
+	typedef LockFreeRingBuffer < PacketBuffer *, packetBufferSize + 1 > packet_queue_t; //!< owns one reference of each queued packet
 
 	// normal members
-	std::deque < bufferedPacket_t > packets;
-	std::deque < recvPacket_t > receivedPackets;
+	packet_queue_t packets;         //!< outgoing; producer: the thread updating the stream, consumer: network send thread
+	packet_queue_t receivedPackets; //!< incoming; producer: network receive thread, consumer: main thread
 	
 	unsigned int sourceid, streamid;
 
@@ -85,14 +78,10 @@ protected:
 
 	// base class methods
 	void addPacket(int type, unsigned int len, char *content);
-	void addReceivedPacket(header_t header, char *buffer);
-
-	std::deque < bufferedPacket_t > *getPacketQueue();
-	std::deque < recvPacket_t > *getReceivePacketQueue();
-	pthread_mutex_t recv_work_mutex;
+	void addReceivedPacket(PacketBuffer *packet);
 
-	void lockReceiveQueue();
-	void unlockReceiveQueue();
+	packet_queue_t *getPacketQueue();
+	packet_queue_t *getReceivePacketQueue();
 
 private:
 
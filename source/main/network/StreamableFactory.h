@@ -71,6 +71,18 @@ public:
 	virtual void netUserAttributesChanged(int source, int streamid) = 0;
 	virtual X *createRemoteInstance(stream_reg_t *reg) = 0;
 
+	/**
+	* Called for every pending registration on each sync (already locked).
+	* Returning false postpones createRemoteInstance() to a later sync, e.g. to prepare the
+	* instance in background or to spread the work over several frames.
+	*/
+	virtual bool isRemoteInstanceReady(stream_reg_t *reg) { return true; }
+
+	/**
+	* Called when a postponed registration is deleted before createRemoteInstance() (already locked).
+	*/
+	virtual void cancelRemoteInstance(stream_reg_t *reg) {}
+
 	// common functions
 	void createRemote(int sourceid, int streamid, stream_register_t *reg, int colour)
 	{
@@ -103,9 +115,16 @@ public:
 		lockStreams();
 		// first registrations
 		int changes = 0;
-		while (!stream_registrations.empty())
+		std::deque < stream_reg_t >::iterator it_reg = stream_registrations.begin();
+		while (it_reg != stream_registrations.end())
 		{
-			stream_reg_t reg = stream_registrations.front();
+			if (!isRemoteInstanceReady(&(*it_reg)))
+			{
+				++it_reg;
+				continue;
+			}
+
+			stream_reg_t reg = *it_reg;
 			Streamable *s = createRemoteInstance(&reg);
 			if (s)
 			{
@@ -129,7 +148,7 @@ public:
 				stream_creation_results.push_back(reg);
 			}
 			// remove registration from list
-			stream_registrations.pop_front();
+			it_reg = stream_registrations.erase(it_reg);
 			changes++;
 		}
 
@@ -141,6 +160,21 @@ public:
 		while (!stream_deletions.empty())
 		{
 			stream_del_t del = stream_deletions.front();
+
+			// drop postponed registrations of the deleted streams, they were never created
+			it_reg = stream_registrations.begin();
+			while (it_reg != stream_registrations.end())
+			{
+				if (it_reg->sourceid == del.sourceid && (del.streamid == -1 || del.streamid == it_reg->streamid))
+				{
+					cancelRemoteInstance(&(*it_reg));
+					it_reg = stream_registrations.erase(it_reg);
+				} else
+				{
+					++it_reg;
+				}
+			}
+
 			removeInstance(&del);
 			stream_deletions.pop_front();
 			changes++;
@@ -0,0 +1,365 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "VehicleStateStream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Ogre;
+
+static const float minQuantStep = 1.0f / 300.0f; //!< precision of the plain format
+static const float extentMargin = 1.25f;          //!< room for deformation before a keyframe needs a bigger step
+
+static const float minPlayoutDelay = 50.0f;
+static const float maxPlayoutDelay = 1000.0f;
+static const float averageRate = 0.1f;            //!< weight of new samples in the interval and jitter averages
+static const float clockRelaxRate = 0.01f;        //!< how fast the clock offset follows slower packets
+
+static inline unsigned int zigzag(int v)
+{
+	return (static_cast<unsigned int>(v) << 1) ^ static_cast<unsigned int>(v >> 31);
+}
+
+static inline int unzigzag(unsigned int v)
+{
+	return static_cast<int>(v >> 1) ^ -static_cast<int>(v & 1);
+}
+
+// ================================================================================
+// VehicleStateEncoder
+// ================================================================================
+
+VehicleStateEncoder::VehicleStateEncoder(int num_nodes, int num_wheels) :
+	  num_nodes(num_nodes)
+	, num_wheels(num_wheels)
+	, key_q(num_nodes * 3, 0)
+	, q(num_nodes * 3, 0)
+	, keyframe_id(0)
+	, packets_since_key(KEYFRAME_INTERVAL)
+	, scale(minQuantStep)
+{
+}
+
+unsigned int VehicleStateEncoder::encode(const oob_t &oob, const Vector3 *positions, const float *wheel_rp, const Vector3 &base_pos, const Quaternion &base_rot, char *buffer, unsigned int buffer_size)
+{
+	const unsigned int head_size  = sizeof(oob_t) + sizeof(delta_state_header_t);
+	const unsigned int wheel_size = num_wheels * sizeof(float);
+	const unsigned int key_size   = head_size + num_nodes * 3 * sizeof(short) + wheel_size;
+	if (key_size > buffer_size)
+		return 0;
+
+	// positions in the vehicle frame; whatever moves rigidly with the vehicle stays constant here
+	Quaternion inv_rot = base_rot.Inverse();
+	float extent = 0.0f;
+	for (int i = 0; i < num_nodes; i++)
+	{
+		Vector3 local = inv_rot * (positions[i] - base_pos);
+		for (int c = 0; c < 3; c++)
+		{
+			extent = std::max(extent, std::fabs(local[c]));
+			q[i * 3 + c] = static_cast<int>(floorf(local[c] / scale + 0.5f));
+		}
+	}
+
+	bool keyframe = (packets_since_key >= KEYFRAME_INTERVAL) || (extent / scale > 32767.0f);
+
+	unsigned int pos = head_size;
+	if (!keyframe)
+	{
+		// differences to the keyframe, must stay smaller than a keyframe
+		const unsigned int limit = std::min(buffer_size, key_size) - wheel_size;
+		for (int i = 0; i < num_nodes * 3 && !keyframe; i++)
+		{
+			unsigned int v = zigzag(q[i] - key_q[i]);
+			do
+			{
+				if (pos >= limit)
+				{
+					keyframe = true;
+					break;
+				}
+				unsigned char b = v & 0x7f;
+				v >>= 7;
+				buffer[pos++] = static_cast<char>(v ? (b | 0x80) : b);
+			} while (v);
+		}
+	}
+
+	if (keyframe)
+	{
+		scale = std::max(extent * extentMargin / 32767.0f, minQuantStep);
+		keyframe_id++;
+		packets_since_key = 0;
+
+		pos = head_size;
+		for (int i = 0; i < num_nodes; i++)
+		{
+			Vector3 local = inv_rot * (positions[i] - base_pos);
+			for (int c = 0; c < 3; c++)
+			{
+				key_q[i * 3 + c] = static_cast<short>(floorf(local[c] / scale + 0.5f));
+			}
+		}
+		memcpy(buffer + pos, &key_q[0], num_nodes * 3 * sizeof(short));
+		pos += num_nodes * 3 * sizeof(short);
+	}
+	packets_since_key++;
+
+	oob_t *send_oob = (oob_t *)buffer;
+	*send_oob = oob;
+	send_oob->flagmask |= NETMASK_DELTA_STATE;
+
+	delta_state_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.keyframe_id = keyframe_id;
+	header.flags       = keyframe ? DELTA_STATE_KEYFRAME : 0;
+	header.scale       = scale;
+	header.origin[0]   = base_pos.x;
+	header.origin[1]   = base_pos.y;
+	header.origin[2]   = base_pos.z;
+	header.rotation[0] = base_rot.w;
+	header.rotation[1] = base_rot.x;
+	header.rotation[2] = base_rot.y;
+	header.rotation[3] = base_rot.z;
+	memcpy(buffer + sizeof(oob_t), &header, sizeof(header));
+
+	if (wheel_size)
+	{
+		memcpy(buffer + pos, wheel_rp, wheel_size);
+		pos += wheel_size;
+	}
+	return pos;
+}
+
+// ================================================================================
+// VehicleStateDecoder
+// ================================================================================
+
+VehicleStateDecoder::VehicleStateDecoder(int num_nodes, int num_wheels) :
+	  num_nodes(num_nodes)
+	, num_wheels(num_wheels)
+	, key_q(num_nodes * 3, 0)
+	, keyframe_id(0)
+	, has_keyframe(false)
+{
+}
+
+bool VehicleStateDecoder::isDeltaPacket(const char *data, unsigned int len)
+{
+	if (len < sizeof(oob_t))
+		return false;
+	oob_t oob;
+	memcpy(&oob, data, sizeof(oob));
+	return (oob.flagmask & NETMASK_DELTA_STATE) != 0;
+}
+
+bool VehicleStateDecoder::decode(const char *data, unsigned int len, VehicleSnapshot &snapshot)
+{
+	const unsigned int head_size  = sizeof(oob_t) + sizeof(delta_state_header_t);
+	const unsigned int wheel_size = num_wheels * sizeof(float);
+	if (len < head_size + wheel_size)
+		return false;
+
+	delta_state_header_t header;
+	memcpy(&snapshot.oob, data, sizeof(oob_t));
+	memcpy(&header, data + sizeof(oob_t), sizeof(header));
+	if (!(header.scale > 0.0f) || !std::isfinite(header.scale))
+		return false;
+
+	const unsigned int end = len - wheel_size;
+	unsigned int pos = head_size;
+	if (header.flags & DELTA_STATE_KEYFRAME)
+	{
+		if (end - pos != num_nodes * 3 * sizeof(short))
+			return false;
+		memcpy(&key_q[0], data + pos, num_nodes * 3 * sizeof(short));
+		keyframe_id  = header.keyframe_id;
+		has_keyframe = true;
+	}
+	else if (!has_keyframe || header.keyframe_id != keyframe_id)
+	{
+		return false; // wait for the next keyframe
+	}
+
+	Vector3 origin(header.origin[0], header.origin[1], header.origin[2]);
+	Quaternion rot(header.rotation[0], header.rotation[1], header.rotation[2], header.rotation[3]);
+	rot.normalise();
+
+	snapshot.nodes.resize(num_nodes);
+	for (int i = 0; i < num_nodes; i++)
+	{
+		int v[3];
+		for (int c = 0; c < 3; c++)
+		{
+			v[c] = key_q[i * 3 + c];
+			if (header.flags & DELTA_STATE_KEYFRAME)
+				continue;
+
+			unsigned int z = 0;
+			int shift = 0;
+			unsigned char b;
+			do
+			{
+				if (pos >= end || shift > 28)
+					return false;
+				b = static_cast<unsigned char>(data[pos++]);
+				z |= (b & 0x7fu) << shift;
+				shift += 7;
+			} while (b & 0x80);
+			v[c] += unzigzag(z);
+		}
+		snapshot.nodes[i] = origin + rot * (Vector3((float)v[0], (float)v[1], (float)v[2]) * header.scale);
+	}
+	if (!(header.flags & DELTA_STATE_KEYFRAME) && pos != end)
+		return false;
+
+	snapshot.wheel_rp.resize(num_wheels);
+	if (wheel_size)
+	{
+		memcpy(&snapshot.wheel_rp[0], data + end, wheel_size);
+	}
+	return true;
+}
+
+// ================================================================================
+// VehicleSnapshotBuffer
+// ================================================================================
+
+VehicleSnapshotBuffer::VehicleSnapshotBuffer() :
+	  first(0)
+	, count(0)
+	, clock_offset(0.0f)
+	, interval(100.0f)
+	, jitter(0.0f)
+	, delay(minPlayoutDelay)
+	, last_offset(0.0f)
+	, has_clock(false)
+{
+}
+
+void VehicleSnapshotBuffer::push(VehicleSnapshot &snapshot, int local_time)
+{
+	float offset = (float)(snapshot.oob.time - local_time);
+
+	if (count > 0)
+	{
+		VehicleSnapshot &newest = at(count - 1);
+		int sent_interval = snapshot.oob.time - newest.oob.time;
+		if (sent_interval <= 0)
+		{
+			if (sent_interval > -(int)maxPlayoutDelay)
+				return; // duplicate or out of order
+			// the sender restarted its clock
+			count = 0;
+			has_clock = false;
+		}
+		else
+		{
+			float arrival_interval = sent_interval - (offset - last_offset);
+			interval += (sent_interval - interval) * averageRate;
+			jitter   += (std::fabs(arrival_interval - sent_interval) - jitter) * averageRate;
+		}
+	}
+	last_offset = offset;
+
+	// the fastest packets define the clock offset, slower ones are what the delay is for
+	if (!has_clock || offset > clock_offset)
+		clock_offset = offset;
+	else
+		clock_offset += (offset - clock_offset) * clockRelaxRate;
+	has_clock = true;
+
+	delay = std::min(std::max(interval + 2.0f * jitter, minPlayoutDelay), maxPlayoutDelay);
+
+	if (count == MAX_SNAPSHOTS)
+	{
+		first = (first + 1) % MAX_SNAPSHOTS;
+		count--;
+	}
+	VehicleSnapshot &slot = at(count);
+	slot.oob = snapshot.oob;
+	slot.nodes.swap(snapshot.nodes);
+	slot.wheel_rp.swap(snapshot.wheel_rp);
+	count++;
+}
+
+/// cubic Hermite between p1 and p2 with Catmull-Rom tangents for uneven spacing
+static inline float hermite(float p0, float p1, float p2, float p3, float t0, float t1, float t2, float t3, float s)
+{
+	float dt = t2 - t1;
+	float m1 = (p2 - p0) / (t2 - t0) * dt;
+	float m2 = (p3 - p1) / (t3 - t1) * dt;
+	float s2 = s * s;
+	float s3 = s2 * s;
+	return (2.0f * s3 - 3.0f * s2 + 1.0f) * p1 + (s3 - 2.0f * s2 + s) * m1 + (-2.0f * s3 + 3.0f * s2) * p2 + (s3 - s2) * m2;
+}
+
+static inline Vector3 hermite(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2, const Vector3 &p3, float t0, float t1, float t2, float t3, float s)
+{
+	float dt = t2 - t1;
+	Vector3 m1 = (p2 - p0) * (dt / (t2 - t0));
+	Vector3 m2 = (p3 - p1) * (dt / (t3 - t1));
+	float s2 = s * s;
+	float s3 = s2 * s;
+	return p1 * (2.0f * s3 - 3.0f * s2 + 1.0f) + m1 * (s3 - 2.0f * s2 + s) + p2 * (-2.0f * s3 + 3.0f * s2) + m2 * (s3 - s2);
+}
+
+bool VehicleSnapshotBuffer::sample(int local_time, VehicleSnapshot &out, float &tratio)
+{
+	if (count < 2)
+		return false;
+
+	float render_time = local_time + clock_offset - delay;
+
+	// no extrapolation: hold the ends
+	int i = 0;
+	while (i < count - 2 && at(i + 1).oob.time <= render_time)
+		i++;
+
+	VehicleSnapshot &s0 = at(std::max(i - 1, 0));
+	VehicleSnapshot &s1 = at(i);
+	VehicleSnapshot &s2 = at(i + 1);
+	VehicleSnapshot &s3 = at(std::min(i + 2, count - 1));
+	float t0 = (float)s0.oob.time, t1 = (float)s1.oob.time, t2 = (float)s2.oob.time, t3 = (float)s3.oob.time;
+
+	tratio = std::min(std::max((render_time - t1) / (t2 - t1), 0.0f), 1.0f);
+
+	out.nodes.resize(s1.nodes.size());
+	for (size_t n = 0; n < s1.nodes.size(); n++)
+	{
+		out.nodes[n] = hermite(s0.nodes[n], s1.nodes[n], s2.nodes[n], s3.nodes[n], t0, t1, t2, t3, tratio);
+	}
+	out.wheel_rp.resize(s1.wheel_rp.size());
+	for (size_t w = 0; w < s1.wheel_rp.size(); w++)
+	{
+		out.wheel_rp[w] = hermite(s0.wheel_rp[w], s1.wheel_rp[w], s2.wheel_rp[w], s3.wheel_rp[w], t0, t1, t2, t3, tratio);
+	}
+
+	out.oob = s1.oob;
+	out.oob.time          = (int)render_time;
+	out.oob.engine_speed  = s1.oob.engine_speed  + tratio * (s2.oob.engine_speed  - s1.oob.engine_speed);
+	out.oob.engine_force  = s1.oob.engine_force  + tratio * (s2.oob.engine_force  - s1.oob.engine_force);
+	out.oob.engine_clutch = s1.oob.engine_clutch + tratio * (s2.oob.engine_clutch - s1.oob.engine_clutch);
+	out.oob.hydrodirstate = s1.oob.hydrodirstate + tratio * (s2.oob.hydrodirstate - s1.oob.hydrodirstate);
+	out.oob.brake         = s1.oob.brake         + tratio * (s2.oob.brake         - s1.oob.brake);
+	out.oob.wheelspeed    = s1.oob.wheelspeed    + tratio * (s2.oob.wheelspeed    - s1.oob.wheelspeed);
+	return true;
+}
@@ -0,0 +1,143 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __VehicleStateStream_H_
+#define __VehicleStateStream_H_
+
+#include "rornet.h"
+
+#include <OgreQuaternion.h>
+#include <OgreVector3.h>
+
+#include <vector>
+
+/**
+ * Delta vehicle stream format, an alternative to the plain node list sent by Beam::sendStreamData().
+ *
+ * Packet layout: oob_t (flagmask has NETMASK_DELTA_STATE) | delta_state_header_t | node data | float wheel_rp[]
+ *
+ * Node positions are sent in the vehicle's own frame (base position + rotation in the header),
+ * quantized with a step chosen from the vehicle size. A keyframe carries all quantized positions
+ * as int16; the following packets carry only the difference to the last keyframe as zigzag varints,
+ * which is one byte per coordinate for everything that moves rigidly with the vehicle.
+ * The stream goes through the server to all clients and nobody acknowledges anything, so keyframes
+ * are repeated every KEYFRAME_INTERVAL packets; a client that missed one waits for the next.
+ */
+
+/// Decoded state of a remote vehicle at one point of (sender's) time
+struct VehicleSnapshot
+{
+	oob_t oob;
+	std::vector<Ogre::Vector3> nodes; //!< first_wheel_node positions
+	std::vector<float> wheel_rp;      //!< wheel rotations
+};
+
+class VehicleStateEncoder
+{
+public:
+
+	static const int KEYFRAME_INTERVAL = 10;
+
+	VehicleStateEncoder(int num_nodes, int num_wheels);
+
+	/**
+	 * @param oob          copied to the packet, NETMASK_DELTA_STATE is added to its flagmask
+	 * @param positions    num_nodes absolute node positions
+	 * @param wheel_rp     num_wheels wheel rotations
+	 * @param base_pos     base transform of the vehicle (rigid body part of the movement)
+	 * @param base_rot     base transform of the vehicle
+	 * @return packet size, 0 if the buffer is too small even for a keyframe
+	 */
+	unsigned int encode(const oob_t &oob, const Ogre::Vector3 *positions, const float *wheel_rp, const Ogre::Vector3 &base_pos, const Ogre::Quaternion &base_rot, char *buffer, unsigned int buffer_size);
+
+	/// forces the next packet to be a keyframe
+	void reset() { packets_since_key = KEYFRAME_INTERVAL; };
+
+protected:
+
+	int num_nodes, num_wheels;
+	std::vector<short> key_q;        //!< quantized local positions of the last keyframe
+	std::vector<int> q;              //!< scratch
+	unsigned short keyframe_id;
+	int packets_since_key;
+	float scale;                     //!< meters per quantization step, set by keyframes
+};
+
+class VehicleStateDecoder
+{
+public:
+
+	VehicleStateDecoder(int num_nodes, int num_wheels);
+
+	/// @return true if the packet is in the delta format (NETMASK_DELTA_STATE)
+	static bool isDeltaPacket(const char *data, unsigned int len);
+
+	/// @return false if the packet is damaged or refers to a keyframe that wasn't received
+	bool decode(const char *data, unsigned int len, VehicleSnapshot &snapshot);
+
+protected:
+
+	int num_nodes, num_wheels;
+	std::vector<short> key_q;
+	unsigned short keyframe_id;
+	bool has_keyframe;
+};
+
+/**
+ * Jitter buffer for remote vehicles: keeps the last MAX_SNAPSHOTS snapshots and plays them back
+ * delayed by the observed packet interval and jitter, interpolating node positions with
+ * Hermite (Catmull-Rom) splines over four snapshots instead of linearly between two.
+ */
+class VehicleSnapshotBuffer
+{
+public:
+
+	static const int MAX_SNAPSHOTS = 8;
+
+	VehicleSnapshotBuffer();
+
+	/// takes over the snapshot data (swap)
+	void push(VehicleSnapshot &snapshot, int local_time);
+
+	/**
+	 * @param out [out] interpolated state; discrete values (gear, flags) come from the older snapshot
+	 * @param tratio [out] position between the two snapshots, 0..1
+	 * @return false if there is nothing to play yet
+	 */
+	bool sample(int local_time, VehicleSnapshot &out, float &tratio);
+
+	size_t size() const { return count; };
+
+	int getDelay() const { return (int)delay; };
+
+protected:
+
+	VehicleSnapshot snapshots[MAX_SNAPSHOTS]; //!< ring, oldest at 'first'
+	int first, count;
+	float clock_offset;    //!< sender time - local time, of the fastest packets
+	float interval;        //!< average sender interval, ms
+	float jitter;          //!< average deviation of arrival intervals from sender intervals, ms
+	float delay;           //!< playback delay, ms
+	float last_offset;     //!< offset of the previous packet
+	bool has_clock;
+
+	VehicleSnapshot &at(int i) { return snapshots[(first + i) % MAX_SNAPSHOTS]; };
+};
+
+#endif // __VehicleStateStream_H_
@@ -142,6 +142,8 @@ enum {
 	NETMASK_ENGINE_MODE_MANUAL        = BITMASK(22), //!< engine mode
 	NETMASK_ENGINE_MODE_MANUAL_STICK  = BITMASK(23), //!< engine mode
 	NETMASK_ENGINE_MODE_MANUAL_RANGES = BITMASK(24), //!< engine mode
+
+	NETMASK_DELTA_STATE = BITMASK(25), //!< stream data uses the delta format: oob_t, delta_state_header_t, node data, wheel data
 };
 
 // structs
@@ -242,6 +244,23 @@ typedef struct oob_t
 	unsigned int flagmask;     //!< flagmask: NETMASK_*
 } oob_t;
 
+/**
+ * RoRNet; follows oob_t in truck stream data when NETMASK_DELTA_STATE is set
+ */
+typedef struct delta_state_header_t
+{
+	unsigned short keyframe_id; //!< keyframe this packet belongs to
+	unsigned char flags;        //!< DELTA_STATE_*
+	unsigned char reserved;
+	float scale;                //!< meters per quantization step
+	float origin[3];            //!< base position of the vehicle
+	float rotation[4];          //!< base rotation of the vehicle: w, x, y, z
+} delta_state_header_t;
+
+enum {
+	DELTA_STATE_KEYFRAME = BITMASK(1), //!< node data are int16 positions, otherwise zigzag varint differences to the keyframe
+};
+
 /**
  * RoRNet; server settings struct
  */
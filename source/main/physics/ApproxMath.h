@@ -28,6 +28,11 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define ROR_USE_SSE2
+# include <emmintrin.h>
+#endif // SSE2
+
 static int mirand = 1;
 
 // Returns a random number in the range [0, 1]
@@ -145,6 +150,73 @@ inline float sign(const float x)
 	return (x > 0.0f) ? 1.0f : (x < 0.0f) ? -1.0f : 0.0f;
 }
 
+// Reduces x to about [-pi, pi]; 2*pi is split in two parts to keep the precision for large x
+inline float approx_reduce_angle(float x)
+{
+	float q = floorf(x * (1.0f / Ogre::Math::TWO_PI) + 0.5f);
+	return (x - q * 6.28125f) - q * 1.9353071795864769e-3f;
+}
+
+// Calculates sin(x), absolute error < 1e-5 for |x| < 10^5
+// Reduces to [-pi/2, pi/2] and evaluates a 9th order polynomial
+inline float approx_sin(float x)
+{
+	x = approx_reduce_angle(x);
+	// fold into [-pi/2, pi/2]
+	if (x > Ogre::Math::HALF_PI)
+		x = Ogre::Math::PI - x;
+	else if (x < -Ogre::Math::HALF_PI)
+		x = -Ogre::Math::PI - x;
+
+	float x2 = x * x;
+	return x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333333e-3f + x2 * (-1.9841270e-4f + x2 * 2.7557319e-6f))));
+}
+
+inline float approx_cos(float x)
+{
+	return approx_sin(approx_reduce_angle(x) + Ogre::Math::HALF_PI);
+}
+
+#ifdef ROR_USE_SSE2
+// approx_reduce_angle() for four values at once
+inline __m128 approx_reduce_angle4(__m128 x)
+{
+	// cvtps rounds to nearest
+	__m128 q = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.0f / Ogre::Math::TWO_PI))));
+	x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(6.28125f)));
+	return _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(1.9353071795864769e-3f)));
+}
+
+// approx_sin() for four values at once
+inline __m128 approx_sin4(__m128 x)
+{
+	const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+	x = approx_reduce_angle4(x);
+
+	// fold into [-pi/2, pi/2]
+	__m128 sign   = _mm_and_ps(x, sign_mask);
+	__m128 absx   = _mm_andnot_ps(sign_mask, x);
+	__m128 fold   = _mm_cmpgt_ps(absx, _mm_set1_ps(Ogre::Math::HALF_PI));
+	__m128 folded = _mm_sub_ps(_mm_set1_ps(Ogre::Math::PI), absx);
+	absx = _mm_or_ps(_mm_and_ps(fold, folded), _mm_andnot_ps(fold, absx));
+	x = _mm_xor_ps(absx, sign);
+
+	__m128 x2 = _mm_mul_ps(x, x);
+	__m128 p  = _mm_set1_ps(2.7557319e-6f);
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.9841270e-4f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(8.3333333e-3f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.6666667e-1f));
+	p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+	return _mm_mul_ps(p, x);
+}
+
+inline __m128 approx_cos4(__m128 x)
+{
+	return approx_sin4(_mm_add_ps(approx_reduce_angle4(x), _mm_set1_ps(Ogre::Math::HALF_PI)));
+}
+#endif // ROR_USE_SSE2
+
 // Ogre3 specific helpers
 inline Ogre::Vector3 approx_normalise(Ogre::Vector3 v)
 {
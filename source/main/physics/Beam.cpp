@@ -32,12 +32,12 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Buoyance.h"
 #include "CacheSystem.h"
 #include "CameraManager.h"
+#include "CharacterFactory.h"
 #include "CmdKeyInertia.h"
 #include "Collisions.h"
 #include "Console.h"
 #include "DashBoardManager.h"
 #include "Differentials.h"
-#include "DustManager.h"
 #include "ErrorUtils.h"
 #include "FlexAirfoil.h"
 #include "FlexBody.h"
@@ -46,6 +46,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "FlexObj.h"
 #include "IHeightFinder.h"
 #include "InputEngine.h"
+#include "LabelBatcher.h"
 #include "Language.h"
 #include "MeshObject.h"
 #include "MovableText.h"
@@ -65,10 +66,14 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "ThreadPool.h"
 #include "TurboJet.h"
 #include "TurboProp.h"
+#include "VehicleStateStream.h"
 #include "Water.h"
 
 #include "RigDef_Parser.h"
 #include "RigDef_Validator.h"
+#include "RigDefLoader.h"
+
+#include <cfloat>
 
 // some gcc fixes
 #if OGRE_PLATFORM == OGRE_PLATFORM_LINUX
@@ -100,10 +105,21 @@ Beam::~Beam()
 	{
 		SoundScriptManager::getSingleton().trigStop(this->trucknum, i);
 	}
+	// and release their samples
+	for (int i=0; i < free_soundsource; i++)
+	{
+		SoundScriptManager::getSingleton().destroyInstance(soundsources[i].ssi);
+		soundsources[i].ssi = 0;
+	}
+	free_soundsource = 0;
 #endif // USE_OPENAL
 
 	// destruct and remove every tiny bit of stuff we created :-|
 	if (nettimer) delete nettimer; nettimer=0;
+	if (netDecoder) delete netDecoder; netDecoder=0;
+	if (netSnapshots) delete netSnapshots; netSnapshots=0;
+	if (netSample) delete netSample; netSample=0;
+	if (netEncoder) delete netEncoder; netEncoder=0;
 	if (engine) delete engine; engine=0;
 	if (buoyance) delete buoyance; buoyance=0;
 	if (autopilot) delete autopilot;
@@ -112,6 +128,13 @@ Beam::~Beam()
 	if (materialFunctionMapper) delete materialFunctionMapper;
 	if (replay) delete replay;
 
+	// the skidmarks themselves stay on the ground
+	for (int i=0; i<free_wheel; i++)
+	{
+		if (skidtrails[i]) delete skidtrails[i];
+		skidtrails[i] = 0;
+	}
+
 	// TODO: Make sure we catch everything here
 	// remove all scene nodes
 	if (deletion_sceneNodes.size() > 0)
@@ -291,11 +314,10 @@ Beam::~Beam()
 		delete (*it);
 	}
 
-	if (netMT)
+	if (netLabel)
 	{
-		netMT->setVisible(false);
-		delete netMT;
-		netMT = 0;
+		LabelBatcher::getSingleton().destroyLabel(netLabel);
+		netLabel = 0;
 	}
 
 	if (state == NETWORKED) // int rig_t::state
@@ -303,8 +325,6 @@ Beam::~Beam()
 		pthread_mutex_destroy(&net_mutex);
 	}
 
-	pthread_cond_destroy(&flexable_task_count_cv);
-	pthread_mutex_destroy(&flexable_task_count_mutex);
 	for (int task=0; task < THREAD_MAX; task++)
 	{
 		pthread_cond_destroy(&task_count_cv[task]);
@@ -510,6 +530,24 @@ void Beam::pushNetwork(char* data, int size)
 	BES_GFX_START(BES_GFX_pushNetwork);
 	if (!oob3) return;
 
+	if (VehicleStateDecoder::isDeltaPacket(data, size))
+	{
+		VehicleSnapshot snapshot;
+		if (!netDecoder->decode(data, size, snapshot))
+		{
+			// damaged, or the keyframe it refers to was lost; the next keyframe fixes that
+			return;
+		}
+		int local_time = nettimer->getMilliseconds();
+
+		MUTEX_LOCK(&net_mutex);
+		netSnapshots->push(snapshot, local_time);
+		netcounter++;
+		MUTEX_UNLOCK(&net_mutex);
+		BES_GFX_STOP(BES_GFX_pushNetwork);
+		return;
+	}
+
 	// check if the size of the data matches to what we expected
 	if ((unsigned int)size == (netbuffersize + sizeof(oob_t)))
 	{
@@ -577,13 +615,31 @@ void Beam::calcNetwork()
 	//we must lock as long as we use oob1, oob2, netb1, netb2
 	MUTEX_LOCK(&net_mutex);
 	int tnow=nettimer->getMilliseconds();
-	//adjust offset to match remote time
-	int rnow=tnow+net_toffset;
-	//if we receive older data from the future, we must correct the offset
-	if (oob1->time>rnow) {net_toffset=oob1->time-tnow; rnow=tnow+net_toffset;}
-	//if we receive last data from the past, we must correct the offset
-	if (oob2->time<rnow) {net_toffset=oob2->time-tnow; rnow=tnow+net_toffset;}
-	float tratio=(float)(rnow-oob1->time)/(float)(oob2->time-oob1->time);
+	oob_t *noob1 = oob1;
+	oob_t *noob2 = oob2;
+	float tratio = 0.0f;
+	bool delta_state = (netSnapshots->size() > 0);
+	if (delta_state)
+	{
+		// the jitter buffer does the timing and the interpolation, everything comes from one sample
+		if (!netSnapshots->sample(tnow, *netSample, tratio))
+		{
+			MUTEX_UNLOCK(&net_mutex);
+			return;
+		}
+		noob1 = noob2 = &netSample->oob;
+		net_toffset = netSample->oob.time - tnow;
+	}
+	else
+	{
+		//adjust offset to match remote time
+		int rnow=tnow+net_toffset;
+		//if we receive older data from the future, we must correct the offset
+		if (oob1->time>rnow) {net_toffset=oob1->time-tnow; rnow=tnow+net_toffset;}
+		//if we receive last data from the past, we must correct the offset
+		if (oob2->time<rnow) {net_toffset=oob2->time-tnow; rnow=tnow+net_toffset;}
+		tratio=(float)(rnow-oob1->time)/(float)(oob2->time-oob1->time);
+	}
 	//LOG(" network time diff: "+ TOSTRING(net_toffset));
 	Vector3 p1ref = Vector3::ZERO;
 	Vector3 p2ref = Vector3::ZERO;
@@ -594,34 +650,41 @@ void Beam::calcNetwork()
 	Vector3 p2 = Vector3::ZERO;
 	for (int i = 0; i < first_wheel_node; i++)
 	{
-		//linear interpolation
-		if (i == 0)
+		if (delta_state)
 		{
-			// first node is uncompressed
-			p1.x  = ((float*)netb1)[0];
-			p1.y  = ((float*)netb1)[1];
-			p1.z  = ((float*)netb1)[2];
-			p1ref = p1;
-			p2.x  = ((float*)netb2)[0];
-			p2.y  = ((float*)netb2)[1];
-			p2.z  = ((float*)netb2)[2];
-			p2ref = p2;
+			nodes[i].AbsPosition = netSample->nodes[i];
 		}
 		else
 		{
-			// all other nodes are compressed:
-			// short int compared to previous node
-			p1.x = (float)(sp1[(i - 1) *3 + 0]) / 300.0f;
-			p1.y = (float)(sp1[(i - 1) *3 + 1]) / 300.0f;
-			p1.z = (float)(sp1[(i - 1) *3 + 2]) / 300.0f;
-			p1   = p1 + p1ref;
-
-			p2.x = (float)(sp2[(i - 1) *3 + 0]) / 300.0f;
-			p2.y = (float)(sp2[(i - 1) *3 + 1]) / 300.0f;
-			p2.z = (float)(sp2[(i - 1) *3 + 2]) / 300.0f;
-			p2   = p2 + p2ref;
+			//linear interpolation
+			if (i == 0)
+			{
+				// first node is uncompressed
+				p1.x  = ((float*)netb1)[0];
+				p1.y  = ((float*)netb1)[1];
+				p1.z  = ((float*)netb1)[2];
+				p1ref = p1;
+				p2.x  = ((float*)netb2)[0];
+				p2.y  = ((float*)netb2)[1];
+				p2.z  = ((float*)netb2)[2];
+				p2ref = p2;
+			}
+			else
+			{
+				// all other nodes are compressed:
+				// short int compared to previous node
+				p1.x = (float)(sp1[(i - 1) *3 + 0]) / 300.0f;
+				p1.y = (float)(sp1[(i - 1) *3 + 1]) / 300.0f;
+				p1.z = (float)(sp1[(i - 1) *3 + 2]) / 300.0f;
+				p1   = p1 + p1ref;
+
+				p2.x = (float)(sp2[(i - 1) *3 + 0]) / 300.0f;
+				p2.y = (float)(sp2[(i - 1) *3 + 1]) / 300.0f;
+				p2.z = (float)(sp2[(i - 1) *3 + 2]) / 300.0f;
+				p2   = p2 + p2ref;
+			}
+			nodes[i].AbsPosition  = p1 + tratio * (p2 - p1);
 		}
-		nodes[i].AbsPosition  = p1 + tratio * (p2 - p1);
 		nodes[i].smoothpos    = nodes[i].AbsPosition;
 		nodes[i].RelPosition  = nodes[i].AbsPosition - origin;
 
@@ -634,7 +697,7 @@ void Beam::calcNetwork()
 	// take care of the wheels
 	for (int i=0; i<free_wheel; i++)
 	{
-		float rp=wheels[i].rp1+tratio*(wheels[i].rp2-wheels[i].rp1);
+		float rp=delta_state ? netSample->wheel_rp[i] : wheels[i].rp1+tratio*(wheels[i].rp2-wheels[i].rp1);
 		//compute ideal positions
 		Vector3 axis=wheels[i].refnode1->RelPosition-wheels[i].refnode0->RelPosition;
 		axis.normalise();
@@ -657,17 +720,17 @@ void Beam::calcNetwork()
 		}
 	}
 	//give some slack to the mutex
-	float engspeed  = oob1->engine_speed+tratio*(oob2->engine_speed-oob1->engine_speed);
-	float engforce  = oob1->engine_force+tratio*(oob2->engine_force-oob1->engine_force);
-	float engclutch = oob1->engine_clutch+tratio*(oob2->engine_clutch-oob1->engine_clutch);
-	float netwspeed = oob1->wheelspeed+tratio*(oob2->wheelspeed-oob1->wheelspeed);
-	float netbrake  = oob1->brake+tratio*(oob2->brake-oob1->brake);
+	float engspeed  = noob1->engine_speed+tratio*(noob2->engine_speed-noob1->engine_speed);
+	float engforce  = noob1->engine_force+tratio*(noob2->engine_force-noob1->engine_force);
+	float engclutch = noob1->engine_clutch+tratio*(noob2->engine_clutch-noob1->engine_clutch);
+	float netwspeed = noob1->wheelspeed+tratio*(noob2->wheelspeed-noob1->wheelspeed);
+	float netbrake  = noob1->brake+tratio*(noob2->brake-noob1->brake);
 
-	hydrodirwheeldisplay = oob1->hydrodirstate;
+	hydrodirwheeldisplay = noob1->hydrodirstate;
 	WheelSpeed           = netwspeed;
 
-	int gear = oob1->engine_gear;
-	unsigned int flagmask = oob1->flagmask;
+	int gear = noob1->engine_gear;
+	unsigned int flagmask = noob1->flagmask;
 
 	MUTEX_UNLOCK(&net_mutex);
 #ifdef USE_OPENAL
@@ -1197,8 +1260,6 @@ void Beam::resetPosition(Vector3 translation, bool setInitPosition)
 		minCameraRadius *= 1.2f; // ten percent buffer
 	}
 
-	//if (netLabelNode) netLabelNode->setPosition(nodes[0].Position);
-
 	resetSlideNodePositions();
 }
 
@@ -1714,9 +1775,58 @@ void Beam::sendStreamSetup()
 			strncpy(reg.truckconfig[i], m_truck_config[i].c_str(), 60);
 	}
 
+	// older clients can't read the delta format and mark the truck invalid
+	if (!netEncoder && BSETTING("Net Delta Compression", false))
+	{
+		netEncoder = new VehicleStateEncoder(first_wheel_node, free_wheel);
+	}
+
 	NetworkStreamManager::getSingleton().addLocalStream(this, (stream_register_t *)&reg, sizeof(reg));
 }
 
+int Beam::getNetSendInterval()
+{
+	float distance = FLT_MAX;
+	if (CharacterFactory::getSingletonPtr())
+	{
+		distance = CharacterFactory::getSingleton().getRemoteDistance(position);
+	}
+
+	Beam **trucks = BeamFactory::getSingleton().getTrucks();
+	int num_trucks = BeamFactory::getSingleton().getTruckCount();
+	for (int t = 0; t < num_trucks; t++)
+	{
+		if (trucks[t] && trucks[t]->state == NETWORKED)
+		{
+			distance = std::min(distance, trucks[t]->position.distance(position));
+		}
+	}
+
+	if (distance < 150.0f) return 100;
+	if (distance < 500.0f) return 200;
+	return 400;
+}
+
+void Beam::getNetBaseFrame(Vector3 &pos, Quaternion &rot)
+{
+	pos = nodes[0].AbsPosition;
+	rot = Quaternion::IDENTITY;
+
+	if (cameranodepos[0] < 0 || cameranodepos[0] >= MAX_NODES || cameranodedir[0] < 0 || cameranodedir[0] >= MAX_NODES || cameranoderoll[0] < 0 || cameranoderoll[0] >= MAX_NODES)
+		return;
+
+	Vector3 zaxis = nodes[cameranodepos[0]].RelPosition - nodes[cameranodedir[0]].RelPosition;
+	Vector3 xaxis = nodes[cameranodepos[0]].RelPosition - nodes[cameranoderoll[0]].RelPosition;
+	zaxis.normalise();
+	xaxis.normalise();
+	Vector3 yaxis = zaxis.crossProduct(xaxis);
+	if (yaxis.normalise() < 0.1f)
+		return; // camera nodes in a line, or collapsed
+	xaxis = yaxis.crossProduct(zaxis);
+
+	rot = Quaternion(xaxis, yaxis, zaxis);
+}
+
 void Beam::sendStreamData()
 {
 	BES_GFX_START(BES_GFX_sendStreamData);
@@ -1725,8 +1835,6 @@ void Beam::sendStreamData()
 	if (t-last_net_time < 100)
 		return;
 
-	last_net_time = t;
-
 	//look if the packet is too big first
 	int final_packet_size = sizeof(oob_t) + sizeof(float) * 3 + first_wheel_node * sizeof(float) * 3 + free_wheel * sizeof(float);
 	if (final_packet_size > (int)maxPacketLen)
@@ -1799,10 +1907,47 @@ void Beam::sendStreamData()
 		if (SoundScriptManager::getSingleton().getTrigState(trucknum, SS_TRIG_HORN))
 			send_oob->flagmask += NETMASK_HORN;
 #endif //OPENAL
+
+		// with the delta format, send less often when nobody is near; changes of lights, blinkers etc. still go out right away
+		if (netEncoder)
+		{
+			if (t-last_net_time < getNetSendInterval() && send_oob->flagmask == last_net_flagmask)
+				return;
+			last_net_flagmask = send_oob->flagmask;
+		}
 	}
 
+	last_net_time = t;
+
+	bool delta_state = false;
+	if (netEncoder)
+	{
+		std::vector<Vector3> positions(first_wheel_node);
+		for (int i = 0; i < first_wheel_node; i++)
+		{
+			positions[i] = nodes[i].AbsPosition;
+		}
+		std::vector<float> wheel_rp(free_wheel + 1);
+		for (int i = 0; i < free_wheel; i++)
+		{
+			wheel_rp[i] = wheels[i].rp;
+		}
+
+		Vector3 base_pos;
+		Quaternion base_rot;
+		getNetBaseFrame(base_pos, base_rot);
+
+		oob_t oob = *(oob_t *)send_buffer;
+		unsigned int delta_len = netEncoder->encode(oob, &positions[0], &wheel_rp[0], base_pos, base_rot, send_buffer, maxPacketLen);
+		if (delta_len > 0)
+		{
+			packet_len = delta_len;
+			delta_state = true;
+		}
+	}
 
 	// then process the contents
+	if (!delta_state)
 	{
 		char *ptr = send_buffer + sizeof(oob_t);
 		float *send_nodes = (float *)ptr;
@@ -3044,17 +3189,13 @@ void Beam::updateSkidmarks()
 		// create skidmark object for wheels with data if not existing
 		if (!skidtrails[i])
 		{
-			skidtrails[i] = new Skidmark(&wheels[i], beamsRoot, 300, 200);
+			skidtrails[i] = new Skidmark(&wheels[i]);
 		}
 
 		skidtrails[i]->updatePoint();
 	}
 
-	//LOG("updating skidmark visuals");
-	for (int i=0; i<free_wheel; i++)
-	{
-		if (skidtrails[i]) skidtrails[i]->update();
-	}
+	// the geometry of all trucks is uploaded by SkidmarkManager::update()
 
 	BES_STOP(BES_CORE_Skidmarks);
 }
@@ -3137,8 +3278,6 @@ void Beam::prepareInside(bool inside)
 		}
 		if (cabNode)
 		{
-			char transmatname[256];
-			sprintf(transmatname, "%s-trans", texname);
 			MaterialPtr transmat=(MaterialPtr)(MaterialManager::getSingleton().getByName(transmatname));
 			transmat->setReceiveShadows(false);
 		}
@@ -3182,8 +3321,6 @@ void Beam::prepareInside(bool inside)
 
 		if (cabNode)
 		{
-			char transmatname[256];
-			sprintf(transmatname, "%s-trans", texname);
 			MaterialPtr transmat=(MaterialPtr)(MaterialManager::getSingleton().getByName(transmatname));
 			transmat->setReceiveShadows(true);
 		}
@@ -3282,6 +3419,25 @@ void Beam::lightsToggle()
 }
 
 void Beam::updateFlares(float dt, bool isCurrent)
+{
+	updateFlaresCompute();
+	updateFlaresFinal(dt, isCurrent);
+}
+
+void Beam::updateFlaresCompute()
+{
+	if (flaresMode==0)
+		return;
+	for (int i=0; i<free_flare; i++)
+	{
+		Vector3 normal=(nodes[flares[i].nodey].smoothpos-nodes[flares[i].noderef].smoothpos).crossProduct(nodes[flares[i].nodex].smoothpos-nodes[flares[i].noderef].smoothpos);
+		normal.normalise();
+		flares[i].vis_normal=normal;
+		flares[i].vis_position=nodes[flares[i].noderef].smoothpos+flares[i].offsetx*(nodes[flares[i].nodex].smoothpos-nodes[flares[i].noderef].smoothpos)+flares[i].offsety*(nodes[flares[i].nodey].smoothpos-nodes[flares[i].noderef].smoothpos);
+	}
+}
+
+void Beam::updateFlaresFinal(float dt, bool isCurrent)
 {
 	bool enableAll = true;
 	if (flaresMode==0)
@@ -3502,9 +3658,8 @@ void Beam::updateFlares(float dt, bool isCurrent)
 			flares[i].light->setVisible(isvisible && enableAll);
 		flares[i].isVisible=isvisible;
 
-		Vector3 normal=(nodes[flares[i].nodey].smoothpos-nodes[flares[i].noderef].smoothpos).crossProduct(nodes[flares[i].nodex].smoothpos-nodes[flares[i].noderef].smoothpos);
-		normal.normalise();
-		Vector3 mposition=nodes[flares[i].noderef].smoothpos+flares[i].offsetx*(nodes[flares[i].nodex].smoothpos-nodes[flares[i].noderef].smoothpos)+flares[i].offsety*(nodes[flares[i].nodey].smoothpos-nodes[flares[i].noderef].smoothpos);
+		Vector3 normal=flares[i].vis_normal;
+		Vector3 mposition=flares[i].vis_position;
 		Vector3 vdir=mposition-mCamera->getPosition();
 		float vlen=vdir.length();
 		// not visible from 500m distance
@@ -3600,30 +3755,50 @@ void Beam::autoBlinkReset()
 
 void Beam::updateProps()
 {
-	BES_GFX_START(BES_GFX_updateProps);
-	int i;
-	//the props
-	for (i=0; i<free_prop; i++)
+	updatePropsCompute();
+	updatePropsFinal();
+}
+
+void Beam::updatePropsCompute()
+{
+	for (int i=0; i<free_prop; i++)
 	{
 		if (!props[i].snode) continue;
 		Vector3 normal=(nodes[props[i].nodey].smoothpos-nodes[props[i].noderef].smoothpos).crossProduct(nodes[props[i].nodex].smoothpos-nodes[props[i].noderef].smoothpos);
 		normal.normalise();
 		//position
 		Vector3 mposition=nodes[props[i].noderef].smoothpos+props[i].offsetx*(nodes[props[i].nodex].smoothpos-nodes[props[i].noderef].smoothpos)+props[i].offsety*(nodes[props[i].nodey].smoothpos-nodes[props[i].noderef].smoothpos);
-		props[i].snode->setPosition(mposition+normal*props[i].offsetz);
+		props[i].vis_position = mposition+normal*props[i].offsetz;
 		//orientation
 		Vector3 refx=nodes[props[i].nodex].smoothpos-nodes[props[i].noderef].smoothpos;
 		refx.normalise();
 		Vector3 refy=refx.crossProduct(normal);
-		Quaternion orientation=Quaternion(refx, normal, refy)*props[i].rot;
-		props[i].snode->setOrientation(orientation);
+		props[i].vis_orientation=Quaternion(refx, normal, refy)*props[i].rot;
 		if (props[i].wheel)
 		{
 			//display wheel
 			Quaternion brot=Quaternion(Degree(-59.0), Vector3::UNIT_X);
 			brot=brot*Quaternion(Degree(hydrodirwheeldisplay*props[i].wheelrotdegree), Vector3::UNIT_Y);
-			props[i].wheel->setPosition(mposition+normal*props[i].offsetz+orientation*props[i].wheelpos);
-			props[i].wheel->setOrientation(orientation*brot);
+			props[i].vis_wheelpos=props[i].vis_position+props[i].vis_orientation*props[i].wheelpos;
+			props[i].vis_wheelrot=props[i].vis_orientation*brot;
+		}
+	}
+}
+
+void Beam::updatePropsFinal()
+{
+	BES_GFX_START(BES_GFX_updateProps);
+	int i;
+	//the props
+	for (i=0; i<free_prop; i++)
+	{
+		if (!props[i].snode) continue;
+		props[i].snode->setPosition(props[i].vis_position);
+		props[i].snode->setOrientation(props[i].vis_orientation);
+		if (props[i].wheel)
+		{
+			props[i].wheel->setPosition(props[i].vis_wheelpos);
+			props[i].wheel->setOrientation(props[i].vis_wheelrot);
 		}
 	}
 	//we also consider airbrakes as props
@@ -3654,7 +3829,7 @@ void Beam::updateSoundSources()
 	if (SoundScriptManager::getSingleton().isDisabled()) return;
 	for (int i=0; i<free_soundsource; i++)
 	{
-		soundsources[i].ssi->setPosition(nodes[soundsources[i].nodenum].AbsPosition, nodes[soundsources[i].nodenum].Velocity);
+		SoundScriptManager::getSingleton().setPosition(soundsources[i].ssi, nodes[soundsources[i].nodenum].AbsPosition, nodes[soundsources[i].nodenum].Velocity);
 	}
 	//also this, so it is updated always, and for any vehicle
 	SoundScriptManager::getSingleton().modulate(trucknum, SS_MOD_AIRSPEED, nodes[0].Velocity.length()*1.9438);
@@ -3665,28 +3840,26 @@ void Beam::updateSoundSources()
 
 void Beam::updateLabels(float dt)
 {
-	if (netLabelNode && netMT && netMT->isVisible())
+	if (netLabel && netLabel->isVisible())
 	{
 		// this ensures that the nickname is always in a readable size
-		netLabelNode->setPosition(position + Vector3(0.0f, (boundingBox.getMaximum().y - boundingBox.getMinimum().y), 0.0f));
+		netLabel->setPosition(position + Vector3(0.0f, (boundingBox.getMaximum().y - boundingBox.getMinimum().y), 0.0f));
 		Vector3 vdir = position - mCamera->getPosition();
 		float vlen = vdir.length();
 		float h = std::max(0.6, vlen / 30.0);
 
-		netMT->setCharacterHeight(h);
+		// the label only rebuilds its glyphs if the height or the caption really changed
+		netLabel->setCharacterHeight(h);
 		if (vlen > 1000) // 1000 ... vlen
-			netMT->setCaption(networkUsername + "  (" + TOSTRING((float)(ceil(vlen / 100) / 10.0) ) + " km)");
+			netLabel->setCaption(networkUsername + "  (" + TOSTRING((float)(ceil(vlen / 100) / 10.0) ) + " km)");
 		else if (vlen > 20) // 20 ... vlen ... 1000
-			netMT->setCaption(networkUsername + "  (" + TOSTRING((int)vlen) + " m)");
+			netLabel->setCaption(networkUsername + "  (" + TOSTRING((int)vlen) + " m)");
 		else // 0 ... vlen ... 20
-			netMT->setCaption(networkUsername);
-
-		//netMT->setAdditionalHeight((boundingBox.getMaximum().y - boundingBox.getMinimum().y) + h + 0.1);
-		netMT->setVisible(true);
+			netLabel->setCaption(networkUsername);
 	}
 }
 
-void Beam::updateVisualPrepare(float dt)
+void Beam::updateVisualPrepare(float dt, std::list<IThreadTask*> &tasks)
 {
 	BES_GFX_START(BES_GFX_updateVisual);
 
@@ -3695,13 +3868,12 @@ void Beam::updateVisualPrepare(float dt)
 	//sounds too
 	updateSoundSources();
 
+	flexmesh_prepare.reset();
+	flexbody_prepare.reset();
+
 	if (deleting) return;
 	if (debugVisuals) updateDebugOverlay();
 
-	//dust
-	// UH - design problem, it updates every truck dust D:
-	DustManager::getSingleton().update(WheelSpeed);
-
 #ifdef USE_OPENAL
 	//airplane radio chatter
 	if (driveable == AIRPLANE && state != SLEEPING)
@@ -3755,8 +3927,6 @@ void Beam::updateVisualPrepare(float dt)
 		}
 	}
 
-	updateProps();
-
 	for (int i=0; i<free_aeroengine; i++) aeroengines[i]->updateVisuals();
 
 	//wings
@@ -3854,23 +4024,17 @@ void Beam::updateVisualPrepare(float dt)
 
 	if (gEnv->threadPool)
 	{
-		flexmesh_prepare.reset();
 		for (int i=0; i<free_wheel; i++)
 		{
 			flexmesh_prepare.set(i, vwheels[i].cnode && vwheels[i].fm->flexitPrepare(this));
 		}
 
-		flexbody_prepare.reset();
 		for (int i=0; i<free_flexbody; i++)
 		{
 			flexbody_prepare.set(i, flexbodies[i]->flexitPrepare(this));
 		}
 
-		flexable_task_count = flexmesh_prepare.count() + flexbody_prepare.count();
-
-		std::list<IThreadTask*> tasks;
-
-		// Push tasks into thread pool
+		// Hand tasks over to the caller, which submits them together with those of the other trucks
 		for (int i=0; i<free_wheel; i++)
 		{
 			if (flexmesh_prepare[i])
@@ -3881,10 +4045,12 @@ void Beam::updateVisualPrepare(float dt)
 			if (flexbody_prepare[i])
 				tasks.emplace_back(flexbodies[i]);
 		}
-
-		gEnv->threadPool->enqueue(tasks);
+		tasks.emplace_back(&visual_task);
 	} else
 	{
+		updatePropsCompute();
+		updateFlaresCompute();
+
 		for (int i=0; i<free_wheel; i++)
 		{
 			if (vwheels[i].cnode && vwheels[i].fm->flexitPrepare(this))
@@ -3909,16 +4075,13 @@ void Beam::updateVisualPrepare(float dt)
 
 void Beam::updateVisualFinal(float dt)
 {
+	BES_GFX_START(BES_GFX_updateVisual);
+
+	updatePropsFinal();
+
+	BES_GFX_START(BES_GFX_updateFlexBodies);
 	if (gEnv->threadPool)
 	{
-		// Wait for all tasks to complete
-		MUTEX_LOCK(&flexable_task_count_mutex);
-		while (flexable_task_count > 0)
-		{
-			pthread_cond_wait(&flexable_task_count_cv, &flexable_task_count_mutex);
-		}
-		MUTEX_UNLOCK(&flexable_task_count_mutex);
-
 		for (int i=0; i<free_wheel; i++)
 		{
 			if (flexmesh_prepare[i])
@@ -3938,10 +4101,27 @@ void Beam::updateVisualFinal(float dt)
 
 void Beam::updateVisual(float dt)
 {
-	updateVisualPrepare(dt);
+	std::list<IThreadTask*> tasks;
+
+	updateVisualPrepare(dt, tasks);
+
+	BeamFactory::getSingleton()._VisualTasksStart(tasks);
+	BeamFactory::getSingleton()._VisualTasksWaitForCompletion();
+
 	updateVisualFinal(dt);
 }
 
+void Beam::VisualTask::run()
+{
+	truck->updatePropsCompute();
+	truck->updateFlaresCompute();
+}
+
+void Beam::VisualTask::onComplete()
+{
+	BeamFactory::getSingleton()._VisualTaskCompleted();
+}
+
 //v=0: full detail
 //v=1: no beams
 void Beam::setDetailLevel(int v)
@@ -3965,18 +4145,17 @@ void Beam::setDetailLevel(int v)
 void Beam::preMapLabelRenderUpdate(bool mode, float charheight)
 {
 	static float orgcharheight=0;
-	if (mode && netLabelNode)
+	if (mode && netLabel)
 	{
-		netMT->showOnTop(true);
-		orgcharheight = netMT->getCharacterHeight();
-		netMT->setCharacterHeight(charheight);
-		//netMT->setAdditionalHeight(0);
-		netMT->setVisible(false);
-	} else if (!mode && netLabelNode)
+		netLabel->showOnTop(true);
+		orgcharheight = netLabel->getCharacterHeight();
+		netLabel->setCharacterHeight(charheight);
+		netLabel->setVisible(false);
+	} else if (!mode && netLabel)
 	{
-		netMT->showOnTop(false);
-		netMT->setCharacterHeight(orgcharheight);
-		netMT->setVisible(true);
+		netLabel->showOnTop(false);
+		netLabel->setCharacterHeight(orgcharheight);
+		netLabel->setVisible(true);
 	}
 }
 
@@ -5055,55 +5234,19 @@ void Beam::updateNetworkInfo()
 		networkAuthlevel = info->authstatus;
 	}
 
-	if (netLabelNode && netMT)
+	if (netLabel)
 	{
-		// ha, this caused the empty caption bug, but fixed now since we change the caption if its empty:
-		netMT->setCaption(networkUsername);
-		/*
-		if (networkAuthlevel & AUTH_ADMIN)
-		{
-			netMT->setFontName("highcontrast_red");
-		} else if (networkAuthlevel & AUTH_RANKED)
-		{
-			netMT->setFontName("highcontrast_green");
-		} else
-		{
-			netMT->setFontName("highcontrast_black");
-		}
-		*/
-		netLabelNode->setVisible(true);
+		netLabel->setCaption(networkUsername);
+		netLabel->setVisible(true);
 	}
 	else
 	{
-		char wname[256];
-		sprintf(wname, "netlabel-%s", truckname);
-		netMT = new MovableText(wname, networkUsername);
-		netMT->setFontName("CyberbitEnglish");
-		netMT->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-		//netMT->setAdditionalHeight(2);
-		netMT->showOnTop(false);
-		netMT->setCharacterHeight(2);
-		netMT->setColor(ColourValue::Black);
-
-		/*
-		if (networkAuthlevel & AUTH_ADMIN)
-		{
-			netMT->setFontName("highcontrast_red");
-		} else if (networkAuthlevel & AUTH_RANKED)
-		{
-			netMT->setFontName("highcontrast_green");
-		} else
-		{
-			netMT->setFontName("highcontrast_black");
-		}
-		*/
-
-		netLabelNode=gEnv->sceneManager->getRootSceneNode()->createChildSceneNode();
-		netLabelNode->attachObject(netMT);
-		netLabelNode->setPosition(position);
-		netLabelNode->setVisible(true);
-		deletion_sceneNodes.emplace_back(netLabelNode);
-		deletion_Objects.emplace_back(netMT);
+		// drawn together with all other labels by the LabelBatcher
+		netLabel = LabelBatcher::getSingleton().createLabel(networkUsername, "CyberbitEnglish");
+		netLabel->setTextAlignment(BatchedLabel::H_CENTER, BatchedLabel::V_ABOVE);
+		netLabel->setCharacterHeight(2);
+		netLabel->setColor(ColourValue::Black);
+		netLabel->setPosition(position);
 	}
 #endif //SOCKETW
 	BES_GFX_STOP(BES_GFX_updateNetworkInfo);
@@ -5114,9 +5257,8 @@ void Beam::deleteNetTruck()
 	// TODO: properly delete things ...
 	//park and recycle vehicle
 	state = RECYCLE;
-	netMT->setVisible(false);
+	if (netLabel) netLabel->setVisible(false);
 	resetPosition(100000, 100000, false, 100000);
-	netLabelNode->setVisible(false);
 	updateVisual();
 }
 
@@ -5149,7 +5291,7 @@ void Beam::changedCamera()
 	for (int i=0; i < free_soundsource; i++)
 	{
 		bool enabled = (soundsources[i].type == -2 || soundsources[i].type == currentcamera);
-		soundsources[i].ssi->setEnabled(enabled);
+		SoundScriptManager::getSingleton().setEnabled(soundsources[i].ssi, enabled);
 	}
 #endif // USE_OPENAL
 
@@ -5883,6 +6025,9 @@ void Beam::run()
 		case THREAD_NODES:
 			calcNodes(curtstep==0, dtperstep, curtstep, tsteps, index, thread_number);
 			break;
+		case THREAD_BUOYANCE:
+			calcBuoyance(curtstep==0, dtperstep, curtstep, tsteps, index, thread_number);
+			break;
 		}
 	}
 }
@@ -5911,46 +6056,6 @@ void Beam::onComplete()
 }
 
 
-void LogParserMessages(RigDef::Parser & parser)
-{
-	if (parser.GetMessages().size() == 0)
-	{
-		LOG(" == Parsing done OK");
-		return;
-	}
-
-	std::stringstream report;
-	report << " == Parsing done, report:" << std::endl <<std::endl;
-
-	std::list<RigDef::Parser::Message>::const_iterator iter = parser.GetMessages().begin();
-	for (; iter != parser.GetMessages().end(); iter++)
-	{
-		switch (iter->type)
-		{
-			case (RigDef::Parser::Message::TYPE_FATAL_ERROR): 
-				report << "FATAL_ERROR"; 
-				break;
-
-			case (RigDef::Parser::Message::TYPE_ERROR): 
-				report << "ERROR"; 
-				break;
-
-			case (RigDef::Parser::Message::TYPE_WARNING): 
-				report << "WARNING"; 
-				break;
-
-			default:
-				report << "INFO"; 
-				break;
-		}
-		report << " (Section " << RigDef::File::SectionToString(iter->section) << ")" << std::endl;
-		report << "\tLine (# " << iter->line_number << "): " << iter->line << std::endl;
-		report << "\tMessage: " << iter->message << std::endl;
-	}
-
-	Ogre::LogManager::getSingleton().logMessage(report.str());
-}
-
 void LogSpawnerMessages(RigSpawner & spawner)
 {
 	std::stringstream report;
@@ -5983,41 +6088,6 @@ void LogSpawnerMessages(RigSpawner & spawner)
 	Ogre::LogManager::getSingleton().logMessage(report.str());
 }
 
-void LogValidatorMessages(RigDef::Validator & validator)
-{
-	if (validator.GetMessages().empty())
-	{
-		Ogre::LogManager::getSingleton().logMessage(" == Validating done OK");
-		return;
-	}
-
-	std::stringstream report;
-	report << " == Validating done, report:" <<std::endl << std::endl;
-
-	std::list<RigDef::Validator::Message>::iterator itor = validator.GetMessages().begin();
-	for( ; itor != validator.GetMessages().end(); itor++)
-	{
-		switch (itor->type)
-		{
-			case (RigDef::Validator::Message::TYPE_FATAL_ERROR):
-				report << "FATAL ERROR";
-				break;
-			case (RigDef::Validator::Message::TYPE_ERROR):
-				report << "ERROR";
-				break;
-			case (RigDef::Validator::Message::TYPE_WARNING):
-				report << "WARNING";
-				break;
-			default:
-				report << "INFO";
-		}
-
-		report << ": " << itor->text << std::endl;
-	}
-
-	Ogre::LogManager::getSingleton().logMessage(report.str());
-}
-
 Beam::Beam(
 	int truck_number, 
 	Ogre::Vector3 pos, 
@@ -6075,6 +6145,7 @@ Beam::Beam(
 	, interPointCD()
 	, intraPointCD()
 	, isInside(false)
+	, last_net_flagmask(0)
 	, last_net_time(0)
 	, lastlastposition(pos)
 	, lastposition(pos)
@@ -6090,9 +6161,12 @@ Beam::Beam(
 	, mousenode(-1)
 	, mousepos(Ogre::Vector3::ZERO)
 	, netBrakeLight(false)
-	, netLabelNode(0)
-	, netMT(0)
+	, netDecoder(0)
+	, netEncoder(0)
+	, netLabel(0)
 	, netReverseLight(false)
+	, netSample(0)
+	, netSnapshots(0)
 	, networkAuthlevel(0)
 	, networkUsername("")
 	, oldreplaypos(-1)
@@ -6136,8 +6210,7 @@ Beam::Beam(
 
 	/* class <Beam> mutexes */
 
-	pthread_cond_init(&flexable_task_count_cv, NULL);
-	pthread_mutex_init(&flexable_task_count_mutex, NULL);
+	visual_task.truck = this;
 	for (int task=0; task < THREAD_MAX; task++)
 	{
 		task_count[task] = 0;
@@ -6196,7 +6269,7 @@ Beam::Beam(
 	// setup replay mode
 	bool enablereplay = BSETTING("Replay mode", false);
 
-	if (enablereplay && !networked && !networking)
+	if (enablereplay && !networked)
 	{
 		replaylen = ISETTING("Replay length", 10000);
 		replay = new Replay(this, replaylen);
@@ -6265,6 +6338,9 @@ Beam::Beam(
 		nettimer = new Ogre::Timer();
 		net_toffset = 0;
 		netcounter = 0;
+		netDecoder = new VehicleStateDecoder(first_wheel_node, free_wheel);
+		netSnapshots = new VehicleSnapshotBuffer();
+		netSample = new VehicleSnapshot();
 		// init mutex
 		pthread_mutex_init(&net_mutex, NULL);
 		if (engine)
@@ -6306,92 +6382,55 @@ bool Beam::LoadTruck(
 		Ogre::ResourceBackgroundQueue::getSingleton().initialiseResourceGroup("customInclude");
 	}
 
-	Ogre::DataStreamPtr ds = Ogre::DataStreamPtr();
-	Ogre::String fixed_file_name = file_name;
-	Ogre::String found_resource_group;
-	Ogre::String errorStr;
+	/* LOADING (cache or parser + validator) */
 
-	try
-	{
-		RoR::Application::GetCacheSystem()->checkResourceLoaded(fixed_file_name, found_resource_group); /* Fixes the filename and finds resource group */
+	bool check_beams = RigDefLoader::ShouldCheckBeams(file_name, preloaded_with_terrain);
 
-		// error on ds open lower
-		// open the stream and start reading :)
-		ds = Ogre::ResourceGroupManager::getSingleton().openResource(fixed_file_name, found_resource_group);
-	} catch(Ogre::Exception& e)
+	// Use the definition loaded in background by BeamFactory::prefetchRigDef(), if any
+	RigDefLoader *loader = BeamFactory::getSingleton().takePrefetchedRigDef(file_name, check_beams);
+	if (loader != nullptr)
 	{
-		errorStr = Ogre::String(e.what());
-		return false;
+		loader->WaitForCompletion();
 	}
-
-	//this->cacheEntryInfo = RoR::Application::GetCacheSystem()->getResourceInfo(filename);
-	if (ds.isNull() || !ds->isReadable())
+	else
 	{
+		loader = new RigDefLoader(file_name, check_beams);
+		if (! loader->ReadFile())
+		{
 #ifdef USE_MYGUI
-		Console *console = RoR::Application::GetConsole();
-		if (console != nullptr) 
-		{
-			console->putMessage(
-				Console::CONSOLE_MSGTYPE_INFO, 
-				Console::CONSOLE_SYSTEM_ERROR, 
-				"unable to load vehicle (unable to open file): " + fixed_file_name + " : " + errorStr, 
-				"error.png", 
-				30000, 
-				true
-			);
-		}
+			Console *console = RoR::Application::GetConsole();
+			if (console != nullptr) 
+			{
+				console->putMessage(
+					Console::CONSOLE_MSGTYPE_INFO, 
+					Console::CONSOLE_SYSTEM_ERROR, 
+					"unable to load vehicle (unable to open file): " + file_name + " : " + loader->GetError(), 
+					"error.png", 
+					30000, 
+					true
+				);
+			}
 #endif // USE_MYGUI
-		return false;
-	}
-
-	/* PARSING */
-
-	LOG(" == Parsing vehicle file: " + file_name);
-
-	RigDef::Parser parser;
-	parser.Prepare();
-	while(! ds->eof())
-	{
-		parser.ParseLine(ds->getLine());
-	}
-	parser.Finalize();
-
-	LogParserMessages(parser);
-
-	/* VALIDATING */
-
-	LOG(" == Validating vehicle: " + parser.GetFile()->name);
-
-	RigDef::Validator validator;
-	validator.Setup(parser.GetFile());
-
-	// Workaround: Some terrains pre-load truckfiles with special purpose:
-	//     "soundloads" = play sound effect at certain spot
-	//     "fixes"      = structures of N/B fixed to the ground
-	// These files can have no beams. Possible extensions: .load or .fixed
-	// .load observed in: "Northern-Isles" [http://www.rigsofrods.com/repository/view/5315]
-	Ogre::String file_extension = file_name.substr(file_name.find_last_of('.'));
-	Ogre::StringUtil::toLowerCase(file_extension);
-	bool extension_matches = (file_extension == ".load") | (file_extension == ".fixed");
-	if (preloaded_with_terrain && extension_matches)
-	{
-		validator.SetCheckBeams(false);
+			delete loader;
+			return false;
+		}
+		loader->Load();
 	}
-	bool valid = validator.Validate();
 
-	LogValidatorMessages(validator);
-	// Continue anyway...
+	loader->LogMessages();
+	boost::shared_ptr<RigDef::File> rig_def = loader->GetFile();
+	delete loader;
 
 	/* PROCESSING */
 
-	LOG(" == Spawning vehicle: " + parser.GetFile()->name);
+	LOG(" == Spawning vehicle: " + rig_def->name);
 
 	RigSpawner spawner;
-	spawner.Setup(this, parser.GetFile(), parent_scene_node, spawn_position, spawn_rotation);
+	spawner.Setup(this, rig_def, parent_scene_node, spawn_position, spawn_rotation);
 
 	/* Setup modules */
-	spawner.AddModule(parser.GetFile()->root_module);
-	if (parser.GetFile()->modules.size() > 0) /* The vehicle-selector may return selected modules even for vehicle with no modules defined! Hence this check. */
+	spawner.AddModule(rig_def->root_module);
+	if (rig_def->modules.size() > 0) /* The vehicle-selector may return selected modules even for vehicle with no modules defined! Hence this check. */
 	{
 		std::vector<Ogre::String>::iterator itor = m_truck_config.begin();
 		for( ; itor != m_truck_config.end(); itor++ )
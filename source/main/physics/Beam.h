@@ -219,15 +219,39 @@ public:
 	
 	/**
 	* Display.
+	* @see updateFlaresCompute
+	* @see updateFlaresFinal
 	*/
 	void updateFlares(float dt, bool isCurrent=false);
 
+	/**
+	* TIGHT-LOOP; Threading; calculates flare positions and normals. Does not touch the scene, may run on a worker thread.
+	*/
+	void updateFlaresCompute();
+
+	/**
+	* TIGHT-LOOP; Display; updates flare/beacon states and scene nodes from the results of updateFlaresCompute().
+	*/
+	void updateFlaresFinal(float dt, bool isCurrent=false);
+
 	/**
 	* TIGHT-LOOP; Display; updates positions of props.
 	* Each prop has scene node parented to root-node (only_a_ptr 11/2013).
+	* @see updatePropsCompute
+	* @see updatePropsFinal
 	*/
 	void updateProps();
 
+	/**
+	* TIGHT-LOOP; Threading; calculates prop positions and orientations. Does not touch the scene, may run on a worker thread.
+	*/
+	void updatePropsCompute();
+
+	/**
+	* TIGHT-LOOP; Display; applies the results of updatePropsCompute() to the prop scene nodes.
+	*/
+	void updatePropsFinal();
+
 	/**
 	* TIGHT-LOOP; Logic: display, sound, particles
 	* @see updateVisualPrepare
@@ -240,12 +264,15 @@ public:
 	* Does a mixture of tasks:
 	* - Sound: updates sound sources; plays aircraft radio chatter; 
 	* - Particles: updates particles (dust, exhausts, custom)
-	* - Display: updates wings; updates props; updates rig-skeleton + cab fade effect; updates flexbodies; updates debug overlay
+	* - Display: updates wings; updates rig-skeleton + cab fade effect; prepares flexbodies; updates debug overlay
+	* @param tasks Receives the flexbody/flexmesh and prop/flare tasks when a thread pool is used; 
+	*        the caller submits them (see BeamFactory::_VisualTasksStart()). Without a thread pool they are computed in place.
 	*/
-	void updateVisualPrepare(float dt=0);
+	void updateVisualPrepare(float dt, std::list<IThreadTask*> &tasks);
 
 	/**
-	* TIGHT-LOOP; Logic: display (+flexbodies), threading
+	* TIGHT-LOOP; Logic: display (+flexbodies +props), threading
+	* Must only be called after the tasks collected by updateVisualPrepare() are done.
 	*/
 	void updateVisualFinal(float dt=0);
 	void updateLabels(float dt=0);
@@ -365,7 +392,6 @@ public:
 	int first_wheel_node;
 	int netbuffersize;
 	int nodebuffersize;
-	Ogre::SceneNode *netLabelNode;
 
 	std::string getTruckName();
 	std::string getTruckFileName();
@@ -480,10 +506,17 @@ public:
 	void run();
 	void onComplete();
 
-	// flexable pthread stuff
-	int flexable_task_count;
-	pthread_cond_t flexable_task_count_cv;
-	pthread_mutex_t flexable_task_count_mutex;
+	/**
+	* Threading; computes the CPU-side visual state (props, flares) of a truck on a worker thread.
+	*/
+	class VisualTask : public IThreadTask
+	{
+	public:
+		Beam* truck;
+
+		void run();
+		void onComplete();
+	};
 
 protected:
 
@@ -493,6 +526,7 @@ protected:
 		THREAD_INTER_TRUCK_COLLISIONS,
 		THREAD_INTRA_TRUCK_COLLISIONS,
 		THREAD_NODES,
+		THREAD_BUOYANCE,
 		THREAD_MAX
 	};
 
@@ -527,6 +561,11 @@ protected:
 	*/
 	void calcNodes(int doUpdate, Ogre::Real dt, int step, int maxsteps, int chunk_index = 0, int chunk_number = 1);
 
+	/**
+	* TIGHT LOOP; Physics; buoyance forces of the buoyant cabs
+	*/
+	void calcBuoyance(int doUpdate, Ogre::Real dt, int step, int maxsteps, int chunk_index = 0, int chunk_number = 1);
+
 	/**
 	* TIGHT LOOP; Physics; 
 	*/
@@ -569,6 +608,8 @@ protected:
 	std::bitset<MAX_WHEELS> flexmesh_prepare;
 	std::bitset<MAX_FLEXBODIES> flexbody_prepare;
 
+	VisualTask visual_task;
+
 	// linked beams (hooks)
 	std::list<Beam*> linkedBeams;
 	void determineLinkedBeams();
@@ -631,7 +672,23 @@ protected:
 	Ogre::Timer *nettimer;
 	int net_toffset;
 	int netcounter;
-	Ogre::MovableText *netMT; //, *netDist;
+	BatchedLabel *netLabel;
+
+	VehicleStateDecoder *netDecoder;     //!< Network; decodes the delta format (network thread only)
+	VehicleSnapshotBuffer *netSnapshots; //!< Network; jitter buffer for the delta format, guarded by net_mutex
+	VehicleSnapshot *netSample;          //!< Network; interpolated state, used by calcNetwork()
+	VehicleStateEncoder *netEncoder;     //!< Network; set when sending the delta format
+	unsigned int last_net_flagmask;
+
+	/**
+	 * @return Milliseconds between stream updates, longer when no other player is near.
+	 */
+	int getNetSendInterval();
+
+	/**
+	 * Base transform for the delta format, from the first camera: position of node 0 and the camera orientation.
+	 */
+	void getNetBaseFrame(Ogre::Vector3 &pos, Ogre::Quaternion &rot);
 
 	// network properties
 	Ogre::String networkUsername;
@@ -625,6 +625,8 @@ struct flare_t
 	bool blinkdelay_state;
 	float size;
 	bool isVisible;
+	Ogre::Vector3 vis_normal;   //!< Calculated by Beam::updateFlaresCompute()
+	Ogre::Vector3 vis_position; //!< Calculated by Beam::updateFlaresCompute()
 };
 
 /**
@@ -678,6 +680,10 @@ struct prop_t
 	Ogre::Real wheelrotdegree;
 	int cameramode; //!< Visibility control {-2 = always, -1 = 3rdPerson only, 0+ = cinecam index}
 	MeshObject *mo;
+	Ogre::Vector3 vis_position;         //!< Calculated by Beam::updatePropsCompute()
+	Ogre::Quaternion vis_orientation;   //!< Calculated by Beam::updatePropsCompute()
+	Ogre::Vector3 vis_wheelpos;         //!< Calculated by Beam::updatePropsCompute()
+	Ogre::Quaternion vis_wheelrot;      //!< Calculated by Beam::updatePropsCompute()
 };
 
 struct exhaust_t
@@ -888,6 +894,7 @@ struct rig_t
 	float truckmass;
 	float loadmass;
 	char texname[1024]; //!< Material name
+	char transmatname[1024]; //!< Material of the transparent cab parts, per vehicle
 	int trucknum;
 	Skin *usedSkin;
 	Buoyance *buoyance;
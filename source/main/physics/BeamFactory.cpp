@@ -28,20 +28,21 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Collisions.h"
 #include "ErrorUtils.h"
 #include "InputEngine.h"
+#include "IWater.h"
 #include "Language.h"
 #include "MainThread.h"
 #include "Network.h"
+#include "PlatformUtils.h"
+#include "RigDefLoader.h"
 #include "RoRFrameListener.h"
 #include "Settings.h"
+#include "Skidmark.h"
 #include "SoundScriptManager.h"
+#include "TerrainManager.h"
 #include "ThreadPool.h"
 #include "ChatSystem.h"
 #include "Console.h"
 
-#ifdef _GNU_SOURCE
-#include <sys/sysinfo.h>
-#endif
-
 #ifdef USE_MYGUI
 #include "GUIMp.h"
 #include "GUIMenu.h"
@@ -60,36 +61,25 @@ template<> BeamFactory *StreamableFactory < BeamFactory, Beam >::_instance = 0;
 int simulatedTruck;
 void* threadstart(void* vid);
 
-static unsigned hardware_concurrency()
-{
-	#if defined(PTW32_VERSION) || defined(__hpux)
-		return pthread_num_processors_np();
-	#elif defined(_GNU_SOURCE)
-		return get_nprocs();
-	#elif defined(__APPLE__) || defined(__FreeBSD__)
-		int count;
-		size_t size = sizeof(count);
-		return sysctlbyname("hw.ncpu", &count, &size, NULL, 0) ? 0 : count;
-	#elif defined(BOOST_HAS_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
-		int const count = sysconf(_SC_NPROCESSORS_ONLN);
-		return (count > 0) ? count : 0;
-	#else
-		return 0;
-	#endif
-} 
-
 BeamFactory::BeamFactory() :
 	  current_truck(-1)
 	, forcedActive(false)
 	, free_truck(0)
-	, num_cpu_cores(hardware_concurrency())
+	, max_remote_spawns_per_frame(std::max(1, ISETTING("Max Vehicle Spawns Per Frame", 1)))
+	, num_cpu_cores(PlatformUtils::GetNumCpuCores())
 	, physFrame(0)
 	, previous_truck(-1)
+	, remote_spawns_this_frame(0)
+	, spawning_rig_def(nullptr)
 	, tdr(0)
 	, thread_done(true)
 	, thread_mode(THREAD_SINGLE)
+	, visual_task_count(0)
 	, work_done(false)
 {
+	pthread_cond_init(&visual_task_count_cv, NULL);
+	pthread_mutex_init(&visual_task_count_mutex, NULL);
+
 	bool disableThreadPool = BSETTING("DisableThreadPool", false);
 	int numThreadsInPool   = ISETTING("NumThreadsInThreadPool", 0);
 
@@ -140,10 +130,19 @@ BeamFactory::BeamFactory() :
 
 BeamFactory::~BeamFactory()
 {
+	dropPrefetchedRigDefs();
+	for (std::map< std::pair<int, int>, RigDefLoader *>::iterator it = remote_rig_defs.begin(); it != remote_rig_defs.end(); ++it)
+	{
+		delete it->second; // waits for the load task
+	}
+	remote_rig_defs.clear();
+
 	pthread_cond_destroy(&thread_done_cv);
 	pthread_cond_destroy(&work_done_cv);
 	pthread_mutex_destroy(&thread_done_mutex);
 	pthread_mutex_destroy(&work_done_mutex);
+	pthread_cond_destroy(&visual_task_count_cv);
+	pthread_mutex_destroy(&visual_task_count_mutex);
 }
 
 bool BeamFactory::removeBeam(Beam *b)
@@ -243,6 +242,9 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 
 	stream_register_trucks_t *treg = (stream_register_trucks_t *)&reg->reg;
 
+	// the definition loaded in background for this stream, see isRemoteInstanceReady()
+	RigDefLoader *loader = takeRemoteRigDef(reg);
+
 	LOG(" new beam truck for " + TOSTRING(reg->sourceid) + ":" + TOSTRING(reg->streamid));
 
 #ifdef USE_SOCKETW
@@ -276,6 +278,7 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 		streamables[reg->sourceid][reg->streamid] = 0;
 		//unlockStreams();
 
+		delete loader;
 		return 0;
 	}
 
@@ -297,9 +300,12 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 	if (truck_num == -1)
 	{
 		LOG("ERROR: could not add beam to main list");
+		delete loader;
 		return 0;
 	}
 
+	// picked up by Beam::LoadTruck() through takePrefetchedRigDef()
+	spawning_rig_def = loader;
 	Beam *b = new Beam(
 		truck_num,
 		pos,
@@ -313,6 +319,10 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 		&truckconfig,
 		0);
 
+	// not taken if the spawn failed early
+	delete spawning_rig_def;
+	spawning_rig_def = nullptr;
+
 	trucks[truck_num] = b;
 
 	b->setSourceID(reg->sourceid);
@@ -333,6 +343,125 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 	return b;
 }
 
+/**
+* @return Loader running on the thread pool, or nullptr without thread pool or if the file can't be read.
+*/
+static RigDefLoader *startRigDefLoader(Ogre::String const & file_name, bool check_beams)
+{
+	if (!gEnv->threadPool)
+	{
+		return nullptr;
+	}
+
+	RigDefLoader *loader = new RigDefLoader(file_name, check_beams);
+	if (!loader->ReadFile())
+	{
+		// Beam::LoadTruck() will try again and report the error
+		delete loader;
+		return nullptr;
+	}
+	loader->StartLoadTask(gEnv->threadPool);
+	return loader;
+}
+
+void BeamFactory::prefetchRigDef(Ogre::String const & file_name, bool preloaded_with_terrain /* = false */)
+{
+	RigDefLoader *loader = startRigDefLoader(file_name, RigDefLoader::ShouldCheckBeams(file_name, preloaded_with_terrain));
+	if (loader != nullptr)
+	{
+		prefetched_rig_defs.insert(std::make_pair(file_name, loader));
+	}
+}
+
+void BeamFactory::dropPrefetchedRigDefs()
+{
+	for (std::multimap<Ogre::String, RigDefLoader *>::iterator it = prefetched_rig_defs.begin(); it != prefetched_rig_defs.end(); ++it)
+	{
+		delete it->second; // waits for the load task
+	}
+	prefetched_rig_defs.clear();
+}
+
+RigDefLoader *BeamFactory::takePrefetchedRigDef(Ogre::String const & file_name, bool check_beams)
+{
+	// the definition of the remote vehicle being spawned by createRemoteInstance()
+	if (spawning_rig_def != nullptr && spawning_rig_def->GetFileName() == file_name && spawning_rig_def->GetCheckBeams() == check_beams)
+	{
+		RigDefLoader *loader = spawning_rig_def;
+		spawning_rig_def = nullptr;
+		return loader;
+	}
+
+	std::multimap<Ogre::String, RigDefLoader *>::iterator it = prefetched_rig_defs.lower_bound(file_name);
+	for (; it != prefetched_rig_defs.end() && it->first == file_name; ++it)
+	{
+		if (it->second->GetCheckBeams() == check_beams)
+		{
+			RigDefLoader *loader = it->second;
+			prefetched_rig_defs.erase(it);
+			return loader;
+		}
+	}
+	return nullptr;
+}
+
+bool BeamFactory::isRemoteInstanceReady(stream_reg_t *reg)
+{
+	// NO LOCKS IN HERE, already locked
+
+	String filename = String(((stream_register_trucks_t *)&reg->reg)->name);
+	std::pair<int, int> stream(reg->sourceid, reg->streamid);
+
+	if (pending_remote_spawns.find(stream) == pending_remote_spawns.end())
+	{
+		// first time seen, start loading the definition in background
+		pending_remote_spawns.insert(stream);
+		RigDefLoader *loader = startRigDefLoader(filename, RigDefLoader::ShouldCheckBeams(filename, false));
+		if (loader != nullptr)
+		{
+			remote_rig_defs[stream] = loader;
+		}
+	}
+
+	// spawning itself happens on the main thread, limit it to spread the load over frames
+	if (remote_spawns_this_frame >= max_remote_spawns_per_frame)
+	{
+		return false;
+	}
+
+	// wait for the definition of this stream, unless it's not being loaded at all (no thread pool, not installed...)
+	std::map< std::pair<int, int>, RigDefLoader *>::iterator it = remote_rig_defs.find(stream);
+	if (it != remote_rig_defs.end() && !it->second->IsLoaded())
+	{
+		return false;
+	}
+
+	pending_remote_spawns.erase(stream);
+	remote_spawns_this_frame++;
+	return true;
+}
+
+void BeamFactory::cancelRemoteInstance(stream_reg_t *reg)
+{
+	// NO LOCKS IN HERE, already locked
+
+	std::pair<int, int> stream(reg->sourceid, reg->streamid);
+	pending_remote_spawns.erase(stream);
+	delete takeRemoteRigDef(reg);
+}
+
+RigDefLoader *BeamFactory::takeRemoteRigDef(stream_reg_t *reg)
+{
+	std::map< std::pair<int, int>, RigDefLoader *>::iterator it = remote_rig_defs.find(std::make_pair(reg->sourceid, reg->streamid));
+	if (it == remote_rig_defs.end())
+	{
+		return nullptr;
+	}
+	RigDefLoader *loader = it->second;
+	remote_rig_defs.erase(it);
+	return loader;
+}
+
 void BeamFactory::localUserAttributesChanged(int new_id)
 {
 	lockStreams();
@@ -386,6 +515,7 @@ bool BeamFactory::syncRemoteStreams()
 {
 	// we override this here, so we know if something changed and could update the player list
 	// we delete and add trucks in there, so be sure that nothing runs as we delete them ...
+	remote_spawns_this_frame = 0;
 	bool changes = StreamableFactory <BeamFactory, Beam>::syncRemoteStreams();
 
 	if (changes)
@@ -736,14 +866,20 @@ bool BeamFactory::enterRescueTruck()
 
 void BeamFactory::updateVisual(float dt)
 {
+	std::list<IThreadTask*> tasks;
+
 	for (int t=0; t < free_truck; t++)
 	{
 		if (trucks[t] && trucks[t]->state != SLEEPING && trucks[t]->loading_finished)
 		{
-			trucks[t]->updateVisualPrepare(dt);
+			trucks[t]->updateVisualPrepare(dt, tasks);
 		}
 	}
 
+	// the flexbody/flexmesh and prop/flare tasks of all trucks run as one batch
+	_VisualTasksStart(tasks);
+
+	// meanwhile, do the work which has to stay on this thread
 	for (int t=0; t < free_truck; t++)
 	{
 		if (!trucks[t]) continue;
@@ -754,19 +890,59 @@ void BeamFactory::updateVisual(float dt)
 		if (trucks[t]->state != SLEEPING && trucks[t]->loading_finished)
 		{
 			trucks[t]->updateSkidmarks();
-			trucks[t]->updateFlares(dt, (t==current_truck));
 		}
 	}
 
+	if (SkidmarkManager::singletonExists())
+	{
+		SkidmarkManager::getSingleton().update(dt);
+	}
+
+	_VisualTasksWaitForCompletion();
+
 	for (int t=0; t < free_truck; t++)
 	{
 		if (trucks[t] && trucks[t]->state != SLEEPING && trucks[t]->loading_finished)
 		{
 			trucks[t]->updateVisualFinal(dt);
+			// beacons depend on the prop positions set by updateVisualFinal()
+			trucks[t]->updateFlaresFinal(dt, (t==current_truck));
 		}
 	}
 }
 
+void BeamFactory::_VisualTasksStart(const std::list<IThreadTask*> &tasks)
+{
+	if (tasks.empty() || !gEnv->threadPool) return;
+
+	MUTEX_LOCK(&visual_task_count_mutex);
+	visual_task_count += (int)tasks.size();
+	MUTEX_UNLOCK(&visual_task_count_mutex);
+
+	gEnv->threadPool->enqueue(tasks);
+}
+
+void BeamFactory::_VisualTasksWaitForCompletion()
+{
+	MUTEX_LOCK(&visual_task_count_mutex);
+	while (visual_task_count > 0)
+	{
+		pthread_cond_wait(&visual_task_count_cv, &visual_task_count_mutex);
+	}
+	MUTEX_UNLOCK(&visual_task_count_mutex);
+}
+
+void BeamFactory::_VisualTaskCompleted()
+{
+	MUTEX_LOCK(&visual_task_count_mutex);
+	visual_task_count--;
+	if (!visual_task_count)
+	{
+		pthread_cond_broadcast(&visual_task_count_cv);
+	}
+	MUTEX_UNLOCK(&visual_task_count_mutex);
+}
+
 void BeamFactory::updateAI(float dt)
 {
 	for (int t=0; t < free_truck; t++)
@@ -786,6 +962,12 @@ void BeamFactory::calcPhysics(float dt)
 	dt = std::min(dt, 1.0f / 20.0f);
 	gEnv->mrTime += dt;
 
+	// the wave phases only depend on the time, compute them once for all water queries of this frame
+	if (gEnv->terrainManager && gEnv->terrainManager->getWater())
+	{
+		gEnv->terrainManager->getWater()->updateWavePhases(gEnv->mrTime);
+	}
+
 	simulatedTruck = current_truck;
 
 	if (simulatedTruck == -1)
@@ -31,7 +31,11 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "StreamableFactory.h"
 #include "TwoDReplay.h"
 
+#include <map>
 #include <pthread.h>
+#include <set>
+
+class RigDefLoader;
 
 /**
 * Builds and manages vehicles; Manages multithreading.
@@ -66,6 +70,24 @@ public:
 	
 	Beam *createRemoteInstance(stream_reg_t *reg);
 
+	/**
+	* Starts loading the rig definition (cache or parser + validator) on the thread pool.
+	* The next vehicle spawned from the same file picks the result up, so parsing
+	* overlaps with spawning of other vehicles. Does nothing without thread pool.
+	*/
+	void prefetchRigDef(Ogre::String const & file_name, bool preloaded_with_terrain = false);
+
+	/**
+	* Used by Beam::LoadTruck().
+	* @return Loader started by prefetchRigDef() (caller takes ownership) or nullptr.
+	*/
+	RigDefLoader *takePrefetchedRigDef(Ogre::String const & file_name, bool check_beams);
+
+	/**
+	* Deletes the loaders which weren't taken, e.g. because their spawn failed; they would serve outdated content later.
+	*/
+	void dropPrefetchedRigDefs();
+
 	bool getThreadingMode() { return thread_mode; };
 
 	/**
@@ -83,6 +105,21 @@ public:
 	*/
 	void _WorkerSignalStart(); 
 
+	/**
+	* Threading; Submits visual tasks (flexbodies, flexmeshes, props, flares) to the thread pool
+	*/
+	void _VisualTasksStart(const std::list<IThreadTask*> &tasks);
+
+	/**
+	* Threading; Waits until all submitted visual tasks are done
+	*/
+	void _VisualTasksWaitForCompletion();
+
+	/**
+	* Threading; Called by a visual task once it is done
+	*/
+	void _VisualTaskCompleted();
+
 	bool asynchronousPhysics() { return async_physics; };
 	int getNumCpuCores() { return num_cpu_cores; };
 
@@ -156,6 +193,11 @@ public:
 
 	ThreadPool *beamThreadPool;
 
+	// visual task pthread stuff
+	int visual_task_count;
+	pthread_cond_t visual_task_count_cv;
+	pthread_mutex_t visual_task_count_mutex;
+
 protected:
 
 	Ogre::SceneNode *parent;
@@ -175,6 +217,15 @@ protected:
 
 	unsigned long physFrame;
 
+	std::multimap<Ogre::String, RigDefLoader *> prefetched_rig_defs;
+	std::map< std::pair<int, int>, RigDefLoader *> remote_rig_defs; //!< by source and stream id, see isRemoteInstanceReady()
+	RigDefLoader *spawning_rig_def; //!< remote definition handed from createRemoteInstance() to Beam::LoadTruck()
+
+	// remote vehicles waiting for their definition or for a free spawn slot in this frame
+	std::set< std::pair<int, int> > pending_remote_spawns;
+	int remote_spawns_this_frame;
+	int max_remote_spawns_per_frame;
+
 	void LogParserMessages();
 	void LogSpawnerMessages();
 
@@ -189,6 +240,9 @@ protected:
 	void localUserAttributesChanged(int newid);
 
 	bool syncRemoteStreams();
+	bool isRemoteInstanceReady(stream_reg_t *reg);
+	void cancelRemoteInstance(stream_reg_t *reg);
+	RigDefLoader *takeRemoteRigDef(stream_reg_t *reg);
 	void updateGUI();
 	void removeInstance(Beam *b);
 	void removeInstance(stream_del_t *del);
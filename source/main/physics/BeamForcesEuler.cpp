@@ -568,20 +568,14 @@ void Beam::calcForcesEulerCompute(int doUpdate, Real dt, int step, int maxsteps)
 	{
 		if (!(step%20))
 		{
-			//clear forces
-			for (int i=0; i<free_buoycab; i++)
+			if (free_buoycab < 100)
 			{
-				int tmpv=buoycabs[i]*3;
-				nodes[cabs[tmpv]].buoyanceForce=0;
-				nodes[cabs[tmpv+1]].buoyanceForce=0;
-				nodes[cabs[tmpv+2]].buoyanceForce=0;
-			}
-			//add forces
-			for (int i=0; i<free_buoycab; i++)
+				calcBuoyance(doUpdate, dt, step, maxsteps);
+			} else
 			{
-				int tmpv=buoycabs[i]*3;
-				buoyance->computeNodeForce(&nodes[cabs[tmpv]], &nodes[cabs[tmpv+1]], &nodes[cabs[tmpv+2]], doUpdate, buoycabtypes[i]);
+				runThreadTask(this, THREAD_BUOYANCE, true);
 			}
+			buoyance->applyTriangleForces(nodes);
 		}
 		//apply forces
 		for (int i=0; i<free_node; i++)
@@ -1915,6 +1909,21 @@ void Beam::calcBeams(int doUpdate, Ogre::Real dt, int step, int maxsteps, int ch
 	BES_STOP(BES_CORE_Beams);
 }
 
+void Beam::calcBuoyance(int doUpdate, Ogre::Real dt, int step, int maxsteps, int chunk_index, int chunk_number)
+{
+	int num_triangles = buoyance->getTriangleCount();
+	int chunk_size = num_triangles / chunk_number;
+	int end_index = (chunk_index+1)*chunk_size;
+
+	if (chunk_index+1 == chunk_number)
+	{
+		end_index = num_triangles;
+	}
+
+	// every chunk writes the forces of its own triangles, they get summed up in applyTriangleForces()
+	buoyance->computeTriangleForces(nodes, chunk_index*chunk_size, end_index, doUpdate);
+}
+
 void Beam::calcNodes(int doUpdate, Ogre::Real dt, int step, int maxsteps, int chunk_index, int chunk_number)
 {
 	IWater *water = 0;
@@ -1980,14 +1989,14 @@ void Beam::calcNodes(int doUpdate, Ogre::Real dt, int step, int maxsteps, int ch
 						switch (gm->fx_type)
 						{
 						case Collisions::FX_DUSTY:
-							if (dustp) dustp->malloc(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour);
+							if (dustp) dustp->malloc(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour, gm);
 							break;
 
 						case Collisions::FX_HARD:
 							// smokey
 							if (nodes[i].iswheel && ns > thresold)
 							{
-								if (dustp) dustp->allocSmoke(nodes[i].AbsPosition, nodes[i].Velocity);
+								if (dustp) dustp->allocSmoke(nodes[i].AbsPosition, nodes[i].Velocity, gm);
 #ifdef USE_OPENAL
 								SoundScriptManager::getSingleton().modulate(trucknum, SS_MOD_SCREETCH, (ns-thresold) / thresold);
 								SoundScriptManager::getSingleton().trigOnce(trucknum, SS_TRIG_SCREETCH);
@@ -1997,14 +2006,14 @@ void Beam::calcNodes(int doUpdate, Ogre::Real dt, int step, int maxsteps, int ch
 							if (!nodes[i].iswheel && ns > 1.0 && !nodes[i].disable_sparks)
 							{
 								// friction < 10 will remove the 'f' nodes from the spark generation nodes
-								if (sparksp) sparksp->allocSparks(nodes[i].AbsPosition, nodes[i].Velocity);
+								if (sparksp) sparksp->allocSparks(nodes[i].AbsPosition, nodes[i].Velocity, gm);
 							}
 							break;
 
 						case Collisions::FX_CLUMPY:
 							if (nodes[i].Velocity.squaredLength() > 1.0)
 							{
-								if (clumpp) clumpp->allocClump(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour);
+								if (clumpp) clumpp->allocClump(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour, gm);
 							}
 							break;
 						}
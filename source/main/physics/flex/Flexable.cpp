@@ -20,6 +20,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Flexable.h"
 
 #include "Beam.h"
+#include "BeamFactory.h"
 
 bool Flexable::flexitPrepare(Beam* b)
 {
@@ -35,11 +36,5 @@ void Flexable::run()
 
 void Flexable::onComplete()
 {
-	MUTEX_LOCK(&beamid->flexable_task_count_mutex);
-	beamid->flexable_task_count--;
-	MUTEX_UNLOCK(&beamid->flexable_task_count_mutex);
-	if (!beamid->flexable_task_count)
-	{
-		pthread_cond_signal(&beamid->flexable_task_count_cv);
-	}
+	BeamFactory::getSingleton()._VisualTaskCompleted();
 }
@@ -0,0 +1,108 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**	
+	@file   RigDefCache.cpp
+*/
+
+#include "RigDefCache.h"
+
+#include "RigDef_BinarySerializer.h"
+#include "RoRPrerequisites.h"
+#include "SHA1.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+/** Numbers the temporary files of Save() */
+static std::atomic<unsigned int> s_save_counter(0);
+
+Ogre::String RigDefCache::GetKey(Ogre::String const & content, bool check_beams)
+{
+	RoR::CSHA1 sha1;
+	sha1.UpdateHash((uint8_t *) content.c_str(), (uint32_t) content.length());
+	char hash[256] = {};
+	sha1.Final();
+	sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+
+	return Ogre::String(hash) + (check_beams ? "" : "_nobeamcheck");
+}
+
+Ogre::String RigDefCache::GetFilePath(Ogre::String const & cache_dir, Ogre::String const & key)
+{
+	return cache_dir + "rig_" + key + "_v" + TOSTRING(RigDef::BinarySerializer::FORMAT_VERSION) + ".rigcache";
+}
+
+boost::shared_ptr<RigDef::File> RigDefCache::Load(Ogre::String const & file_path, Ogre::String const & key)
+{
+	std::ifstream in(file_path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (! in.is_open())
+	{
+		return boost::shared_ptr<RigDef::File>();
+	}
+
+	// Single read of the whole file
+	std::streamoff size = in.tellg();
+	if (size <= 0)
+	{
+		return boost::shared_ptr<RigDef::File>();
+	}
+	std::vector<char> buffer(static_cast<size_t>(size));
+	in.seekg(0, std::ios::beg);
+	if (! in.read(&buffer[0], size))
+	{
+		return boost::shared_ptr<RigDef::File>();
+	}
+
+	return RigDef::BinarySerializer::Deserialize(&buffer[0], buffer.size(), key);
+}
+
+bool RigDefCache::Save(Ogre::String const & file_path, Ogre::String const & key, boost::shared_ptr<RigDef::File> file)
+{
+	std::vector<char> buffer;
+	RigDef::BinarySerializer::Serialize(file, key, buffer);
+
+	// Write to a temporary file first, so an interrupted write never leaves a truncated entry behind.
+	// The name is unique per call, the same rig may be saved by more loaders at once.
+	Ogre::String temp_path = file_path + "." + TOSTRING(s_save_counter.fetch_add(1)) + ".tmp";
+	std::ofstream out(temp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (! out.is_open())
+	{
+		return false;
+	}
+	out.write(&buffer[0], buffer.size());
+	out.close();
+	if (out.fail())
+	{
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	std::remove(file_path.c_str());
+	if (std::rename(temp_path.c_str(), file_path.c_str()) != 0)
+	{
+		std::remove(temp_path.c_str());
+		return false;
+	}
+	return true;
+}
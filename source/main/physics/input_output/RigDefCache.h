@@ -0,0 +1,67 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**	
+	@file   RigDefCache.h
+	@brief  Disk cache of parsed and validated rig definitions.
+*/
+
+#pragma once
+
+#include "RigDef_File.h"
+
+#include <boost/shared_ptr.hpp>
+#include <OgreString.h>
+
+/**
+* Stores validated RigDef::File data in the cache directory (see RigDef::BinarySerializer),
+* so that spawning an already seen vehicle skips parsing and validation.
+*
+* Entries are keyed by the hash of the file content, so a modified file gets a new entry.
+* Entries from a different format version are rejected on load and overwritten.
+*
+* Doesn't read global settings, so it may be used from worker threads.
+*/
+class RigDefCache
+{
+public:
+
+	/**
+	* @param content Complete content of the rig-def file.
+	* @param check_beams Validator setting; the validated result depends on it.
+	*/
+	static Ogre::String GetKey(Ogre::String const & content, bool check_beams);
+
+	/**
+	* @param cache_dir Cache directory with trailing separator, see setting "Cache Path".
+	*/
+	static Ogre::String GetFilePath(Ogre::String const & cache_dir, Ogre::String const & key);
+
+	/**
+	* @return Null if not cached or if the cache file is unusable.
+	*/
+	static boost::shared_ptr<RigDef::File> Load(Ogre::String const & file_path, Ogre::String const & key);
+
+	/**
+	* @return False if the file couldn't be written.
+	*/
+	static bool Save(Ogre::String const & file_path, Ogre::String const & key, boost::shared_ptr<RigDef::File> file);
+};
@@ -0,0 +1,291 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**	
+	@file   RigDefLoader.cpp
+*/
+
+#include "RigDefLoader.h"
+
+#include "Application.h"
+#include "CacheSystem.h"
+#include "RigDefCache.h"
+#include "Settings.h"
+#include "ThreadPool.h"
+
+#include <OgreDataStream.h>
+#include <OgreResourceGroupManager.h>
+#include <sstream>
+
+RigDefLoader::RigDefLoader(Ogre::String const & file_name, bool check_beams):
+	m_file_name(file_name),
+	m_check_beams(check_beams),
+	m_use_cache(false),
+	m_use_regex_tokenizer(false),
+	m_loaded_from_cache(false),
+	m_cache_save_failed(false),
+	m_task_running(false),
+	m_loaded(false)
+{
+	pthread_mutex_init(&m_task_mutex, NULL);
+	pthread_cond_init(&m_task_cond, NULL);
+}
+
+RigDefLoader::~RigDefLoader()
+{
+	WaitForCompletion();
+
+	pthread_cond_destroy(&m_task_cond);
+	pthread_mutex_destroy(&m_task_mutex);
+}
+
+bool RigDefLoader::ShouldCheckBeams(Ogre::String const & file_name, bool preloaded_with_terrain)
+{
+	Ogre::String file_extension = file_name.substr(file_name.find_last_of('.'));
+	Ogre::StringUtil::toLowerCase(file_extension);
+	bool extension_matches = (file_extension == ".load") | (file_extension == ".fixed");
+	return ! (preloaded_with_terrain && extension_matches);
+}
+
+bool RigDefLoader::ReadFile()
+{
+	Ogre::DataStreamPtr ds = Ogre::DataStreamPtr();
+	Ogre::String fixed_file_name = m_file_name;
+	Ogre::String found_resource_group;
+
+	try
+	{
+		RoR::Application::GetCacheSystem()->checkResourceLoaded(fixed_file_name, found_resource_group); /* Fixes the filename and finds resource group */
+
+		ds = Ogre::ResourceGroupManager::getSingleton().openResource(fixed_file_name, found_resource_group);
+	}
+	catch (Ogre::Exception & e)
+	{
+		m_error = Ogre::String(e.what());
+		return false;
+	}
+
+	if (ds.isNull() || !ds->isReadable())
+	{
+		m_error = "unable to open file: " + fixed_file_name;
+		return false;
+	}
+
+	m_content = ds->getAsString();
+
+	// Settings must be read here, they aren't safe to access from worker threads
+	m_cache_dir = SSETTING("Cache Path", "");
+	m_use_regex_tokenizer = BSETTING("RigDef Regex Parser", false);
+	m_use_cache = BSETTING("Rig Cache", true) && ! m_use_regex_tokenizer;
+	return true;
+}
+
+void RigDefLoader::Load()
+{
+	Ogre::String cache_key;
+	Ogre::String cache_path;
+
+	if (m_use_cache)
+	{
+		cache_key = RigDefCache::GetKey(m_content, m_check_beams);
+		cache_path = RigDefCache::GetFilePath(m_cache_dir, cache_key);
+		m_file = RigDefCache::Load(cache_path, cache_key);
+		m_loaded_from_cache = (m_file != nullptr);
+	}
+
+	if (! m_loaded_from_cache)
+	{
+		/* PARSING */
+
+		RigDef::Parser parser;
+		parser.SetUseRegexTokenizer(m_use_regex_tokenizer);
+		parser.Prepare();
+		Ogre::MemoryDataStream stream(const_cast<char *>(m_content.data()), m_content.size(), false, true);
+		while(! stream.eof())
+		{
+			parser.ParseLine(stream.getLine());
+		}
+		parser.Finalize();
+
+		m_parser_messages = parser.GetMessages();
+		m_file = parser.GetFile();
+
+		/* VALIDATING */
+
+		RigDef::Validator validator;
+		validator.Setup(m_file);
+		validator.SetCheckBeams(m_check_beams);
+		bool valid = validator.Validate();
+
+		m_validator_messages = validator.GetMessages();
+
+		// Only valid rigs are cached, so that errors keep being reported until fixed.
+		if (m_use_cache && valid)
+		{
+			m_cache_save_failed = ! RigDefCache::Save(cache_path, cache_key, m_file);
+		}
+	}
+
+	Ogre::String().swap(m_content); // Not needed anymore
+
+	MUTEX_LOCK(&m_task_mutex);
+	m_loaded = true;
+	MUTEX_UNLOCK(&m_task_mutex);
+}
+
+void RigDefLoader::StartLoadTask(ThreadPool *thread_pool)
+{
+	MUTEX_LOCK(&m_task_mutex);
+	m_task_running = true;
+	MUTEX_UNLOCK(&m_task_mutex);
+
+	thread_pool->enqueue(new LoadTask(this));
+}
+
+void RigDefLoader::WaitForCompletion()
+{
+	MUTEX_LOCK(&m_task_mutex);
+	while (m_task_running)
+	{
+		pthread_cond_wait(&m_task_cond, &m_task_mutex);
+	}
+	MUTEX_UNLOCK(&m_task_mutex);
+}
+
+bool RigDefLoader::IsLoaded()
+{
+	MUTEX_LOCK(&m_task_mutex);
+	bool loaded = m_loaded;
+	MUTEX_UNLOCK(&m_task_mutex);
+	return loaded;
+}
+
+void RigDefLoader::LoadTask::run()
+{
+	m_loader->Load();
+}
+
+void RigDefLoader::LoadTask::onComplete()
+{
+	MUTEX_LOCK(&m_loader->m_task_mutex);
+	m_loader->m_task_running = false;
+	pthread_cond_signal(&m_loader->m_task_cond);
+	MUTEX_UNLOCK(&m_loader->m_task_mutex);
+
+	delete this;
+}
+
+void RigDefLoader::LogMessages()
+{
+	if (m_loaded_from_cache)
+	{
+		LOG(" == Loaded vehicle from cache: " + m_file_name);
+		return;
+	}
+
+	LOG(" == Parsing vehicle file: " + m_file_name);
+	LogParserMessages();
+
+	LOG(" == Validating vehicle: " + m_file->name);
+	LogValidatorMessages();
+	// Continue anyway...
+
+	if (m_cache_save_failed)
+	{
+		LOG(" == Unable to write rig cache file in: " + m_cache_dir);
+	}
+}
+
+void RigDefLoader::LogParserMessages()
+{
+	if (m_parser_messages.size() == 0)
+	{
+		LOG(" == Parsing done OK");
+		return;
+	}
+
+	std::stringstream report;
+	report << " == Parsing done, report:" << std::endl <<std::endl;
+
+	std::list<RigDef::Parser::Message>::const_iterator iter = m_parser_messages.begin();
+	for (; iter != m_parser_messages.end(); iter++)
+	{
+		switch (iter->type)
+		{
+			case (RigDef::Parser::Message::TYPE_FATAL_ERROR): 
+				report << "FATAL_ERROR"; 
+				break;
+
+			case (RigDef::Parser::Message::TYPE_ERROR): 
+				report << "ERROR"; 
+				break;
+
+			case (RigDef::Parser::Message::TYPE_WARNING): 
+				report << "WARNING"; 
+				break;
+
+			default:
+				report << "INFO"; 
+				break;
+		}
+		report << " (Section " << RigDef::File::SectionToString(iter->section) << ")" << std::endl;
+		report << "\tLine (# " << iter->line_number << "): " << iter->line << std::endl;
+		report << "\tMessage: " << iter->message << std::endl;
+	}
+
+	Ogre::LogManager::getSingleton().logMessage(report.str());
+}
+
+void RigDefLoader::LogValidatorMessages()
+{
+	if (m_validator_messages.empty())
+	{
+		Ogre::LogManager::getSingleton().logMessage(" == Validating done OK");
+		return;
+	}
+
+	std::stringstream report;
+	report << " == Validating done, report:" <<std::endl << std::endl;
+
+	std::list<RigDef::Validator::Message>::iterator itor = m_validator_messages.begin();
+	for( ; itor != m_validator_messages.end(); itor++)
+	{
+		switch (itor->type)
+		{
+			case (RigDef::Validator::Message::TYPE_FATAL_ERROR):
+				report << "FATAL ERROR";
+				break;
+			case (RigDef::Validator::Message::TYPE_ERROR):
+				report << "ERROR";
+				break;
+			case (RigDef::Validator::Message::TYPE_WARNING):
+				report << "WARNING";
+				break;
+			default:
+				report << "INFO";
+		}
+
+		report << ": " << itor->text << std::endl;
+	}
+
+	Ogre::LogManager::getSingleton().logMessage(report.str());
+}
@@ -0,0 +1,160 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/**	
+	@file   RigDefLoader.h
+	@brief  Loads rig definition (cache or parser + validator), optionally on a worker thread.
+*/
+
+#pragma once
+
+#include "RoRPrerequisites.h"
+#include "IThreadTask.h"
+#include "RigDef_Parser.h"
+#include "RigDef_Validator.h"
+
+#include <boost/shared_ptr.hpp>
+#include <OgreString.h>
+#include <pthread.h>
+
+/**
+* Obtains the validated RigDef::File of a vehicle, either from RigDefCache or by parsing and validating.
+*
+* The work is split into stages, so that the costly part can run on a worker thread:
+*
+* - ReadFile()     Main thread. Reads the file through Ogre resource system and all required settings.
+* - Load()         Any thread. Cache lookup or parsing + validation; uses only data in memory and the cache directory.
+* - LogMessages()  Main thread. Writes the parser and validator reports to the log.
+*
+* BeamFactory::prefetchRigDef() runs Load() on the thread pool, Beam::LoadTruck() picks the result up.
+*/
+class RigDefLoader : public ZeroedMemoryAllocator
+{
+public:
+
+	RigDefLoader(Ogre::String const & file_name, bool check_beams);
+
+	/** Waits for the load task, if running */
+	~RigDefLoader();
+
+	/**
+	* Workaround: Some terrains pre-load truckfiles with special purpose:
+	*     "soundloads" = play sound effect at certain spot
+	*     "fixes"      = structures of N/B fixed to the ground
+	* These files can have no beams. Possible extensions: .load or .fixed
+	* .load observed in: "Northern-Isles" [http://www.rigsofrods.com/repository/view/5315]
+	*/
+	static bool ShouldCheckBeams(Ogre::String const & file_name, bool preloaded_with_terrain);
+
+	/**
+	* Main thread.
+	* @return False if the file couldn't be opened, see GetError().
+	*/
+	bool ReadFile();
+
+	/**
+	* Any thread; requires ReadFile().
+	*/
+	void Load();
+
+	/**
+	* Runs Load() on the thread pool; requires ReadFile().
+	*/
+	void StartLoadTask(ThreadPool *thread_pool);
+
+	/** Blocks until the load task is finished. Returns immediately if there is none. */
+	void WaitForCompletion();
+
+	/** @return True if Load() has finished. */
+	bool IsLoaded();
+
+	/** Main thread; requires Load() to be finished. */
+	void LogMessages();
+
+	boost::shared_ptr<RigDef::File> GetFile()
+	{
+		return m_file;
+	}
+
+	Ogre::String const & GetFileName() const
+	{
+		return m_file_name;
+	}
+
+	bool GetCheckBeams() const
+	{
+		return m_check_beams;
+	}
+
+	Ogre::String const & GetError() const
+	{
+		return m_error;
+	}
+
+private:
+
+	/** Runs Load() on a worker thread; deletes itself when done */
+	class LoadTask : public IThreadTask
+	{
+	public:
+
+		LoadTask(RigDefLoader *loader):
+			m_loader(loader)
+		{}
+
+		void run();
+		void onComplete();
+
+	private:
+
+		RigDefLoader *m_loader;
+	};
+
+	void LogParserMessages();
+
+	void LogValidatorMessages();
+
+	/* Input (ReadFile) */
+
+	Ogre::String   m_file_name;
+	bool           m_check_beams;
+	Ogre::String   m_content;
+	Ogre::String   m_cache_dir;
+	bool           m_use_cache;
+	bool           m_use_regex_tokenizer;
+	Ogre::String   m_error;
+
+	/* Output (Load) */
+
+	boost::shared_ptr<RigDef::File>        m_file;
+	bool                                   m_loaded_from_cache;
+	bool                                   m_cache_save_failed;
+	std::list<RigDef::Parser::Message>     m_parser_messages;
+	std::list<RigDef::Validator::Message>  m_validator_messages;
+
+	/* Load task state */
+
+	bool            m_task_running;
+	bool            m_loaded;
+	pthread_mutex_t m_task_mutex;
+	pthread_cond_t  m_task_cond;
+};
@@ -66,6 +66,7 @@
 #include "FlexObj.h"
 #include "InputEngine.h"
 #include "MaterialFunctionMapper.h"
+#include "MaterialInstanceCache.h"
 #include "MaterialReplacer.h"
 #include "MeshObject.h"
 #include "PointColDetector.h"
@@ -197,6 +198,9 @@ rig_t *RigSpawner::SpawnRig()
 {
 	InitializeRig();
 
+	unsigned int materials_cloned = MaterialInstanceCache::getSingleton().getClonedCount();
+	unsigned int materials_shared = MaterialInstanceCache::getSingleton().getSharedCount();
+
 	/* Vehicle name */
 	m_rig->realtruckname = m_file->name;
 
@@ -451,6 +455,11 @@ rig_t *RigSpawner::SpawnRig()
 	/* POST-PROCESSING */
 	FinalizeRig();
 
+	materials_cloned = MaterialInstanceCache::getSingleton().getClonedCount() - materials_cloned;
+	materials_shared = MaterialInstanceCache::getSingleton().getSharedCount() - materials_shared;
+	LOG("Materials of vehicle '" + m_rig->realtruckname + "': " + TOSTRING(materials_cloned) + " cloned, " + TOSTRING(materials_shared) + " shared"
+		+ " (all vehicles: " + TOSTRING(MaterialInstanceCache::getSingleton().getClonedCount()) + " cloned, " + TOSTRING(MaterialInstanceCache::getSingleton().getSharedCount()) + " shared)");
+
 	/* Pass ownership */
 	rig_t *rig = m_rig;
 	m_rig = nullptr;
@@ -573,6 +582,7 @@ void RigSpawner::InitializeRig()
 
 	memset(m_rig->default_node_options, 0, 49);
 	memset(m_rig->texname, 0, 1023);
+	memset(m_rig->transmatname, 0, 1023);
 	memset(m_rig->helpmat, 0, 255);
 	
 	m_rig->fadeDist=150.0;
@@ -791,6 +801,11 @@ void RigSpawner::InitializeRig()
 
 void RigSpawner::FinalizeRig()
 {
+	if (m_rig->buoyance)
+	{
+		m_rig->buoyance->setupTriangles(m_rig->cabs, m_rig->buoycabs, m_rig->buoycabtypes, m_rig->free_buoycab);
+	}
+
 	// we should post-process the torque curve if existing
 	if (m_rig->engine)
 	{
@@ -913,10 +928,10 @@ void RigSpawner::FinalizeRig()
 			return;
 		}
 
-		//-trans
-		char transmatname[256];
-		sprintf(transmatname, "%s-trans", m_rig->texname);
-		Ogre::MaterialPtr transmat=mat->clone(transmatname);
+		//-trans, per vehicle since Beam::prepareInside() toggles its shadows
+		char *transmatname = m_rig->transmatname;
+		snprintf(transmatname, sizeof(m_rig->transmatname), "%s-trans-%s", m_rig->texname, m_rig->truckname);
+		Ogre::MaterialPtr transmat=MaterialInstanceCache::getSingleton().clonePerInstance(m_rig->texname, transmatname);
 		if (mat->getTechnique(0)->getNumPasses()>1)
 		{
 			transmat->getTechnique(0)->removePass(1);
@@ -929,42 +944,49 @@ void RigSpawner::FinalizeRig()
 		}
 		transmat->compile();
 
-		//-back
+		//-back, shared; the shadow optimizations are a global setting
 		char backmatname[256];
 		sprintf(backmatname, "%s-back", m_rig->texname);
-		Ogre::MaterialPtr backmat=mat->clone(backmatname);
-		if (mat->getTechnique(0)->getNumPasses()>1)
+		bool created = false;
+		Ogre::MaterialPtr backmat=MaterialInstanceCache::getSingleton().getShared(m_rig->texname, backmatname, created);
+		if (created)
 		{
-			backmat->getTechnique(0)->removePass(1);
-		}
-		if (transmat->getTechnique(0)->getPass(0)->getNumTextureUnitStates()>0)
-		{
-			backmat->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setColourOperationEx(
-				Ogre::LBX_SOURCE1, 
-				Ogre::LBS_MANUAL, 
-				Ogre::LBS_MANUAL, 
-				Ogre::ColourValue(0,0,0),
-				Ogre::ColourValue(0,0,0)
-			);
-		}
-		if (m_rig->shadowOptimizations)
-		{
-			backmat->setReceiveShadows(false);
+			if (mat->getTechnique(0)->getNumPasses()>1)
+			{
+				backmat->getTechnique(0)->removePass(1);
+			}
+			if (transmat->getTechnique(0)->getPass(0)->getNumTextureUnitStates()>0)
+			{
+				backmat->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setColourOperationEx(
+					Ogre::LBX_SOURCE1, 
+					Ogre::LBS_MANUAL, 
+					Ogre::LBS_MANUAL, 
+					Ogre::ColourValue(0,0,0),
+					Ogre::ColourValue(0,0,0)
+				);
+			}
+			if (m_rig->shadowOptimizations)
+			{
+				backmat->setReceiveShadows(false);
+			}
+			//just in case
+			//backmat->getTechnique(0)->getPass(0)->setSceneBlending(SBT_TRANSPARENT_ALPHA);
+			//backmat->getTechnique(0)->getPass(0)->setAlphaRejectSettings(CMPF_GREATER, 128);
+			backmat->compile();
 		}
-		//just in case
-		//backmat->getTechnique(0)->getPass(0)->setSceneBlending(SBT_TRANSPARENT_ALPHA);
-		//backmat->getTechnique(0)->getPass(0)->setAlphaRejectSettings(CMPF_GREATER, 128);
-		backmat->compile();
 
-		//-noem and -noem-trans
+		//-noem and -noem-trans, shared; Beam::lightsToggle() only swaps the entity materials
 		if (mat->getTechnique(0)->getNumPasses()>1)
 		{
 			m_rig->hasEmissivePass=1;
 			char clomatname[256];
 			sprintf(clomatname, "%s-noem", m_rig->texname);
-			Ogre::MaterialPtr clomat=mat->clone(clomatname);
-			clomat->getTechnique(0)->removePass(1);
-			clomat->compile();
+			Ogre::MaterialPtr clomat=MaterialInstanceCache::getSingleton().getShared(m_rig->texname, clomatname, created);
+			if (created)
+			{
+				clomat->getTechnique(0)->removePass(1);
+				clomat->compile();
+			}
 		}
 
 		//base texture is not modified
@@ -2933,20 +2955,27 @@ Ogre::MaterialPtr RigSpawner::CloneMaterial(Ogre::String const & source_name, Og
 		AddMessage(Message::TYPE_ERROR, msg.str());
 		return Ogre::MaterialPtr(nullptr);
 	}
-	return src_mat->clone(clone_name);
+	return MaterialInstanceCache::getSingleton().clonePerInstance(source_name, clone_name);
 }
 
-void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
+Ogre::MaterialPtr RigSpawner::GetSharedMaterial(Ogre::String const & source_name, Ogre::String const & instance_name, bool & created)
 {
-	Ogre::MaterialPtr test = static_cast<Ogre::MaterialPtr>(Ogre::MaterialManager::getSingleton().getByName(def.name));
-	if (! test.isNull())
+	Ogre::MaterialPtr material = MaterialInstanceCache::getSingleton().getShared(source_name, instance_name, created);
+	if (material.isNull())
 	{
 		std::stringstream msg;
-		msg << "Managed material '" << def.name << "' already exists (probably because the vehicle was already spawned before)";
-		AddMessage(Message::TYPE_WARNING, msg.str());
+		msg << "Built-in material '" << source_name << "' missing! Skipping...";
+		AddMessage(Message::TYPE_ERROR, msg.str());
 	}
+	return material;
+}
 
+void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
+{
+	/* Managed materials hold no per-vehicle state, every spawn of the vehicle shares them.
+	   Only the spawn which creates the material sets it up. */
 	Ogre::MaterialPtr material;
+	bool created = false;
 	if (def.type == RigDef::ManagedMaterial::TYPE_FLEXMESH_STANDARD || def.type == RigDef::ManagedMaterial::TYPE_FLEXMESH_TRANSPARENT)
 	{
 		Ogre::String mat_name_base 
@@ -2959,8 +2988,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 			if (def.HasSpecularMap())
 			{
 				/* FLEXMESH, damage, specular */
-				material = CloneMaterial(mat_name_base + "/speculardamage", def.name);
-				if (material.isNull())
+				material = GetSharedMaterial(mat_name_base + "/speculardamage", def.name, created);
+				if (material.isNull() || !created)
 				{
 					return;
 				}
@@ -2972,8 +3001,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 			else
 			{
 				/* FLEXMESH, damage, no_specular */
-				material = CloneMaterial(mat_name_base + "/damageonly", def.name);
-				if (material.isNull())
+				material = GetSharedMaterial(mat_name_base + "/damageonly", def.name, created);
+				if (material.isNull() || !created)
 				{
 					return;
 				}
@@ -2986,8 +3015,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 			if (def.HasSpecularMap())
 			{
 				/* FLEXMESH, no_damage, specular */
-				material = CloneMaterial(mat_name_base + "/specularonly", def.name);
-				if (material.isNull())
+				material = GetSharedMaterial(mat_name_base + "/specularonly", def.name, created);
+				if (material.isNull() || !created)
 				{
 					return;
 				}
@@ -2998,8 +3027,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 			else
 			{
 				/* FLEXMESH, no_damage, no_specular */
-				material = CloneMaterial(mat_name_base + "/simple", def.name);
-				if (material.isNull())
+				material = GetSharedMaterial(mat_name_base + "/simple", def.name, created);
+				if (material.isNull() || !created)
 				{
 					return;
 				}
@@ -3017,8 +3046,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 		if (def.HasSpecularMap())
 		{
 			/* MESH, specular */
-			material = CloneMaterial(mat_name_base + "/specular", def.name);
-			if (material.isNull())
+			material = GetSharedMaterial(mat_name_base + "/specular", def.name, created);
+			if (material.isNull() || !created)
 			{
 				return;
 			}
@@ -3029,8 +3058,8 @@ void RigSpawner::ProcessManagedMaterial(RigDef::ManagedMaterial & def)
 		else
 		{
 			/* MESH, no_specular */
-			material = CloneMaterial(mat_name_base + "/simple", def.name);
-			if (material.isNull())
+			material = GetSharedMaterial(mat_name_base + "/simple", def.name, created);
+			if (material.isNull() || !created)
 			{
 				return;
 			}
@@ -7069,10 +7098,11 @@ void RigSpawner::ProcessGlobals(RigDef::Globals & def)
 				throw Exception("Vehicle material (or a built-in replacement) was not found.");
 			}
 		}
-		std::stringstream mat_clone_name;
-		mat_clone_name << material_name << "-" << m_rig->truckname;
-		mat->clone(mat_clone_name.str());
-		strncpy(m_rig->texname, mat_clone_name.str().c_str(), sizeof(m_rig->texname));
+		/* The cab material is shared by all vehicles using it, see FinalizeRig() */
+		Ogre::String mat_clone_name = mat->getName() + "-cab";
+		bool created = false;
+		MaterialInstanceCache::getSingleton().getShared(mat->getName(), mat_clone_name, created);
+		strncpy(m_rig->texname, mat_clone_name.c_str(), sizeof(m_rig->texname));
 	}
 }
 
@@ -123,11 +123,18 @@ public:
 	}
 
 	/**
-	* Finds and clones given material. Reports errors.
+	* Finds and clones given material for this vehicle only. Reports errors.
 	* @return NULL Ogre::MaterialPtr on error.
 	*/
 	Ogre::MaterialPtr CloneMaterial(Ogre::String const & source_name, Ogre::String const & clone_name);
 
+	/**
+	* Finds given material and returns its clone shared by all vehicles, see MaterialInstanceCache. Reports errors.
+	* @param created Set to true if the clone was just created and needs to be set up.
+	* @return NULL Ogre::MaterialPtr on error.
+	*/
+	Ogre::MaterialPtr GetSharedMaterial(Ogre::String const & source_name, Ogre::String const & instance_name, bool & created);
+
 	/**
 	* Finds existing node by Node::Id; throws an exception if the node doesn't exist.
 	* @return Index of existing node
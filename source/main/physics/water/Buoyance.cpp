@@ -19,6 +19,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "Buoyance.h"
 
+#include "ApproxMath.h"
 #include "BeamData.h"
 #include "DustManager.h"
 #include "DustPool.h"
@@ -29,86 +30,145 @@ using namespace Ogre;
 
 Buoyance::Buoyance()
 {
-	update=0;
 	sink=0;
 	splashp = DustManager::getSingleton().getDustPool("splash");
 	ripplep = DustManager::getSingleton().getDustPool("ripple");
 }
 
-//compute tetrahedron volume
-inline float Buoyance::computeVolume(Vector3 o, Vector3 a, Vector3 b, Vector3 c)
+void Buoyance::setupTriangles(const int *cabs, const int *buoycabs, const int *buoycabtypes, int free_buoycab)
 {
-	return ((a-o).dotProduct((b-o).crossProduct(c-o)))/6.0;
+	tri_a.clear();
+	tri_b.clear();
+	tri_c.clear();
+	tri_type.clear();
+
+	for (int i=0; i<free_buoycab; i++)
+	{
+		int tmpv=buoycabs[i]*3;
+		tri_a.push_back(cabs[tmpv]);
+		tri_b.push_back(cabs[tmpv+1]);
+		tri_c.push_back(cabs[tmpv+2]);
+		tri_type.push_back(buoycabtypes[i]);
+	}
+
+	tri_force.assign(tri_a.size() * 3, Vector3::ZERO);
 }
 
-//compute pressure and drag force on a submerged triangle
-Vector3 Buoyance::computePressureForceSub(Vector3 a, Vector3 b, Vector3 c, Vector3 vel, int type)
+void Buoyance::computeTriangleForces(node_t *nodes, int begin, int end, int doupdate)
 {
-	//compute normal vector
-	Vector3 normal=(b-a).crossProduct(c-a);
-	float surf=normal.length();
-	if (surf<0.00001) return Vector3::ZERO;
-	normal=normal/surf; //normalize
-	surf=surf/2.0; //surface
-	float vol=0.0;
-	if (type!=BUOY_DRAGONLY)
-	{
-		//compute pression prism points
-		Vector3 ap=a+(gEnv->terrainManager->getWater()->getHeightWaves(a)-a.y)*9810*normal;
-		Vector3 bp=b+(gEnv->terrainManager->getWater()->getHeightWaves(b)-b.y)*9810*normal;
-		Vector3 cp=c+(gEnv->terrainManager->getWater()->getHeightWaves(c)-c.y)*9810*normal;
-		//find centroid
-		Vector3 ctd=(a+b+c+ap+bp+cp)/6.0;
-		//compute volume
-		vol+=computeVolume(ctd, a, b, c);
-		vol+=computeVolume(ctd, a, ap, bp);
-		vol+=computeVolume(ctd, a, bp, b);
-		vol+=computeVolume(ctd, b, bp, cp);
-		vol+=computeVolume(ctd, b, cp, c);
-		vol+=computeVolume(ctd, c, cp, ap);
-		vol+=computeVolume(ctd, c, ap, a);
-		vol+=computeVolume(ctd, ap, cp, bp);
-	};
-	Vector3 drg=Vector3::ZERO;
-	if (type!=BUOY_DRAGLESS)
+	// every triangle is split into 6 sub triangles around its center, two per vertex:
+	// a: (a, mab, m) (a, m, mca), b: (b, mbc, m) (b, m, mab), c: (c, mca, m) (c, m, mbc)
+	static const int sub_vertices[6][3] = {{0, 4, 3}, {0, 3, 6}, {1, 5, 3}, {1, 3, 4}, {2, 6, 3}, {2, 3, 5}};
+
+	IWater *water=gEnv->terrainManager->getWater();
+
+	Vector3 vpos[BLOCK_TRIANGLES * 3];
+	float vwh[BLOCK_TRIANGLES * 3];
+	Vector3 tvel[BLOCK_TRIANGLES];
+	Vector3 spos[BLOCK_TRIANGLES * 6 * 3];
+	Vector3 scenter[BLOCK_TRIANGLES * 6];
+	float swh[BLOCK_TRIANGLES * 6];
+	int sslot[BLOCK_TRIANGLES * 6];
+	int stri[BLOCK_TRIANGLES * 6];
+	piece_buffer_t pieces;
+
+	for (int first=begin; first<end; first+=BLOCK_TRIANGLES)
 	{
-		//now, the drag
-		//take in account the wave speed
-		//compute center
-		Vector3 tc=(a+b+c)/3.0;
-		vel=vel-gEnv->terrainManager->getWater()->getVelocity(tc);
-		float vell=vel.length();
-		if (vell>0.01)
+		int count=std::min((int)BLOCK_TRIANGLES, end-first);
+
+		//water level at the vertices
+		for (int k=0; k<count; k++)
+		{
+			vpos[k*3+0]=nodes[tri_a[first+k]].AbsPosition;
+			vpos[k*3+1]=nodes[tri_b[first+k]].AbsPosition;
+			vpos[k*3+2]=nodes[tri_c[first+k]].AbsPosition;
+		}
+		water->getHeightWavesBatch(vpos, vwh, count*3);
+
+		//split the triangles which are not fully emerged
+		int subs=0;
+		for (int k=0; k<count; k++)
 		{
-			float cosaoa=fabs(normal.dotProduct(vel/vell));
-	//		drg=(-500.0*surf*vell*cosaoa)*vel;
-			drg=(-500.0*surf*vell*vell*cosaoa)*normal;
-			if (normal.dotProduct(vel/vell)<0) drg=-drg;
-			if (update && splashp)
+			int t=first+k;
+			tri_force[t*3+0]=Vector3::ZERO;
+			tri_force[t*3+1]=Vector3::ZERO;
+			tri_force[t*3+2]=Vector3::ZERO;
+
+			const Vector3 &a=vpos[k*3+0];
+			const Vector3 &b=vpos[k*3+1];
+			const Vector3 &c=vpos[k*3+2];
+			if (a.y>vwh[k*3+0] && b.y>vwh[k*3+1] && c.y>vwh[k*3+2]) continue;
+
+			Vector3 pts[7];
+			pts[0]=a;
+			pts[1]=b;
+			pts[2]=c;
+			pts[3]=(a+b+c)/3.0f; //center
+			//suboptimal
+			pts[4]=(a+b)/2.0f;
+			pts[5]=(b+c)/2.0f;
+			pts[6]=(c+a)/2.0f;
+			tvel[k]=(nodes[tri_a[t]].Velocity+nodes[tri_b[t]].Velocity+nodes[tri_c[t]].Velocity)/3.0f;
+
+			for (int s=0; s<6; s++)
 			{
-				float fxl=vell*cosaoa*surf;
-				if (fxl>1.5) //if enough pushing drag
-				{
-					Vector3 fxdir=fxl*normal;
-					if (fxdir.y<0) fxdir.y=-fxdir.y;
-					if (gEnv->terrainManager->getWater()->getHeightWaves(a)-a.y<0.1) splashp->malloc(a, fxdir);
-					else if (gEnv->terrainManager->getWater()->getHeightWaves(b)-b.y<0.1) splashp->malloc(b, fxdir);
-					else if (gEnv->terrainManager->getWater()->getHeightWaves(c)-c.y<0.1) splashp->malloc(c, fxdir);
-				}
+				spos[subs*3+0]=pts[sub_vertices[s][0]];
+				spos[subs*3+1]=pts[sub_vertices[s][1]];
+				spos[subs*3+2]=pts[sub_vertices[s][2]];
+				scenter[subs]=(spos[subs*3+0]+spos[subs*3+1]+spos[subs*3+2])/3.0f;
+				sslot[subs]=t*3+s/2;
+				stri[subs]=k;
+				subs++;
 			}
 		}
+		if (!subs) continue;
+
+		//water level at the sub triangle centers, used to clip them
+		water->getHeightWavesBatch(scenter, swh, subs);
+
+		pieces.count=0;
+		for (int s=0; s<subs; s++)
+		{
+			clipTriangle(spos[s*3+0], spos[s*3+1], spos[s*3+2], swh[s], tvel[stri[s]], tri_type[sslot[s]/3], sslot[s], pieces);
+		}
+		computePieceForces(pieces, doupdate);
+	}
+}
+
+void Buoyance::applyTriangleForces(node_t *nodes)
+{
+	//clear forces
+	for (size_t t=0; t<tri_a.size(); t++)
+	{
+		nodes[tri_a[t]].buoyanceForce=Vector3::ZERO;
+		nodes[tri_b[t]].buoyanceForce=Vector3::ZERO;
+		nodes[tri_c[t]].buoyanceForce=Vector3::ZERO;
 	}
-	//okay
-	if (sink) return drg;
-	return vol*normal+drg;
+	//add forces, always in the same order
+	for (size_t t=0; t<tri_a.size(); t++)
+	{
+		nodes[tri_a[t]].buoyanceForce+=tri_force[t*3+0];
+		nodes[tri_b[t]].buoyanceForce+=tri_force[t*3+1];
+		nodes[tri_c[t]].buoyanceForce+=tri_force[t*3+2];
+	}
+}
+
+inline void Buoyance::addPiece(piece_buffer_t &pieces, const Vector3 &a, const Vector3 &b, const Vector3 &c, const Vector3 &vel, int type, int slot)
+{
+	int i=pieces.count++;
+	pieces.pos[i*3+0]=a;
+	pieces.pos[i*3+1]=b;
+	pieces.pos[i*3+2]=c;
+	pieces.center[i]=(a+b+c)/3.0f;
+	pieces.vel[i]=vel;
+	pieces.type[i]=type;
+	pieces.slot[i]=slot;
 }
 
-//compute pressure and drag forces on a random triangle
-Vector3 Buoyance::computePressureForce(Vector3 a, Vector3 b, Vector3 c, Vector3 vel, int type)
+void Buoyance::clipTriangle(Vector3 a, Vector3 b, Vector3 c, float wha, const Vector3 &vel, int type, int slot, piece_buffer_t &pieces)
 {
-	float wha=gEnv->terrainManager->getWater()->getHeightWaves((a+b+c)/3.0);
 	//check if fully emerged
-	if (a.y>wha && b.y>wha && c.y>wha) return Vector3::ZERO;
+	if (a.y>wha && b.y>wha && c.y>wha) return;
 	//check if semi emerged
 	if (a.y>wha || b.y>wha || c.y>wha)
 	{
@@ -116,70 +176,189 @@ Vector3 Buoyance::computePressureForce(Vector3 a, Vector3 b, Vector3 c, Vector3
 		//one dip
 		if (a.y<wha && b.y>wha && c.y>wha)
 		{
-			return computePressureForceSub(a,a+(wha-a.y)/(b.y-a.y)*(b-a),a+(wha-a.y)/(c.y-a.y)*(c-a), vel, type);
+			addPiece(pieces, a, a+(wha-a.y)/(b.y-a.y)*(b-a), a+(wha-a.y)/(c.y-a.y)*(c-a), vel, type, slot);
 		}
-		if (b.y<wha && c.y>wha && a.y>wha)
+		else if (b.y<wha && c.y>wha && a.y>wha)
 		{
-			return computePressureForceSub(b,b+(wha-b.y)/(c.y-b.y)*(c-b),b+(wha-b.y)/(a.y-b.y)*(a-b), vel, type);
+			addPiece(pieces, b, b+(wha-b.y)/(c.y-b.y)*(c-b), b+(wha-b.y)/(a.y-b.y)*(a-b), vel, type, slot);
 		}
-		if (c.y<wha && a.y>wha && b.y>wha)
+		else if (c.y<wha && a.y>wha && b.y>wha)
 		{
-			return computePressureForceSub(c,c+(wha-c.y)/(a.y-c.y)*(a-c),c+(wha-c.y)/(b.y-c.y)*(b-c), vel, type);
+			addPiece(pieces, c, c+(wha-c.y)/(a.y-c.y)*(a-c), c+(wha-c.y)/(b.y-c.y)*(b-c), vel, type, slot);
 		}
 		//two dips
-		if (a.y>wha && b.y<wha && c.y<wha)
+		else if (a.y>wha && b.y<wha && c.y<wha)
 		{
 			Vector3 tb=a+(wha-a.y)/(b.y-a.y)*(b-a);
 			Vector3 tc=a+(wha-a.y)/(c.y-a.y)*(c-a);
-			Vector3 f=computePressureForceSub(tb, b, tc, vel, type);
-			return f+computePressureForceSub(tc, b, c, vel, type);
+			addPiece(pieces, tb, b, tc, vel, type, slot);
+			addPiece(pieces, tc, b, c, vel, type, slot);
 		}
-		if (b.y>wha && c.y<wha && a.y<wha)
+		else if (b.y>wha && c.y<wha && a.y<wha)
 		{
 			Vector3 tc=b+(wha-b.y)/(c.y-b.y)*(c-b);
 			Vector3 ta=b+(wha-b.y)/(a.y-b.y)*(a-b);
-			Vector3 f=computePressureForceSub(tc, c, ta, vel, type);
-			return f+computePressureForceSub(ta, c, a, vel, type);
+			addPiece(pieces, tc, c, ta, vel, type, slot);
+			addPiece(pieces, ta, c, a, vel, type, slot);
 		}
-		if (c.y>wha && a.y<wha && b.y<wha)
+		else if (c.y>wha && a.y<wha && b.y<wha)
 		{
 			Vector3 ta=c+(wha-c.y)/(a.y-c.y)*(a-c);
 			Vector3 tb=c+(wha-c.y)/(b.y-c.y)*(b-c);
-			Vector3 f=computePressureForceSub(ta, a, tb, vel, type);
-			return f+computePressureForceSub(tb, a, b, vel, type);
+			addPiece(pieces, ta, a, tb, vel, type, slot);
+			addPiece(pieces, tb, a, b, vel, type, slot);
 		}
-		return Vector3::ZERO;
 	}
 	else
 	{
 		//fully submerged case
-		return computePressureForceSub(a,b,c,vel, type);
+		addPiece(pieces, a, b, c, vel, type, slot);
 	}
 }
-void Buoyance::computeNodeForce(node_t *a, node_t *b, node_t *c, int doupdate, int type)
+
+//compute pressure and drag force on the submerged pieces
+//the pressure force is the weight of the water prism above the piece (9810 N/m^3): surface * mean depth * 9810
+//the drag is 500 * surface * speed^2 * cos(angle of attack), against the normal component of the relative speed
+void Buoyance::computePieceForces(piece_buffer_t &pieces, int doupdate)
 {
-	if (a->AbsPosition.y>gEnv->terrainManager->getWater()->getHeightWaves(a->AbsPosition) && b->AbsPosition.y>gEnv->terrainManager->getWater()->getHeightWaves(b->AbsPosition) && c->AbsPosition.y>gEnv->terrainManager->getWater()->getHeightWaves(c->AbsPosition)) return;
-	//compute center
-	Vector3 m=(a->AbsPosition+b->AbsPosition+c->AbsPosition)/3.0;
-	//compute projected points
-	/*
-	Vector3 tmp=b->Position-a->Position;
-	Vector3 mab=(tmp.dotProduct(m-a->Position)/tmp.squaredLength())*tmp;
-	tmp=c->Position-b->Position;
-	Vector3 mbc=(tmp.dotProduct(m-b->Position)/tmp.squaredLength())*tmp;
-	tmp=a->Position-c->Position;
-	Vector3 mca=(tmp.dotProduct(m-c->Position)/tmp.squaredLength())*tmp;
-	*/
-	//suboptimal
-	Vector3 mab=(a->AbsPosition+b->AbsPosition)/2.0;
-	Vector3 mbc=(b->AbsPosition+c->AbsPosition)/2.0;
-	Vector3 mca=(c->AbsPosition+a->AbsPosition)/2.0;
-	Vector3 vel=(a->Velocity+b->Velocity+c->Velocity)/3.0;
-	//apply forces
-	update=doupdate;
-	a->buoyanceForce+=computePressureForce(a->AbsPosition, mab, m, vel, type)+computePressureForce(a->AbsPosition, m, mca, vel, type);
-	b->buoyanceForce+=computePressureForce(b->AbsPosition, mbc, m, vel, type)+computePressureForce(b->AbsPosition, m, mab, vel, type);
-	c->buoyanceForce+=computePressureForce(c->AbsPosition, mca, m, vel, type)+computePressureForce(c->AbsPosition, m, mbc, vel, type);
+	if (!pieces.count) return;
+
+	IWater *water=gEnv->terrainManager->getWater();
+
+	float wh[MAX_PIECES * 3];
+	Vector3 wvel[MAX_PIECES];
+	Vector3 normal[MAX_PIECES];
+	float force[MAX_PIECES]; //along the normal
+	float fxl[MAX_PIECES];   //splash strength
+
+	water->getHeightWavesBatch(pieces.pos, wh, pieces.count*3);
+	//take in account the wave speed
+	water->getVelocityBatch(pieces.center, wvel, pieces.count);
+
+	float pressure_scale=sink?0.0f:1.0f;
+
+#ifdef ROR_USE_SSE2
+	for (int i=0; i<pieces.count; i+=4)
+	{
+		int n=std::min(4, pieces.count-i);
+
+		// gather four pieces, padding with the last one
+		float ax[4], ay[4], az[4], bx[4], by[4], bz[4], cx[4], cy[4], cz[4];
+		float da[4], db[4], dc[4], vx[4], vy[4], vz[4], pf[4], df[4];
+		for (int k=0; k<4; k++)
+		{
+			int p=i+std::min(k, n-1);
+			const Vector3 &a=pieces.pos[p*3+0];
+			const Vector3 &b=pieces.pos[p*3+1];
+			const Vector3 &c=pieces.pos[p*3+2];
+			Vector3 v=pieces.vel[p]-wvel[p];
+			ax[k]=a.x; ay[k]=a.y; az[k]=a.z;
+			bx[k]=b.x; by[k]=b.y; bz[k]=b.z;
+			cx[k]=c.x; cy[k]=c.y; cz[k]=c.z;
+			da[k]=wh[p*3+0]-a.y;
+			db[k]=wh[p*3+1]-b.y;
+			dc[k]=wh[p*3+2]-c.y;
+			vx[k]=v.x; vy[k]=v.y; vz[k]=v.z;
+			pf[k]=(pieces.type[p]!=BUOY_DRAGONLY)?pressure_scale:0.0f;
+			df[k]=(pieces.type[p]!=BUOY_DRAGLESS)?1.0f:0.0f;
+		}
+
+		//compute normal vector
+		__m128 ax4=_mm_loadu_ps(ax), ay4=_mm_loadu_ps(ay), az4=_mm_loadu_ps(az);
+		__m128 e1x=_mm_sub_ps(_mm_loadu_ps(bx), ax4), e1y=_mm_sub_ps(_mm_loadu_ps(by), ay4), e1z=_mm_sub_ps(_mm_loadu_ps(bz), az4);
+		__m128 e2x=_mm_sub_ps(_mm_loadu_ps(cx), ax4), e2y=_mm_sub_ps(_mm_loadu_ps(cy), ay4), e2z=_mm_sub_ps(_mm_loadu_ps(cz), az4);
+		__m128 nx=_mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+		__m128 ny=_mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+		__m128 nz=_mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+		__m128 len=_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+		//degenerated pieces get a null normal, and thus no force
+		__m128 inv=_mm_and_ps(_mm_cmpge_ps(len, _mm_set1_ps(0.00001f)), _mm_div_ps(_mm_set1_ps(1.0f), len));
+		nx=_mm_mul_ps(nx, inv);
+		ny=_mm_mul_ps(ny, inv);
+		nz=_mm_mul_ps(nz, inv);
+		__m128 surf=_mm_mul_ps(len, _mm_set1_ps(0.5f));
+
+		//pressure
+		__m128 depth=_mm_add_ps(_mm_add_ps(_mm_loadu_ps(da), _mm_loadu_ps(db)), _mm_loadu_ps(dc));
+		__m128 f=_mm_mul_ps(_mm_mul_ps(surf, depth), _mm_mul_ps(_mm_loadu_ps(pf), _mm_set1_ps(-9810.0f/3.0f)));
+
+		//drag
+		__m128 vx4=_mm_loadu_ps(vx), vy4=_mm_loadu_ps(vy), vz4=_mm_loadu_ps(vz);
+		__m128 vell=_mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx4, vx4), _mm_mul_ps(vy4, vy4)), _mm_mul_ps(vz4, vz4)));
+		__m128 d=_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, vx4), _mm_mul_ps(ny, vy4)), _mm_mul_ps(nz, vz4));
+		__m128 moving=_mm_cmpgt_ps(vell, _mm_set1_ps(0.01f));
+		__m128 surfd=_mm_and_ps(moving, _mm_mul_ps(surf, _mm_loadu_ps(df)));
+		f=_mm_add_ps(f, _mm_mul_ps(_mm_mul_ps(surfd, _mm_set1_ps(-500.0f)), _mm_mul_ps(vell, d)));
+		__m128 absd=_mm_andnot_ps(_mm_set1_ps(-0.0f), d);
+
+		float outf[4], outl[4], outx[4], outy[4], outz[4];
+		_mm_storeu_ps(outf, f);
+		_mm_storeu_ps(outl, _mm_mul_ps(surfd, absd));
+		_mm_storeu_ps(outx, nx);
+		_mm_storeu_ps(outy, ny);
+		_mm_storeu_ps(outz, nz);
+		for (int k=0; k<n; k++)
+		{
+			force[i+k]=outf[k];
+			fxl[i+k]=outl[k];
+			normal[i+k]=Vector3(outx[k], outy[k], outz[k]);
+		}
+	}
+#else
+	for (int i=0; i<pieces.count; i++)
+	{
+		const Vector3 &a=pieces.pos[i*3+0];
+		const Vector3 &b=pieces.pos[i*3+1];
+		const Vector3 &c=pieces.pos[i*3+2];
+		force[i]=0.0f;
+		fxl[i]=0.0f;
+
+		//compute normal vector
+		normal[i]=(b-a).crossProduct(c-a);
+		float surf=normal[i].length();
+		if (surf<0.00001)
+		{
+			normal[i]=Vector3::ZERO;
+			continue;
+		}
+		normal[i]=normal[i]/surf; //normalize
+		surf=surf/2.0; //surface
+
+		if (pieces.type[i]!=BUOY_DRAGONLY)
+		{
+			float depth=(wh[i*3+0]-a.y)+(wh[i*3+1]-b.y)+(wh[i*3+2]-c.y);
+			force[i]-=pressure_scale*surf*depth*9810.0f/3.0f;
+		}
+		if (pieces.type[i]!=BUOY_DRAGLESS)
+		{
+			Vector3 vel=pieces.vel[i]-wvel[i];
+			float vell=vel.length();
+			if (vell>0.01)
+			{
+				float d=normal[i].dotProduct(vel);
+				force[i]-=500.0f*surf*vell*d;
+				fxl[i]=fabs(d)*surf;
+			}
+		}
+	}
+#endif // ROR_USE_SSE2
+
+	for (int i=0; i<pieces.count; i++)
+	{
+		tri_force[pieces.slot[i]]+=force[i]*normal[i];
+
+		if (doupdate && splashp && fxl[i]>1.5) //if enough pushing drag
+		{
+			Vector3 fxdir=fxl[i]*normal[i];
+			if (fxdir.y<0) fxdir.y=-fxdir.y;
+			const Vector3 &a=pieces.pos[i*3+0];
+			const Vector3 &b=pieces.pos[i*3+1];
+			const Vector3 &c=pieces.pos[i*3+2];
+			if (wh[i*3+0]-a.y<0.1) splashp->malloc(a, fxdir);
+			else if (wh[i*3+1]-b.y<0.1) splashp->malloc(b, fxdir);
+			else if (wh[i*3+2]-c.y<0.1) splashp->malloc(c, fxdir);
+		}
+	}
 }
 
 void Buoyance::setsink(int v)
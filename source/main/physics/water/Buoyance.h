@@ -29,16 +29,26 @@ public:
 	Buoyance();
 	~Buoyance();
 
-	//compute tetrahedron volume
-	inline float computeVolume(Ogre::Vector3 o, Ogre::Vector3 a, Ogre::Vector3 b, Ogre::Vector3 c);
+	/**
+	* Builds the flat list of buoyant cab triangles, called once at spawn.
+	* @param cabs Node indices, three per cab
+	* @param buoycabs Indices of the buoyant cabs
+	* @param buoycabtypes BUOY_* type of every buoyant cab
+	*/
+	void setupTriangles(const int *cabs, const int *buoycabs, const int *buoycabtypes, int free_buoycab);
 
-	//compute pressure and drag force on a submerged triangle
-	Ogre::Vector3 computePressureForceSub(Ogre::Vector3 a, Ogre::Vector3 b, Ogre::Vector3 c, Ogre::Vector3 vel, int type);
-	
-	//compute pressure and drag forces on a random triangle
-	Ogre::Vector3 computePressureForce(Ogre::Vector3 a, Ogre::Vector3 b, Ogre::Vector3 c, Ogre::Vector3 vel, int type);
-	
-	void computeNodeForce(node_t *a, node_t *b, node_t *c, int doupdate, int type);
+	int getTriangleCount() { return (int)tri_a.size(); };
+
+	/**
+	* TIGHT LOOP; Physics; computes the forces of the triangles [begin, end).
+	* Every triangle only writes its own force slots, so disjoint ranges can run in parallel.
+	*/
+	void computeTriangleForces(node_t *nodes, int begin, int end, int doupdate);
+
+	/**
+	* Replaces node_t::buoyanceForce of all triangle nodes with the sum of the forces computed by computeTriangleForces()
+	*/
+	void applyTriangleForces(node_t *nodes);
 
 	void setsink(int v);
 
@@ -46,9 +56,37 @@ public:
 
 private:
 
+	enum {
+		BLOCK_TRIANGLES = 16,                         //!< triangles processed per batch of water queries
+		MAX_PIECES      = BLOCK_TRIANGLES * 6 * 2     //!< 6 sub triangles per triangle, clipped into at most 2 pieces each
+	};
+
+	// submerged pieces of triangles, waiting for the pressure/drag kernel
+	struct piece_buffer_t
+	{
+		Ogre::Vector3 pos[MAX_PIECES * 3]; //!< vertices a, b, c of every piece
+		Ogre::Vector3 center[MAX_PIECES];
+		Ogre::Vector3 vel[MAX_PIECES];     //!< velocity of the triangle the piece belongs to
+		int type[MAX_PIECES];
+		int slot[MAX_PIECES];              //!< index into tri_force
+		int count;
+	};
+
+	inline void addPiece(piece_buffer_t &pieces, const Ogre::Vector3 &a, const Ogre::Vector3 &b, const Ogre::Vector3 &c, const Ogre::Vector3 &vel, int type, int slot);
+
+	// cuts the part of the triangle above the water level 'wh' away and adds the rest to 'pieces'
+	void clipTriangle(Ogre::Vector3 a, Ogre::Vector3 b, Ogre::Vector3 c, float wh, const Ogre::Vector3 &vel, int type, int slot, piece_buffer_t &pieces);
+
+	// pressure and drag forces of all pieces, added to tri_force
+	void computePieceForces(piece_buffer_t &pieces, int doupdate);
+
 	DustPool *splashp, *ripplep;
 	int sink;
-	int update;
+
+	// structure of arrays, one entry per buoyant triangle
+	std::vector<int> tri_a, tri_b, tri_c; //!< node indices
+	std::vector<int> tri_type;
+	std::vector<Ogre::Vector3> tri_force; //!< three per triangle, force on node a, b and c
 };
 
 #endif // __Buoyance_H_
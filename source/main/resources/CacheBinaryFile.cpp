@@ -0,0 +1,434 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** 
+	@file   CacheBinaryFile.cpp
+*/
+
+#include "CacheBinaryFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const char     MAGIC_NUMBER[8]   = {'R', 'o', 'R', 'M', 'o', 'd', 'C', '\0'};
+static const uint32_t ENDIANNESS_MARKER = 0x01020304;
+
+// ================================================================================
+// Writer
+// ================================================================================
+
+CacheBinaryFile::Writer::Writer(Ogre::String const & shaone)
+{
+	m_shaone = AddString(shaone);
+}
+
+CacheBinaryFile::StringRef CacheBinaryFile::Writer::AddString(Ogre::String const & str)
+{
+	auto found = m_string_index.find(str);
+	if (found != m_string_index.end())
+	{
+		return found->second;
+	}
+	StringRef ref;
+	ref.offset = static_cast<uint32_t>(m_string_table.size());
+	ref.length = static_cast<uint32_t>(str.size());
+	m_string_table.append(str);
+	m_string_index.insert(std::make_pair(str, ref));
+	return ref;
+}
+
+void CacheBinaryFile::Writer::AddEntry(CacheEntry const & t)
+{
+	Record r;
+	memset(&r, 0, sizeof(Record)); // Padding bytes, keeps the output deterministic.
+
+	r.filetime                   = static_cast<int64_t>(t.filetime);
+
+	r.minitype                   = AddString(t.minitype);
+	r.fname                      = AddString(t.fname);
+	r.fname_without_uid          = AddString(t.fname_without_uid);
+	r.dname                      = AddString(t.dname);
+	r.uniqueid                   = AddString(t.uniqueid);
+	r.guid                       = AddString(t.guid);
+	r.fext                       = AddString(t.fext);
+	r.type                       = AddString(t.type);
+	r.dirname                    = AddString(t.dirname);
+	r.hash                       = AddString(t.hash);
+	r.filecachename              = AddString(t.filecachename);
+	r.description                = AddString(t.description);
+	r.tags                       = AddString(t.tags);
+
+	r.authors.first = static_cast<uint32_t>(m_authors.size());
+	r.authors.count = static_cast<uint32_t>(t.authors.size());
+	for (auto itor = t.authors.begin(); itor != t.authors.end(); ++itor)
+	{
+		AuthorRecord author;
+		memset(&author, 0, sizeof(AuthorRecord));
+		author.id    = itor->id;
+		author.type  = AddString(itor->type);
+		author.name  = AddString(itor->name);
+		author.email = AddString(itor->email);
+		m_authors.push_back(author);
+	}
+
+	r.sectionconfigs.first = static_cast<uint32_t>(m_list_strings.size());
+	r.sectionconfigs.count = static_cast<uint32_t>(t.sectionconfigs.size());
+	for (auto itor = t.sectionconfigs.begin(); itor != t.sectionconfigs.end(); ++itor)
+	{
+		m_list_strings.push_back(AddString(*itor));
+	}
+
+	r.materials.first = static_cast<uint32_t>(m_list_strings.size());
+	r.materials.count = static_cast<uint32_t>(t.materials.size());
+	for (auto itor = t.materials.begin(); itor != t.materials.end(); ++itor)
+	{
+		m_list_strings.push_back(AddString(*itor));
+	}
+
+	r.number                     = t.number;
+	r.categoryid                 = t.categoryid;
+	r.addtimestamp               = t.addtimestamp;
+	r.version                    = t.version;
+	r.usagecounter               = t.usagecounter;
+	r.fileformatversion          = t.fileformatversion;
+	r.nodecount                  = t.nodecount;
+	r.beamcount                  = t.beamcount;
+	r.shockcount                 = t.shockcount;
+	r.fixescount                 = t.fixescount;
+	r.hydroscount                = t.hydroscount;
+	r.wheelcount                 = t.wheelcount;
+	r.propwheelcount             = t.propwheelcount;
+	r.commandscount              = t.commandscount;
+	r.flarescount                = t.flarescount;
+	r.propscount                 = t.propscount;
+	r.wingscount                 = t.wingscount;
+	r.turbopropscount            = t.turbopropscount;
+	r.turbojetcount              = t.turbojetcount;
+	r.rotatorscount              = t.rotatorscount;
+	r.exhaustscount              = t.exhaustscount;
+	r.flexbodiescount            = t.flexbodiescount;
+	r.materialflarebindingscount = t.materialflarebindingscount;
+	r.soundsourcescount          = t.soundsourcescount;
+	r.managedmaterialscount      = t.managedmaterialscount;
+	r.driveable                  = t.driveable;
+	r.numgears                   = t.numgears;
+	r.enginetype                 = t.enginetype;
+
+	r.truckmass                  = t.truckmass;
+	r.loadmass                   = t.loadmass;
+	r.minrpm                     = t.minrpm;
+	r.maxrpm                     = t.maxrpm;
+	r.torque                     = t.torque;
+
+	r.flags = 0;
+	if (t.hasSubmeshs)      { r.flags |= Record::FLAG_HAS_SUBMESHS; }
+	if (t.customtach)       { r.flags |= Record::FLAG_CUSTOM_TACH; }
+	if (t.custom_particles) { r.flags |= Record::FLAG_CUSTOM_PARTICLES; }
+	if (t.forwardcommands)  { r.flags |= Record::FLAG_FORWARD_COMMANDS; }
+	if (t.importcommands)   { r.flags |= Record::FLAG_IMPORT_COMMANDS; }
+	if (t.rollon)           { r.flags |= Record::FLAG_ROLLON; }
+	if (t.rescuer)          { r.flags |= Record::FLAG_RESCUER; }
+
+	m_records.push_back(r);
+}
+
+void CacheBinaryFile::Writer::AddFingerprint(ArchiveFingerprint const & fingerprint)
+{
+	FingerprintRecord r;
+	memset(&r, 0, sizeof(FingerprintRecord));
+	r.size   = fingerprint.size;
+	r.mtime  = static_cast<int64_t>(fingerprint.mtime);
+	r.path   = AddString(fingerprint.path);
+	r.hash   = AddString(fingerprint.hash);
+	r.is_zip = fingerprint.is_zip ? 1 : 0;
+	m_fingerprints.push_back(r);
+}
+
+bool CacheBinaryFile::Writer::WriteToFile(Ogre::String const & path)
+{
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	memcpy(header.magic, MAGIC_NUMBER, sizeof(MAGIC_NUMBER));
+	header.format_version     = FORMAT_VERSION;
+	header.endianness_marker  = ENDIANNESS_MARKER;
+	header.header_size        = sizeof(Header);
+	header.record_size        = sizeof(Record);
+	header.author_record_size = sizeof(AuthorRecord);
+	header.fingerprint_record_size = sizeof(FingerprintRecord);
+	header.num_entries        = static_cast<uint32_t>(m_records.size());
+	header.num_fingerprints   = static_cast<uint32_t>(m_fingerprints.size());
+	header.num_authors        = static_cast<uint32_t>(m_authors.size());
+	header.num_list_strings   = static_cast<uint32_t>(m_list_strings.size());
+	header.string_table_size  = static_cast<uint32_t>(m_string_table.size());
+	header.shaone             = m_shaone;
+
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f == nullptr)
+	{
+		return false;
+	}
+	bool ok = (fwrite(&header, sizeof(Header), 1, f) == 1);
+	if (ok && ! m_records.empty())
+	{
+		ok = (fwrite(&m_records[0], sizeof(Record), m_records.size(), f) == m_records.size());
+	}
+	if (ok && ! m_fingerprints.empty())
+	{
+		ok = (fwrite(&m_fingerprints[0], sizeof(FingerprintRecord), m_fingerprints.size(), f) == m_fingerprints.size());
+	}
+	if (ok && ! m_authors.empty())
+	{
+		ok = (fwrite(&m_authors[0], sizeof(AuthorRecord), m_authors.size(), f) == m_authors.size());
+	}
+	if (ok && ! m_list_strings.empty())
+	{
+		ok = (fwrite(&m_list_strings[0], sizeof(StringRef), m_list_strings.size(), f) == m_list_strings.size());
+	}
+	if (ok && ! m_string_table.empty())
+	{
+		ok = (fwrite(m_string_table.data(), 1, m_string_table.size(), f) == m_string_table.size());
+	}
+	ok = (fclose(f) == 0) && ok;
+	if (! ok)
+	{
+		remove(path.c_str()); // Never leave a truncated file behind.
+	}
+	return ok;
+}
+
+// ================================================================================
+// Reader
+// ================================================================================
+
+CacheBinaryFile::Reader::Reader():
+	m_header(nullptr),
+	m_records(nullptr),
+	m_fingerprints(nullptr),
+	m_authors(nullptr),
+	m_list_strings(nullptr),
+	m_string_table(nullptr)
+{}
+
+bool CacheBinaryFile::Reader::Open(Ogre::String const & path)
+{
+	m_header = nullptr;
+	if (! m_file.Open(path) || m_file.GetSize() < sizeof(Header))
+	{
+		return false;
+	}
+	const char* data = m_file.GetData();
+	const Header* header = reinterpret_cast<const Header*>(data);
+	if (memcmp(header->magic, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0
+		|| header->format_version     != FORMAT_VERSION
+		|| header->endianness_marker  != ENDIANNESS_MARKER
+		|| header->header_size        != sizeof(Header)
+		|| header->record_size        != sizeof(Record)
+		|| header->author_record_size != sizeof(AuthorRecord)
+		|| header->fingerprint_record_size != sizeof(FingerprintRecord))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	// 64-bit sums; the counts come from the file and can't be trusted
+	uint64_t records_offset      = sizeof(Header);
+	uint64_t fingerprints_offset = records_offset + uint64_t(header->num_entries) * sizeof(Record);
+	uint64_t authors_offset      = fingerprints_offset + uint64_t(header->num_fingerprints) * sizeof(FingerprintRecord);
+	uint64_t list_strings_offset = authors_offset + uint64_t(header->num_authors) * sizeof(AuthorRecord);
+	uint64_t string_table_offset = list_strings_offset + uint64_t(header->num_list_strings) * sizeof(StringRef);
+	uint64_t total_size          = string_table_offset + header->string_table_size;
+	if (total_size != m_file.GetSize())
+	{
+		m_file.Close();
+		return false;
+	}
+
+	m_header       = header;
+	m_records      = reinterpret_cast<const Record*>      (data + records_offset);
+	m_fingerprints = reinterpret_cast<const FingerprintRecord*>(data + fingerprints_offset);
+	m_authors      = reinterpret_cast<const AuthorRecord*>(data + authors_offset);
+	m_list_strings = reinterpret_cast<const StringRef*>   (data + list_strings_offset);
+	m_string_table = data + string_table_offset;
+	return true;
+}
+
+Ogre::String CacheBinaryFile::Reader::GetSHA1() const
+{
+	Ogre::String shaone;
+	if (m_header != nullptr)
+	{
+		ReadString(m_header->shaone, shaone);
+	}
+	return shaone;
+}
+
+unsigned int CacheBinaryFile::Reader::GetNumEntries() const
+{
+	return (m_header != nullptr) ? m_header->num_entries : 0;
+}
+
+unsigned int CacheBinaryFile::Reader::GetNumFingerprints() const
+{
+	return (m_header != nullptr) ? m_header->num_fingerprints : 0;
+}
+
+bool CacheBinaryFile::Reader::ReadFingerprint(unsigned int index, ArchiveFingerprint & fingerprint) const
+{
+	if (m_header == nullptr || index >= m_header->num_fingerprints)
+	{
+		return false;
+	}
+	FingerprintRecord const & r = m_fingerprints[index];
+	if (! ReadString(r.path, fingerprint.path) || ! ReadString(r.hash, fingerprint.hash))
+	{
+		return false;
+	}
+	fingerprint.group  = "";
+	fingerprint.is_zip = (r.is_zip != 0);
+	fingerprint.size   = r.size;
+	fingerprint.mtime  = static_cast<std::time_t>(r.mtime);
+	return true;
+}
+
+bool CacheBinaryFile::Reader::ReadString(StringRef const & ref, Ogre::String & out) const
+{
+	if (uint64_t(ref.offset) + ref.length > m_header->string_table_size)
+	{
+		return false;
+	}
+	out.assign(m_string_table + ref.offset, ref.length);
+	return true;
+}
+
+bool CacheBinaryFile::Reader::IsListValid(ListRef const & list, uint32_t list_size) const
+{
+	return uint64_t(list.first) + list.count <= list_size;
+}
+
+bool CacheBinaryFile::Reader::ReadEntry(unsigned int index, CacheEntry & t) const
+{
+	if (m_header == nullptr || index >= m_header->num_entries)
+	{
+		return false;
+	}
+	Record const & r = m_records[index];
+
+	bool ok = ReadString(r.minitype,          t.minitype)
+		&& ReadString(r.fname,                t.fname)
+		&& ReadString(r.fname_without_uid,    t.fname_without_uid)
+		&& ReadString(r.dname,                t.dname)
+		&& ReadString(r.uniqueid,             t.uniqueid)
+		&& ReadString(r.guid,                 t.guid)
+		&& ReadString(r.fext,                 t.fext)
+		&& ReadString(r.type,                 t.type)
+		&& ReadString(r.dirname,              t.dirname)
+		&& ReadString(r.hash,                 t.hash)
+		&& ReadString(r.filecachename,        t.filecachename)
+		&& ReadString(r.description,          t.description)
+		&& ReadString(r.tags,                 t.tags)
+		&& IsListValid(r.authors,             m_header->num_authors)
+		&& IsListValid(r.sectionconfigs,      m_header->num_list_strings)
+		&& IsListValid(r.materials,           m_header->num_list_strings);
+	if (! ok)
+	{
+		return false;
+	}
+
+	t.authors.resize(r.authors.count);
+	for (uint32_t i = 0; i < r.authors.count; ++i)
+	{
+		AuthorRecord const & author = m_authors[r.authors.first + i];
+		t.authors[i].id = author.id;
+		if (! ReadString(author.type, t.authors[i].type) || ! ReadString(author.name, t.authors[i].name) || ! ReadString(author.email, t.authors[i].email))
+		{
+			return false;
+		}
+	}
+
+	t.sectionconfigs.resize(r.sectionconfigs.count);
+	for (uint32_t i = 0; i < r.sectionconfigs.count; ++i)
+	{
+		if (! ReadString(m_list_strings[r.sectionconfigs.first + i], t.sectionconfigs[i]))
+		{
+			return false;
+		}
+	}
+
+	t.materials.clear();
+	Ogre::String material;
+	for (uint32_t i = 0; i < r.materials.count; ++i)
+	{
+		if (! ReadString(m_list_strings[r.materials.first + i], material))
+		{
+			return false;
+		}
+		t.materials.insert(t.materials.end(), material); // Written in order, insertion is O(1)
+	}
+
+	t.filetime                   = static_cast<std::time_t>(r.filetime);
+	t.number                     = r.number;
+	t.categoryid                 = r.categoryid;
+	t.addtimestamp               = r.addtimestamp;
+	t.version                    = r.version;
+	t.usagecounter               = r.usagecounter;
+	t.fileformatversion          = r.fileformatversion;
+	t.nodecount                  = r.nodecount;
+	t.beamcount                  = r.beamcount;
+	t.shockcount                 = r.shockcount;
+	t.fixescount                 = r.fixescount;
+	t.hydroscount                = r.hydroscount;
+	t.wheelcount                 = r.wheelcount;
+	t.propwheelcount             = r.propwheelcount;
+	t.commandscount              = r.commandscount;
+	t.flarescount                = r.flarescount;
+	t.propscount                 = r.propscount;
+	t.wingscount                 = r.wingscount;
+	t.turbopropscount            = r.turbopropscount;
+	t.turbojetcount              = r.turbojetcount;
+	t.rotatorscount              = r.rotatorscount;
+	t.exhaustscount              = r.exhaustscount;
+	t.flexbodiescount            = r.flexbodiescount;
+	t.materialflarebindingscount = r.materialflarebindingscount;
+	t.soundsourcescount          = r.soundsourcescount;
+	t.managedmaterialscount      = r.managedmaterialscount;
+	t.driveable                  = r.driveable;
+	t.numgears                   = r.numgears;
+	t.enginetype                 = static_cast<char>(r.enginetype);
+
+	t.truckmass                  = r.truckmass;
+	t.loadmass                   = r.loadmass;
+	t.minrpm                     = r.minrpm;
+	t.maxrpm                     = r.maxrpm;
+	t.torque                     = r.torque;
+
+	t.hasSubmeshs                = (r.flags & Record::FLAG_HAS_SUBMESHS) != 0;
+	t.customtach                 = (r.flags & Record::FLAG_CUSTOM_TACH) != 0;
+	t.custom_particles           = (r.flags & Record::FLAG_CUSTOM_PARTICLES) != 0;
+	t.forwardcommands            = (r.flags & Record::FLAG_FORWARD_COMMANDS) != 0;
+	t.importcommands             = (r.flags & Record::FLAG_IMPORT_COMMANDS) != 0;
+	t.rollon                     = (r.flags & Record::FLAG_ROLLON) != 0;
+	t.rescuer                    = (r.flags & Record::FLAG_RESCUER) != 0;
+
+	t.resourceLoaded             = false;
+	t.changedornew               = false;
+	t.deleted                    = false;
+	return true;
+}
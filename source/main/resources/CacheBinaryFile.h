@@ -0,0 +1,249 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** 
+	@file   CacheBinaryFile.h
+	@brief  Binary form of the mod cache, read directly from a memory mapping.
+*/
+
+#pragma once
+
+#include "CacheSystem.h"
+#include "MemoryMappedFile.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+	@class  CacheBinaryFile
+
+	@brief File layout and reader/writer of the binary mod cache.
+
+	LAYOUT:
+		Header
+		Record            [num_entries]       - one fixed-size record per CacheEntry
+		FingerprintRecord [num_fingerprints]  - content archives (zips, directories) as they were when written
+		AuthorRecord      [num_authors]       - referenced by Record::authors
+		StringRef         [num_list_strings]  - items of Record::sectionconfigs and Record::materials
+		char              [string_table_size] - all strings, deduplicated, not zero-terminated
+
+	Nothing needs parsing: Reader maps the file, checks the header and then decodes
+	only the records which are asked for. The data are only valid for the same
+	FORMAT_VERSION and platform (byte order, record sizes); Reader rejects everything else.
+*/
+class CacheBinaryFile
+{
+
+public:
+
+	/** IMPORTANT! Increment whenever the layout or CacheEntry contents change. */
+	static const uint32_t FORMAT_VERSION = 2;
+
+	struct StringRef
+	{
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	struct ListRef
+	{
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct Header
+	{
+		char      magic[8];
+		uint32_t  format_version;
+		uint32_t  endianness_marker;
+		uint32_t  header_size;
+		uint32_t  record_size;
+		uint32_t  author_record_size;
+		uint32_t  fingerprint_record_size;
+		uint32_t  num_entries;
+		uint32_t  num_fingerprints;
+		uint32_t  num_authors;
+		uint32_t  num_list_strings;
+		uint32_t  string_table_size;
+		StringRef shaone;
+		uint32_t  reserved;          ///< Pads the header to 64 bytes; records must stay 8-byte aligned in the mapping.
+	};
+
+	struct Record
+	{
+		enum Flags
+		{
+			FLAG_HAS_SUBMESHS      = 1 << 0,
+			FLAG_CUSTOM_TACH       = 1 << 1,
+			FLAG_CUSTOM_PARTICLES  = 1 << 2,
+			FLAG_FORWARD_COMMANDS  = 1 << 3,
+			FLAG_IMPORT_COMMANDS   = 1 << 4,
+			FLAG_ROLLON            = 1 << 5,
+			FLAG_RESCUER           = 1 << 6
+		};
+
+		int64_t   filetime;
+
+		StringRef minitype;
+		StringRef fname;
+		StringRef fname_without_uid;
+		StringRef dname;
+		StringRef uniqueid;
+		StringRef guid;
+		StringRef fext;
+		StringRef type;
+		StringRef dirname;
+		StringRef hash;
+		StringRef filecachename;
+		StringRef description;
+		StringRef tags;
+
+		ListRef   authors;
+		ListRef   sectionconfigs;
+		ListRef   materials;
+
+		int32_t   number;
+		int32_t   categoryid;
+		int32_t   addtimestamp;
+		int32_t   version;
+		int32_t   usagecounter;
+		int32_t   fileformatversion;
+		int32_t   nodecount;
+		int32_t   beamcount;
+		int32_t   shockcount;
+		int32_t   fixescount;
+		int32_t   hydroscount;
+		int32_t   wheelcount;
+		int32_t   propwheelcount;
+		int32_t   commandscount;
+		int32_t   flarescount;
+		int32_t   propscount;
+		int32_t   wingscount;
+		int32_t   turbopropscount;
+		int32_t   turbojetcount;
+		int32_t   rotatorscount;
+		int32_t   exhaustscount;
+		int32_t   flexbodiescount;
+		int32_t   materialflarebindingscount;
+		int32_t   soundsourcescount;
+		int32_t   managedmaterialscount;
+		int32_t   driveable;
+		int32_t   numgears;
+		int32_t   enginetype;
+
+		float     truckmass;
+		float     loadmass;
+		float     minrpm;
+		float     maxrpm;
+		float     torque;
+
+		uint32_t  flags;
+	};
+
+	struct FingerprintRecord
+	{
+		uint64_t  size;
+		int64_t   mtime;
+		StringRef path;
+		StringRef hash;
+		uint32_t  is_zip;
+		uint32_t  reserved;
+	};
+
+	struct AuthorRecord
+	{
+		int32_t   id;
+		StringRef type;
+		StringRef name;
+		StringRef email;
+	};
+
+	/** Collects entries in memory and writes the whole file at once. */
+	class Writer
+	{
+	public:
+
+		Writer(Ogre::String const & shaone);
+
+		/** Stores the entry as-is, including 'number'. */
+		void AddEntry(CacheEntry const & entry);
+
+		void AddFingerprint(ArchiveFingerprint const & fingerprint);
+
+		/** @return False if the file couldn't be written. */
+		bool WriteToFile(Ogre::String const & path);
+
+	private:
+
+		StringRef AddString(Ogre::String const & str);
+
+		std::vector<Record>                        m_records;
+		std::vector<FingerprintRecord>             m_fingerprints;
+		std::vector<AuthorRecord>                  m_authors;
+		std::vector<StringRef>                     m_list_strings;
+		std::string                                m_string_table;
+		std::unordered_map<std::string, StringRef> m_string_index;
+		StringRef                                  m_shaone;
+	};
+
+	/** Maps the file and decodes entries on request. */
+	class Reader
+	{
+	public:
+
+		Reader();
+
+		/** Maps the file and validates header and section sizes; records are not touched.
+		* @return False if the file is missing or has different version/platform or size.
+		*/
+		bool Open(Ogre::String const & path);
+
+		Ogre::String GetSHA1() const;
+
+		unsigned int GetNumEntries() const;
+
+		/** Decodes a single entry. Flags resourceLoaded, changedornew and deleted are reset.
+		* @return False if the record references data out of bounds (corrupted file).
+		*/
+		bool ReadEntry(unsigned int index, CacheEntry & entry) const;
+
+		unsigned int GetNumFingerprints() const;
+
+		/** @return False if the record references data out of bounds (corrupted file). */
+		bool ReadFingerprint(unsigned int index, ArchiveFingerprint & fingerprint) const;
+
+	private:
+
+		bool ReadString(StringRef const & ref, Ogre::String & out) const;
+
+		bool IsListValid(ListRef const & list, uint32_t list_size) const;
+
+		RoR::MemoryMappedFile m_file;
+		const Header*         m_header;
+		const Record*         m_records;
+		const FingerprintRecord* m_fingerprints;
+		const AuthorRecord*   m_authors;
+		const StringRef*      m_list_strings;
+		const char*           m_string_table;
+	};
+};
@@ -0,0 +1,268 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   CacheSearchIndex.cpp
+*/
+
+#include "CacheSearchIndex.h"
+
+#include "CacheSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+using namespace Ogre;
+
+// Match ranks, lower is better
+static const int RANK_NAME_START    = 0;
+static const int RANK_NAME_WORD     = 1;
+static const int RANK_NAME          = 2;
+static const int RANK_FILE          = 3;
+static const int RANK_AUTHOR        = 4;
+static const int RANK_DESCRIPTION   = 5;
+
+static bool isShorterList(const std::vector<int> *a, const std::vector<int> *b)
+{
+	return a->size() < b->size();
+}
+
+static String toLower(String str)
+{
+	StringUtil::toLowerCase(str);
+	return str;
+}
+
+CacheSearchIndex::CacheSearchIndex()
+{
+}
+
+void CacheSearchIndex::Clear()
+{
+	m_documents.clear();
+	m_trigrams.clear();
+}
+
+void CacheSearchIndex::Build(const std::vector<CacheEntry> &entries)
+{
+	Clear();
+	m_documents.resize(entries.size());
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const CacheEntry &entry = entries[i];
+		Document &doc = m_documents[i];
+
+		doc.name        = toLower(entry.dname);
+		doc.file        = toLower(entry.fname);
+		doc.description = toLower(entry.description);
+		doc.guid        = toLower(entry.guid);
+		doc.hash        = toLower(entry.hash);
+		doc.wheels      = TOSTRING(entry.wheelcount) + "x" + TOSTRING(entry.propwheelcount);
+		for (std::vector<AuthorInfo>::const_iterator it = entry.authors.begin(); it != entry.authors.end(); it++)
+		{
+			doc.authors += toLower(it->name) + "\n" + toLower(it->email) + "\n";
+		}
+
+		AddTrigrams(static_cast<int>(i), doc.name);
+		AddTrigrams(static_cast<int>(i), doc.file);
+		AddTrigrams(static_cast<int>(i), doc.description);
+		AddTrigrams(static_cast<int>(i), doc.authors);
+		AddTrigrams(static_cast<int>(i), doc.guid);
+		AddTrigrams(static_cast<int>(i), doc.hash);
+	}
+}
+
+uint32_t CacheSearchIndex::Trigram(const char *str)
+{
+	return (static_cast<uint32_t>(static_cast<unsigned char>(str[0])) << 16)
+		| (static_cast<uint32_t>(static_cast<unsigned char>(str[1])) << 8)
+		| static_cast<uint32_t>(static_cast<unsigned char>(str[2]));
+}
+
+void CacheSearchIndex::AddTrigrams(int doc_index, String const & text)
+{
+	for (size_t i = 0; i + 3 <= text.size(); i++)
+	{
+		std::vector<int> &postings = m_trigrams[Trigram(text.c_str() + i)];
+		// documents are added in order, so checking the last one is enough to keep the list unique
+		if (postings.empty() || postings.back() != doc_index)
+		{
+			postings.push_back(doc_index);
+		}
+	}
+}
+
+bool CacheSearchIndex::FindCandidates(String const & text, std::vector<int> &out) const
+{
+	if (text.size() < 3)
+	{
+		return false;
+	}
+
+	// collect the posting lists, shortest first
+	std::vector<const std::vector<int> *> lists;
+	for (size_t i = 0; i + 3 <= text.size(); i++)
+	{
+		std::unordered_map<uint32_t, std::vector<int>>::const_iterator found = m_trigrams.find(Trigram(text.c_str() + i));
+		if (found == m_trigrams.end())
+		{
+			out.clear(); // nothing contains this trigram
+			return true;
+		}
+		lists.push_back(&found->second);
+	}
+	std::sort(lists.begin(), lists.end(), isShorterList);
+
+	out = *lists[0];
+	std::vector<int> next;
+	for (size_t i = 1; i < lists.size() && !out.empty(); i++)
+	{
+		if (lists[i] == lists[i - 1])
+			continue; // repeated trigram
+		next.clear();
+		std::set_intersection(out.begin(), out.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+		out.swap(next);
+	}
+	return true;
+}
+
+CacheSearchIndex::Field CacheSearchIndex::ParseQuery(String const & query, String &text)
+{
+	if (query.find(':') == String::npos)
+	{
+		text = query;
+		return FIELD_ALL;
+	}
+
+	// empty parts are skipped, everything after a second colon is ignored
+	StringVector parts = StringUtil::split(query, ":");
+	if (parts.size() < 2)
+	{
+		return FIELD_INVALID;
+	}
+	text = parts[1];
+	String const & field = parts[0];
+
+	if (field == "author")  return FIELD_AUTHOR;
+	if (field == "file")    return FIELD_FILE;
+	if (field == "guid")    return FIELD_GUID;
+	if (field == "hash")    return FIELD_HASH;
+	if (field == "wheels")  return FIELD_WHEELS;
+	return FIELD_INVALID;
+}
+
+int CacheSearchIndex::Match(const Document &doc, Field field, String const & text)
+{
+	switch (field)
+	{
+	case FIELD_ALL:
+		{
+			size_t pos = doc.name.find(text);
+			if (pos == 0)
+				return RANK_NAME_START;
+			if (pos != String::npos)
+			{
+				// the match starts a word somewhere in the name?
+				for (; pos != String::npos; pos = doc.name.find(text, pos + 1))
+				{
+					if (!isalnum(static_cast<unsigned char>(doc.name[pos - 1])))
+						return RANK_NAME_WORD;
+				}
+				return RANK_NAME;
+			}
+			if (doc.file.find(text) != String::npos)
+				return RANK_FILE;
+			if (doc.authors.find(text) != String::npos)
+				return RANK_AUTHOR;
+			if (doc.description.find(text) != String::npos)
+				return RANK_DESCRIPTION;
+			return -1;
+		}
+	case FIELD_AUTHOR:
+		return (doc.authors.find(text) != String::npos) ? 0 : -1;
+	case FIELD_FILE:
+		return (doc.file.find(text) != String::npos) ? 0 : -1;
+	case FIELD_GUID:
+		return (doc.guid.find(text) != String::npos) ? 0 : -1;
+	case FIELD_HASH:
+		return (doc.hash.find(text) != String::npos) ? 0 : -1;
+	case FIELD_WHEELS:
+		return (doc.wheels == text) ? 0 : -1;
+	default:
+		return -1;
+	}
+}
+
+void CacheSearchIndex::Search(String const & query, const std::vector<int> &candidates, std::vector<int> &results) const
+{
+	results.clear();
+
+	String text;
+	Field field = ParseQuery(query, text);
+	if (field == FIELD_INVALID)
+	{
+		return;
+	}
+
+	std::vector<int> indexed;
+	bool use_index = (field != FIELD_WHEELS) && FindCandidates(text, indexed);
+
+	std::vector<std::pair<int, int>> ranked; // rank, entry
+	for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end(); it++)
+	{
+		if (*it < 0 || *it >= static_cast<int>(m_documents.size()))
+			continue;
+		if (use_index && !std::binary_search(indexed.begin(), indexed.end(), *it))
+			continue;
+		int rank = Match(m_documents[*it], field, text);
+		if (rank >= 0)
+		{
+			ranked.push_back(std::make_pair(rank, *it));
+		}
+	}
+	std::sort(ranked.begin(), ranked.end());
+
+	results.reserve(ranked.size());
+	for (std::vector<std::pair<int, int>>::iterator it = ranked.begin(); it != ranked.end(); it++)
+	{
+		results.push_back(it->second);
+	}
+}
+
+bool CacheSearchIndex::IsRefinement(String const & previous, String const & query)
+{
+	if (query.size() < previous.size() || query.compare(0, previous.size(), previous) != 0)
+	{
+		return false;
+	}
+
+	String previous_text, query_text;
+	Field previous_field = ParseQuery(previous, previous_text);
+	Field query_field = ParseQuery(query, query_text);
+
+	// substring matches only get fewer when the text grows; exact matches and field changes don't work that way
+	return previous_field == query_field
+		&& previous_field != FIELD_WHEELS
+		&& previous_field != FIELD_INVALID
+		&& query_text.compare(0, previous_text.size(), previous_text) == 0;
+}
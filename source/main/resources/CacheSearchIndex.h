@@ -0,0 +1,124 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   CacheSearchIndex.h
+	@brief  In-memory text search over the mod cache entries.
+*/
+
+#pragma once
+
+#include "RoRPrerequisites.h"
+
+#include <OgreString.h>
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+	@class  CacheSearchIndex
+
+	@brief Trigram index over the searchable texts of all cache entries.
+
+	Entries are identified by their position in CacheSystem::getEntries().
+	All texts are stored lowercase; a query is first narrowed down to the entries
+	containing all of its trigrams, then each candidate is verified by substring
+	search. Results are therefore the same as with a plain scan, only ranked:
+	matches in the name come first, then file name, authors and description.
+
+	QUERY SYNTAX (same as the selector always had):
+		text          name, file name, description, author names and e-mails
+		author:text   author names and e-mails
+		file:text     file name
+		guid:text     GUID
+		hash:text     archive hash
+		wheels:4x2    exact wheel count x propelled wheel count
+*/
+class CacheSearchIndex
+{
+
+public:
+
+	CacheSearchIndex();
+
+	void Build(const std::vector<CacheEntry> &entries);
+
+	void Clear();
+
+	size_t GetNumEntries() const
+	{
+		return m_documents.size();
+	}
+
+	/**
+	* @param query      Search text, lowercase.
+	* @param candidates Entries to search in (positions in the cache entries).
+	* @param results    [out] Matching candidates, best match first; ties keep the cache order.
+	*/
+	void Search(Ogre::String const & query, const std::vector<int> &candidates, std::vector<int> &results) const;
+
+	/**
+	* Results of 'query' are always a subset of results of 'previous' if this returns true,
+	* so the previous results can be searched instead of everything (user keeps typing).
+	*/
+	static bool IsRefinement(Ogre::String const & previous, Ogre::String const & query);
+
+protected:
+
+	enum Field
+	{
+		FIELD_ALL,
+		FIELD_AUTHOR,
+		FIELD_FILE,
+		FIELD_GUID,
+		FIELD_HASH,
+		FIELD_WHEELS,
+		FIELD_INVALID
+	};
+
+	struct Document
+	{
+		Ogre::String name;
+		Ogre::String file;
+		Ogre::String description;
+		Ogre::String authors;     //!< names and e-mails, separated by newlines
+		Ogre::String guid;
+		Ogre::String hash;
+		Ogre::String wheels;      //!< "<wheelcount>x<propwheelcount>"
+	};
+
+	/** Splits "field:text" queries. */
+	static Field ParseQuery(Ogre::String const & query, Ogre::String &text);
+
+	/** @return Rank of the match (lower is better), -1 if the document doesn't match. */
+	static int Match(const Document &doc, Field field, Ogre::String const & text);
+
+	static uint32_t Trigram(const char *str);
+
+	void AddTrigrams(int doc_index, Ogre::String const & text);
+
+	/** @return False if the text is too short to be looked up. */
+	bool FindCandidates(Ogre::String const & text, std::vector<int> &out) const;
+
+	std::vector<Document>                            m_documents;
+	std::unordered_map<uint32_t, std::vector<int>>   m_trigrams;    //!< trigram -> sorted document indices
+};
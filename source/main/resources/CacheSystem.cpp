@@ -27,10 +27,14 @@
 
 #include "CacheSystem.h"
 
+#include "Application.h"
 #include "BeamData.h"
 #include "BeamEngine.h"
+#include "CacheBinaryFile.h"
+#include "ContentManager.h"
 #include "ErrorUtils.h"
-#include "ImprovedConfigFile.h"
+#include "IndexedZipArchive.h"
+#include "IThreadTask.h"
 #include "Language.h"
 #include "PlatformUtils.h"
 #include "RigDef_Parser.h"
@@ -38,6 +42,7 @@
 #include "SHA1.h"
 #include "SoundScriptManager.h"
 #include "TerrainManager.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 	
 #ifdef USE_MYGUI
@@ -46,6 +51,8 @@
 
 #include <OgreFileSystem.h>
 
+#include <algorithm>
+
 using namespace Ogre;
 
 // default constructor resets the data.
@@ -119,7 +126,19 @@ CacheSystem::CacheSystem() :
 	, deletedFiles(0)
 	, newFiles(0)
 	, rgcounter(0)
-{
+	, search_index_dirty(true)
+	, rescan_thread_running(false)
+	, rescan_done(false)
+	, rescan_time_ms(0)
+	, generation_pool(0)
+	, generation_pool_size(0)
+	, generation_tasks(0)
+	, generation_parse_tasks(0)
+{
+	pthread_mutex_init(&rescan_mutex, NULL);
+	pthread_mutex_init(&generation_mutex, NULL);
+	pthread_cond_init(&generation_cond, NULL);
+
 	// register the extensions
 	known_extensions.push_back("machine");
 	known_extensions.push_back("fixed");
@@ -141,6 +160,14 @@ CacheSystem::CacheSystem() :
 
 CacheSystem::~CacheSystem()
 {
+	if (rescan_thread_running)
+	{
+		pthread_join(rescan_thread, NULL);
+		rescan_thread_running = false;
+	}
+	pthread_mutex_destroy(&rescan_mutex);
+	pthread_mutex_destroy(&generation_mutex);
+	pthread_cond_destroy(&generation_cond);
 }
 
 void CacheSystem::setLocation(String cachepath, String configpath)
@@ -160,36 +187,52 @@ void CacheSystem::Startup(bool force_check)
 	// read valid categories from file
 	readCategoryTitles();
 
-	// calculate sha1 over all the content
-	currentSHA1 = filenamesSHA1();
+	std::vector<FingerprintRoot> roots = getFingerprintRoots();
 
-	CacheValidityState validity = CACHE_STATE_UNKNOWN;
-	if (force_check)
+	// quick start: use the cache right away and check the archives while the menu is shown
+	if (!force_check && BSETTING("Background Cache Rescan", true) && loadCache() && !cached_fingerprints.empty())
 	{
-		validity = CACHE_NEEDS_UPDATE_INCREMENTAL;
+		LOG("* mod cache loaded, checking archives in background");
+		startBackgroundRescan(roots);
 	}
 	else
 	{
-		validity = IsCacheValid();
-	}
-	
-	if (validity != CACHE_VALID)
-	{
-		LOG("cache invalid, updating ...");
-		// generate the cache
-		generateCache(validity == CACHE_NEEDS_UPDATE_FULL);
+		// calculate sha1 over all the content
+		currentSHA1 = filenamesSHA1();
+
+		Ogre::Timer timer;
+		current_fingerprints.clear();
+		scanFingerprints(roots, current_fingerprints);
+		LOG("* " + TOSTRING(current_fingerprints.size()) + " archives checked in " + TOSTRING(timer.getMilliseconds()) + " ms");
 
-		LOG("Cache updated, enumerating all resource groups...");
-		StringVector sv = ResourceGroupManager::getSingleton().getResourceGroups();
-		for(auto itor = sv.begin(); itor != sv.end(); ++itor)
+		CacheValidityState validity = CACHE_STATE_UNKNOWN;
+		if (force_check)
 		{
-			LOG("\t\t" + *itor);
+			validity = CACHE_NEEDS_UPDATE_INCREMENTAL;
+		}
+		else
+		{
+			validity = IsCacheValid();
 		}
-	}
 
-	LOG("loading cache...");
-	// load the cache finally!
-	loadCache();
+		if (validity != CACHE_VALID)
+		{
+			LOG("cache invalid, updating ...");
+			// generate the cache
+			generateCache(validity == CACHE_NEEDS_UPDATE_FULL);
+
+			LOG("Cache updated, enumerating all resource groups...");
+			StringVector sv = ResourceGroupManager::getSingleton().getResourceGroups();
+			for(auto itor = sv.begin(); itor != sv.end(); ++itor)
+			{
+				LOG("\t\t" + *itor);
+			}
+		}
+
+		LOG("loading cache...");
+		// load the cache finally!
+		loadCache();
+	}
 
 	// show error on zero content
 	if (entries.empty())
@@ -206,6 +249,9 @@ void CacheSystem::Startup(bool force_check)
 		LOG("\t\t" + *itor);
 	}
 
+	// all zips have been seen by now
+	RoR::Application::GetContentManager()->SaveZipIndex();
+
 	LOG("cache loaded!");
 }
 
@@ -219,61 +265,146 @@ std::vector<CacheEntry> *CacheSystem::getEntries()
 	return &entries;
 }
 
+CacheSearchIndex *CacheSystem::getSearchIndex()
+{
+	if (search_index_dirty || search_index.GetNumEntries() != entries.size())
+	{
+		Ogre::Timer timer;
+		search_index.Build(entries);
+		search_index_dirty = false;
+		LOG("CacheSystem: search index of " + TOSTRING(entries.size()) + " entries built in " + TOSTRING(timer.getMilliseconds()) + " ms");
+	}
+	return &search_index;
+}
+
 String CacheSystem::getCacheConfigFilename(bool full)
 {
 	if (full) return location+String(CACHE_FILE);
 	return String(CACHE_FILE);
 }
 
+String CacheSystem::getCacheBinaryFilename()
+{
+	return location+String(CACHE_BINARY_FILE);
+}
+
 // we implement this on our own, since we cannot reply on the ogre version
 bool CacheSystem::resourceExistsInAllGroups(Ogre::String filename)
 {
+	return !findGroupContainingResource(filename).empty();
+}
+
+String CacheSystem::findGroupContainingResource(String const & filename)
+{
+	RoR::ContentManager *content_manager = RoR::Application::GetContentManager();
+	IndexedZipArchiveFactory *zip_factory = (content_manager != nullptr) ? content_manager->GetZipArchiveFactory() : nullptr;
+	if (zip_factory != nullptr)
+	{
+		StringVector archives;
+		zip_factory->FindArchives(filename, archives);
+		for (StringVector::iterator it = archives.begin(); it != archives.end(); it++)
+		{
+			// locations come and go, refresh once when an archive's group is unknown or outdated
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				std::map<String, String>::iterator found = zipResourceGroups.find(*it);
+				if (found != zipResourceGroups.end())
+				{
+					try
+					{
+						if (ResourceGroupManager::getSingleton().resourceExists(found->second, filename))
+							return found->second;
+					} catch(...)
+					{
+					}
+				}
+				if (attempt == 0)
+					updateZipResourceGroups();
+			}
+		}
+	}
+
 	String group;
-	bool exists=true;
 	try
 	{
 		group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
-	}catch(...)
+	} catch(...)
 	{
-		exists=false;
 	}
-	if (group.empty())
-		exists = false;
-	return exists;
+	return group;
 }
 
-CacheSystem::CacheValidityState CacheSystem::IsCacheValid()
+void CacheSystem::updateZipResourceGroups()
 {
-	String cfgfilename = getCacheConfigFilename(false);
-	ImprovedConfigFile cfg;
-	ConfigFile ff;
-	if (!resourceExistsInAllGroups(cfgfilename))
+	zipResourceGroups.clear();
+	StringVector groups = ResourceGroupManager::getSingleton().getResourceGroups();
+	for (StringVector::iterator group = groups.begin(); group != groups.end(); group++)
 	{
-		LOG("unable to load config file: "+cfgfilename);
-		return CACHE_NEEDS_UPDATE_FULL;
+		StringVectorPtr locations = ResourceGroupManager::getSingleton().listResourceLocations(*group);
+		for (StringVector::iterator it = locations->begin(); it != locations->end(); it++)
+		{
+			zipResourceGroups.insert(std::make_pair(*it, *group));
+		}
 	}
+}
 
-	String group = ResourceGroupManager::getSingleton().findGroupContainingResource(cfgfilename);
-	DataStreamPtr stream=ResourceGroupManager::getSingleton().openResource(cfgfilename, group);
-	cfg.load(stream, "\t:=", false);
-	String shaone = cfg.getSetting("shaone");
-	String cacheformat = cfg.getSetting("cacheformat");
+CacheSystem::CacheValidityState CacheSystem::IsCacheValid()
+{
+	// only the header is read, the entries stay untouched on disk
+	CacheBinaryFile::Reader reader;
+	if (!reader.Open(getCacheBinaryFilename()))
+	{
+		// the incremental update falls back to the text cache, if there is any
+		LOG("* binary mod cache missing or has invalid format, trying to regenerate");
+		return CACHE_NEEDS_UPDATE_INCREMENTAL;
+	}
 
+	String shaone = reader.GetSHA1();
 	if (shaone == "" || shaone != currentSHA1)
 	{
 		LOG("* mod cache is invalid (not up to date), regenerating new one ...");
 		return CACHE_NEEDS_UPDATE_INCREMENTAL;
 	}
-	if (cacheformat != String(CACHE_FILE_FORMAT))
+
+	// names are the same, but contents of some archives may have changed
+	ArchiveFingerprintMap cached;
+	for (unsigned int i = 0; i < reader.GetNumFingerprints(); i++)
+	{
+		ArchiveFingerprint fp;
+		if (!reader.ReadFingerprint(i, fp))
+		{
+			return CACHE_NEEDS_UPDATE_INCREMENTAL;
+		}
+		cached[getVirtualPath(fp.path)] = fp;
+	}
+	if (!isSameFingerprints(cached, current_fingerprints))
 	{
-		entries.clear();
-		LOG("* mod cache has invalid format, trying to regenerate");
+		LOG("* some archives changed, updating mod cache ...");
 		return CACHE_NEEDS_UPDATE_INCREMENTAL;
 	}
 	LOG("* mod cache is valid, using it.");
 	return CACHE_VALID;
 }
 
+bool CacheSystem::isSameFingerprints(const ArchiveFingerprintMap &a, const ArchiveFingerprintMap &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (ArchiveFingerprintMap::const_iterator it = a.begin(), it2 = b.begin(); it != a.end(); ++it, ++it2)
+	{
+		if (it->first != it2->first
+			|| it->second.is_zip != it2->second.is_zip
+			|| it->second.size   != it2->second.size
+			|| it->second.mtime  != it2->second.mtime
+			|| it->second.hash   != it2->second.hash)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 void CacheSystem::logBadTruckAttrib(const String& line, CacheEntry& t)
 {
 	LOG("Bad Mod attribute line: " + line + " in mod " + t.dname);
@@ -604,7 +735,66 @@ bool CacheSystem::loadCache()
 {
 	// Clear existing entries
 	entries.clear();
+	cached_fingerprints.clear();
+	search_index_dirty = true;
+
+	Ogre::Timer timer;
+	String format = "binary";
+	bool loaded = loadBinaryCache();
+	if (!loaded)
+	{
+		format = "text";
+		loaded = loadTextCache();
+	}
+	if (loaded)
+	{
+		LOG("CacheSystem::loadCache: " + TOSTRING(entries.size()) + " entries loaded from " + format + " cache in " + TOSTRING(timer.getMilliseconds()) + " ms");
+	}
+	return loaded;
+}
+
+bool CacheSystem::loadBinaryCache()
+{
+	CacheBinaryFile::Reader reader;
+	if (!reader.Open(getCacheBinaryFilename()))
+	{
+		return false;
+	}
+
+	std::vector<CacheEntry> loaded_entries(reader.GetNumEntries());
+	for (unsigned int i = 0; i < reader.GetNumEntries(); i++)
+	{
+		if (!reader.ReadEntry(i, loaded_entries[i]))
+		{
+			LOG("binary mod cache is corrupted: " + getCacheBinaryFilename());
+			return false;
+		}
+	}
+
+	ArchiveFingerprintMap loaded_fingerprints;
+	for (unsigned int i = 0; i < reader.GetNumFingerprints(); i++)
+	{
+		ArchiveFingerprint fp;
+		if (!reader.ReadFingerprint(i, fp))
+		{
+			LOG("binary mod cache is corrupted: " + getCacheBinaryFilename());
+			return false;
+		}
+		loaded_fingerprints[getVirtualPath(fp.path)] = fp;
+	}
+	cached_fingerprints.swap(loaded_fingerprints);
+
+	for (std::vector<CacheEntry>::iterator it = loaded_entries.begin(); it != loaded_entries.end(); it++)
+	{
+		category_usage[it->categoryid] = category_usage[it->categoryid] + 1;
+		it->categoryname = categories[it->categoryid].title;
+	}
+	entries.swap(loaded_entries);
+	return true;
+}
 
+bool CacheSystem::loadTextCache()
+{
 	String cfgfilename = getCacheConfigFilename(false);
 
 	if ( !resourceExistsInAllGroups(cfgfilename) )
@@ -616,8 +806,6 @@ bool CacheSystem::loadCache()
 	String group = ResourceGroupManager::getSingleton().findGroupContainingResource(String(cfgfilename));
 	DataStreamPtr stream=ResourceGroupManager::getSingleton().openResource(cfgfilename, group);
 
-	LOG("CacheSystem::loadCache");
-
 	CacheEntry t;
 	String line = "";
 	int mode = 0;
@@ -700,6 +888,17 @@ int CacheSystem::incrementalCacheUpdate()
 		//error loading cache!
 		return -1;
 
+	// fast path: only archives which changed since the cache was written
+	if (!cached_fingerprints.empty() && updateChangedArchives())
+	{
+		writeGeneratedCache();
+#ifdef USE_MYGUI
+		LoadingWindow::getSingleton().hide();
+#endif //USE_MYGUI
+		LOG("* incremental check done.");
+		return 0;
+	}
+
 	LOG("* incremental check starting ...");
 	LOG("* incremental check (1/5): deleted and changed files ...");
 #ifdef USE_MYGUI
@@ -770,6 +969,7 @@ int CacheSystem::incrementalCacheUpdate()
 
 	// we try to reload one zip only one time, not multiple times if it contains more resources at once
 	std::vector<Ogre::String> reloaded_zips;
+	std::vector<ArchiveFingerprint> changed_zips;
 	LOG("* incremental check (2/5): processing changed zips ...");
 #ifdef USE_MYGUI
 	LoadingWindow::getSingleton().setProgress(40, _L("incremental check: processing changed zips\n"));
@@ -787,13 +987,16 @@ int CacheSystem::incrementalCacheUpdate()
 		}
 		if (!found)
 		{
-#ifdef USE_MYGUI
-			LoadingWindow::getSingleton().setProgress(40, _L("incremental check: processing changed zips\n")+it->fname);
-#endif //USE_MYGUI
-			loadSingleZip(*it);
+			ArchiveFingerprint archive;
+			archive.path = it->dirname;
+			archive.is_zip = true;
+			archive.size = 0;
+			archive.mtime = 0;
+			changed_zips.push_back(archive);
 			reloaded_zips.push_back(it->dirname);
 		}
 	}
+	loadArchives(changed_zips);
 	LOG("* incremental check (3/5): new content ...");
 #ifdef USE_MYGUI
 	LoadingWindow::getSingleton().setProgress(60, _L("incremental check: new content\n"));
@@ -902,6 +1105,62 @@ int CacheSystem::incrementalCacheUpdate()
 	return 0;
 }
 
+bool CacheSystem::updateChangedArchives()
+{
+	// find out what changed
+	std::set<String> outdated; // entries of these archives get removed
+	std::vector<ArchiveFingerprint> reindex;
+	for (ArchiveFingerprintMap::iterator it = cached_fingerprints.begin(); it != cached_fingerprints.end(); it++)
+	{
+		if (current_fingerprints.find(it->first) == current_fingerprints.end())
+		{
+			LOG("- " + it->second.path + " is not existing");
+			outdated.insert(it->first);
+		}
+	}
+	for (ArchiveFingerprintMap::iterator it = current_fingerprints.begin(); it != current_fingerprints.end(); it++)
+	{
+		ArchiveFingerprintMap::iterator cached = cached_fingerprints.find(it->first);
+		if (cached == cached_fingerprints.end())
+		{
+			LOG("- " + it->second.path + " is new");
+			newFiles++;
+		}
+		else if (cached->second.size != it->second.size || cached->second.mtime != it->second.mtime || cached->second.hash != it->second.hash || cached->second.is_zip != it->second.is_zip)
+		{
+			LOG("- " + it->second.path + " changed");
+			changedFiles++;
+			outdated.insert(it->first);
+		}
+		else
+		{
+			continue;
+		}
+		reindex.push_back(it->second);
+	}
+
+	if (outdated.empty() && reindex.empty())
+	{
+		// the change isn't in any of the tracked archives
+		return false;
+	}
+
+	LOG("* incremental check: " + TOSTRING(outdated.size()) + " archives outdated, " + TOSTRING(reindex.size()) + " archives to index");
+
+	for (std::vector<CacheEntry>::iterator it = entries.begin(); it != entries.end(); it++)
+	{
+		if (outdated.find(getVirtualPath(it->dirname)) != outdated.end())
+		{
+			removeFileFromFileCache(it);
+			it->deleted = true;
+			deletedFiles++;
+		}
+	}
+
+	loadArchives(reindex);
+	return true;
+}
+
 CacheEntry *CacheSystem::getEntry(int modid)
 {
 	for (std::vector<CacheEntry>::iterator it = entries.begin(); it != entries.end(); it++)
@@ -933,28 +1192,7 @@ Ogre::String CacheSystem::formatInnerEntry(int counter, CacheEntry t)
 	if (!t.deleted)
 	{
 		// this ensures that we wont break the format with empty ("") values
-		if (t.minitype.empty())
-			t.minitype = "unknown";
-		if (t.type.empty())
-			t.type = "unknown";
-		if (t.dirname.empty())
-			t.dirname = "unknown";
-		if (t.fname.empty())
-			t.fname = "unknown";
-		if (t.fext.empty())
-			t.fext = "unknown";
-		if (t.dname.empty())
-			t.dname = "unknown";
-		if (t.hash.empty())
-			t.hash = "none";
-		if (t.uniqueid.empty())
-			t.uniqueid = "no-uid";
-		if (t.guid.empty())
-			t.guid = "no-guid";
-		if (t.fname_without_uid.empty())
-			t.fname_without_uid = "unknown";
-		if (t.filecachename.empty())
-			t.filecachename = "none";
+		setEmptyFieldsToDefaults(t);
 
 		result += "\tusagecounter="+TOSTRING(t.usagecounter)+"\n";
 		result += "\taddtimestamp="+TOSTRING(t.addtimestamp)+"\n";
@@ -978,9 +1216,6 @@ Ogre::String CacheSystem::formatInnerEntry(int counter, CacheEntry t)
 		{
 			for (int i=0;i<(int)t.authors.size();i++)
 			{
-				if (t.authors[i].type.empty())  t.authors[i].type = "unknown";
-				if (t.authors[i].name.empty())  t.authors[i].name = "unknown";
-				if (t.authors[i].email.empty()) t.authors[i].email = "unknown";
 				result += "\tauthor=" + (t.authors[i].type) + \
 					"," + TOSTRING(t.authors[i].id) + \
 					"," + (t.authors[i].name) + "," + (t.authors[i].email) + "\n";
@@ -1045,6 +1280,39 @@ Ogre::String CacheSystem::formatInnerEntry(int counter, CacheEntry t)
 	return result;
 }
 
+void CacheSystem::setEmptyFieldsToDefaults(CacheEntry &t)
+{
+	if (t.minitype.empty())
+		t.minitype = "unknown";
+	if (t.type.empty())
+		t.type = "unknown";
+	if (t.dirname.empty())
+		t.dirname = "unknown";
+	if (t.fname.empty())
+		t.fname = "unknown";
+	if (t.fext.empty())
+		t.fext = "unknown";
+	if (t.dname.empty())
+		t.dname = "unknown";
+	if (t.hash.empty())
+		t.hash = "none";
+	if (t.uniqueid.empty())
+		t.uniqueid = "no-uid";
+	if (t.guid.empty())
+		t.guid = "no-guid";
+	if (t.fname_without_uid.empty())
+		t.fname_without_uid = "unknown";
+	if (t.filecachename.empty())
+		t.filecachename = "none";
+
+	for (std::vector<AuthorInfo>::iterator it = t.authors.begin(); it != t.authors.end(); it++)
+	{
+		if (it->type.empty())  it->type = "unknown";
+		if (it->name.empty())  it->name = "unknown";
+		if (it->email.empty()) it->email = "unknown";
+	}
+}
+
 Ogre::String CacheSystem::normalizeText(Ogre::String text)
 {
 	String result = "";
@@ -1074,6 +1342,52 @@ Ogre::String CacheSystem::formatEntry(int counter, CacheEntry t)
 }
 
 void CacheSystem::writeGeneratedCache()
+{
+	if (!writeBinaryCache())
+	{
+		String path = getCacheBinaryFilename();
+		ErrorUtils::ShowError(_L("Fatal Error: Unable to write cache to disk"), _L("Unable to write file.\nPlease ensure the parent directories exists and that you have write access to this location:\n") + path);
+		exit(1337);
+	}
+
+	// the text format is not read anymore unless the binary cache is missing, but it's human-readable
+	if (BSETTING("Cache Text Export", false))
+	{
+		writeTextCache();
+	}
+}
+
+bool CacheSystem::writeBinaryCache()
+{
+	String path = getCacheBinaryFilename();
+	LOG("writing binary cache to file ("+path+")...");
+
+	CacheBinaryFile::Writer writer(currentSHA1);
+	int counter=0;
+	for (std::vector<CacheEntry>::iterator it = entries.begin(); it != entries.end(); it++)
+	{
+		if (it->deleted) continue;
+		// same values as the text format would give after reloading
+		CacheEntry t = *it;
+		setEmptyFieldsToDefaults(t);
+		t.number = counter; // always count linear!
+		writer.AddEntry(t);
+		counter++;
+	}
+	for (ArchiveFingerprintMap::iterator it = current_fingerprints.begin(); it != current_fingerprints.end(); it++)
+	{
+		writer.AddFingerprint(it->second);
+	}
+
+	if (!writer.WriteToFile(path))
+	{
+		return false;
+	}
+	LOG("...done!");
+	return true;
+}
+
+void CacheSystem::writeTextCache()
 {
 	String path = getCacheConfigFilename(true);
 	LOG("writing cache to file ("+path+")...");
@@ -1203,6 +1517,9 @@ void CacheSystem::addFile(String filename, String archiveType, String archiveDir
 
 	//read first line
 	CacheEntry entry;
+	String content;
+	// trucks get parsed by the worker threads while generating
+	bool parse_later = (generation_pool != 0 && ext != "terrn2");
 	if (!resourceExistsInAllGroups(filename))
 		return;
 
@@ -1217,10 +1534,16 @@ void CacheSystem::addFile(String filename, String archiveType, String archiveDir
 			if (ext == "terrn2")
 			{
 				fillTerrainDetailInfo(entry, ds, filename);
+			} else if (parse_later)
+			{
+				content = ds->getAsString();
 			} else
 			{
+				String messages;
 				entry.dname = ds->getLine();
-				fillTruckDetailInfo(entry, ds, filename);
+				fillTruckDetailInfo(entry, ds, filename, messages);
+				if (!messages.empty())
+					Ogre::LogManager::getSingleton().logMessage(messages);
 			}
 
 			// ds closes automatically, so do _not_ close it explicitly below
@@ -1247,7 +1570,10 @@ void CacheSystem::addFile(String filename, String archiveType, String archiveDir
 				// fallback if no hash was found
 				entry.hash="none";
 			// read in author and category
-			entries.push_back(entry);
+			if (parse_later)
+				enqueueParseTask(entry, content);
+			else
+				entries.push_back(entry);
 		} catch(Ogre::Exception& e)
 		{
 			if (e.getNumber() == Ogre::Exception::ERR_DUPLICATE_ITEM)
@@ -1264,7 +1590,7 @@ void CacheSystem::addFile(String filename, String archiveType, String archiveDir
 	}
 }
 
-void CacheSystem::fillTruckDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr stream, Ogre::String file_name)
+void CacheSystem::fillTruckDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr stream, Ogre::String file_name, Ogre::String &messages)
 {
 	/* LOAD AND PARSE THE VEHICLE */
 	RigDef::Parser parser;
@@ -1307,7 +1633,7 @@ void CacheSystem::fillTruckDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr str
 			report << "\tMessage: " << iter->message << std::endl;
 		}
 
-		Ogre::LogManager::getSingleton().logMessage(report.str());
+		messages = report.str();
 	}
 
 	/* RETRIEVE DATA */
@@ -1741,7 +2067,8 @@ void CacheSystem::checkForNewFiles(Ogre::String ext)
 
 String CacheSystem::filenamesSHA1()
 {
-	String filenames = "";
+	// the names are hashed one by one, which gives the same result as hashing them concatenated
+	RoR::CSHA1 sha1;
 
 	// get all Files
 	/*
@@ -1787,22 +2114,180 @@ String CacheSystem::filenamesSHA1()
 					}
 					if (!vipfile) continue;
 				}
-				name += iterFiles->filename;
-				filenames += name + "\n";
+				name += iterFiles->filename + "\n";
+				sha1.UpdateHash((uint8_t *)name.c_str(), (uint32_t)name.size());
 			}
 		}
 	}
 
 	char result[256] = {};
 
-	RoR::CSHA1 sha1;
-	char *data = const_cast<char*>(filenames.c_str());
-	sha1.UpdateHash((uint8_t *)data, (uint32_t)strlen(data));
 	sha1.Final();
 	sha1.ReportHash(result, RoR::CSHA1::REPORT_HEX_SHORT);
 	return result;
 }
 
+std::vector<CacheSystem::FingerprintRoot> CacheSystem::getFingerprintRoots()
+{
+	// the same groups as filenamesSHA1() uses
+	std::vector<FingerprintRoot> roots;
+	String restype[3] = {"Packs", "TerrainFolders", "VehicleFolders"};
+	for (int i=0; i<3; i++)
+	{
+		if (!ResourceGroupManager::getSingleton().resourceGroupExists(restype[i]))
+			continue;
+
+		const ResourceGroupManager::LocationList &locations = ResourceGroupManager::getSingleton().getResourceLocationList(restype[i]);
+		for (ResourceGroupManager::LocationList::const_iterator it = locations.begin(); it != locations.end(); ++it)
+		{
+			if ((*it)->archive->getType() != "FileSystem")
+				continue;
+			FingerprintRoot root;
+			root.path = (*it)->archive->getName();
+			root.group = restype[i];
+			root.recursive = (*it)->recursive;
+			roots.push_back(root);
+		}
+	}
+	return roots;
+}
+
+void CacheSystem::scanFingerprints(const std::vector<FingerprintRoot> &roots, ArchiveFingerprintMap &out)
+{
+	// uses own archive instances, resource groups must not be touched from other threads
+	FileSystemArchiveFactory FSAF;
+	for (std::vector<FingerprintRoot>::const_iterator root = roots.begin(); root != roots.end(); ++root)
+	{
+		Archive *fsa = FSAF.createInstance(root->path);
+
+		// zips: one fingerprint each
+		FileInfoListPtr zips = fsa->findFileInfo("*.zip", root->recursive, false);
+		for (FileInfoList::iterator it = zips->begin(); it != zips->end(); ++it)
+		{
+			ArchiveFingerprint fp;
+			fp.path = root->path + "/" + it->filename;
+			fp.group = root->group;
+			fp.is_zip = true;
+			fp.size = it->uncompressedSize;
+			fp.mtime = fsa->getModifiedTime(it->filename);
+			if (!fp.mtime)
+			{
+				// slow sha1 check, needed for platforms where filetime is not yet implemented
+				char hash[256] = {};
+				RoR::CSHA1 sha1;
+				sha1.HashFile(const_cast<char*>(getRealPath(fp.path).c_str()));
+				sha1.Final();
+				sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+				fp.hash = hash;
+			}
+			out[getVirtualPath(fp.path)] = fp;
+		}
+
+		// the directory itself: all other files, so that added, removed or modified files are noticed
+		ArchiveFingerprint dir;
+		dir.path = root->path;
+		dir.group = root->group;
+		dir.is_zip = false;
+		dir.size = 0;
+		dir.mtime = 0;
+
+		StringVector lines;
+		FileInfoListPtr files = fsa->listFileInfo(root->recursive, false);
+		for (FileInfoList::iterator it = files->begin(); it != files->end(); ++it)
+		{
+			if (StringUtil::endsWith(it->filename, ".zip"))
+				continue;
+			std::time_t ft = fsa->getModifiedTime(it->filename);
+			dir.size += it->uncompressedSize;
+			dir.mtime = std::max(dir.mtime, ft);
+			lines.push_back(it->filename + "\t" + TOSTRING(it->uncompressedSize) + "\t" + TOSTRING((long)ft) + "\n");
+		}
+		std::sort(lines.begin(), lines.end()); // listing order is up to the OS
+
+		char hash[256] = {};
+		RoR::CSHA1 sha1;
+		for (StringVector::iterator it = lines.begin(); it != lines.end(); ++it)
+		{
+			sha1.UpdateHash((uint8_t *)it->c_str(), (uint32_t)it->size());
+		}
+		sha1.Final();
+		sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+		dir.hash = hash;
+		out[getVirtualPath(dir.path)] = dir;
+
+		FSAF.destroyInstance(fsa);
+	}
+}
+
+void CacheSystem::startBackgroundRescan(const std::vector<FingerprintRoot> &roots)
+{
+	rescan_roots = roots;
+	rescan_done = false;
+	if (pthread_create(&rescan_thread, NULL, rescanThreadEntry, this))
+	{
+		LOG("CacheSystem: Can not start the rescan thread, archives are checked right away");
+		rescanThreadEntry(this);
+		return;
+	}
+	rescan_thread_running = true;
+}
+
+void *CacheSystem::rescanThreadEntry(void *arg)
+{
+	CacheSystem *cs = static_cast<CacheSystem *>(arg);
+
+	Ogre::Timer timer;
+	ArchiveFingerprintMap result;
+	cs->scanFingerprints(cs->rescan_roots, result);
+
+	MUTEX_LOCK(&cs->rescan_mutex);
+	cs->rescan_result.swap(result);
+	cs->rescan_time_ms = timer.getMilliseconds();
+	cs->rescan_done = true;
+	MUTEX_UNLOCK(&cs->rescan_mutex);
+	return NULL;
+}
+
+void CacheSystem::applyBackgroundRescan(bool wait /* = false */)
+{
+	if (wait && rescan_thread_running)
+	{
+		pthread_join(rescan_thread, NULL);
+		rescan_thread_running = false;
+	}
+
+	MUTEX_LOCK(&rescan_mutex);
+	bool done = rescan_done;
+	rescan_done = false;
+	if (done)
+	{
+		current_fingerprints.swap(rescan_result);
+		rescan_result.clear();
+	}
+	MUTEX_UNLOCK(&rescan_mutex);
+
+	if (!done)
+		return;
+
+	if (rescan_thread_running)
+	{
+		pthread_join(rescan_thread, NULL);
+		rescan_thread_running = false;
+	}
+	LOG("* " + TOSTRING(current_fingerprints.size()) + " archives checked in background in " + TOSTRING(rescan_time_ms) + " ms");
+
+	if (isSameFingerprints(cached_fingerprints, current_fingerprints))
+	{
+		LOG("* mod cache is valid, using it.");
+		return;
+	}
+
+	LOG("* some archives changed, updating mod cache ...");
+	currentSHA1 = filenamesSHA1();
+	generateCache(false);
+	loadCache();
+}
+
 void CacheSystem::fillTerrainDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr ds, Ogre::String fname)
 {
 	TerrainManager tm;
@@ -1891,9 +2376,10 @@ CacheEntry CacheSystem::getResourceInfo(Ogre::String &filename)
 bool CacheSystem::checkResourceLoaded(Ogre::String &filename, Ogre::String &group)
 {
 	// check if we already loaded it via ogre ...
-	if (ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(filename))
+	String found_group = findGroupContainingResource(filename);
+	if (!found_group.empty())
 	{
-		group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
+		group = found_group;
 		return true;
 	}
 
@@ -1913,10 +2399,10 @@ bool CacheSystem::checkResourceLoaded(Ogre::String &filename, Ogre::String &grou
 			// we found the file, load it
 			filename = it->fname;
 			bool res = checkResourceLoaded(*it);
-			bool exists = ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(filename);
-			if (!exists)
+			found_group = findGroupContainingResource(filename);
+			if (found_group.empty())
 				return false;
-			group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
+			group = found_group;
 			return res;
 		}
 	}
@@ -2036,12 +2522,7 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 #endif
 
 	String realzipPath = getRealPath(zippath);
-	char hash[256] = {};
-
-	RoR::CSHA1 sha1;
-	sha1.HashFile(const_cast<char*>(realzipPath.c_str()));
-	sha1.Final();
-	sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+	String hash = getZipHash(realzipPath);
 	zipHashes[getVirtualPath(zippath)] = hash;
 
 	String compr = "";
@@ -2049,7 +2530,7 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 		compr = "(No Compression)";
 	else if (cfactor > 0)
 		compr = "(Compression: " + TOSTRING(cfactor) + ")";
-	LOG("Adding archive " + realzipPath + " (hash: "+String(hash)+") " + compr);
+	LOG("Adding archive " + realzipPath + " (hash: "+hash+") " + compr);
 
 	rgcounter++;
 	String rgname = "General-"+TOSTRING(rgcounter);
@@ -2101,56 +2582,56 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 	}
 }
 
-void CacheSystem::loadAllZipsInResourceGroup(String group)
+void CacheSystem::collectZipsInResourceGroup(String group, std::vector<ArchiveFingerprint> &out)
 {
-	std::map<String, bool> loadedZips;
-	ResourceGroupManager& rgm = ResourceGroupManager::getSingleton();
-	FileInfoListPtr files = rgm.findResourceFileInfo(group, "*.zip");
-	FileInfoList::iterator iterFiles = files->begin();
-	size_t i=0, filecount=files->size();
-	for (; iterFiles!= files->end(); ++iterFiles, i++)
+	std::set<String> loadedZips;
+	FileInfoListPtr files = ResourceGroupManager::getSingleton().findResourceFileInfo(group, "*.zip");
+	for (FileInfoList::iterator iterFiles = files->begin(); iterFiles!= files->end(); ++iterFiles)
 	{
-		if (loadedZips[iterFiles->filename])
+		if (!loadedZips.insert(iterFiles->filename).second)
 		{
 			LOG(" zip already loaded: " + iterFiles->filename);
 			// already loaded for some strange reason
 			continue;
 		}
-		// update loader
-		int progress = ((float)i/(float)filecount)*100;
-#ifdef USE_MYGUI
-		UTFString tmp = _L("Loading zips in group ") + ANSI_TO_UTF(group) + L"\n" + ANSI_TO_UTF(iterFiles->filename) + L"\n" + ANSI_TO_UTF(TOSTRING(i)) + L"/" + ANSI_TO_UTF(TOSTRING(filecount));
-		LoadingWindow::getSingleton().setProgress(progress, tmp);
-#endif //USE_MYGUI
-
-		loadSingleZip((Ogre::FileInfo)*iterFiles);
-		loadedZips[iterFiles->filename] = true;
+		ArchiveFingerprint archive;
+		archive.path = iterFiles->archive->getName() + "/" + iterFiles->filename;
+		archive.group = group;
+		archive.is_zip = true;
+		archive.size = iterFiles->uncompressedSize;
+		archive.mtime = 0;
+		out.push_back(archive);
 	}
-	// hide loader again
-#ifdef USE_MYGUI
-	LoadingWindow::getSingleton().hide();
-#endif //USE_MYGUI
 }
 
-void CacheSystem::loadAllDirectoriesInResourceGroup(String group)
+void CacheSystem::collectDirectoriesInResourceGroup(String group, std::vector<ArchiveFingerprint> &out)
 {
 	FileInfoListPtr list = ResourceGroupManager::getSingleton().listResourceFileInfo(group, true);
-	size_t i=0, filecount=list->size();
-	for (FileInfoList::iterator listitem = list->begin(); listitem!= list->end(); ++listitem,i++)
+	for (FileInfoList::iterator listitem = list->begin(); listitem!= list->end(); ++listitem)
 	{
 		if (!listitem->archive) continue;
-		String dirname = listitem->archive->getName() + SSETTING("dirsep", "\\") + listitem->filename;
-		// update loader
-		int progress = ((float)i/(float)filecount)*100;
-#ifdef USE_MYGUI
-		LoadingWindow::getSingleton().setProgress(progress, _L("Loading directory\n") + listitem->filename);
-#endif //USE_MYGUI
-		loadSingleDirectory(dirname, group, true);
+		ArchiveFingerprint archive;
+		archive.path = listitem->archive->getName() + SSETTING("dirsep", "\\") + listitem->filename;
+		archive.group = group;
+		archive.is_zip = false;
+		archive.size = 0;
+		archive.mtime = 0;
+		out.push_back(archive);
 	}
-	// hide loader again
-#ifdef USE_MYGUI
-	LoadingWindow::getSingleton().hide();
-#endif //USE_MYGUI
+}
+
+void CacheSystem::loadAllZipsInResourceGroup(String group)
+{
+	std::vector<ArchiveFingerprint> archives;
+	collectZipsInResourceGroup(group, archives);
+	loadArchives(archives);
+}
+
+void CacheSystem::loadAllDirectoriesInResourceGroup(String group)
+{
+	std::vector<ArchiveFingerprint> archives;
+	collectDirectoriesInResourceGroup(group, archives);
+	loadArchives(archives);
 }
 
 void CacheSystem::loadAllZips()
@@ -2159,19 +2640,276 @@ void CacheSystem::loadAllZips()
 	if (lodedalready)
 		return;
 	lodedalready=true;
+	// all archives at once, so that the worker threads stay busy and the progress covers everything
+	std::vector<ArchiveFingerprint> archives;
 	//setup zip packages
 	//search zip in packs group
-	loadAllZipsInResourceGroup("Packs");
-	loadAllZipsInResourceGroup("VehicleFolders");
-	loadAllZipsInResourceGroup("TerrainFolders");
+	collectZipsInResourceGroup("Packs", archives);
+	collectZipsInResourceGroup("VehicleFolders", archives);
+	collectZipsInResourceGroup("TerrainFolders", archives);
+
+	collectDirectoriesInResourceGroup("VehicleFolders", archives);
+	collectDirectoriesInResourceGroup("TerrainFolders", archives);
+
+	loadArchives(archives);
+}
+
+class CacheSystem::HashTask : public IThreadTask
+{
+public:
+
+	HashTask(CacheSystem *cache, String real_path):
+		  m_cache(cache)
+		, m_real_path(real_path)
+	{}
+
+	void run()
+	{
+		char hash[256] = {};
+		RoR::CSHA1 sha1;
+		sha1.HashFile(const_cast<char*>(m_real_path.c_str()));
+		sha1.Final();
+		sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+		m_hash = hash;
+	}
 
-	loadAllDirectoriesInResourceGroup("VehicleFolders");
-	loadAllDirectoriesInResourceGroup("TerrainFolders");
+	void onComplete()
+	{
+		MUTEX_LOCK(&m_cache->generation_mutex);
+		m_cache->prehashed_zips[m_real_path] = m_hash;
+		m_cache->zips_being_hashed.erase(m_real_path);
+		m_cache->generation_tasks--;
+		pthread_cond_broadcast(&m_cache->generation_cond);
+		MUTEX_UNLOCK(&m_cache->generation_mutex);
+
+		delete this;
+	}
+
+private:
+
+	CacheSystem *m_cache;
+	String m_real_path;
+	String m_hash;
+};
+
+class CacheSystem::ParseTask : public IThreadTask
+{
+public:
+
+	ParseTask(CacheSystem *cache, const CacheEntry &entry, const String &content):
+		  m_cache(cache)
+		, m_content(content)
+	{
+		m_result.entry = entry;
+		m_result.valid = false;
+	}
+
+	void run()
+	{
+		try
+		{
+			DataStreamPtr ds(OGRE_NEW MemoryDataStream(const_cast<char *>(m_content.data()), m_content.size(), false, true));
+			m_result.entry.dname = ds->getLine();
+			fillTruckDetailInfo(m_result.entry, ds, m_result.entry.fname, m_result.messages);
+			m_result.valid = true;
+		}
+		catch (std::exception& e)
+		{
+			m_result.messages += "error while parsing '" + m_result.entry.fname + "': " + e.what();
+		}
+		m_content.clear();
+	}
+
+	void onComplete()
+	{
+		MUTEX_LOCK(&m_cache->generation_mutex);
+		m_cache->parsed_entries.push_back(m_result);
+		m_cache->generation_parse_tasks--;
+		m_cache->generation_tasks--;
+		pthread_cond_broadcast(&m_cache->generation_cond);
+		MUTEX_UNLOCK(&m_cache->generation_mutex);
+
+		delete this;
+	}
+
+private:
+
+	CacheSystem *m_cache;
+	String m_content;
+	ParsedEntry m_result;
+};
+
+static bool compareEntryNumbers(const CacheEntry &a, const CacheEntry &b)
+{
+	return a.number < b.number;
+}
+
+void CacheSystem::loadArchives(const std::vector<ArchiveFingerprint> &archives)
+{
+	if (archives.empty())
+		return;
+
+	Ogre::Timer timer;
+	size_t first_new_entry = entries.size();
+
+	int num_threads = ISETTING("Cache Generation Threads", 0);
+	if (num_threads <= 0)
+		num_threads = std::max(1, (int)RoR::PlatformUtils::GetNumCpuCores());
+	if (num_threads > 1 && archives.size() > 1)
+	{
+		generation_pool = new ThreadPool(num_threads);
+		generation_pool_size = num_threads;
+	}
+	LOG("* indexing " + TOSTRING(archives.size()) + " archives, worker threads: " + TOSTRING(generation_pool ? num_threads : 0));
+
+	// the progress is weighted by archive size, plus fixed costs for loading each archive
+	const Ogre::uint64 ARCHIVE_WEIGHT = 256 * 1024;
+	Ogre::uint64 total_weight = 0, done_weight = 0;
+	for (std::vector<ArchiveFingerprint>::const_iterator it = archives.begin(); it != archives.end(); it++)
+	{
+		total_weight += it->size + ARCHIVE_WEIGHT;
+	}
+
+	size_t next_hash = 0;
+	for (size_t i = 0; i < archives.size(); i++)
+	{
+		const ArchiveFingerprint &archive = archives[i];
+
+		// let the workers hash the next few zips while this one gets loaded
+		while (generation_pool && next_hash < archives.size() && next_hash < i + 2 * (size_t)generation_pool_size)
+		{
+			if (archives[next_hash].is_zip)
+				enqueueHashTask(getRealPath(archives[next_hash].path));
+			next_hash++;
+		}
+
+		setGenerationProgress(timer.getMilliseconds(), done_weight, total_weight, i, archives.size(), archive.path);
+
+		if (archive.is_zip)
+			loadSingleZip(archive.path, -1);
+		else
+			loadSingleDirectory(archive.path, archive.group, true);
+
+		done_weight += archive.size + ARCHIVE_WEIGHT;
+	}
+
+	if (generation_pool)
+	{
+#ifdef USE_MYGUI
+		LoadingWindow::getSingleton().setProgress(100, _L("Loading archives\n") + _L("waiting for worker threads"));
+#endif //USE_MYGUI
+		std::vector<ParsedEntry> parsed;
+		MUTEX_LOCK(&generation_mutex);
+		while (generation_tasks > 0)
+		{
+			pthread_cond_wait(&generation_cond, &generation_mutex);
+		}
+		parsed.swap(parsed_entries);
+		prehashed_zips.clear();
+		MUTEX_UNLOCK(&generation_mutex);
+
+		delete generation_pool;
+		generation_pool = 0;
+		generation_pool_size = 0;
+
+		for (std::vector<ParsedEntry>::iterator it = parsed.begin(); it != parsed.end(); it++)
+		{
+			if (!it->messages.empty())
+				Ogre::LogManager::getSingleton().logMessage(it->messages);
+			if (it->valid)
+				entries.push_back(it->entry);
+		}
+		// same order as if parsed one after another: the new entries were numbered in that order,
+		// older entries keep their place (their numbers come from the cache file and may overlap)
+		std::sort(entries.begin() + first_new_entry, entries.end(), compareEntryNumbers);
+	}
+
+	LOG("* " + TOSTRING(archives.size()) + " archives indexed in " + TOSTRING(timer.getMilliseconds()) + " ms");
+
+	// hide loader again
+#ifdef USE_MYGUI
+	LoadingWindow::getSingleton().hide();
+#endif //USE_MYGUI
+}
+
+void CacheSystem::enqueueHashTask(String real_path)
+{
+	MUTEX_LOCK(&generation_mutex);
+	if (prehashed_zips.find(real_path) != prehashed_zips.end() || !zips_being_hashed.insert(real_path).second)
+	{
+		MUTEX_UNLOCK(&generation_mutex);
+		return;
+	}
+	generation_tasks++;
+	MUTEX_UNLOCK(&generation_mutex);
+
+	generation_pool->enqueue(new HashTask(this, real_path));
+}
+
+void CacheSystem::enqueueParseTask(const CacheEntry &entry, const String &content)
+{
+	// limit the number of file contents held in memory
+	MUTEX_LOCK(&generation_mutex);
+	while (generation_parse_tasks >= 4 * generation_pool_size)
+	{
+		pthread_cond_wait(&generation_cond, &generation_mutex);
+	}
+	generation_parse_tasks++;
+	generation_tasks++;
+	MUTEX_UNLOCK(&generation_mutex);
+
+	generation_pool->enqueue(new ParseTask(this, entry, content));
+}
+
+String CacheSystem::getZipHash(String real_path)
+{
+	if (generation_pool)
+	{
+		MUTEX_LOCK(&generation_mutex);
+		while (zips_being_hashed.find(real_path) != zips_being_hashed.end())
+		{
+			pthread_cond_wait(&generation_cond, &generation_mutex);
+		}
+		std::map<String, String>::iterator found = prehashed_zips.find(real_path);
+		if (found != prehashed_zips.end())
+		{
+			String hash = found->second;
+			prehashed_zips.erase(found);
+			MUTEX_UNLOCK(&generation_mutex);
+			return hash;
+		}
+		MUTEX_UNLOCK(&generation_mutex);
+	}
+
+	char hash[256] = {};
+	RoR::CSHA1 sha1;
+	sha1.HashFile(const_cast<char*>(real_path.c_str()));
+	sha1.Final();
+	sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+	return hash;
+}
+
+void CacheSystem::setGenerationProgress(unsigned long elapsed_ms, Ogre::uint64 done_weight, Ogre::uint64 total_weight, size_t done, size_t total, String name)
+{
+#ifdef USE_MYGUI
+	float ratio = (total_weight > 0) ? (float)((double)done_weight / (double)total_weight) : 0.0f;
+	UTFString tmp = _L("Loading archives\n") + ANSI_TO_UTF(name) + L"\n" + ANSI_TO_UTF(TOSTRING(done)) + L"/" + ANSI_TO_UTF(TOSTRING(total));
+
+	// estimate from the throughput so far, once there is something to estimate from
+	if (ratio > 0.0f && elapsed_ms > 2000)
+	{
+		unsigned long remaining = (unsigned long)((elapsed_ms / 1000.0f) * (1.0f - ratio) / ratio);
+		String eta = TOSTRING(remaining / 60) + ":" + ((remaining % 60 < 10) ? "0" : "") + TOSTRING(remaining % 60);
+		tmp = tmp + L"\n" + _L("remaining time: ") + ANSI_TO_UTF(eta);
+	}
+	LoadingWindow::getSingleton().setProgress((int)(ratio * 100), tmp);
+#endif //USE_MYGUI
 }
 
 
 void CacheSystem::checkForNewZipsInResourceGroup(String group)
 {
+	std::vector<ArchiveFingerprint> new_zips;
 	FileInfoListPtr files = ResourceGroupManager::getSingleton().findResourceFileInfo(group, "*.zip");
 	FileInfoList::iterator iterFiles = files->begin();
 	size_t i=0, filecount=files->size();
@@ -2201,12 +2939,19 @@ void CacheSystem::checkForNewZipsInResourceGroup(String group)
 #endif //USE_MYGUI
 			LOG("- "+zippath+" is new");
 			newFiles++;
-			loadSingleZip((Ogre::FileInfo)*iterFiles);
+			ArchiveFingerprint archive;
+			archive.path = iterFiles->archive->getName() + "/" + iterFiles->filename;
+			archive.group = group;
+			archive.is_zip = true;
+			archive.size = iterFiles->uncompressedSize;
+			archive.mtime = 0;
+			new_zips.push_back(archive);
 		}
 	}
 #ifdef USE_MYGUI
 	LoadingWindow::getSingleton().hide();
 #endif //USE_MYGUI
+	loadArchives(new_zips);
 }
 
 void CacheSystem::checkForNewDirectoriesInResourceGroup(String group)
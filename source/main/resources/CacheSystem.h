@@ -30,10 +30,14 @@
 
 #include "RoRPrerequisites.h"
 
+#include "CacheSearchIndex.h"
+
 #include <Ogre.h>
+#include <pthread.h>
 
 #define CACHE_FILE "mods.cache"
 #define CACHE_FILE_FORMAT "6"
+#define CACHE_BINARY_FILE "mods.bincache"
 
 // 60*60*24 = one day
 #define CACHE_FILE_FRESHNESS 86400
@@ -52,6 +56,19 @@ struct AuthorInfo
 	Ogre::String email;
 };
 
+/** State of one content archive (zip file or directory), used to find out which archives need to be re-indexed. */
+struct ArchiveFingerprint
+{
+	Ogre::String path;                  //!< real path, as used for loading
+	Ogre::String group;                 //!< resource group; only valid for fresh scans, not stored in the cache
+	bool is_zip;                        //!< zip file or directory
+	Ogre::uint64 size;                  //!< zip: file size; directory: sum of sizes of its files
+	std::time_t mtime;                  //!< zip: modification time; directory: latest modification of its files
+	Ogre::String hash;                  //!< zip: content SHA1 if mtime is unknown; directory: SHA1 over names, sizes and times of its files
+};
+
+typedef std::map<Ogre::String, ArchiveFingerprint> ArchiveFingerprintMap; //!< key: virtual path of the archive
+
 class CacheEntry
 {
 
@@ -148,6 +165,14 @@ public:
 
 	void Startup(bool forcecheck=false);
 	void loadAllZips();
+
+	/**
+	* Applies result of the archive check which Startup() left running in background.
+	* If archives changed, updates the cache; this re-indexes them and blocks, so it's only done
+	* in the menu and before loading a terrain, never during the game. Main thread only.
+	* @param wait Finish the check first, else nothing happens until it finished.
+	*/
+	void applyBackgroundRescan(bool wait = false);
 	
 	static Ogre::String stripUIDfromString(Ogre::String uidstr);
 	static Ogre::String getUIDfromString(Ogre::String uidstr);
@@ -169,6 +194,7 @@ public:
 	Ogre::String addMeshMaterials(CacheEntry &entry, Ogre::Entity *e);
 	std::map<int, Category_Entry> *getCategories();
 	std::vector<CacheEntry> *getEntries();
+	CacheSearchIndex *getSearchIndex();      // built on first use after the cache was (re)loaded
 
 	int getCategoryUsage(int category);
 	CacheEntry *getEntry(int modid);
@@ -184,7 +210,7 @@ public:
 	void loadSingleZip(Ogre::String zippath, int cfactor, bool unload=true, bool ownGroup=true);
 	void loadSingleDirectory(Ogre::String dirname, Ogre::String group, bool alreadyLoaded=true);
 
-	static bool resourceExistsInAllGroups(Ogre::String filename);
+	bool resourceExistsInAllGroups(Ogre::String filename);
 
 	// see: https://code.google.com/p/rigsofrods-streams/source/browse/trunk/0.39/win32-skeleton/config/categories.cfg
 	enum CategoryID {CID_Max=9000, CID_Unsorted=9990, CID_All=9991, CID_Fresh=9992, CID_Hidden=9993, CID_SearchResults=9994};
@@ -216,18 +242,28 @@ protected:
 
 	// reads all advanced information out of the entry's file
 	void fillTerrainDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr ds, Ogre::String fname);
-	void fillTruckDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr ds, Ogre::String fname);
+	/** Doesn't touch the cache system or resource groups, safe to be called from worker threads.
+	* @param messages [out] Parser report, to be logged by the caller.
+	*/
+	static void fillTruckDetailInfo(CacheEntry &entry, Ogre::DataStreamPtr ds, Ogre::String fname, Ogre::String &messages);
 
 	/// Checks if update is needed
 	CacheValidityState IsCacheValid();
+	bool isSameFingerprints(const ArchiveFingerprintMap &a, const ArchiveFingerprintMap &b);
 	Ogre::String filenamesSHA1();             // generates the hash over the whole content
-	bool loadCache();			              // loads cache config file, new format
+	bool loadCache();			              // loads binary cache file, falls back to text format
+	bool loadBinaryCache();
+	bool loadTextCache();
 	Ogre::String getCacheConfigFilename(bool full); // returns filename of the cache file
+	Ogre::String getCacheBinaryFilename();    // returns full path of the binary cache file
 	int incrementalCacheUpdate();             // tries to update parts of the Cache only
+	bool updateChangedArchives();             // re-indexes archives whose fingerprint changed, false if none did
 
 	void generateFileCache(CacheEntry &entry, Ogre::String directory=Ogre::String());	// generates a new cache
 	void deleteFileCache(char *filename); // removed files from cache
-	void writeGeneratedCache();
+	void writeGeneratedCache();               // writes binary cache and optionally text export
+	bool writeBinaryCache();
+	void writeTextCache();
 	void writeStreamCache();
 	
 	// adds a zip to the cache
@@ -239,6 +275,7 @@ protected:
 	void generateCache(bool forcefull=false);
 	Ogre::String formatEntry(int counter, CacheEntry t);
 	Ogre::String formatInnerEntry(int counter, CacheEntry t);
+	static void setEmptyFieldsToDefaults(CacheEntry &t);
 	void updateSingleTruckEntryCache(int number, CacheEntry t);
 	void parseModAttribute(const Ogre::String& line, CacheEntry& t);
 	void logBadTruckAttrib(const Ogre::String& line, CacheEntry& t);
@@ -264,6 +301,13 @@ protected:
 	void checkForNewZipsInResourceGroup(Ogre::String group);
 	void checkForNewDirectoriesInResourceGroup(Ogre::String group);
 
+	/**
+	* Resource group of the file, empty if none has it. Files in indexed zips are a hash lookup in the
+	* zip index; everything else goes through Ogre, which searches every resource group.
+	*/
+	Ogre::String findGroupContainingResource(Ogre::String const & filename);
+	void updateZipResourceGroups();
+
 	void generateZipList();
 	bool isZipUsedInEntries(Ogre::String filename);
 	bool isFileInEntries(Ogre::String filename);
@@ -272,6 +316,44 @@ protected:
 
 	void loadAllDirectoriesInResourceGroup(Ogre::String group);
 
+	struct FingerprintRoot
+	{
+		Ogre::String path;
+		Ogre::String group;
+		bool recursive;
+	};
+
+	std::vector<FingerprintRoot> getFingerprintRoots();
+	/** Only reads the filesystem, safe to be called from other threads. */
+	void scanFingerprints(const std::vector<FingerprintRoot> &roots, ArchiveFingerprintMap &out);
+
+	void startBackgroundRescan(const std::vector<FingerprintRoot> &roots);
+	static void *rescanThreadEntry(void *arg);
+
+	/** Hashes a zip file on a worker thread; deletes itself when done */
+	class HashTask;
+	/** Parses a truck file on a worker thread; deletes itself when done */
+	class ParseTask;
+
+	struct ParsedEntry
+	{
+		CacheEntry entry;
+		Ogre::String messages;
+		bool valid;
+	};
+
+	/**
+	* Indexes the archives. Zip hashing and truck parsing run on worker threads while
+	* the main thread loads the archives into resource groups, which is not thread-safe.
+	*/
+	void loadArchives(const std::vector<ArchiveFingerprint> &archives);
+	void collectZipsInResourceGroup(Ogre::String group, std::vector<ArchiveFingerprint> &out);
+	void collectDirectoriesInResourceGroup(Ogre::String group, std::vector<ArchiveFingerprint> &out);
+	void enqueueHashTask(Ogre::String real_path);
+	void enqueueParseTask(const CacheEntry &entry, const Ogre::String &content);
+	Ogre::String getZipHash(Ogre::String real_path); // waits for a pending hash task, hashes the file itself if there is none
+	void setGenerationProgress(unsigned long elapsed_ms, Ogre::uint64 done_weight, Ogre::uint64 total_weight, size_t done, size_t total, Ogre::String name);
+
 	// ================================================================================
 	// Variables
 	// ================================================================================
@@ -287,7 +369,34 @@ protected:
 
 	std::vector<CacheEntry> entries; //!< this holds all files
 
+	CacheSearchIndex search_index;   //!< over entries
+	bool search_index_dirty;
+
 	std::map<Ogre::String, Ogre::String> zipHashes;
+	std::map<Ogre::String, Ogre::String> zipResourceGroups; //!< resource location -> group, see findGroupContainingResource()
+
+	ArchiveFingerprintMap current_fingerprints; //!< archives as they are now, written with the cache
+	ArchiveFingerprintMap cached_fingerprints;  //!< archives as they were when the cache was written; empty if unknown
+
+	// background rescan
+	pthread_t rescan_thread;
+	pthread_mutex_t rescan_mutex;
+	bool rescan_thread_running;
+	bool rescan_done;                         //!< protected by rescan_mutex
+	std::vector<FingerprintRoot> rescan_roots;
+	ArchiveFingerprintMap rescan_result;      //!< protected by rescan_mutex
+	unsigned long rescan_time_ms;             //!< protected by rescan_mutex
+
+	// parallel generation
+	ThreadPool *generation_pool;              //!< only set while loadArchives() runs
+	int generation_pool_size;
+	pthread_mutex_t generation_mutex;
+	pthread_cond_t generation_cond;
+	int generation_tasks;                     //!< pending tasks; protected by generation_mutex
+	int generation_parse_tasks;               //!< pending parse tasks; protected by generation_mutex
+	std::vector<ParsedEntry> parsed_entries;  //!< protected by generation_mutex
+	std::map<Ogre::String, Ogre::String> prehashed_zips; //!< key: real path; protected by generation_mutex
+	std::set<Ogre::String> zips_being_hashed; //!< protected by generation_mutex
 
 	// categories
 	std::map<int, Category_Entry> categories;
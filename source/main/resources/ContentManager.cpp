@@ -23,6 +23,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Application.h"
 #include "Settings.h"
 #include "ColoredTextAreaOverlayElementFactory.h"
+#include "IndexedZipArchive.h"
 #include "SoundScriptManager.h"
 #include "SkinManager.h"
 #include "Language.h"
@@ -40,6 +41,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "Utils.h"
 
+#include <OgreArchiveManager.h>
+
 using namespace Ogre;
 using namespace std;
 using namespace RoR;
@@ -87,12 +90,33 @@ DECLARE_RESOURCE_PACK( 30, RIG_EDITOR,            "rig_editor",           "RigEd
 // ================================================================================
 
 ContentManager::ContentManager():
-	m_loaded_resource_packs(0)
+	  m_loaded_resource_packs(0)
+	, m_zip_archive_factory(nullptr)
 {
+	if (BSETTING("Zip Index", true))
+	{
+		size_t cache_bytes = static_cast<size_t>(std::max(0, ISETTING("Zip Cache Size", 16))) * 1024 * 1024;
+		m_zip_archive_factory = OGRE_NEW IndexedZipArchiveFactory(cache_bytes);
+		if (m_zip_archive_factory->GetIndex()->Load(SSETTING("Cache Path", "") + "zips.index"))
+		{
+			LOG("[RoR|ContentManager] Zip index loaded");
+		}
+		// Replaces Ogre's "Zip" factory. Never deleted: the ArchiveManager keeps using it until Ogre shuts down.
+		Ogre::ArchiveManager::getSingleton().addArchiveFactory(m_zip_archive_factory);
+	}
 }
 
 ContentManager::~ContentManager()
 {
+	SaveZipIndex();
+}
+
+void ContentManager::SaveZipIndex()
+{
+	if (m_zip_archive_factory != nullptr && !m_zip_archive_factory->GetIndex()->Save(SSETTING("Cache Path", "") + "zips.index"))
+	{
+		LOG("[RoR|ContentManager] Failed to save the zip index");
+	}
 }
 
 void ContentManager::AddResourcePack(ResourcePack const & resource_pack)
@@ -31,6 +31,8 @@
 
 #include <OgreResourceGroupManager.h>
 
+class IndexedZipArchiveFactory;
+
 namespace RoR
 {
 
@@ -89,6 +91,15 @@ public:
 	
 	bool init(void);
 
+	/** Writes the zip index to the cache directory, if it changed. */
+	void SaveZipIndex();
+
+	/** @return Null if the zip index is disabled. */
+	IndexedZipArchiveFactory* GetZipArchiveFactory()
+	{
+		return m_zip_archive_factory;
+	}
+
 protected:
 
 	ContentManager();
@@ -104,6 +115,8 @@ protected:
 
 	Ogre::uint64 m_loaded_resource_packs;
 
+	IndexedZipArchiveFactory* m_zip_archive_factory;
+
 };
 
 } // namespace RoR
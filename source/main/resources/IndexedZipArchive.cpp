@@ -0,0 +1,408 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   IndexedZipArchive.cpp
+*/
+
+#include "IndexedZipArchive.h"
+
+#include <OgreLogManager.h>
+#include <OgreStringConverter.h>
+#include <OgreZip.h>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Ogre;
+
+// Ogre::ZipArchive lists files by their base name, unless the resource manager is built strict
+#if OGRE_VERSION >= 0x010900 && !OGRE_RESOURCEMANAGER_STRICT
+#	define ZIP_ARCHIVE_BASENAMES 1
+#else
+#	define ZIP_ARCHIVE_BASENAMES 0
+#endif
+
+/** Files bigger than this are never kept in the entry cache. */
+static const size_t ZIP_ENTRY_CACHE_MAX_ENTRY_BYTES = 1024 * 1024;
+
+static const String ZIP_ARCHIVE_TYPE = "Zip";
+
+static StringVectorPtr newStringVector()
+{
+	return StringVectorPtr(OGRE_NEW_T(StringVector, MEMCATEGORY_GENERAL)(), SPFM_DELETE_T);
+}
+
+static FileInfoListPtr newFileInfoList()
+{
+	return FileInfoListPtr(OGRE_NEW_T(FileInfoList, MEMCATEGORY_GENERAL)(), SPFM_DELETE_T);
+}
+
+// ================================================================================
+// IndexedZipArchive
+// ================================================================================
+
+IndexedZipArchive::IndexedZipArchive(String const & name, String const & arch_type, IndexedZipArchiveFactory *factory, ZipIndex *index, ZipEntryCache *entry_cache):
+	  Archive(name, arch_type)
+	, m_factory(factory)
+	, m_index(index)
+	, m_entry_cache(entry_cache)
+	, m_indexed(false)
+	, m_modified_time(0)
+	, m_zip_archive(nullptr)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+IndexedZipArchive::~IndexedZipArchive()
+{
+	unload();
+	if (m_indexed)
+	{
+		m_factory->_RemoveArchiveEntries(mName, getEntryKeys());
+	}
+	pthread_mutex_destroy(&m_mutex);
+}
+
+std::vector<String> IndexedZipArchive::getEntryKeys() const
+{
+	std::vector<String> keys;
+	keys.reserve(m_entries.size());
+	for (std::unordered_map<String, Entry>::const_iterator it = m_entries.begin(); it != m_entries.end(); it++)
+	{
+		keys.push_back(it->first);
+	}
+	return keys;
+}
+
+void IndexedZipArchive::load()
+{
+	if (m_indexed)
+	{
+		m_factory->_RemoveArchiveEntries(mName, getEntryKeys());
+	}
+
+	std::vector<ZipIndex::FileRecord> records;
+	if (!m_index->GetArchive(mName, records, m_modified_time))
+	{
+		LogManager::getSingleton().logMessage("[RoR|ZipIndex] Unsupported zip file, using the standard zip archive: " + mName);
+		m_indexed = false;
+		getZipArchive();
+		return;
+	}
+
+	m_file_list.clear();
+	m_entries.clear();
+	m_file_list.reserve(records.size());
+	for (std::vector<ZipIndex::FileRecord>::iterator it = records.begin(); it != records.end(); it++)
+	{
+		FileInfo info;
+		info.archive          = this;
+		info.filename         = it->name;
+		info.compressedSize   = static_cast<size_t>(it->compressed_size);
+		info.uncompressedSize = static_cast<size_t>(it->uncompressed_size);
+		StringUtil::splitFilename(info.filename, info.basename, info.path);
+
+		if (info.basename.empty())
+		{
+			// directory, see Ogre::ZipArchive::load()
+			info.filename = info.filename.substr(0, info.filename.length() - 1);
+			StringUtil::splitFilename(info.filename, info.basename, info.path);
+			info.compressedSize = size_t(-1);
+		}
+		else
+		{
+			Entry entry;
+			entry.full_name = it->name;
+			entry.crc       = it->crc;
+
+			String key = it->name;
+			StringUtil::toLowerCase(key);
+			m_entries[key] = entry;
+#if ZIP_ARCHIVE_BASENAMES
+			key = info.basename;
+			StringUtil::toLowerCase(key);
+			m_entries.insert(std::make_pair(key, entry)); // first one wins, like in Ogre
+			info.filename = info.basename;
+#endif
+		}
+		m_file_list.push_back(info);
+	}
+	m_indexed = true;
+	m_factory->_AddArchiveEntries(mName, getEntryKeys());
+}
+
+void IndexedZipArchive::unload()
+{
+	pthread_mutex_lock(&m_mutex);
+	if (m_zip_archive != nullptr)
+	{
+		m_zip_archive->unload();
+		OGRE_DELETE m_zip_archive;
+		m_zip_archive = nullptr;
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+Archive* IndexedZipArchive::getZipArchive() const
+{
+	pthread_mutex_lock(&m_mutex);
+	if (m_zip_archive == nullptr)
+	{
+		m_zip_archive = OGRE_NEW ZipArchive(mName, ZIP_ARCHIVE_TYPE);
+		m_zip_archive->load();
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return m_zip_archive;
+}
+
+const IndexedZipArchive::Entry* IndexedZipArchive::findEntry(String const & filename) const
+{
+	String key = filename;
+	StringUtil::toLowerCase(key);
+	std::unordered_map<String, Entry>::const_iterator found = m_entries.find(key);
+#if ZIP_ARCHIVE_BASENAMES
+	if (found == m_entries.end())
+	{
+		String basename, path;
+		StringUtil::splitFilename(key, basename, path);
+		found = m_entries.find(basename);
+	}
+#endif
+	return (found != m_entries.end()) ? &found->second : nullptr;
+}
+
+DataStreamPtr IndexedZipArchive::open(String const & filename, bool readOnly) const
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->open(filename, readOnly);
+	}
+
+	const Entry *entry = findEntry(filename);
+	if (entry == nullptr)
+	{
+		return DataStreamPtr();
+	}
+
+	String cache_key = mName + "\n" + entry->full_name + "\n" + StringConverter::toString(entry->crc);
+	std::vector<char> data;
+	if (m_entry_cache != nullptr && m_entry_cache->Get(cache_key, data))
+	{
+		MemoryDataStream *stream = OGRE_NEW MemoryDataStream(filename, data.size(), true, true);
+		memcpy(stream->getPtr(), &data[0], data.size());
+		return DataStreamPtr(stream);
+	}
+
+	DataStreamPtr stream = getZipArchive()->open(entry->full_name, readOnly);
+	if (stream.isNull() || m_entry_cache == nullptr || !m_entry_cache->IsCacheable(stream->size()))
+	{
+		return stream;
+	}
+
+	MemoryDataStream *memory_stream = OGRE_NEW MemoryDataStream(filename, stream);
+	m_entry_cache->Put(cache_key, reinterpret_cast<const char *>(memory_stream->getPtr()), memory_stream->size());
+	return DataStreamPtr(memory_stream);
+}
+
+StringVectorPtr IndexedZipArchive::list(bool recursive, bool dirs)
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->list(recursive, dirs);
+	}
+
+	StringVectorPtr ret = newStringVector();
+	for (FileInfoList::const_iterator it = m_file_list.begin(); it != m_file_list.end(); it++)
+	{
+		if ((dirs == (it->compressedSize == size_t(-1))) && (recursive || it->path.empty()))
+		{
+			ret->push_back(it->filename);
+		}
+	}
+	return ret;
+}
+
+FileInfoListPtr IndexedZipArchive::listFileInfo(bool recursive, bool dirs)
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->listFileInfo(recursive, dirs);
+	}
+
+	FileInfoListPtr ret = newFileInfoList();
+	for (FileInfoList::const_iterator it = m_file_list.begin(); it != m_file_list.end(); it++)
+	{
+		if ((dirs == (it->compressedSize == size_t(-1))) && (recursive || it->path.empty()))
+		{
+			ret->push_back(*it);
+		}
+	}
+	return ret;
+}
+
+StringVectorPtr IndexedZipArchive::find(String const & pattern, bool recursive, bool dirs)
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->find(pattern, recursive, dirs);
+	}
+
+	StringVectorPtr ret = newStringVector();
+	FileInfoListPtr found = findFileInfo(pattern, recursive, dirs);
+	for (FileInfoList::const_iterator it = found->begin(); it != found->end(); it++)
+	{
+		ret->push_back(it->filename);
+	}
+	return ret;
+}
+
+FileInfoListPtr IndexedZipArchive::findFileInfo(String const & pattern, bool recursive, bool dirs) const
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->findFileInfo(pattern, recursive, dirs);
+	}
+
+	// same rules as Ogre::ZipArchive::find()
+	bool wild_card = (pattern.find("*") != String::npos);
+	bool full_match = (pattern.find('/') != String::npos) || (pattern.find('\\') != String::npos);
+
+	FileInfoListPtr ret = newFileInfoList();
+	for (FileInfoList::const_iterator it = m_file_list.begin(); it != m_file_list.end(); it++)
+	{
+		if ((dirs == (it->compressedSize == size_t(-1))) && (recursive || full_match || wild_card))
+		{
+			if (StringUtil::match(full_match ? it->filename : it->basename, pattern, false))
+			{
+				ret->push_back(*it);
+			}
+		}
+	}
+	return ret;
+}
+
+bool IndexedZipArchive::exists(String const & filename)
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->exists(filename);
+	}
+	return findEntry(filename) != nullptr;
+}
+
+time_t IndexedZipArchive::getModifiedTime(String const & filename)
+{
+	if (!m_indexed)
+	{
+		return getZipArchive()->getModifiedTime(filename);
+	}
+	return m_modified_time;
+}
+
+// ================================================================================
+// IndexedZipArchiveFactory
+// ================================================================================
+
+IndexedZipArchiveFactory::IndexedZipArchiveFactory(size_t cache_bytes):
+	m_entry_cache(cache_bytes, ZIP_ENTRY_CACHE_MAX_ENTRY_BYTES)
+{
+	pthread_mutex_init(&m_entry_archives_mutex, NULL);
+}
+
+IndexedZipArchiveFactory::~IndexedZipArchiveFactory()
+{
+	pthread_mutex_destroy(&m_entry_archives_mutex);
+}
+
+const String& IndexedZipArchiveFactory::getType() const
+{
+	return ZIP_ARCHIVE_TYPE;
+}
+
+#if OGRE_VERSION >= 0x010900
+Archive* IndexedZipArchiveFactory::createInstance(String const & name, bool readOnly)
+#else
+Archive* IndexedZipArchiveFactory::createInstance(String const & name)
+#endif
+{
+	return OGRE_NEW IndexedZipArchive(name, ZIP_ARCHIVE_TYPE, this, &m_index, &m_entry_cache);
+}
+
+void IndexedZipArchiveFactory::destroyInstance(Archive* archive)
+{
+	OGRE_DELETE archive;
+}
+
+void IndexedZipArchiveFactory::FindArchives(String const & filename, StringVector &archives)
+{
+	String key = filename;
+	StringUtil::toLowerCase(key);
+
+	pthread_mutex_lock(&m_entry_archives_mutex);
+	std::unordered_map<String, StringVector>::const_iterator found = m_entry_archives.find(key);
+#if ZIP_ARCHIVE_BASENAMES
+	if (found == m_entry_archives.end())
+	{
+		String basename, path;
+		StringUtil::splitFilename(key, basename, path);
+		found = m_entry_archives.find(basename);
+	}
+#endif
+	if (found != m_entry_archives.end())
+	{
+		archives.insert(archives.end(), found->second.begin(), found->second.end());
+	}
+	pthread_mutex_unlock(&m_entry_archives_mutex);
+}
+
+void IndexedZipArchiveFactory::_AddArchiveEntries(String const & archive, std::vector<String> const & keys)
+{
+	pthread_mutex_lock(&m_entry_archives_mutex);
+	for (std::vector<String>::const_iterator it = keys.begin(); it != keys.end(); it++)
+	{
+		m_entry_archives[*it].push_back(archive);
+	}
+	pthread_mutex_unlock(&m_entry_archives_mutex);
+}
+
+void IndexedZipArchiveFactory::_RemoveArchiveEntries(String const & archive, std::vector<String> const & keys)
+{
+	pthread_mutex_lock(&m_entry_archives_mutex);
+	for (std::vector<String>::const_iterator it = keys.begin(); it != keys.end(); it++)
+	{
+		std::unordered_map<String, StringVector>::iterator found = m_entry_archives.find(*it);
+		if (found == m_entry_archives.end())
+		{
+			continue;
+		}
+		StringVector::iterator pos = std::find(found->second.begin(), found->second.end(), archive);
+		if (pos != found->second.end())
+		{
+			found->second.erase(pos);
+		}
+		if (found->second.empty())
+		{
+			m_entry_archives.erase(found);
+		}
+	}
+	pthread_mutex_unlock(&m_entry_archives_mutex);
+}
@@ -0,0 +1,151 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   IndexedZipArchive.h
+	@brief  Zip archive for Ogre resource groups, listed from ZipIndex instead of opening the zip file.
+*/
+
+#pragma once
+
+#include "ZipIndex.h"
+
+#include <OgreArchive.h>
+#include <OgreArchiveFactory.h>
+
+#include <pthread.h>
+#include <unordered_map>
+
+class IndexedZipArchiveFactory;
+
+/**
+	@class  IndexedZipArchive
+
+	@brief Drop-in replacement of Ogre's "Zip" archive.
+
+	Adding a zip to a resource group makes Ogre list and search its contents right away,
+	which used to open every mod zip on each start. Here the listing comes from ZipIndex;
+	the real Ogre::ZipArchive is only created when a file is actually opened, and small
+	files are served from ZipEntryCache when opened repeatedly.
+
+	File names, search and listing behave exactly as in Ogre::ZipArchive.
+*/
+class IndexedZipArchive : public Ogre::Archive
+{
+
+public:
+
+	IndexedZipArchive(Ogre::String const & name, Ogre::String const & arch_type, IndexedZipArchiveFactory *factory, ZipIndex *index, ZipEntryCache *entry_cache);
+	~IndexedZipArchive();
+
+	bool isCaseSensitive() const { return false; }
+
+	void load();
+	void unload();
+
+	Ogre::DataStreamPtr open(Ogre::String const & filename, bool readOnly = true) const;
+
+	Ogre::StringVectorPtr list(bool recursive = true, bool dirs = false);
+	Ogre::FileInfoListPtr listFileInfo(bool recursive = true, bool dirs = false);
+	Ogre::StringVectorPtr find(Ogre::String const & pattern, bool recursive = true, bool dirs = false);
+	Ogre::FileInfoListPtr findFileInfo(Ogre::String const & pattern, bool recursive = true, bool dirs = false) const;
+	bool exists(Ogre::String const & filename);
+	time_t getModifiedTime(Ogre::String const & filename);
+
+protected:
+
+	struct Entry
+	{
+		Ogre::String  full_name; //!< name inside the zip file
+		uint32_t      crc;
+	};
+
+	/** @return The delegate archive, created and loaded on first use. */
+	Ogre::Archive* getZipArchive() const;
+
+	const Entry* findEntry(Ogre::String const & filename) const;
+
+	/** @return Keys of m_entries, as registered in the factory's lookup. */
+	std::vector<Ogre::String> getEntryKeys() const;
+
+	IndexedZipArchiveFactory*                       m_factory;
+	ZipIndex*                                       m_index;
+	ZipEntryCache*                                  m_entry_cache;
+	bool                                            m_indexed;         //!< false = index not available, everything goes to the delegate
+	Ogre::FileInfoList                              m_file_list;
+	std::unordered_map<Ogre::String, Entry>         m_entries;         //!< lowercase file name -> entry
+	std::time_t                                     m_modified_time;
+	mutable Ogre::Archive*                          m_zip_archive;
+	mutable pthread_mutex_t                         m_mutex;
+};
+
+/**
+	@class  IndexedZipArchiveFactory
+
+	@brief Registered under the type "Zip", so it replaces Ogre's zip archive factory everywhere.
+*/
+class IndexedZipArchiveFactory : public Ogre::ArchiveFactory
+{
+
+public:
+
+	/**
+	* @param cache_bytes Size of the unpacked entry cache, 0 = disabled.
+	*/
+	IndexedZipArchiveFactory(size_t cache_bytes);
+	~IndexedZipArchiveFactory();
+
+	const Ogre::String& getType() const;
+
+#if OGRE_VERSION >= 0x010900
+	Ogre::Archive* createInstance(Ogre::String const & name, bool readOnly);
+	Ogre::Archive* createInstance(Ogre::String const & name) { return createInstance(name, true); }
+#else
+	Ogre::Archive* createInstance(Ogre::String const & name);
+#endif
+
+	void destroyInstance(Ogre::Archive* archive);
+
+	ZipIndex* GetIndex()
+	{
+		return &m_index;
+	}
+
+	/**
+	* Looks the file up in all loaded indexed archives at once; same name rules as IndexedZipArchive::exists().
+	* @param archives [out] Names of the archives containing the file, in load order.
+	*/
+	void FindArchives(Ogre::String const & filename, Ogre::StringVector &archives);
+
+	/** Called by IndexedZipArchive::load(). @param keys Lowercase file names the archive answers to. */
+	void _AddArchiveEntries(Ogre::String const & archive, std::vector<Ogre::String> const & keys);
+
+	/** Called when an IndexedZipArchive is unloaded or destroyed. */
+	void _RemoveArchiveEntries(Ogre::String const & archive, std::vector<Ogre::String> const & keys);
+
+protected:
+
+	ZipIndex       m_index;
+	ZipEntryCache  m_entry_cache;
+
+	std::unordered_map<Ogre::String, Ogre::StringVector> m_entry_archives; //!< lowercase file name -> names of the loaded archives containing it
+	pthread_mutex_t                                      m_entry_archives_mutex;
+};
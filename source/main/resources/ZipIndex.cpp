@@ -0,0 +1,455 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   ZipIndex.cpp
+*/
+
+#include "ZipIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+static const char MAGIC_NUMBER[8] = {'R', 'o', 'R', 'Z', 'i', 'p', 'I', '\0'};
+
+// zip format, see PKWARE APPNOTE.TXT
+static const uint32_t ZIP_END_OF_CENTRAL_DIR_SIGNATURE  = 0x06054b50;
+static const uint32_t ZIP_CENTRAL_DIR_HEADER_SIGNATURE  = 0x02014b50;
+static const size_t   ZIP_END_OF_CENTRAL_DIR_SIZE       = 22;
+static const size_t   ZIP_CENTRAL_DIR_HEADER_SIZE       = 46;
+static const size_t   ZIP_MAX_COMMENT_SIZE              = 0xFFFF;
+
+static uint16_t readU16(const unsigned char *p)
+{
+	return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const unsigned char *p)
+{
+	return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static bool statFile(Ogre::String const & path, uint64_t &size, int64_t &mtime)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+	{
+		return false;
+	}
+	size = static_cast<uint64_t>(st.st_size);
+	mtime = static_cast<int64_t>(st.st_mtime);
+	return true;
+}
+
+// ================================================================================
+// Index file helpers
+// ================================================================================
+
+class IndexWriter
+{
+public:
+
+	template<typename T> void Write(T value)
+	{
+		const char *p = reinterpret_cast<const char *>(&value);
+		buffer.insert(buffer.end(), p, p + sizeof(T));
+	}
+
+	void WriteString(Ogre::String const & str)
+	{
+		Write(static_cast<uint32_t>(str.size()));
+		buffer.insert(buffer.end(), str.begin(), str.end());
+	}
+
+	std::vector<char> buffer;
+};
+
+class IndexReader
+{
+public:
+
+	IndexReader(const char *data, size_t size):
+		  m_pos(data)
+		, m_end(data + size)
+	{}
+
+	template<typename T> bool Read(T &value)
+	{
+		if (static_cast<size_t>(m_end - m_pos) < sizeof(T))
+			return false;
+		memcpy(&value, m_pos, sizeof(T));
+		m_pos += sizeof(T);
+		return true;
+	}
+
+	bool ReadString(Ogre::String &str)
+	{
+		uint32_t length = 0;
+		if (!Read(length) || static_cast<size_t>(m_end - m_pos) < length)
+			return false;
+		str.assign(m_pos, length);
+		m_pos += length;
+		return true;
+	}
+
+	bool IsAtEnd() const
+	{
+		return m_pos == m_end;
+	}
+
+private:
+
+	const char *m_pos;
+	const char *m_end;
+};
+
+// ================================================================================
+// ZipIndex
+// ================================================================================
+
+ZipIndex::ZipIndex():
+	m_dirty(false)
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+ZipIndex::~ZipIndex()
+{
+	pthread_mutex_destroy(&m_mutex);
+}
+
+bool ZipIndex::Load(Ogre::String const & filename)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+	std::vector<char> data;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size > 0)
+	{
+		data.resize(static_cast<size_t>(size));
+		if (fread(&data[0], 1, data.size(), file) != data.size())
+		{
+			data.clear();
+		}
+	}
+	fclose(file);
+
+	IndexReader reader(data.empty() ? NULL : &data[0], data.size());
+	char magic[8];
+	uint32_t version = 0, num_archives = 0;
+	if (!reader.Read(magic) || memcmp(magic, MAGIC_NUMBER, sizeof(magic)) != 0 || !reader.Read(version) || version != FORMAT_VERSION || !reader.Read(num_archives))
+	{
+		return false;
+	}
+
+	std::map<Ogre::String, ArchiveRecord> archives;
+	for (uint32_t i = 0; i < num_archives; i++)
+	{
+		Ogre::String path;
+		ArchiveRecord archive;
+		uint32_t num_files = 0;
+		if (!reader.ReadString(path) || !reader.Read(archive.size) || !reader.Read(archive.mtime) || !reader.Read(num_files))
+		{
+			return false;
+		}
+		archive.used = false;
+		for (uint32_t j = 0; j < num_files; j++)
+		{
+			FileRecord record;
+			if (!reader.ReadString(record.name) || !reader.Read(record.crc) || !reader.Read(record.offset) || !reader.Read(record.compressed_size) || !reader.Read(record.uncompressed_size))
+			{
+				return false;
+			}
+			archive.files.push_back(record);
+		}
+		archives[path] = archive;
+	}
+	if (!reader.IsAtEnd())
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_archives.swap(archives);
+	m_dirty = false;
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+bool ZipIndex::Save(Ogre::String const & filename)
+{
+	IndexWriter writer;
+
+	pthread_mutex_lock(&m_mutex);
+	if (!m_dirty)
+	{
+		pthread_mutex_unlock(&m_mutex);
+		return true;
+	}
+	std::vector<const std::pair<const Ogre::String, ArchiveRecord> *> archives;
+	for (std::map<Ogre::String, ArchiveRecord>::iterator it = m_archives.begin(); it != m_archives.end(); it++)
+	{
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		if (it->second.used || statFile(it->first, size, mtime))
+		{
+			archives.push_back(&(*it));
+		}
+	}
+
+	writer.buffer.insert(writer.buffer.end(), MAGIC_NUMBER, MAGIC_NUMBER + sizeof(MAGIC_NUMBER));
+	writer.Write(FORMAT_VERSION);
+	writer.Write(static_cast<uint32_t>(archives.size()));
+	for (size_t i = 0; i < archives.size(); i++)
+	{
+		const ArchiveRecord &archive = archives[i]->second;
+		writer.WriteString(archives[i]->first);
+		writer.Write(archive.size);
+		writer.Write(archive.mtime);
+		writer.Write(static_cast<uint32_t>(archive.files.size()));
+		for (std::vector<FileRecord>::const_iterator it = archive.files.begin(); it != archive.files.end(); it++)
+		{
+			writer.WriteString(it->name);
+			writer.Write(it->crc);
+			writer.Write(it->offset);
+			writer.Write(it->compressed_size);
+			writer.Write(it->uncompressed_size);
+		}
+	}
+	m_dirty = false;
+	pthread_mutex_unlock(&m_mutex);
+
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (!file)
+	{
+		return false;
+	}
+	bool ok = (fwrite(&writer.buffer[0], 1, writer.buffer.size(), file) == writer.buffer.size());
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+	{
+		remove(filename.c_str());
+	}
+	return ok;
+}
+
+bool ZipIndex::GetArchive(Ogre::String const & path, std::vector<FileRecord> &files, std::time_t &mtime)
+{
+	uint64_t file_size = 0;
+	int64_t file_mtime = 0;
+	if (!statFile(path, file_size, file_mtime))
+	{
+		return false;
+	}
+	mtime = static_cast<std::time_t>(file_mtime);
+
+	pthread_mutex_lock(&m_mutex);
+	std::map<Ogre::String, ArchiveRecord>::iterator found = m_archives.find(path);
+	if (found != m_archives.end() && found->second.size == file_size && found->second.mtime == file_mtime)
+	{
+		found->second.used = true;
+		files = found->second.files;
+		pthread_mutex_unlock(&m_mutex);
+		return true;
+	}
+	pthread_mutex_unlock(&m_mutex);
+
+	// new or changed archive
+	if (!ReadCentralDirectory(path, files))
+	{
+		return false;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	ArchiveRecord &archive = m_archives[path];
+	archive.size = file_size;
+	archive.mtime = file_mtime;
+	archive.used = true;
+	archive.files = files;
+	m_dirty = true;
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+bool ZipIndex::ReadCentralDirectory(Ogre::String const & path, std::vector<FileRecord> &files)
+{
+	files.clear();
+
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+	fseek(file, 0, SEEK_END);
+	long file_size = ftell(file);
+	if (file_size < static_cast<long>(ZIP_END_OF_CENTRAL_DIR_SIZE))
+	{
+		fclose(file);
+		return false;
+	}
+
+	// the end of central directory record is followed only by the archive comment
+	size_t tail_size = static_cast<size_t>(std::min<long>(file_size, ZIP_END_OF_CENTRAL_DIR_SIZE + ZIP_MAX_COMMENT_SIZE));
+	std::vector<unsigned char> tail(tail_size);
+	fseek(file, file_size - static_cast<long>(tail_size), SEEK_SET);
+	if (fread(&tail[0], 1, tail_size, file) != tail_size)
+	{
+		fclose(file);
+		return false;
+	}
+
+	const unsigned char *eocd = NULL;
+	for (size_t pos = tail_size - ZIP_END_OF_CENTRAL_DIR_SIZE + 1; pos > 0; pos--)
+	{
+		const unsigned char *p = &tail[pos - 1];
+		if (readU32(p) == ZIP_END_OF_CENTRAL_DIR_SIGNATURE && pos - 1 + ZIP_END_OF_CENTRAL_DIR_SIZE + readU16(p + 20) == tail_size)
+		{
+			eocd = p;
+			break;
+		}
+	}
+	if (!eocd)
+	{
+		fclose(file);
+		return false;
+	}
+
+	uint16_t disk_number    = readU16(eocd + 4);
+	uint16_t cd_disk_number = readU16(eocd + 6);
+	uint16_t num_entries    = readU16(eocd + 10);
+	uint32_t cd_size        = readU32(eocd + 12);
+	uint32_t cd_offset      = readU32(eocd + 16);
+
+	// zip64 stores 0xFFFF... here, split archives use disk numbers; leave those to Ogre
+	if (disk_number != 0 || cd_disk_number != 0 || num_entries == 0xFFFF || cd_size == 0xFFFFFFFF || cd_offset == 0xFFFFFFFF
+		|| static_cast<uint64_t>(cd_offset) + cd_size > static_cast<uint64_t>(file_size))
+	{
+		fclose(file);
+		return false;
+	}
+
+	std::vector<unsigned char> cd(cd_size);
+	if (cd_size > 0)
+	{
+		fseek(file, static_cast<long>(cd_offset), SEEK_SET);
+		if (fread(&cd[0], 1, cd_size, file) != cd_size)
+		{
+			fclose(file);
+			return false;
+		}
+	}
+	fclose(file);
+
+	files.reserve(num_entries);
+	size_t pos = 0;
+	for (uint16_t i = 0; i < num_entries; i++)
+	{
+		if (cd_size - pos < ZIP_CENTRAL_DIR_HEADER_SIZE || readU32(&cd[pos]) != ZIP_CENTRAL_DIR_HEADER_SIGNATURE)
+		{
+			files.clear();
+			return false;
+		}
+		const unsigned char *header = &cd[pos];
+		size_t name_length    = readU16(header + 28);
+		size_t extra_length   = readU16(header + 30);
+		size_t comment_length = readU16(header + 32);
+		if (cd_size - pos - ZIP_CENTRAL_DIR_HEADER_SIZE < name_length + extra_length + comment_length)
+		{
+			files.clear();
+			return false;
+		}
+
+		FileRecord record;
+		record.name.assign(reinterpret_cast<const char *>(header + ZIP_CENTRAL_DIR_HEADER_SIZE), name_length);
+		record.crc               = readU32(header + 16);
+		record.compressed_size   = readU32(header + 20);
+		record.uncompressed_size = readU32(header + 24);
+		record.offset            = readU32(header + 42);
+		files.push_back(record);
+
+		pos += ZIP_CENTRAL_DIR_HEADER_SIZE + name_length + extra_length + comment_length;
+	}
+	return true;
+}
+
+// ================================================================================
+// ZipEntryCache
+// ================================================================================
+
+ZipEntryCache::ZipEntryCache(size_t max_bytes, size_t max_entry_bytes):
+	  m_bytes(0)
+	, m_max_bytes(max_bytes)
+	, m_max_entry_bytes(std::min(max_entry_bytes, max_bytes))
+{
+	pthread_mutex_init(&m_mutex, NULL);
+}
+
+ZipEntryCache::~ZipEntryCache()
+{
+	pthread_mutex_destroy(&m_mutex);
+}
+
+bool ZipEntryCache::Get(Ogre::String const & key, std::vector<char> &data)
+{
+	pthread_mutex_lock(&m_mutex);
+	std::unordered_map<Ogre::String, EntryList::iterator>::iterator found = m_lookup.find(key);
+	if (found == m_lookup.end())
+	{
+		pthread_mutex_unlock(&m_mutex);
+		return false;
+	}
+	// move to front
+	m_entries.splice(m_entries.begin(), m_entries, found->second);
+	data = found->second->second;
+	pthread_mutex_unlock(&m_mutex);
+	return true;
+}
+
+void ZipEntryCache::Put(Ogre::String const & key, const char *data, size_t size)
+{
+	if (!IsCacheable(size))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	if (m_lookup.find(key) == m_lookup.end())
+	{
+		m_entries.push_front(std::make_pair(key, std::vector<char>(data, data + size)));
+		m_lookup[key] = m_entries.begin();
+		m_bytes += size;
+
+		// evict least recently used
+		while (m_bytes > m_max_bytes && !m_entries.empty())
+		{
+			m_bytes -= m_entries.back().second.size();
+			m_lookup.erase(m_entries.back().first);
+			m_entries.pop_back();
+		}
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
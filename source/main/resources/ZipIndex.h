@@ -0,0 +1,143 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   ZipIndex.h
+	@brief  Persistent table of contents of zip archives, and a cache of unpacked zip entries.
+*/
+
+#pragma once
+
+#include <OgreString.h>
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <pthread.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+	@class  ZipIndex
+
+	@brief Remembers the central directory of every zip archive seen, so it doesn't need to be read on each start.
+
+	Records are keyed by archive path and validated by file size and modification time;
+	a changed archive gets its central directory read again. Only plain zip files are
+	supported (no zip64, no multi-disk archives); GetArchive() fails for everything else
+	and the caller should fall back to Ogre's zip archive.
+
+	All functions are thread-safe.
+*/
+class ZipIndex
+{
+
+public:
+
+	/** IMPORTANT! Increment whenever the file layout changes. */
+	static const uint32_t FORMAT_VERSION = 1;
+
+	struct FileRecord
+	{
+		Ogre::String  name;              //!< full path inside the archive, directories end with '/'
+		uint32_t      crc;
+		uint64_t      offset;            //!< offset of the local file header
+		uint64_t      compressed_size;
+		uint64_t      uncompressed_size;
+	};
+
+	ZipIndex();
+	~ZipIndex();
+
+	/** Loads the records written by Save(); missing or outdated files are ignored. */
+	bool Load(Ogre::String const & filename);
+
+	/** Writes the records if anything changed since Load(). Records of archives which no longer exist are dropped. */
+	bool Save(Ogre::String const & filename);
+
+	/**
+	* @param files [out] Contents of the archive, in central directory order.
+	* @return False if the archive can't be read or isn't supported.
+	*/
+	bool GetArchive(Ogre::String const & path, std::vector<FileRecord> &files, std::time_t &mtime);
+
+	/** Reads the central directory directly from the zip file. */
+	static bool ReadCentralDirectory(Ogre::String const & path, std::vector<FileRecord> &files);
+
+protected:
+
+	struct ArchiveRecord
+	{
+		uint64_t                 size;
+		int64_t                  mtime;
+		bool                     used;   //!< looked up in this session
+		std::vector<FileRecord>  files;
+	};
+
+	std::map<Ogre::String, ArchiveRecord> m_archives;
+	bool                                  m_dirty;
+	pthread_mutex_t                       m_mutex;
+};
+
+/**
+	@class  ZipEntryCache
+
+	@brief Small LRU cache of unpacked zip entries, so frequently opened files don't need to be inflated again.
+
+	All functions are thread-safe.
+*/
+class ZipEntryCache
+{
+
+public:
+
+	/**
+	* @param max_bytes        Total size of cached data.
+	* @param max_entry_bytes  Bigger entries are not cached.
+	*/
+	ZipEntryCache(size_t max_bytes, size_t max_entry_bytes);
+	~ZipEntryCache();
+
+	bool IsCacheable(size_t size) const
+	{
+		return size > 0 && size <= m_max_entry_bytes;
+	}
+
+	/**
+	* @param data [out] Copy of the cached entry.
+	* @return False if not cached.
+	*/
+	bool Get(Ogre::String const & key, std::vector<char> &data);
+
+	void Put(Ogre::String const & key, const char *data, size_t size);
+
+protected:
+
+	typedef std::list<std::pair<Ogre::String, std::vector<char> > > EntryList; //!< most recently used first
+
+	EntryList                                                 m_entries;
+	std::unordered_map<Ogre::String, EntryList::iterator>     m_lookup;
+	size_t                                                    m_bytes;
+	size_t                                                    m_max_bytes;
+	size_t                                                    m_max_entry_bytes;
+	pthread_mutex_t                                           m_mutex;
+};
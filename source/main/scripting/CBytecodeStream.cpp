@@ -21,30 +21,101 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "CBytecodeStream.h"
 
-CBytecodeStream::CBytecodeStream(std::string filename) : f(0)
+#include "SHA1.h"
+
+#include <cstring>
+
+// file layout: magic, data size, SHA1 of data, data
+static const char BYTECODE_MAGIC[8] = {'R', 'o', 'R', 'A', 'S', 'B', 'C', '1'};
+static const size_t BYTECODE_HASH_SIZE = 20;
+
+static void hashData(const std::vector<char> &data, uint8_t *hash)
 {
-	f = fopen(filename.c_str(), "wb");
+	RoR::CSHA1 sha1;
+	if (!data.empty())
+		sha1.UpdateHash((uint8_t *)&data[0], (uint32_t)data.size());
+	sha1.Final();
+	sha1.GetHash(hash);
+}
+
+CBytecodeStream::CBytecodeStream(std::string filename, Mode mode) : filename(filename), mode(mode), f(0), readPos(0), valid(false), failed(false)
+{
+	if (mode == MODE_WRITE)
+	{
+		f = fopen(filename.c_str(), "wb");
+		valid = (f != 0);
+		return;
+	}
+
+	f = fopen(filename.c_str(), "rb");
+	if (!f) return;
+
+	char magic[sizeof(BYTECODE_MAGIC)];
+	uint32_t size = 0;
+	uint8_t hash[BYTECODE_HASH_SIZE], expected_hash[BYTECODE_HASH_SIZE];
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, BYTECODE_MAGIC, sizeof(magic)) != 0)
+		return;
+	if (fread(&size, sizeof(size), 1, f) != 1 || fread(expected_hash, sizeof(expected_hash), 1, f) != 1)
+		return;
+
+	// the size must match the file exactly
+	long data_start = ftell(f);
+	fseek(f, 0, SEEK_END);
+	if (ftell(f) - data_start != (long)size)
+		return;
+	fseek(f, data_start, SEEK_SET);
+
+	data.resize(size);
+	if (size > 0 && fread(&data[0], size, 1, f) != 1)
+		return;
+
+	hashData(data, hash);
+	valid = (memcmp(hash, expected_hash, sizeof(hash)) == 0);
 }
 
 CBytecodeStream::~CBytecodeStream()
 {
+	if (f && mode == MODE_WRITE)
+	{
+		uint32_t size = (uint32_t)data.size();
+		uint8_t hash[BYTECODE_HASH_SIZE];
+		hashData(data, hash);
+
+		bool ok = fwrite(BYTECODE_MAGIC, sizeof(BYTECODE_MAGIC), 1, f) == 1
+			&& fwrite(&size, sizeof(size), 1, f) == 1
+			&& fwrite(hash, sizeof(hash), 1, f) == 1
+			&& (data.empty() || fwrite(&data[0], data.size(), 1, f) == 1);
+		ok = (fclose(f) == 0) && ok;
+		f = 0;
+		if (!ok)
+			remove(filename.c_str());
+	}
 	if (f)
 		fclose(f);
 }
 
 void CBytecodeStream::Write(const void *ptr, AngelScript::asUINT size)
 {
-	if (!f) return;
-	fwrite(ptr, size, 1, f);
+	if (!f || mode != MODE_WRITE) return;
+	const char *bytes = (const char *)ptr;
+	data.insert(data.end(), bytes, bytes + size);
 }
 
 void CBytecodeStream::Read(void *ptr, AngelScript::asUINT size)
 {
-	if (!f) return;
-	fread(ptr, size, 1, f);
+	if (!valid || mode != MODE_READ || data.size() - readPos < size)
+	{
+		// AngelScript doesn't check for errors, give it zeros and report the failure afterwards
+		memset(ptr, 0, size);
+		readPos = data.size();
+		failed = true;
+		return;
+	}
+	memcpy(ptr, &data[readPos], size);
+	readPos += size;
 }
 
 bool CBytecodeStream::Existing()
 {
-	return (f != 0);
+	return valid;
 }
@@ -25,17 +25,39 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "RoRPrerequisites.h"
 
 #include <angelscript.h>
-
+#include <vector>
+
+/**
+ * Compiled script module stored in a file.
+ * The bytecode is kept in memory and written to the file by the destructor together with
+ * its size and checksum. When reading, the whole file is checked first, so AngelScript never
+ * gets truncated or damaged bytecode (LoadByteCode() doesn't survive that).
+ */
 class CBytecodeStream : public AngelScript::asIBinaryStream
 {
 public:
-	CBytecodeStream(std::string filename);
+	enum Mode
+	{
+		MODE_READ,
+		MODE_WRITE
+	};
+
+	CBytecodeStream(std::string filename, Mode mode = MODE_WRITE);
 	~CBytecodeStream();
 	void Read(void *ptr, AngelScript::asUINT size);
 	void Write(const void *ptr, AngelScript::asUINT size);
+	/** @return True if the file was opened (MODE_WRITE) or found and valid (MODE_READ). */
 	bool Existing();
+	/** @return True if AngelScript attempted to read past the end of the data. */
+	bool Failed() { return failed; };
 private:
+	std::string filename;
+	Mode mode;
 	FILE *f;
+	std::vector<char> data;
+	size_t readPos;
+	bool valid;
+	bool failed;
 };
 
 #endif //CBYTECODEESTREAM_H__
\ No newline at end of file
@@ -59,8 +59,29 @@ int OgreScriptBuilder::LoadScriptSection(const char *filename)
 		sha1.UpdateHash((uint8_t *)code.c_str(), (uint32_t)code.size());
 		sha1.Final();
 		sha1.ReportHash(hash_result, RoR::CSHA1::REPORT_HEX_SHORT);
-		hash = String(hash_result);
+		sectionHashes += scriptFile + "\n" + String(hash_result) + "\n";
 	}
 
 	return ProcessScriptSection(code.c_str(), filename);
 }
+
+String OgreScriptBuilder::getHash()
+{
+	return hashString(sectionHashes);
+}
+
+String OgreScriptBuilder::getCacheKey()
+{
+	return hashString(interfaceVersion + "\n" + sectionHashes);
+}
+
+String OgreScriptBuilder::hashString(const String &hash_input)
+{
+	char hash_result[250];
+	memset(hash_result, 0, 249);
+	RoR::CSHA1 sha1;
+	sha1.UpdateHash((uint8_t *)hash_input.c_str(), (uint32_t)hash_input.size());
+	sha1.Final();
+	sha1.ReportHash(hash_result, RoR::CSHA1::REPORT_HEX_SHORT);
+	return String(hash_result);
+}
@@ -33,10 +33,22 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 class OgreScriptBuilder : public AngelScript::CScriptBuilder, public ZeroedMemoryAllocator
 {
 public:
-	Ogre::String getHash() { return hash; };
+	/**
+	 * Identifies the compiled module: part of getCacheKey(), so the key changes
+	 * whenever the registered application interface does.
+	 */
+	void setInterfaceVersion(const Ogre::String &version) { interfaceVersion = version; };
+
+	/** @return Hash of all loaded sections, including the #included ones; the same on every build. */
+	Ogre::String getHash();
+
+	/** @return Hash of the interface version and all loaded sections, identifies the bytecode. */
+	Ogre::String getCacheKey();
 protected:
-	Ogre::String hash;
+	Ogre::String interfaceVersion;
+	Ogre::String sectionHashes; //!< name and hash of each loaded section, in load order
 	int LoadScriptSection(const char *filename);
+	static Ogre::String hashString(const Ogre::String &hash_input);
 };
 
 #endif //OGRESCRIPTBUILDER_H__
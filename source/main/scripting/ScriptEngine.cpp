@@ -901,6 +901,42 @@ void ScriptEngine::triggerEvent(int eventnum, int value)
 	}
 }
 
+int ScriptEngine::loadScriptSections(OgreScriptBuilder &builder)
+{
+	int result = builder.StartNewModule(engine, moduleName);
+	if ( result < 0 )
+	{
+		SLOG("Failed to start new module");
+		return result;
+	}
+
+	result = builder.AddSectionFromFile(scriptName.c_str());
+	if ( result < 0 )
+	{
+		SLOG("Unkown error while loading script file: "+scriptName);
+		SLOG("Failed to add script file");
+		return result;
+	}
+	return 0;
+}
+
+String ScriptEngine::getInterfaceVersion()
+{
+	// bytecode refers to the registered functions and types, so it's only usable with the same registrations;
+	// AS_INTERFACE_VERSION covers changed declarations, the counts catch forgotten version bumps
+	String version = String(AS_INTERFACE_VERSION) + " " + ANGELSCRIPT_VERSION_STRING + " " + TOSTRING(sizeof(void*))
+		+ " f" + TOSTRING(engine->GetGlobalFunctionCount())
+		+ " p" + TOSTRING(engine->GetGlobalPropertyCount())
+		+ " e" + TOSTRING(engine->GetEnumCount())
+		+ " t" + TOSTRING(engine->GetTypedefCount());
+	for (AngelScript::asUINT i = 0; i < engine->GetObjectTypeCount(); i++)
+	{
+		AngelScript::asIObjectType *type = engine->GetObjectTypeByIndex(i);
+		version += String(" ") + type->GetName() + ":" + TOSTRING(type->GetMethodCount()) + ":" + TOSTRING(type->GetPropertyCount()) + ":" + TOSTRING(type->GetBehaviourCount());
+	}
+	return version;
+}
+
 int ScriptEngine::loadScript(String _scriptName)
 {
 	scriptName = _scriptName;
@@ -912,43 +948,48 @@ int ScriptEngine::loadScript(String _scriptName)
 	// search for #include directives, and load any included files as
 	// well.
 	OgreScriptBuilder builder;
+	builder.setInterfaceVersion(getInterfaceVersion());
 
+	Ogre::Timer timer;
 	AngelScript::asIScriptModule *mod = 0;
+
+	// the sources are always read: the bytecode file name contains their hash (and the hash of all #included files)
+	result = loadScriptSections(builder);
+	if ( result < 0 )
+	{
+		return result;
+	}
+	scriptHash = builder.getHash();
+	String bytecodeFile = SSETTING("Cache Path", "") + "script" + builder.getCacheKey() + "_" + scriptName + "c";
+
 	// try to load bytecode
 	bool cached = false;
+	if (BSETTING("Script Bytecode Cache", true))
 	{
-		// the code below should load a compilation result but it crashes for some reason atm ...
-		//AngelScript::asIScriptModule *mod = engine->GetModule("RoRScript", AngelScript::asGM_ALWAYS_CREATE);
-		/*
-		String fn = SSETTING("Cache Path") + "script" + hash + "_" + scriptName + "c";
-		CBytecodeStream bstream(fn);
+		CBytecodeStream bstream(bytecodeFile, CBytecodeStream::MODE_READ);
 		if (bstream.Existing())
 		{
-			// CRASHES here :(
+			// replaces the module with the added sections
+			mod = engine->GetModule(moduleName, AngelScript::asGM_ALWAYS_CREATE);
 			int res = mod->LoadByteCode(&bstream);
-			cached = !res;
+			cached = (res >= 0) && !bstream.Failed();
+			if (!cached)
+			{
+				SLOG("Invalid script bytecode, compiling the script: " + bytecodeFile);
+				remove(bytecodeFile.c_str());
+				// the sections were discarded with the old module
+				result = loadScriptSections(builder);
+				if ( result < 0 )
+				{
+					return result;
+				}
+			}
 		}
-		*/
 	}
 	if (!cached)
 	{
-		// not cached so dynamically load and compile it
-		result = builder.StartNewModule(engine, moduleName);
-		if ( result < 0 )
-		{
-			SLOG("Failed to start new module");
-			return result;
-		}
-
-		mod = engine->GetModule(moduleName, AngelScript::asGM_ONLY_IF_EXISTS);
-
-		result = builder.AddSectionFromFile(scriptName.c_str());
-		if ( result < 0 )
-		{
-			SLOG("Unkown error while loading script file: "+scriptName);
-			SLOG("Failed to add script file");
-			return result;
-		}
+		// not cached so compile it
+		mod = builder.GetModule();
 		result = builder.BuildModule();
 		if ( result < 0 )
 		{
@@ -957,14 +998,14 @@ int ScriptEngine::loadScript(String _scriptName)
 		}
 
 		// save the bytecode
-		scriptHash = builder.getHash();
+		if (BSETTING("Script Bytecode Cache", true))
 		{
-			String fn = SSETTING("Cache Path", "") + "script" + scriptHash + "_" + scriptName + "c";
-			SLOG("saving script bytecode to file " + fn);
-			CBytecodeStream bstream(fn);
+			SLOG("saving script bytecode to file " + bytecodeFile);
+			CBytecodeStream bstream(bytecodeFile, CBytecodeStream::MODE_WRITE);
 			mod->SaveByteCode(&bstream);
 		}
 	}
+	SLOG("Script " + scriptName + (cached ? " loaded from bytecode" : " compiled") + " in " + TOSTRING(timer.getMilliseconds()) + " ms");
 
 	// get some other optional functions
 	frameStepFunctionPtr = mod->GetFunctionIdByDecl("void frameStep(float)");
@@ -44,6 +44,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
  */
 
 class GameScript;
+class OgreScriptBuilder;
 /**
  *  @brief This class represents the angelscript scripting interface. It can load and execute scripts.
  */
@@ -196,6 +197,17 @@ protected:
 	 */
 	int loadScriptFile(const char *fileName, std::string &script, std::string &hash);
 
+	/**
+	 * Starts a new module and adds the current script (and all files it includes) to it, without compiling.
+	 * @return 0 on success, everything else on error
+	 */
+	int loadScriptSections(OgreScriptBuilder &builder);
+
+	/**
+	 * @return Description of the registered application interface, part of the bytecode cache key.
+	 */
+	Ogre::String getInterfaceVersion();
+
 	// undocumented debugging functions below, not working.
 	void ExceptionCallback(AngelScript::asIScriptContext *ctx, void *param);
 	void PrintVariables(AngelScript::asIScriptContext *ctx, int stackLevel);
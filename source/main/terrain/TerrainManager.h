@@ -40,6 +40,7 @@ public:
 
 	Ogre::String getTerrainName() { return terrain_name; };
 	Ogre::String getGUID() { return guid; };
+	Ogre::String getFileHash() { return file_hash; };
 	int getCategoryID() { return category_id; };
 	int getVersion() { return version; };
 	int getFarClip() { return far_clip; }
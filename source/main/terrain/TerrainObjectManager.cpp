@@ -859,8 +859,8 @@ void TerrainObjectManager::loadObject(const Ogre::String &name, const Ogre::Vect
 					char tmp[255]="";
 					sscanf(ptline, "sound %s", tmp);
 					SoundScriptInstance *sound = SoundScriptManager::getSingleton().createInstance(tmp, MAX_TRUCKS+1, tenode);
-					sound->setPosition(tenode->getPosition(), Vector3::ZERO);
-					sound->start();
+					SoundScriptManager::getSingleton().setPosition(sound, tenode->getPosition(), Vector3::ZERO);
+					SoundScriptManager::getSingleton().start(sound);
 				}
 #endif //USE_OPENAL
 				continue;
@@ -1194,6 +1194,12 @@ void TerrainObjectManager::loadPreloadedTrucks()
 	{
 		return;
 	}
+
+	// load all definitions in background first, spawning (main thread) then overlaps with parsing of the following trucks
+	for (unsigned int i=0; i<truck_preload.size(); i++)
+	{
+		BeamFactory::getSingleton().prefetchRigDef(truck_preload[i].name, true /* preloaded_with_terrain */);
+	}
 	
 	for (unsigned int i=0; i<truck_preload.size(); i++)
 	{
@@ -1224,8 +1230,9 @@ void TerrainObjectManager::loadPreloadedTrucks()
 		}
 #endif //USE_MYGUI
 	}
-	
 
+	// definitions of failed spawns
+	BeamFactory::getSingleton().dropPrefetchedRigDefs();
 }
 
 bool TerrainObjectManager::update( float dt )
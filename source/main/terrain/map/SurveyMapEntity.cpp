@@ -37,6 +37,8 @@ SurveyMapEntity::SurveyMapEntity(SurveyMapManager *ctrl, String type, MyGUI::Sta
 	, mState(Sleeping)
 	, mX(0)
 	, mZ(0)
+	, mNeedsUpdate(true)
+	, mVisible(false)
 {
 	initialiseByAttributes(this, parent);
 
@@ -64,7 +66,7 @@ void SurveyMapEntity::init()
 		mIsStatic = false;
 	}
 
-	setVisibility(false);
+	mMainWidget->setVisible(false);
 
 	updateIcon();
 	update();
@@ -77,20 +79,14 @@ void SurveyMapEntity::setPosition(Vector3 pos)
 
 void SurveyMapEntity::setPosition(float x, float z)
 {
-	bool needsUpdate = false;
-
+	// the widget is moved by the next update() of the SurveyMapManager
 	if (fabs(x - mX) > 0.00001f || fabs(z - mZ) > 0.00001f)
 	{
-		needsUpdate = true;
+		mNeedsUpdate = true;
 	}
 
 	mX = x;
 	mZ = z;
-
-	if (needsUpdate)
-	{
-		update();
-	}
 }
 
 void SurveyMapEntity::setRotation(Quaternion q)
@@ -105,22 +101,29 @@ void SurveyMapEntity::setRotation(Radian r)
 
 void SurveyMapEntity::setRotation(Real r)
 {
+	// only turns the icon, the image does not change
 	mRotation = r;
 	if (mIconRotating)
 	{
-		mIconRotating->setAngle(-r);
+		mIconRotating->setAngle(mRotation);
 	}
-	updateIcon();
 }
 
 bool SurveyMapEntity::getVisibility()
 {
-	return mMainWidget->getVisible();
+	return mVisible;
 }
 
 void SurveyMapEntity::setVisibility(bool value)
 {
-	mMainWidget->setVisible(value);
+	if (value == mVisible) return;
+
+	mVisible = value;
+	mNeedsUpdate = true;
+	if (!mVisible)
+	{
+		mMainWidget->setVisible(false);
+	}
 }
 
 void SurveyMapEntity::setState(int truckstate)
@@ -153,7 +156,7 @@ void SurveyMapEntity::setState(int truckstate)
 	{
 		mState = mapstate;
 		updateIcon();
-		update();
+		mNeedsUpdate = true;
 	}
 }
 
@@ -164,7 +167,9 @@ int SurveyMapEntity::getState()
 
 void SurveyMapEntity::update()
 {
-	if (!mMainWidget->getVisible()) return;
+	mNeedsUpdate = false;
+
+	if (!mVisible) return;
 
 	if (!mMapControl->getMapEntitiesVisible())
 	{
@@ -173,15 +178,25 @@ void SurveyMapEntity::update()
 		return;
 	}
 
+	// position relative to the part of the terrain the map shows
+	Vector2 viewOrigin = mMapControl->getViewOrigin();
+	Vector2 viewSize = mMapControl->getViewSize();
+	if (viewSize.x <= 0.0f || viewSize.y <= 0.0f) return;
+
+	float u = (mX - viewOrigin.x) / viewSize.x;
+	float v = (mZ - viewOrigin.y) / viewSize.y;
+	if (u < 0.0f || u > 1.0f || v < 0.0f || v > 1.0f)
+	{
+		mMainWidget->setVisible(false);
+		return;
+	}
+
 	Vector2 terrainSize = Vector2(gEnv->terrainManager->getMaxTerrainSize().x, gEnv->terrainManager->getMaxTerrainSize().z);
 	float wscale = mMapControl->getWindowSize().length() / terrainSize.length();
 
-	// TODO: Fix the icon positions based on the overview map size and zoom value
-	// TODO: Split visibility calculation and position update into two functions
-	
 	mMainWidget->setPosition(
-		mX / mMapControl->getMapSize().x * mParent->getWidth() - mMainWidget->getWidth() / 2,
-		mZ / mMapControl->getMapSize().z * mParent->getHeight() - mMainWidget->getHeight() / 2
+		u * mParent->getWidth() - mMainWidget->getWidth() / 2,
+		v * mParent->getHeight() - mMainWidget->getHeight() / 2
 	);
 	mIcon->setCoord(
 		mMainWidget->getWidth() / 2 - mIconSize.width * wscale / 2,
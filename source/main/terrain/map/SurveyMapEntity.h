@@ -46,6 +46,9 @@ public:
 	void setState(int state);
 	void setVisibility(bool value);
 
+	/// the position, state or visibility changed since the last update()
+	bool needsUpdate() { return mNeedsUpdate; };
+
 	void update();
 
 private:
@@ -71,6 +74,8 @@ private:
 	Ogre::String mDescription;
 	Ogre::String mType;
 	bool mIsStatic;
+	bool mNeedsUpdate;
+	bool mVisible;
 
 	void init();
 	void updateIcon();
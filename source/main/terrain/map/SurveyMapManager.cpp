@@ -39,6 +39,11 @@ using namespace Ogre;
 
 SurveyMapManager::SurveyMapManager() :
 	  mAlpha(1.0f)
+	, mBakedBackground(false)
+	, mDetailTextureActive(true)
+	, mDetailTextureNeedsUpdate(true)
+	, mEntityUpdateDue(true)
+	, mEntityUpdateTimer(0.0f)
 	, mMapCenter(Vector2::ZERO)
 	, mMapCenterThreshold(5.0f)
 	, mMapEntitiesVisible(false)
@@ -47,6 +52,13 @@ SurveyMapManager::SurveyMapManager() :
 	, mMapTextureCreator(0)
 	, mMapTextureNeedsUpdate(true)
 	, mMapZoom(0.0f)
+	, mTextureUpdateTimer(0.0f)
+	, mUpdateInterval(0.0f)
+	, mViewChanged(true)
+	, mViewOrigin(Vector2::ZERO)
+	, mViewSize(Vector2::ZERO)
+	, realh(0)
+	, realw(0)
 {
 	initialiseByAttributes(this);
 	setVisibility(false);
@@ -61,11 +73,20 @@ void SurveyMapManager::init()
 	mMapSize = gEnv->terrainManager->getMaxTerrainSize();
 	mMapCenter = Vector2(mMapSize.x / 2.0f, mMapSize.z / 2.0f);
 
+	mMapCenterThreshold = FSETTING("SurveyMapCenterThreshold", 5.0f);
+
+	float updateRate = FSETTING("SurveyMapUpdateRate", 10.0f);
+	mUpdateInterval = (updateRate > 0.0f) ? 1.0f / updateRate : 0.0f;
+	mTextureUpdateTimer = mUpdateInterval;
+
+	// the static background is rendered once per terrain and kept on disk
+	String cacheFile = SSETTING("Cache Path", "") + "surveymap-" + gEnv->terrainManager->getFileHash() + "-" + TOSTRING(SurveyMapTextureCreator::TEXTURE_SIZE) + ".png";
+
 	mMapTextureCreator = new SurveyMapTextureCreator();
-	mMapTextureCreator->update();
-	setMapTexture(mMapTextureCreator->getTextureName());
+	mBakedBackground = mMapTextureCreator->bake(cacheFile);
 
-	mMapCenterThreshold = FSETTING("SurveyMapCenterThreshold", 5.0f);
+	updateView(mMapZoom);
+	updateMapTexture();
 }
 
 SurveyMapEntity *SurveyMapManager::createMapEntity(String type)
@@ -132,11 +153,74 @@ void SurveyMapManager::windowResized()
 	// TODO
 }
 
-void SurveyMapManager::updateMapEntityPositions()
+void SurveyMapManager::updateMapEntityPositions(bool all)
 {
 	for (std::set<SurveyMapEntity *>::iterator it = mMapEntities.begin(); it != mMapEntities.end(); it++)
 	{
-		(*it)->update();
+		if (all || (*it)->needsUpdate())
+		{
+			(*it)->update();
+		}
+	}
+}
+
+void SurveyMapManager::updateView(Real zoom)
+{
+	Vector2 size = Vector2(mMapSize.x - (mMapSize.x - 20.0f) * zoom, mMapSize.z - (mMapSize.z - 20.0f) * zoom);
+	Vector2 origin = mMapCenter - size / 2.0f;
+
+	// keep the view on the terrain, the baked background ends there
+	origin.x = Math::Clamp(origin.x, 0.0f, std::max(0.0f, mMapSize.x - size.x));
+	origin.y = Math::Clamp(origin.y, 0.0f, std::max(0.0f, mMapSize.z - size.y));
+
+	if (origin == mViewOrigin && size == mViewSize) return;
+
+	mViewOrigin = origin;
+	mViewSize = size;
+	mViewChanged = true;
+}
+
+void SurveyMapManager::updateMapTexture()
+{
+	const int textureSize = SurveyMapTextureCreator::TEXTURE_SIZE;
+
+	// texels of the baked background covering the view, it is only used as long as it is not magnified
+	float texelsX = mViewSize.x / mMapSize.x * textureSize;
+	float texelsY = mViewSize.y / mMapSize.z * textureSize;
+	bool detail = !mBakedBackground || texelsX < realw || texelsY < realh;
+
+	if (!detail)
+	{
+		if (mDetailTextureActive || mViewChanged)
+		{
+			if (mDetailTextureActive)
+			{
+				setMapTexture(mMapTextureCreator->getBakedTextureName());
+				mDetailTextureActive = false;
+			}
+			mMapTexture->setImageCoord(MyGUI::IntCoord(
+				(int)(mViewOrigin.x / mMapSize.x * textureSize),
+				(int)(mViewOrigin.y / mMapSize.z * textureSize),
+				(int)texelsX,
+				(int)texelsY));
+		}
+	} else
+	{
+		if (!mDetailTextureActive)
+		{
+			setMapTexture(mMapTextureCreator->getTextureName());
+			mMapTexture->setImageCoord(MyGUI::IntCoord(0, 0, textureSize, textureSize));
+			mDetailTextureActive = true;
+			mDetailTextureNeedsUpdate = true;
+		}
+		mDetailTextureNeedsUpdate |= mViewChanged;
+
+		if (mDetailTextureNeedsUpdate && mTextureUpdateTimer >= mUpdateInterval)
+		{
+			mMapTextureCreator->update();
+			mDetailTextureNeedsUpdate = false;
+			mTextureUpdateTimer = 0.0f;
+		}
 	}
 }
 
@@ -158,7 +242,7 @@ void SurveyMapManager::setMapZoom(Real zoomValue, bool update /*= true*/, bool p
 
 	if (update)
 	{
-		mMapTextureCreator->update();
+		updateView(mMapZoom);
 		if (permanent)
 			mMapTextureNeedsUpdate = true;
 	}
@@ -180,7 +264,7 @@ void SurveyMapManager::setMapCenter(Vector2 position, bool update /*= true*/)
 
 	if (update)
 	{
-		mMapTextureCreator->update();
+		updateView(mMapZoom);
 		mMapTextureNeedsUpdate = true;
 	}
 }
@@ -232,6 +316,9 @@ void SurveyMapManager::setWindowPosition(int x, int y, float size)
 	}
 
 	mMainWidget->setCoord(realx, realy, realw, realh);
+
+	// the icon size and the texture resolution depend on the window size
+	mViewChanged = true;
 }
 
 Ogre::String SurveyMapManager::getTypeByDriveable( int driveable )
@@ -273,6 +360,7 @@ void SurveyMapManager::update(Ogre::Real dt)
 	if (RoR::Application::GetInputEngine()->getEventBoolValueBounce(EV_SURVEY_MAP_TOGGLE_ICONS))
 	{
 		mMapEntitiesVisible = !mMapEntitiesVisible;
+		mViewChanged = true;
 	}
 
 	if (mMapMode == SURVEY_MAP_NONE) return;
@@ -350,7 +438,23 @@ void SurveyMapManager::update(Ogre::Real dt)
 		break;
 	}
 
-	updateMapEntityPositions();
+	// the map is redrawn and the entities are moved at a fixed rate, independent of the frame rate
+	mTextureUpdateTimer += dt;
+	mEntityUpdateTimer += dt;
+	mEntityUpdateDue = mEntityUpdateTimer >= mUpdateInterval;
+	if (mEntityUpdateDue)
+	{
+		mEntityUpdateTimer = 0.0f;
+	}
+
+	bool viewChanged = mViewChanged;
+	updateMapTexture();
+	mViewChanged = false;
+
+	if (mEntityUpdateDue || viewChanged)
+	{
+		updateMapEntityPositions(viewChanged);
+	}
 }
 
 void SurveyMapManager::toggleMapView()
@@ -399,7 +503,9 @@ void SurveyMapManager::toggleMapAlpha()
 }
 
 void SurveyMapManager::Update(Beam ** vehicles, int num_vehicles)
-{	
+{
+	if (!mEntityUpdateDue) return;
+
 	for (int t=0; t<num_vehicles; t++)
 	{
 		if (!vehicles[t]) continue;	
@@ -412,6 +518,8 @@ void SurveyMapManager::Update(Beam ** vehicles, int num_vehicles)
 			e->setRotation(Radian(vehicles[t]->getHeadingDirectionAngle()));
 		}
 	}
+
+	updateMapEntityPositions(false);
 }
 
 #endif // USE_MYGUI
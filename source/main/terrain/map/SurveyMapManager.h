@@ -58,6 +58,10 @@ public:
 	void setMapCenter(Ogre::Vector3 position, float maxOffset, bool update = true);
 	Ogre::Vector2 getMapCenter() { return mMapCenter; };
 
+	/// the part of the terrain the map currently shows, in world units (x, z)
+	Ogre::Vector2 getViewOrigin() { return mViewOrigin; };
+	Ogre::Vector2 getViewSize() { return mViewSize; };
+
 	void setMapTexture(Ogre::String name);
 
 	Ogre::Vector3 getMapSize() { return mMapSize; };
@@ -93,11 +97,26 @@ protected:
 	SurveyMapTextureCreator* mMapTextureCreator;
 	bool mMapTextureNeedsUpdate;
 
+	Ogre::Vector2 mViewOrigin;
+	Ogre::Vector2 mViewSize;
+	bool mViewChanged;
+
+	bool mBakedBackground;           //!< the overview of the whole terrain is available as texture
+	bool mDetailTextureActive;       //!< the view is too small for the baked overview, it is rendered instead
+	bool mDetailTextureNeedsUpdate;
+	float mTextureUpdateTimer;
+	float mEntityUpdateTimer;
+	float mUpdateInterval;           //!< seconds between re-renders and entity updates, 0 = every frame
+	bool mEntityUpdateDue;
+
+	void updateView(Ogre::Real zoom);
+	void updateMapTexture();
+
 	std::map<Ogre::String, SurveyMapEntity *> mNamedEntities;
 	std::set<SurveyMapEntity *> mMapEntities;
 	bool mMapEntitiesVisible;
 
-	void updateMapEntityPositions();
+	void updateMapEntityPositions(bool all);
 	void setMapEntitiesVisibility(bool visibility);
 
 	int mMapMode;
@@ -25,6 +25,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "SurveyMapManager.h"
 #include "TerrainManager.h"
 
+#include <fstream>
+
 using namespace Ogre;
 
 int SurveyMapTextureCreator::mCounter = 0;
@@ -36,7 +38,6 @@ SurveyMapTextureCreator::SurveyMapTextureCreator() :
 	, mStatics(NULL)
 	, mTextureUnitState(NULL)
 	, mViewport(NULL)
-	, mMapCenter(Vector2::ZERO)
 	, mMapSize(Vector3::ZERO)
 	, mMapZoom(0.0f)
 {
@@ -46,7 +47,7 @@ SurveyMapTextureCreator::SurveyMapTextureCreator() :
 
 bool SurveyMapTextureCreator::init()
 {
-	TexturePtr texture = TextureManager::getSingleton().createManual(getTextureName(), ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, 2048, 2048, TU_RENDERTARGET, PF_R8G8B8, TU_RENDERTARGET, new ResourceBuffer());
+	TexturePtr texture = TextureManager::getSingleton().createManual(getTextureName(), ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, TEXTURE_SIZE, TEXTURE_SIZE, TU_RENDERTARGET, PF_R8G8B8, TU_RENDERTARGET, new ResourceBuffer());
 	
 	if ( texture.isNull() ) return false;;
 
@@ -86,28 +87,68 @@ void SurveyMapTextureCreator::setStaticGeometry(StaticGeometry *staticGeometry)
 
 void SurveyMapTextureCreator::update()
 {
-	if ( !mRttTex ) return;
+	if ( !mRttTex || !gEnv->surveyMap ) return;
+
+	mMapSize = gEnv->surveyMap->getMapSize();
+	mMapZoom = gEnv->surveyMap->getMapZoom();
+
+	render(gEnv->surveyMap->getViewOrigin(), gEnv->surveyMap->getViewSize());
+}
+
+bool SurveyMapTextureCreator::bake(const String &cacheFile)
+{
+	if ( !mRttTex || !gEnv->surveyMap ) return false;
+
+	Image image;
+
+	std::ifstream file(cacheFile.c_str(), std::ios::in | std::ios::binary);
+	if (file.is_open())
+	{
+		try
+		{
+			DataStreamPtr stream(OGRE_NEW FileStreamDataStream(cacheFile, &file, false));
+			image.load(stream, "png");
+			TextureManager::getSingleton().loadImage(getBakedTextureName(), ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, image);
+			LOG("Survey map background loaded from " + cacheFile);
+			return true;
+		} catch (Exception &e)
+		{
+			LOG("Survey map background cache unusable, rendering it again: " + e.getFullDescription());
+		}
+	}
 
-	mMapSize = Vector3::ZERO;
-	mMapCenter = Vector2::ZERO;
+	mMapSize = gEnv->surveyMap->getMapSize();
 	mMapZoom = 0.0f;
 
-	if (gEnv->terrainManager)
-		mMapSize = gEnv->surveyMap->getMapSize();
+	render(Vector2::ZERO, Vector2(mMapSize.x, mMapSize.z));
 
-	if (gEnv->surveyMap)
+	uchar *data = OGRE_ALLOC_T(uchar, PixelUtil::getMemorySize(TEXTURE_SIZE, TEXTURE_SIZE, 1, PF_BYTE_RGB), MEMCATEGORY_GENERAL);
+	PixelBox pixels(TEXTURE_SIZE, TEXTURE_SIZE, 1, PF_BYTE_RGB, data);
+	mRttTex->copyContentsToMemory(pixels);
+
+	// the image owns the pixels from now on
+	image.loadDynamicImage(data, TEXTURE_SIZE, TEXTURE_SIZE, 1, PF_BYTE_RGB, true);
+	TextureManager::getSingleton().loadImage(getBakedTextureName(), ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, image);
+
+	try
+	{
+		image.save(cacheFile);
+		LOG("Survey map background written to " + cacheFile);
+	} catch (Exception &e)
 	{
-		mMapCenter = gEnv->surveyMap->getMapCenter();
-		mMapZoom   = gEnv->surveyMap->getMapZoom();
+		LOG("Could not write the survey map background cache: " + e.getFullDescription());
 	}
+	return true;
+}
 
-	float orthoWindowWidth  = mMapSize.x - (mMapSize.x - 20.0f) * mMapZoom;
-	float orthoWindowHeight = mMapSize.z - (mMapSize.z - 20.0f) * mMapZoom;
+void SurveyMapTextureCreator::render(const Vector2 &origin, const Vector2 &size)
+{
+	Vector2 center = origin + size / 2.0f;
 
 	mCamera->setFarClipDistance(mMapSize.y + 3.0f);
-	mCamera->setOrthoWindow(orthoWindowWidth, orthoWindowHeight);
-	mCamera->setPosition(Vector3(mMapCenter.x, mMapSize.y + 2.0f, mMapCenter.y));
-	mCamera->lookAt(Vector3(mMapCenter.x, 0.0f, mMapCenter.y));
+	mCamera->setOrthoWindow(size.x, size.y);
+	mCamera->setPosition(Vector3(center.x, mMapSize.y + 2.0f, center.y));
+	mCamera->lookAt(Vector3(center.x, 0.0f, center.y));
 
 	preRenderTargetUpdate();
 
@@ -131,6 +172,11 @@ String SurveyMapTextureCreator::getTextureName()
 	return "MapRttTex" + TOSTRING(mCounter);
 }
 
+String SurveyMapTextureCreator::getBakedTextureName()
+{
+	return "MapBakedTex" + TOSTRING(mCounter);
+}
+
 void SurveyMapTextureCreator::preRenderTargetUpdate()
 {
 	Beam **trucks = BeamFactory::getSingleton().getTrucks();
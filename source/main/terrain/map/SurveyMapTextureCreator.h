@@ -33,15 +33,29 @@ public:
 	Ogre::String getMaterialName();
 	Ogre::String getCameraName();
 	Ogre::String getTextureName();
+	Ogre::String getBakedTextureName();
 
 	void setStaticGeometry(Ogre::StaticGeometry *staticGeometry);
 
+	/**
+	* Provides the overview of the whole terrain as texture getBakedTextureName().
+	* It is loaded from 'cacheFile' if that exists, else rendered once and written to it.
+	*/
+	bool bake(const Ogre::String &cacheFile);
+
+	/**
+	* Renders the current view of the survey map into texture getTextureName()
+	*/
 	void update();
 
+	static const int TEXTURE_SIZE = 2048;
+
 protected:
 
 	bool init();
 
+	void render(const Ogre::Vector2 &origin, const Ogre::Vector2 &size);
+
 	void preRenderTargetUpdate();
     void postRenderTargetUpdate();
 
@@ -53,7 +67,6 @@ protected:
 	Ogre::Viewport *mViewport;
 
 	Ogre::Real mMapZoom;
-	Ogre::Vector2 mMapCenter;
 	Ogre::Vector3 mMapSize;
 
 	static int mCounter;
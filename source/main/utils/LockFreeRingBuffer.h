@@ -0,0 +1,92 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __LockFreeRingBuffer_H_
+#define __LockFreeRingBuffer_H_
+
+#include <atomic>
+#include <cstddef>
+
+/**
+* Fixed size ring buffer for exactly one producer thread and one consumer thread.
+* push() and pop() never block and never take a lock; push() fails when the buffer is full.
+* @param T Element type, copied in and out.
+* @param N Capacity + 1 (one slot is always kept empty to tell "full" from "empty").
+*/
+template <class T, size_t N>
+class LockFreeRingBuffer
+{
+public:
+
+	LockFreeRingBuffer() : head(0), tail(0)
+	{
+	}
+
+	/// producer side
+	bool push(const T &value)
+	{
+		size_t h    = head.load(std::memory_order_relaxed);
+		size_t next = (h + 1) % N;
+		if (next == tail.load(std::memory_order_acquire))
+			return false; // full
+		buffer[h] = value;
+		head.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/// consumer side
+	bool pop(T &value)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+			return false; // empty
+		value = buffer[t];
+		tail.store((t + 1) % N, std::memory_order_release);
+		return true;
+	}
+
+	/// consumer side; only a snapshot, the producer may push at any time
+	bool empty() const
+	{
+		return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+	}
+
+	/// consumer side; only a snapshot, the producer may push at any time
+	size_t size() const
+	{
+		size_t h = head.load(std::memory_order_acquire);
+		size_t t = tail.load(std::memory_order_acquire);
+		return (h + N - t) % N;
+	}
+
+	static size_t capacity() { return N - 1; }
+
+protected:
+
+	std::atomic<size_t> head; //!< next slot to write, owned by the producer
+	std::atomic<size_t> tail; //!< next slot to read, owned by the consumer
+	T buffer[N];
+
+private:
+
+	LockFreeRingBuffer(const LockFreeRingBuffer&);
+	LockFreeRingBuffer& operator=(const LockFreeRingBuffer&);
+};
+
+#endif // __LockFreeRingBuffer_H_
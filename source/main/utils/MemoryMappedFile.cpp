@@ -0,0 +1,145 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** 
+	@file   MemoryMappedFile.cpp
+*/
+
+#include "MemoryMappedFile.h"
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#	include <windows.h>
+#	include <cstdint>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+using namespace RoR;
+
+MemoryMappedFile::MemoryMappedFile():
+	m_data(nullptr),
+	m_size(0)
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	,m_file_handle(INVALID_HANDLE_VALUE)
+	,m_mapping_handle(NULL)
+#endif
+{}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+
+bool MemoryMappedFile::Open(Ogre::String const & path)
+{
+	Close();
+
+	m_file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_file_handle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (! GetFileSizeEx(m_file_handle, &size) || size.QuadPart == 0 || size.QuadPart > (LONGLONG) SIZE_MAX)
+	{
+		Close();
+		return false;
+	}
+	m_mapping_handle = CreateFileMappingA(m_file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (m_mapping_handle == NULL)
+	{
+		Close();
+		return false;
+	}
+	m_data = static_cast<const char*>(MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping_handle != NULL)
+	{
+		CloseHandle(m_mapping_handle);
+	}
+	if (m_file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file_handle);
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping_handle = NULL;
+	m_file_handle = INVALID_HANDLE_VALUE;
+}
+
+#else // POSIX
+
+bool MemoryMappedFile::Open(Ogre::String const & path)
+{
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // The mapping stays valid.
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	m_data = static_cast<const char*>(data);
+	m_size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif // OGRE_PLATFORM
@@ -0,0 +1,83 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** 
+	@file   MemoryMappedFile.h
+	@brief  Read-only memory mapping of a whole file.
+*/
+
+#pragma once
+
+#include <OgrePlatform.h>
+#include <OgreString.h>
+
+namespace RoR
+{
+
+/**
+	@class  MemoryMappedFile
+	@brief  Maps a file into memory for reading; pages are loaded by the OS on first access.
+*/
+class MemoryMappedFile
+{
+
+public:
+
+	MemoryMappedFile();
+
+	~MemoryMappedFile();
+
+	/** Maps the whole file, closes previously opened one.
+	* @return False if the file doesn't exist, is empty or can't be mapped.
+	*/
+	bool Open(Ogre::String const & path);
+
+	void Close();
+
+	bool IsOpen() const
+	{
+		return m_data != nullptr;
+	}
+
+	const char* GetData() const
+	{
+		return m_data;
+	}
+
+	size_t GetSize() const
+	{
+		return m_size;
+	}
+
+private:
+
+	MemoryMappedFile(MemoryMappedFile const &);
+	MemoryMappedFile& operator=(MemoryMappedFile const &);
+
+	const char* m_data;
+	size_t      m_size;
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	void*       m_file_handle;
+	void*       m_mapping_handle;
+#endif
+};
+
+} // namespace RoR
@@ -28,6 +28,11 @@
 #include "PlatformUtils.h"
 
 #include <Ogre.h>
+#include <pthread.h>
+
+#ifdef _GNU_SOURCE
+#include <sys/sysinfo.h>
+#endif
 
 using namespace RoR;
 
@@ -76,3 +81,21 @@ bool PlatformUtils::FolderExists(Ogre::String const & path)
 {
 	return FolderExists(path.c_str());
 }
+
+unsigned int PlatformUtils::GetNumCpuCores()
+{
+	#if defined(PTW32_VERSION) || defined(__hpux)
+		return pthread_num_processors_np();
+	#elif defined(_GNU_SOURCE)
+		return get_nprocs();
+	#elif defined(__APPLE__) || defined(__FreeBSD__)
+		int count;
+		size_t size = sizeof(count);
+		return sysctlbyname("hw.ncpu", &count, &size, NULL, 0) ? 0 : count;
+	#elif defined(BOOST_HAS_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+		int const count = sysconf(_SC_NPROCESSORS_ONLN);
+		return (count > 0) ? count : 0;
+	#else
+		return 0;
+	#endif
+}
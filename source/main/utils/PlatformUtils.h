@@ -45,6 +45,9 @@ struct PlatformUtils
 	static bool FolderExists(const char * path);
 
 	static bool FolderExists(Ogre::String const & path);
+
+	/** @return Number of logical processors, 0 if unknown. */
+	static unsigned int GetNumCpuCores();
 };
 
 } // namespace RoR
@@ -0,0 +1,387 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// network_loopback_benchmark: sends stream messages through a local stand-in server which
+// echoes them back, like the real server relays stream data, and measures messages/s and latency.
+// Compares the old client I/O (one send per message, header and payload read separately)
+// with NetworkSendBatch and NetworkReceiveBuffer as used by Network and NetworkStreamManager.
+
+#include "NetworkIO.h"
+#include "PacketBuffer.h"
+#include "rornet.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <pthread.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif // _WIN32
+
+struct run_t
+{
+	int fd;
+	bool batched;
+	int messages;
+	int batch_size;
+	int window;                           //!< messages in flight at most
+	std::vector<unsigned short> sizes;    //!< payload size of each message
+	std::atomic<int> received;
+	std::vector<double> latencies;        //!< microseconds
+	int errors;
+};
+
+static unsigned long long nowMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void closeSocket(int fd)
+{
+#ifdef _WIN32
+	closesocket((SOCKET)fd);
+#else
+	close(fd);
+#endif // _WIN32
+}
+
+static int sendAll(int fd, const char *data, size_t len)
+{
+	while (len > 0)
+	{
+		int sent = (int)send(fd, data, (int)len, 0);
+		if (sent <= 0)
+			return -1;
+		data += sent;
+		len -= sent;
+	}
+	return 0;
+}
+
+static int recvAll(int fd, char *data, size_t len)
+{
+	while (len > 0)
+	{
+		int received = (int)recv(fd, data, (int)len, 0);
+		if (received <= 0)
+			return -1;
+		data += received;
+		len -= received;
+	}
+	return 0;
+}
+
+// the payload starts with the time it was queued and the message number, the last byte repeats the number
+static void fillMessage(header_t &header, char *payload, int number, unsigned short size)
+{
+	memset(&header, 0, sizeof(header_t));
+	header.command  = MSG2_STREAM_DATA;
+	header.source   = 1;
+	header.streamid = 10;
+	header.size     = size;
+
+	unsigned long long now = nowMicroseconds();
+	memcpy(payload, &now, sizeof(now));
+	memcpy(payload + sizeof(now), &number, sizeof(number));
+	payload[size - 1] = (char)number;
+}
+
+static void checkMessage(run_t &run, const header_t &header, const char *payload)
+{
+	unsigned long long sent = 0;
+	int number = -1;
+	memcpy(&sent, payload, sizeof(sent));
+	memcpy(&number, payload + sizeof(sent), sizeof(number));
+
+	if (number != run.received.load() || header.size != run.sizes[number] || payload[header.size - 1] != (char)number)
+		run.errors++;
+
+	run.latencies.push_back((double)(nowMicroseconds() - sent));
+	run.received.fetch_add(1);
+}
+
+// stand-in server, echoes everything
+void *serverThread(void *arg)
+{
+	int fd = (int)(size_t)arg;
+	std::vector<char> buffer(64 * 1024);
+	while (true)
+	{
+		int received = (int)recv(fd, &buffer[0], (int)buffer.size(), 0);
+		if (received <= 0 || sendAll(fd, &buffer[0], received) < 0)
+			break;
+	}
+	closeSocket(fd);
+	return NULL;
+}
+
+void *receiveThread(void *arg)
+{
+	run_t &run = *(run_t *)arg;
+	header_t header;
+
+	if (!run.batched)
+	{
+		// as Network::receivemessage() did for every message
+		char buffer[MAX_MESSAGE_LENGTH];
+		char content[MAX_MESSAGE_LENGTH];
+		while (run.received.load() < run.messages)
+		{
+			memset(buffer, 0, MAX_MESSAGE_LENGTH);
+			if (recvAll(run.fd, buffer, sizeof(header_t)) < 0)
+				break;
+			memcpy(&header, buffer, sizeof(header_t));
+			if (header.size >= MAX_MESSAGE_LENGTH - sizeof(header_t) || recvAll(run.fd, buffer + sizeof(header_t), header.size) < 0)
+				break;
+			memcpy(content, buffer + sizeof(header_t), header.size);
+			PacketBuffer::countCopy(header.size);
+			checkMessage(run, header, content);
+		}
+		return NULL;
+	}
+
+	// as Network::receivePacket()
+	NetworkReceiveBuffer recv_buffer;
+	while (run.received.load() < run.messages)
+	{
+		int result;
+		while ((result = recv_buffer.next(header)) == 0)
+		{
+			if (recv_buffer.fill(run.fd) < 0)
+				return NULL;
+		}
+		if (result < 0)
+			break;
+
+		PacketBuffer *packet = PacketBuffer::allocate(header.size);
+		packet->getHeader() = header;
+		int copied = recv_buffer.readPayload(run.fd, packet->getPayload(), header.size);
+		if (copied < 0)
+		{
+			packet->release();
+			break;
+		}
+		PacketBuffer::countCopy(copied);
+		checkMessage(run, header, packet->getPayload());
+		packet->release();
+	}
+	return NULL;
+}
+
+// sends batch_size messages per tick, like NetworkStreamManager::sendStreams() once per frame
+void sendMessages(run_t &run)
+{
+	NetworkSendBatch send_batch;
+	std::vector<PacketBuffer *> packets;
+	char buffer[MAX_MESSAGE_LENGTH];
+
+	for (int first = 0; first < run.messages; first += run.batch_size)
+	{
+		int count = std::min(run.batch_size, run.messages - first);
+		while (first + count - run.received.load() > run.window)
+		{
+			std::this_thread::yield();
+		}
+
+		if (!run.batched)
+		{
+			// as Network::sendMessageRaw(), one message at a time
+			for (int i = first; i < first + count; i++)
+			{
+				header_t header;
+				fillMessage(header, buffer + sizeof(header_t), i, run.sizes[i]);
+				memcpy(buffer, &header, sizeof(header_t));
+				if (sendAll(run.fd, buffer, sizeof(header_t) + header.size) < 0)
+				{
+					run.errors++;
+					return;
+				}
+			}
+			continue;
+		}
+
+		// as Network::sendPackets()
+		for (int i = first; i < first + count; i++)
+		{
+			PacketBuffer *packet = PacketBuffer::allocate(run.sizes[i]);
+			fillMessage(packet->getHeader(), packet->getPayload(), i, run.sizes[i]);
+			packets.push_back(packet);
+			send_batch.add(packet->getWireData(), packet->getWireSize());
+		}
+		int result = send_batch.send(run.fd);
+		send_batch.clear();
+		for (size_t i = 0; i < packets.size(); i++)
+		{
+			packets[i]->release();
+		}
+		packets.clear();
+		if (result < 0)
+		{
+			run.errors++;
+			return;
+		}
+	}
+}
+
+bool connectLoopback(int &client, int &server)
+{
+	int listener = (int)socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family      = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port        = 0;
+	socklen_t len = sizeof(addr);
+	if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0
+		|| getsockname(listener, (struct sockaddr *)&addr, &len) != 0)
+	{
+		return false;
+	}
+
+	client = (int)socket(AF_INET, SOCK_STREAM, 0);
+	if (client < 0 || connect(client, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+		return false;
+	server = (int)accept(listener, NULL, NULL);
+	closeSocket(listener);
+	return server >= 0;
+}
+
+bool runBenchmark(const char *name, bool batched, const std::vector<unsigned short> &sizes, int batch_size, int window)
+{
+	run_t run;
+	run.batched    = batched;
+	run.messages   = (int)sizes.size();
+	run.batch_size = batch_size;
+	run.window     = window;
+	run.sizes      = sizes;
+	run.received   = 0;
+	run.errors     = 0;
+	run.latencies.reserve(sizes.size());
+
+	int server = -1;
+	if (!connectLoopback(run.fd, server))
+	{
+		printf("%s: can't connect to the loopback server\n", name);
+		return false;
+	}
+
+	pthread_t server_thread, receive_thread;
+	pthread_create(&server_thread, NULL, serverThread, (void *)(size_t)server);
+	pthread_create(&receive_thread, NULL, receiveThread, &run);
+
+	size_t copied_before = PacketBuffer::getCopiedBytes();
+	unsigned long long start = nowMicroseconds();
+	sendMessages(run);
+	pthread_join(receive_thread, NULL);
+	double seconds = (nowMicroseconds() - start) / 1000000.0;
+	size_t copied = PacketBuffer::getCopiedBytes() - copied_before;
+
+	closeSocket(run.fd);
+	pthread_join(server_thread, NULL);
+
+	if (run.received.load() != run.messages || run.errors)
+	{
+		printf("%s: %d of %d messages received, %d errors\n", name, run.received.load(), run.messages, run.errors);
+		return false;
+	}
+
+	size_t payload_bytes = 0;
+	for (size_t i = 0; i < sizes.size(); i++)
+	{
+		payload_bytes += sizes[i];
+	}
+
+	std::sort(run.latencies.begin(), run.latencies.end());
+	double average = 0;
+	for (size_t i = 0; i < run.latencies.size(); i++)
+	{
+		average += run.latencies[i];
+	}
+	average /= run.latencies.size();
+
+	printf("%-8s %8.3f M msgs/s, latency avg %7.1f us, median %7.1f us, 99%% %7.1f us, received payload copied: %5.1f%%\n",
+		name, run.messages / seconds / 1000000.0, average, run.latencies[run.latencies.size() / 2], run.latencies[run.latencies.size() * 99 / 100],
+		100.0 * copied / payload_bytes);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int messages   = 200000;
+	int batch_size = 16;
+	int window     = 256;
+	int min_size   = 100;
+	int max_size   = 800;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		if (!strcmp(argv[i], "-n"))
+			messages = std::max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-b"))
+			batch_size = std::max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-w"))
+			window = std::max(1, atoi(argv[i + 1]));
+		else if (!strcmp(argv[i], "-s"))
+			max_size = std::min(std::max(min_size, atoi(argv[i + 1])), MAX_MESSAGE_LENGTH - (int)sizeof(header_t) - 1);
+		else
+		{
+			printf("usage: %s [-n <messages>] [-b <messages per tick>] [-w <messages in flight>] [-s <max. payload size>]\n", argv[0]);
+			return 1;
+		}
+	}
+	window = std::max(window, batch_size);
+
+#ifdef _WIN32
+	WSADATA wsa_data;
+	WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif // _WIN32
+
+	// same sizes for both runs
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> size_distribution(min_size, max_size);
+	std::vector<unsigned short> sizes(messages);
+	for (int i = 0; i < messages; i++)
+	{
+		sizes[i] = (unsigned short)size_distribution(random);
+	}
+
+	printf("%d messages of %d-%d bytes, %d per tick, at most %d in flight\n", messages, min_size, max_size, batch_size, window);
+	bool ok = runBenchmark("single", false, sizes, batch_size, window);
+	ok = runBenchmark("batched", true, sizes, batch_size, window) && ok;
+
+#ifdef _WIN32
+	WSACleanup();
+#endif // _WIN32
+
+	return ok ? 0 : 1;
+}
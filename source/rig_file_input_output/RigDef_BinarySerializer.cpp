@@ -0,0 +1,1336 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   RigDef_BinarySerializer.cpp
+
+	Every struct has a single Process() function listing its fields, used both for
+	writing (BinaryWriter) and reading (BinaryReader), so the two can't get out of sync.
+	When adding a field to RigDef::File, add it to the respective Process() function and
+	increment BinarySerializer::FORMAT_VERSION.
+*/
+
+#include "RigDef_BinarySerializer.h"
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <typeinfo>
+
+namespace RigDef
+{
+
+static const unsigned int MAGIC_NUMBER      = 0x42444752; // "RGDB"
+static const unsigned int ENDIANNESS_MARKER = 0x01020304;
+static const unsigned int NULL_INDEX = 0xFFFFFFFF;
+
+/* -------------------------------------------------------------------------- */
+/* Archives                                                                   */
+/* -------------------------------------------------------------------------- */
+
+class BinaryWriter
+{
+public:
+
+	BinaryWriter(std::vector<char> & buffer):
+		m_buffer(buffer)
+	{}
+
+	void Raw(const void* data, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(data);
+		m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+	}
+
+	std::vector<char> &                 m_buffer;
+	std::map<const void*, unsigned int> m_shared_objects; ///< Already written defaults and their indices
+};
+
+class BinaryReader
+{
+public:
+
+	BinaryReader(const char* data, size_t size):
+		m_pos(data),
+		m_end(data + size),
+		m_failed(false)
+	{}
+
+	void Raw(void* data, size_t size)
+	{
+		if (m_failed || static_cast<size_t>(m_end - m_pos) < size)
+		{
+			m_failed = true;
+			memset(data, 0, size);
+			return;
+		}
+		memcpy(data, m_pos, size);
+		m_pos += size;
+	}
+
+	/** Sanity check of container sizes; every element takes at least 1 byte */
+	bool CheckCount(unsigned int count)
+	{
+		if (static_cast<size_t>(m_end - m_pos) < count)
+		{
+			m_failed = true;
+		}
+		return ! m_failed;
+	}
+
+	bool IsComplete()
+	{
+		return ! m_failed && m_pos == m_end;
+	}
+
+	struct SharedObject
+	{
+		std::type_info const *   type;
+		boost::shared_ptr<void>  object;
+	};
+
+	const char*               m_pos;
+	const char*               m_end;
+	bool                      m_failed;
+	std::vector<SharedObject> m_shared_objects;
+};
+
+/* -------------------------------------------------------------------------- */
+/* Values                                                                     */
+/* -------------------------------------------------------------------------- */
+
+template <class A> void Process(A & ar, int & value)          { ar.Raw(&value, sizeof(value)); }
+template <class A> void Process(A & ar, unsigned int & value) { ar.Raw(&value, sizeof(value)); }
+template <class A> void Process(A & ar, float & value)        { ar.Raw(&value, sizeof(value)); }
+template <class A> void Process(A & ar, double & value)       { ar.Raw(&value, sizeof(value)); }
+template <class A> void Process(A & ar, char & value)         { ar.Raw(&value, sizeof(value)); }
+
+template <class A> void Process(A & ar, bool & value)
+{
+	unsigned char byte = value ? 1 : 0;
+	ar.Raw(&byte, 1);
+	value = (byte != 0);
+}
+
+template <class A, class E> void ProcessEnum(A & ar, E & value)
+{
+	unsigned int number = static_cast<unsigned int>(value);
+	Process(ar, number);
+	value = static_cast<E>(number);
+}
+
+template <class A> void Process(A & ar, Ogre::Vector3 & value)
+{
+	Process(ar, value.x);
+	Process(ar, value.y);
+	Process(ar, value.z);
+}
+
+template <class A> void Process(A & ar, Ogre::ColourValue & value)
+{
+	Process(ar, value.r);
+	Process(ar, value.g);
+	Process(ar, value.b);
+	Process(ar, value.a);
+}
+
+void Process(BinaryWriter & ar, Ogre::String & value)
+{
+	unsigned int length = static_cast<unsigned int>(value.length());
+	Process(ar, length);
+	ar.Raw(value.data(), length);
+}
+
+void Process(BinaryReader & ar, Ogre::String & value)
+{
+	unsigned int length = 0;
+	Process(ar, length);
+	if (ar.CheckCount(length))
+	{
+		value.assign(ar.m_pos, length);
+		ar.m_pos += length;
+	}
+}
+
+template <class A, class T, size_t N> void Process(A & ar, T (& array)[N])
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		Process(ar, array[i]);
+	}
+}
+
+/** Default-constructed element for reading containers */
+template <class T> T MakeElement()
+{
+	return T();
+}
+
+template <> Node::Range MakeElement<Node::Range>()
+{
+	return Node::Range(Node::Id());
+}
+
+template <class T> void Process(BinaryWriter & ar, std::vector<T> & container)
+{
+	unsigned int count = static_cast<unsigned int>(container.size());
+	Process(ar, count);
+	for (typename std::vector<T>::iterator itor = container.begin(); itor != container.end(); ++itor)
+	{
+		Process(ar, *itor);
+	}
+}
+
+template <class T> void Process(BinaryReader & ar, std::vector<T> & container)
+{
+	unsigned int count = 0;
+	Process(ar, count);
+	if (! ar.CheckCount(count))
+	{
+		return;
+	}
+	container.clear();
+	container.resize(count, MakeElement<T>());
+	for (typename std::vector<T>::iterator itor = container.begin(); itor != container.end(); ++itor)
+	{
+		Process(ar, *itor);
+	}
+}
+
+template <class T> void Process(BinaryWriter & ar, std::list<T> & container)
+{
+	unsigned int count = static_cast<unsigned int>(container.size());
+	Process(ar, count);
+	for (typename std::list<T>::iterator itor = container.begin(); itor != container.end(); ++itor)
+	{
+		Process(ar, *itor);
+	}
+}
+
+template <class T> void Process(BinaryReader & ar, std::list<T> & container)
+{
+	unsigned int count = 0;
+	Process(ar, count);
+	if (! ar.CheckCount(count))
+	{
+		return;
+	}
+	container.clear();
+	container.resize(count, MakeElement<T>());
+	for (typename std::list<T>::iterator itor = container.begin(); itor != container.end(); ++itor)
+	{
+		Process(ar, *itor);
+	}
+}
+
+/** Optional section (null if not present in file), owned by one element */
+template <class T> void ProcessOwned(BinaryWriter & ar, boost::shared_ptr<T> & ptr)
+{
+	bool present = (ptr != nullptr);
+	Process(ar, present);
+	if (present)
+	{
+		Process(ar, *ptr);
+	}
+}
+
+template <class T> void ProcessOwned(BinaryReader & ar, boost::shared_ptr<T> & ptr)
+{
+	bool present = false;
+	Process(ar, present);
+	ptr.reset();
+	if (present && ! ar.m_failed)
+	{
+		ptr = boost::shared_ptr<T>(new T());
+		Process(ar, *ptr);
+	}
+}
+
+/** Defaults, shared by many elements; written at first use, then referenced by index */
+template <class T> void ProcessShared(BinaryWriter & ar, boost::shared_ptr<T> & ptr)
+{
+	unsigned int index = NULL_INDEX;
+	if (ptr == nullptr)
+	{
+		Process(ar, index);
+		return;
+	}
+	std::map<const void*, unsigned int>::iterator found = ar.m_shared_objects.find(ptr.get());
+	if (found != ar.m_shared_objects.end())
+	{
+		index = found->second;
+		Process(ar, index);
+		return;
+	}
+	index = static_cast<unsigned int>(ar.m_shared_objects.size());
+	ar.m_shared_objects.insert(std::make_pair(ptr.get(), index));
+	Process(ar, index);
+	Process(ar, *ptr);
+}
+
+template <class T> void ProcessShared(BinaryReader & ar, boost::shared_ptr<T> & ptr)
+{
+	unsigned int index = NULL_INDEX;
+	Process(ar, index);
+	ptr.reset();
+	if (index == NULL_INDEX || ar.m_failed)
+	{
+		return;
+	}
+	if (index < ar.m_shared_objects.size())
+	{
+		BinaryReader::SharedObject & shared = ar.m_shared_objects[index];
+		if (*shared.type != typeid(T))
+		{
+			ar.m_failed = true;
+			return;
+		}
+		ptr = boost::static_pointer_cast<T>(shared.object);
+		return;
+	}
+	if (index != ar.m_shared_objects.size())
+	{
+		ar.m_failed = true;
+		return;
+	}
+	ptr = boost::shared_ptr<T>(new T());
+	BinaryReader::SharedObject shared;
+	shared.type = &typeid(T);
+	shared.object = ptr;
+	ar.m_shared_objects.push_back(shared);
+	Process(ar, *ptr);
+}
+
+template <class A, class T> void Process(A & ar, boost::shared_ptr<T> & ptr)              { ProcessOwned(ar, ptr); }
+template <class A> void Process(A & ar, boost::shared_ptr<BeamDefaults> & ptr)   { ProcessShared(ar, ptr); }
+template <class A> void Process(A & ar, boost::shared_ptr<NodeDefaults> & ptr)   { ProcessShared(ar, ptr); }
+template <class A> void Process(A & ar, boost::shared_ptr<DefaultInertia> & ptr) { ProcessShared(ar, ptr); }
+
+/* -------------------------------------------------------------------------- */
+/* Node ID                                                                    */
+/* -------------------------------------------------------------------------- */
+
+void Process(BinaryWriter & ar, Node::Id & id)
+{
+	unsigned int number = id.Num();
+	Ogre::String name = id.Str();
+	Process(ar, number);
+	Process(ar, name);
+}
+
+void Process(BinaryReader & ar, Node::Id & id)
+{
+	unsigned int number = 0;
+	Ogre::String name;
+	Process(ar, number);
+	Process(ar, name);
+	if (name.empty())
+	{
+		id.SetNum(number);
+	}
+	else
+	{
+		id.SetStr(name);
+	}
+}
+
+template <class A> void Process(A & ar, Node::Range & range)
+{
+	Process(ar, range.start);
+	Process(ar, range.end);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Utility structs                                                            */
+/* -------------------------------------------------------------------------- */
+
+template <class A> void Process(A & ar, CameraSettings & def)
+{
+	ProcessEnum(ar, def.mode);
+	Process(ar, def.cinecam_index);
+}
+
+template <class A> void Process(A & ar, NodeDefaults & def)
+{
+	Process(ar, def.load_weight);
+	Process(ar, def.friction);
+	Process(ar, def.volume);
+	Process(ar, def.surface);
+	Process(ar, def.options);
+}
+
+template <class A> void Process(A & ar, BeamDefaultsScale & def)
+{
+	Process(ar, def.springiness);
+	Process(ar, def.damping_constant);
+	Process(ar, def.deformation_threshold_constant);
+	Process(ar, def.breaking_threshold_constant);
+}
+
+template <class A> void Process(A & ar, BeamDefaults & def)
+{
+	Process(ar, def.springiness);
+	Process(ar, def.damping_constant);
+	Process(ar, def.deformation_threshold_constant);
+	Process(ar, def.breaking_threshold_constant);
+	Process(ar, def.visual_beam_diameter);
+	Process(ar, def.beam_material_name);
+	Process(ar, def.plastic_deformation_coefficient);
+	Process(ar, def._user_specified_fields);
+	Process(ar, def._enable_advanced_deformation);
+	Process(ar, def._is_user_defined);
+	Process(ar, def.scale);
+}
+
+template <class A> void Process(A & ar, Inertia & def)
+{
+	Process(ar, def.start_delay_factor);
+	Process(ar, def.stop_delay_factor);
+	Process(ar, def.start_function);
+	Process(ar, def.stop_function);
+}
+
+template <class A> void Process(A & ar, DefaultInertia & def)
+{
+	Process(ar, static_cast<Inertia &>(def));
+}
+
+template <class A> void Process(A & ar, OptionalInertia & def)
+{
+	Process(ar, static_cast<Inertia &>(def));
+	Process(ar, def._start_delay_factor_set);
+	Process(ar, def._stop_delay_factor_set);
+}
+
+template <class A> void Process(A & ar, ManagedMaterialsOptions & def)
+{
+	Process(ar, def.double_sided);
+}
+
+template <class A> void Process(A & ar, SkeletonSettings & def)
+{
+	Process(ar, def.visibility_range_meters);
+	Process(ar, def.beam_thickness_meters);
+}
+
+template <class A> void Process(A & ar, Animation::MotorSource & def)
+{
+	Process(ar, def.source);
+	Process(ar, def.motor);
+}
+
+template <class A> void Process(A & ar, Animation & def)
+{
+	Process(ar, def.ratio);
+	Process(ar, def.lower_limit);
+	Process(ar, def.upper_limit);
+	Process(ar, def.source);
+	Process(ar, def.motor_sources);
+	Process(ar, def.mode);
+	Process(ar, def.event);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Sections                                                                   */
+/* -------------------------------------------------------------------------- */
+
+template <class A> void Process(A & ar, Node & def)
+{
+	Process(ar, def.id);
+	Process(ar, def.position);
+	Process(ar, def.options);
+	Process(ar, def.load_weight_override);
+	Process(ar, def._has_load_weight_override);
+	Process(ar, def.node_defaults);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Globals & def)
+{
+	Process(ar, def.dry_mass);
+	Process(ar, def.cargo_mass);
+	Process(ar, def.material_name);
+}
+
+template <class A> void Process(A & ar, GuiSettings & def)
+{
+	Process(ar, def.tacho_material);
+	Process(ar, def.speedo_material);
+	Process(ar, def.speedo_highest_kph);
+	Process(ar, def.use_max_rpm);
+	Process(ar, def.help_material);
+	ProcessEnum(ar, def.interactive_overview_map_mode);
+	Process(ar, def.dashboard_layouts);
+	Process(ar, def.rtt_dashboard_layouts);
+}
+
+template <class A> void Process(A & ar, Airbrake & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.x_axis_node);
+	Process(ar, def.y_axis_node);
+	Process(ar, def.aditional_node);
+	Process(ar, def.offset);
+	Process(ar, def.width);
+	Process(ar, def.height);
+	Process(ar, def.max_inclination_angle);
+	Process(ar, def.texcoord_x1);
+	Process(ar, def.texcoord_x2);
+	Process(ar, def.texcoord_y1);
+	Process(ar, def.texcoord_y2);
+	Process(ar, def.lift_coefficient);
+}
+
+template <class A> void Process(A & ar, Axle & def)
+{
+	Process(ar, def.wheels);
+	Process(ar, def.options);
+}
+
+template <class A> void Process(A & ar, Beam & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.options);
+	Process(ar, def.extension_break_limit);
+	Process(ar, def._has_extension_break_limit);
+	Process(ar, def.detacher_group);
+	Process(ar, def.defaults);
+}
+
+template <class A> void Process(A & ar, Camera & def)
+{
+	Process(ar, def.center_node);
+	Process(ar, def.back_node);
+	Process(ar, def.left_node);
+}
+
+template <class A> void Process(A & ar, CameraRail & def)
+{
+	Process(ar, def.nodes);
+}
+
+template <class A> void Process(A & ar, Cinecam & def)
+{
+	Process(ar, def.position);
+	Process(ar, def.nodes);
+	Process(ar, def.spring);
+	Process(ar, def.damping);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.node_defaults);
+}
+
+template <class A> void Process(A & ar, CollisionBox & def)
+{
+	Process(ar, def.nodes);
+}
+
+template <class A> void Process(A & ar, CruiseControl & def)
+{
+	Process(ar, def.min_speed);
+	Process(ar, def.autobrake);
+}
+
+template <class A> void Process(A & ar, Author & def)
+{
+	Process(ar, def.type);
+	Process(ar, def.forum_account_id);
+	Process(ar, def.name);
+	Process(ar, def.email);
+	Process(ar, def._has_forum_account);
+}
+
+template <class A> void Process(A & ar, Fileinfo & def)
+{
+	Process(ar, def.unique_id);
+	Process(ar, def.category_id);
+	Process(ar, def.file_version);
+	Process(ar, def._has_unique_id);
+	Process(ar, def._has_category_id);
+	Process(ar, def._has_file_version_set);
+}
+
+template <class A> void Process(A & ar, Engine & def)
+{
+	Process(ar, def.shift_down_rpm);
+	Process(ar, def.shift_up_rpm);
+	Process(ar, def.torque);
+	Process(ar, def.global_gear_ratio);
+	Process(ar, def.reverse_gear_ratio);
+	Process(ar, def.neutral_gear_ratio);
+	Process(ar, def.gear_ratios);
+}
+
+template <class A> void Process(A & ar, Engoption & def)
+{
+	Process(ar, def.inertia);
+	ProcessEnum(ar, def.type);
+	Process(ar, def.clutch_force);
+	Process(ar, def._clutch_force_use_default);
+	Process(ar, def.shift_time);
+	Process(ar, def.clutch_time);
+	Process(ar, def.post_shift_time);
+	Process(ar, def.idle_rpm);
+	Process(ar, def._idle_rpm_use_default);
+	Process(ar, def.stall_rpm);
+	Process(ar, def.max_idle_mixture);
+	Process(ar, def.min_idle_mixture);
+}
+
+template <class A> void Process(A & ar, Exhaust & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.direction_node);
+	Process(ar, def.material_name);
+}
+
+template <class A> void Process(A & ar, ExtCamera & def)
+{
+	ProcessEnum(ar, def.mode);
+	Process(ar, def.node);
+}
+
+template <class A> void Process(A & ar, Brakes & def)
+{
+	Process(ar, def.default_braking_force);
+	Process(ar, def.parking_brake_force);
+	Process(ar, def._parking_brake_force_set);
+}
+
+template <class A> void Process(A & ar, AntiLockBrakes & def)
+{
+	Process(ar, def.regulation_force);
+	Process(ar, def.min_speed);
+	Process(ar, def.pulse_per_sec);
+	Process(ar, def._pulse_per_sec_set);
+	Process(ar, def.mode);
+}
+
+template <class A> void Process(A & ar, TractionControl & def)
+{
+	Process(ar, def.regulation_force);
+	Process(ar, def.wheel_slip);
+	Process(ar, def.fade_speed);
+	Process(ar, def.pulse_per_sec);
+	Process(ar, def.mode);
+}
+
+template <class A> void Process(A & ar, SlopeBrake & def)
+{
+	Process(ar, def.regulating_force);
+	Process(ar, def.attach_angle);
+	Process(ar, def.release_angle);
+}
+
+template <class A> void Process(A & ar, BaseWheel & def)
+{
+	Process(ar, def.width);
+	Process(ar, def.num_rays);
+	Process(ar, def.nodes);
+	Process(ar, def.rigidity_node);
+	ProcessEnum(ar, def.braking);
+	ProcessEnum(ar, def.propulsion);
+	Process(ar, def.reference_arm_node);
+	Process(ar, def.mass);
+	Process(ar, def.node_defaults);
+	Process(ar, def.beam_defaults);
+}
+
+template <class A> void Process(A & ar, Wheel & def)
+{
+	Process(ar, static_cast<BaseWheel &>(def));
+	Process(ar, def.radius);
+	Process(ar, def.springiness);
+	Process(ar, def.damping);
+	Process(ar, def.face_material_name);
+	Process(ar, def.band_material_name);
+}
+
+template <class A> void Process(A & ar, BaseWheel2 & def)
+{
+	Process(ar, static_cast<BaseWheel &>(def));
+	Process(ar, def.rim_radius);
+	Process(ar, def.tyre_radius);
+	Process(ar, def.tyre_springiness);
+	Process(ar, def.tyre_damping);
+}
+
+template <class A> void Process(A & ar, Wheel2 & def)
+{
+	Process(ar, static_cast<BaseWheel2 &>(def));
+	Process(ar, def.face_material_name);
+	Process(ar, def.band_material_name);
+	Process(ar, def.rim_springiness);
+	Process(ar, def.rim_damping);
+}
+
+template <class A> void Process(A & ar, MeshWheel & def)
+{
+	Process(ar, static_cast<BaseWheel &>(def));
+	ProcessEnum(ar, def.side);
+	Process(ar, def.mesh_name);
+	Process(ar, def.material_name);
+	Process(ar, def.rim_radius);
+	Process(ar, def.tyre_radius);
+	Process(ar, def.spring);
+	Process(ar, def.damping);
+}
+
+template <class A> void Process(A & ar, MeshWheel2 & def)
+{
+	Process(ar, static_cast<BaseWheel2 &>(def));
+	ProcessEnum(ar, def.side);
+	Process(ar, def.mesh_name);
+	Process(ar, def.material_name);
+}
+
+template <class A> void Process(A & ar, Flare2 & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.x);
+	Process(ar, def.y);
+	Process(ar, def.offset);
+	ProcessEnum(ar, def.type);
+	Process(ar, def.control_number);
+	Process(ar, def.blink_delay_milis);
+	Process(ar, def.size);
+	Process(ar, def.material_name);
+}
+
+template <class A> void Process(A & ar, Flexbody & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.x_axis_node);
+	Process(ar, def.y_axis_node);
+	Process(ar, def.offset);
+	Process(ar, def.rotation);
+	Process(ar, def.mesh_name);
+	Process(ar, def.animations);
+	Process(ar, def.forset);
+	Process(ar, def.camera_settings);
+}
+
+template <class A> void Process(A & ar, FlexBodyWheel & def)
+{
+	Process(ar, static_cast<BaseWheel2 &>(def));
+	ProcessEnum(ar, def.side);
+	Process(ar, def.rim_springiness);
+	Process(ar, def.rim_damping);
+	Process(ar, def.rim_mesh_name);
+	Process(ar, def.tyre_mesh_name);
+}
+
+template <class A> void Process(A & ar, Fusedrag & def)
+{
+	Process(ar, def.autocalc);
+	Process(ar, def.front_node);
+	Process(ar, def.rear_node);
+	Process(ar, def.approximate_width);
+	Process(ar, def.airfoil_name);
+	Process(ar, def.area_coefficient);
+	Process(ar, def._area_coefficient_set);
+}
+
+template <class A> void Process(A & ar, Hook & def)
+{
+	Process(ar, def.node);
+	Process(ar, def.flags);
+	Process(ar, def.option_hook_range);
+	Process(ar, def.option_speed_coef);
+	Process(ar, def.option_max_force);
+	Process(ar, def.option_hookgroup);
+	Process(ar, def.option_lockgroup);
+	Process(ar, def.option_timer);
+	Process(ar, def.option_minimum_range_meters);
+}
+
+template <class A> void Process(A & ar, Shock & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.spring_rate);
+	Process(ar, def.damping);
+	Process(ar, def.short_bound);
+	Process(ar, def.long_bound);
+	Process(ar, def.precompression);
+	Process(ar, def.options);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Shock2 & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.spring_in);
+	Process(ar, def.damp_in);
+	Process(ar, def.progress_factor_spring_in);
+	Process(ar, def.progress_factor_damp_in);
+	Process(ar, def.spring_out);
+	Process(ar, def.damp_out);
+	Process(ar, def.progress_factor_spring_out);
+	Process(ar, def.progress_factor_damp_out);
+	Process(ar, def.short_bound);
+	Process(ar, def.long_bound);
+	Process(ar, def.precompression);
+	Process(ar, def.options);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Hydro & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.lenghtening_factor);
+	Process(ar, def.options);
+	Process(ar, def.inertia);
+	Process(ar, def.inertia_defaults);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, AeroAnimator & def)
+{
+	Process(ar, def.flags);
+	Process(ar, def.motor);
+}
+
+template <class A> void Process(A & ar, Animator & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.lenghtening_factor);
+	Process(ar, def.flags);
+	Process(ar, def.short_limit);
+	Process(ar, def.long_limit);
+	Process(ar, def.aero_animator);
+	Process(ar, def.inertia_defaults);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Command2 & def)
+{
+	Process(ar, def._format_version);
+	Process(ar, def.nodes);
+	Process(ar, def.shorten_rate);
+	Process(ar, def.lengthen_rate);
+	Process(ar, def.max_contraction);
+	Process(ar, def.max_extension);
+	Process(ar, def.contract_key);
+	Process(ar, def.extend_key);
+	Process(ar, def.options);
+	Process(ar, def.description);
+	Process(ar, def.inertia);
+	Process(ar, def.affect_engine);
+	Process(ar, def.needs_engine);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.inertia_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Rotator & def)
+{
+	Process(ar, def.axis_nodes);
+	Process(ar, def.base_plate_nodes);
+	Process(ar, def.rotating_plate_nodes);
+	Process(ar, def.rate);
+	Process(ar, def.spin_left_key);
+	Process(ar, def.spin_right_key);
+	Process(ar, def.inertia);
+	Process(ar, def.inertia_defaults);
+	Process(ar, def.engine_coupling);
+	Process(ar, def.needs_engine);
+}
+
+template <class A> void Process(A & ar, Rotator2 & def)
+{
+	Process(ar, static_cast<Rotator &>(def));
+	Process(ar, def.rotating_force);
+	Process(ar, def.tolerance);
+	Process(ar, def.description);
+}
+
+template <class A> void Process(A & ar, Trigger & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.contraction_trigger_limit);
+	Process(ar, def.expansion_trigger_limit);
+	Process(ar, def.shortbound_trigger_key);
+	Process(ar, def.longbound_trigger_key);
+	Process(ar, def.options);
+	Process(ar, def.boundary_timer);
+	Process(ar, def._engine_trigger_motor_index);
+	ProcessEnum(ar, def._engine_trigger_function);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Lockgroup & def)
+{
+	Process(ar, def.number);
+	Process(ar, def.nodes);
+}
+
+template <class A> void Process(A & ar, ManagedMaterial & def)
+{
+	Process(ar, def.name);
+	ProcessEnum(ar, def.type);
+	Process(ar, def.options);
+	Process(ar, def.diffuse_map);
+	Process(ar, def.damaged_diffuse_map);
+	Process(ar, def.specular_map);
+}
+
+template <class A> void Process(A & ar, MaterialFlareBinding & def)
+{
+	Process(ar, def.flare_number);
+	Process(ar, def.material_name);
+}
+
+template <class A> void Process(A & ar, NodeCollision & def)
+{
+	Process(ar, def.node);
+	Process(ar, def.radius);
+}
+
+template <class A> void Process(A & ar, Particle & def)
+{
+	Process(ar, def.emitter_node);
+	Process(ar, def.reference_node);
+	Process(ar, def.particle_system_name);
+}
+
+template <class A> void Process(A & ar, Pistonprop & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.axis_node);
+	Process(ar, def.blade_tip_nodes);
+	Process(ar, def.couple_node);
+	Process(ar, def._couple_node_set);
+	Process(ar, def.turbine_power_kW);
+	Process(ar, def.pitch);
+	Process(ar, def.airfoil);
+}
+
+template <class A> void Process(A & ar, Prop::SteeringWheelSpecial & def)
+{
+	Process(ar, def.offset);
+	Process(ar, def._offset_is_set);
+	Process(ar, def.rotation_angle);
+	Process(ar, def.mesh_name);
+}
+
+template <class A> void Process(A & ar, Prop::BeaconSpecial & def)
+{
+	Process(ar, def.flare_material_name);
+	Process(ar, def.color);
+}
+
+template <class A> void Process(A & ar, Prop & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.x_axis_node);
+	Process(ar, def.y_axis_node);
+	Process(ar, def.offset);
+	Process(ar, def.rotation);
+	Process(ar, def.mesh_name);
+	Process(ar, def.animations);
+	Process(ar, def.camera_settings);
+	ProcessEnum(ar, def.special);
+	Process(ar, def.special_prop_beacon);
+	Process(ar, def.special_prop_steering_wheel);
+}
+
+template <class A> void Process(A & ar, RailGroup & def)
+{
+	Process(ar, def.id);
+	Process(ar, def.node_list);
+}
+
+template <class A> void Process(A & ar, Ropable & def)
+{
+	Process(ar, def.node);
+	Process(ar, def.group);
+	Process(ar, def._has_group_set);
+	Process(ar, def.multilock);
+	Process(ar, def._has_multilock_set);
+}
+
+template <class A> void Process(A & ar, Rope & def)
+{
+	Process(ar, def.root_node);
+	Process(ar, def.end_node);
+	Process(ar, def.invisible);
+	Process(ar, def._has_invisible_set);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+}
+
+template <class A> void Process(A & ar, Screwprop & def)
+{
+	Process(ar, def.prop_node);
+	Process(ar, def.back_node);
+	Process(ar, def.top_node);
+	Process(ar, def.power);
+}
+
+template <class A> void Process(A & ar, SlideNode & def)
+{
+	Process(ar, def.slide_node);
+	Process(ar, def.rail_node_ranges);
+	Process(ar, def.spring_rate);
+	Process(ar, def.break_force);
+	Process(ar, def.tolerance);
+	Process(ar, def.railgroup_id);
+	Process(ar, def._railgroup_id_set);
+	Process(ar, def.attachment_rate);
+	Process(ar, def.max_attachment_distance);
+	Process(ar, def._break_force_set);
+	Process(ar, def.constraint_flags);
+}
+
+template <class A> void Process(A & ar, SoundSource & def)
+{
+	Process(ar, def.node);
+	Process(ar, def.sound_script_name);
+}
+
+template <class A> void Process(A & ar, SoundSource2 & def)
+{
+	Process(ar, static_cast<SoundSource &>(def));
+	ProcessEnum(ar, def.mode);
+	Process(ar, def.cinecam_index);
+}
+
+template <class A> void Process(A & ar, SpeedLimiter & def)
+{
+	Process(ar, def.max_speed);
+}
+
+template <class A> void Process(A & ar, Cab & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.options);
+}
+
+template <class A> void Process(A & ar, Texcoord & def)
+{
+	Process(ar, def.node);
+	Process(ar, def.u);
+	Process(ar, def.v);
+}
+
+template <class A> void Process(A & ar, Submesh & def)
+{
+	Process(ar, def.backmesh);
+	Process(ar, def.texcoords);
+	Process(ar, def.cab_triangles);
+}
+
+template <class A> void Process(A & ar, Tie & def)
+{
+	Process(ar, def.root_node);
+	Process(ar, def.max_reach_length);
+	Process(ar, def.auto_shorten_rate);
+	Process(ar, def.min_length);
+	Process(ar, def.max_length);
+	ProcessEnum(ar, def.options);
+	Process(ar, def.max_stress);
+	Process(ar, def.beam_defaults);
+	Process(ar, def.detacher_group);
+	Process(ar, def.group);
+	Process(ar, def._group_set);
+}
+
+template <class A> void Process(A & ar, TorqueCurve::Sample & def)
+{
+	Process(ar, def.power);
+	Process(ar, def.torque_percent);
+}
+
+template <class A> void Process(A & ar, TorqueCurve & def)
+{
+	Process(ar, def.samples);
+	Process(ar, def.predefined_func_name);
+}
+
+template <class A> void Process(A & ar, Turbojet & def)
+{
+	Process(ar, def.front_node);
+	Process(ar, def.back_node);
+	Process(ar, def.side_node);
+	Process(ar, def.is_reversable);
+	Process(ar, def.dry_thrust);
+	Process(ar, def.wet_thrust);
+	Process(ar, def.front_diameter);
+	Process(ar, def.back_diameter);
+	Process(ar, def.nozzle_length);
+}
+
+template <class A> void Process(A & ar, Turboprop2 & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.axis_node);
+	Process(ar, def.blade_tip_nodes);
+	Process(ar, def.turbine_power_kW);
+	Process(ar, def.airfoil);
+	Process(ar, def.couple_node);
+	Process(ar, def._format_version);
+}
+
+template <class A> void Process(A & ar, VideoCamera & def)
+{
+	Process(ar, def.reference_node);
+	Process(ar, def.left_node);
+	Process(ar, def.bottom_node);
+	Process(ar, def.alt_reference_node);
+	Process(ar, def._alt_reference_node_set);
+	Process(ar, def.alt_orientation_node);
+	Process(ar, def._alt_orientation_node_set);
+	Process(ar, def.offset);
+	Process(ar, def.rotation);
+	Process(ar, def.field_of_view);
+	Process(ar, def.texture_width);
+	Process(ar, def.texture_height);
+	Process(ar, def.min_clip_distance);
+	Process(ar, def.max_clip_distance);
+	Process(ar, def.camera_role);
+	Process(ar, def.camera_mode);
+	Process(ar, def.material_name);
+	Process(ar, def.camera_name);
+}
+
+template <class A> void Process(A & ar, Wing & def)
+{
+	Process(ar, def.nodes);
+	Process(ar, def.tex_coords);
+	ProcessEnum(ar, def.control_surface);
+	Process(ar, def.chord_point);
+	Process(ar, def.min_deflection);
+	Process(ar, def.max_deflection);
+	Process(ar, def.airfoil);
+	Process(ar, def.efficacy_coef);
+}
+
+/* -------------------------------------------------------------------------- */
+/* File                                                                       */
+/* -------------------------------------------------------------------------- */
+
+/** Everything except name, which is needed to construct the module */
+template <class A> void Process(A & ar, File::Module & def)
+{
+	Process(ar, def.help_panel_material_name);
+	Process(ar, def.contacter_nodes);
+	Process(ar, def.airbrakes);
+	Process(ar, def.animators);
+	Process(ar, def.anti_lock_brakes);
+	Process(ar, def.axles);
+	Process(ar, def.beams);
+	Process(ar, def.brakes);
+	Process(ar, def.cameras);
+	Process(ar, def.camera_rails);
+	Process(ar, def.collision_boxes);
+	Process(ar, def.cinecam);
+	Process(ar, def.commands_2);
+	Process(ar, def.cruise_control);
+	Process(ar, def.contacters);
+	Process(ar, def.engine);
+	Process(ar, def.engoption);
+	Process(ar, def.exhausts);
+	Process(ar, def.ext_camera);
+	Process(ar, def.fixes);
+	Process(ar, def.flares_2);
+	Process(ar, def.flexbodies);
+	Process(ar, def.flex_body_wheels);
+	Process(ar, def.fusedrag);
+	Process(ar, def.globals);
+	Process(ar, def.gui_settings);
+	Process(ar, def.hooks);
+	Process(ar, def.hydros);
+	Process(ar, def.lockgroups);
+	Process(ar, def.managed_materials);
+	Process(ar, def.material_flare_bindings);
+	Process(ar, def.mesh_wheels);
+	Process(ar, def.mesh_wheels_2);
+	Process(ar, def.nodes);
+	Process(ar, def.node_collisions);
+	Process(ar, def.particles);
+	Process(ar, def.pistonprops);
+	Process(ar, def.props);
+	Process(ar, def.railgroups);
+	Process(ar, def.ropables);
+	Process(ar, def.ropes);
+	Process(ar, def.rotators);
+	Process(ar, def.rotators_2);
+	Process(ar, def.screwprops);
+	Process(ar, def.shocks);
+	Process(ar, def.shocks_2);
+	Process(ar, def.skeleton_settings);
+	Process(ar, def.slidenodes);
+	Process(ar, def.slope_brake);
+	Process(ar, def.soundsources);
+	Process(ar, def.soundsources2);
+	Process(ar, def.speed_limiter);
+	Process(ar, def.submeshes_ground_model_name);
+	Process(ar, def.submeshes);
+	Process(ar, def.ties);
+	Process(ar, def.torque_curve);
+	Process(ar, def.traction_control);
+	Process(ar, def.triggers);
+	Process(ar, def.turbojets);
+	Process(ar, def.turboprops_2);
+	Process(ar, def.videocameras);
+	Process(ar, def.wheels);
+	Process(ar, def.wheels_2);
+	Process(ar, def.wings);
+}
+
+void ProcessModule(BinaryWriter & ar, boost::shared_ptr<File::Module> & module)
+{
+	Process(ar, module->name);
+	Process(ar, *module);
+}
+
+void ProcessModule(BinaryReader & ar, boost::shared_ptr<File::Module> & module)
+{
+	Ogre::String name;
+	Process(ar, name);
+	module = boost::shared_ptr<File::Module>(new File::Module(name));
+	Process(ar, *module);
+}
+
+void ProcessModules(BinaryWriter & ar, std::map< Ogre::String, boost::shared_ptr<File::Module> > & modules)
+{
+	unsigned int count = static_cast<unsigned int>(modules.size());
+	Process(ar, count);
+	std::map< Ogre::String, boost::shared_ptr<File::Module> >::iterator itor = modules.begin();
+	for (; itor != modules.end(); ++itor)
+	{
+		Ogre::String key = itor->first;
+		Process(ar, key);
+		ProcessModule(ar, itor->second);
+	}
+}
+
+void ProcessModules(BinaryReader & ar, std::map< Ogre::String, boost::shared_ptr<File::Module> > & modules)
+{
+	unsigned int count = 0;
+	Process(ar, count);
+	if (! ar.CheckCount(count))
+	{
+		return;
+	}
+	modules.clear();
+	for (unsigned int i = 0; i < count && ! ar.m_failed; i++)
+	{
+		Ogre::String key;
+		Process(ar, key);
+		ProcessModule(ar, modules[key]);
+	}
+}
+
+template <class A> void Process(A & ar, File & def)
+{
+	Process(ar, def.file_format_version);
+	Process(ar, def.guid);
+	Process(ar, def.description);
+	Process(ar, def.hide_in_chooser);
+	Process(ar, def.enable_advanced_deformation);
+	Process(ar, def.slide_nodes_connect_instantly);
+	Process(ar, def.rollon);
+	Process(ar, def.forward_commands);
+	Process(ar, def.import_commands);
+	Process(ar, def.lockgroup_default_nolock);
+	Process(ar, def.rescuer);
+	Process(ar, def.disable_default_sounds);
+	Process(ar, def.name);
+	Process(ar, def.collision_range);
+	Process(ar, def._collision_range_set);
+	Process(ar, def.minimum_mass);
+	Process(ar, def._minimum_mass_set);
+	ProcessModule(ar, def.root_module);
+	ProcessModules(ar, def.modules);
+	Process(ar, def.authors);
+	Process(ar, def.file_info);
+}
+
+/** Identifies format version and platform */
+template <class A> void ProcessHeader(A & ar, unsigned int & magic, unsigned int & version, unsigned int & byte_order, unsigned int & sizes)
+{
+	Process(ar, magic);
+	Process(ar, version);
+	Process(ar, byte_order);
+	Process(ar, sizes);
+}
+
+static unsigned int GetTypeSizes()
+{
+	return static_cast<unsigned int>((sizeof(int) << 24) | (sizeof(Ogre::Real) << 16) | (sizeof(float) << 8) | sizeof(bool));
+}
+
+/* -------------------------------------------------------------------------- */
+/* BinarySerializer                                                           */
+/* -------------------------------------------------------------------------- */
+
+void BinarySerializer::Serialize(boost::shared_ptr<File> file, Ogre::String const & source_id, std::vector<char> & buffer)
+{
+	BinaryWriter ar(buffer);
+
+	unsigned int magic = MAGIC_NUMBER;
+	unsigned int version = FORMAT_VERSION;
+	unsigned int byte_order = ENDIANNESS_MARKER;
+	unsigned int sizes = GetTypeSizes();
+	ProcessHeader(ar, magic, version, byte_order, sizes);
+
+	Ogre::String id = source_id;
+	Process(ar, id);
+	Process(ar, *file);
+}
+
+boost::shared_ptr<File> BinarySerializer::Deserialize(const char* data, size_t size, Ogre::String const & source_id)
+{
+	BinaryReader ar(data, size);
+
+	unsigned int magic = 0;
+	unsigned int version = 0;
+	unsigned int byte_order = 0;
+	unsigned int sizes = 0;
+	ProcessHeader(ar, magic, version, byte_order, sizes);
+	if (ar.m_failed || magic != MAGIC_NUMBER || version != FORMAT_VERSION || byte_order != ENDIANNESS_MARKER || sizes != GetTypeSizes())
+	{
+		return boost::shared_ptr<File>();
+	}
+
+	Ogre::String id;
+	Process(ar, id);
+	if (ar.m_failed || id != source_id)
+	{
+		return boost::shared_ptr<File>();
+	}
+
+	boost::shared_ptr<File> file(new File());
+	Process(ar, *file);
+	if (! ar.IsComplete())
+	{
+		return boost::shared_ptr<File>();
+	}
+	return file;
+}
+
+} // namespace RigDef
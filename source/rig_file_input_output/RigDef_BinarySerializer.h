@@ -0,0 +1,69 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   RigDef_BinarySerializer.h
+	@brief  Compact binary snapshot of RigDef::File, used to cache parsed rigs.
+*/
+
+#pragma once
+
+#include "RigDef_File.h"
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace RigDef
+{
+
+/**
+	@class  BinarySerializer
+
+	@brief Writes/reads the complete RigDef::File data structure to/from a memory buffer.
+
+	Unlike Serializer (text writer), the output is meant only for the program itself:
+	it's a raw dump of all fields in declaration order, read back with a single pass and
+	no parsing. Defaults (BeamDefaults, NodeDefaults, DefaultInertia) are written once and
+	referenced by index, so elements keep sharing the same defaults object as after parsing.
+
+	The data are only valid for the same FORMAT_VERSION and the same platform (byte order, sizes);
+	Deserialize() rejects everything else.
+*/
+class BinarySerializer
+{
+
+public:
+
+	/** IMPORTANT! Increment whenever RigDef::File, Parser or Validator output changes. */
+	static const unsigned int FORMAT_VERSION = 1;
+
+	/** Appends the snapshot to 'buffer'.
+	* @param source_id Identification of the source data (for example content hash), checked by Deserialize().
+	*/
+	static void Serialize(boost::shared_ptr<File> file, Ogre::String const & source_id, std::vector<char> & buffer);
+
+	/**
+	* @return Null if the data are incomplete, of different version/platform or from different source.
+	*/
+	static boost::shared_ptr<File> Deserialize(const char* data, size_t size, Ogre::String const & source_id);
+};
+
+} // namespace RigDef
@@ -45,7 +45,8 @@ namespace RigDef
 #define STR_PARSE_BOOL(_STR_) Ogre::StringConverter::parseBool(_STR_)
 
 Parser::Parser():
-	m_ror_minimass(0)
+	m_ror_minimass(0),
+	m_use_regex_tokenizer(false)
 {
 	/* Push defaults */
 	m_ror_default_inertia = boost::shared_ptr<DefaultInertia>(new DefaultInertia);
@@ -69,10 +70,9 @@ void Parser::ParseLine(Ogre::String const & line)
 	bool scan_for_keyword = true;
 
 	/* Check line type */
-	boost::smatch line_type_result;
 	if (m_in_block_comment)
 	{
-		if (boost::regex_match(line, Regexes::CHECK_BLOCK_COMMENT_END))
+		if (IsBlockKeywordLine(line, "end_comment", Regexes::CHECK_BLOCK_COMMENT_END))
 		{
 			m_in_block_comment = false;
 		}
@@ -80,7 +80,7 @@ void Parser::ParseLine(Ogre::String const & line)
 	}
 	else if (m_in_description_section)
 	{
-		if (boost::regex_match(line, Regexes::CHECK_END_DESCRIPTION))
+		if (IsBlockKeywordLine(line, "end_description", Regexes::CHECK_END_DESCRIPTION))
 		{
 			m_in_description_section = false;
 		}
@@ -92,22 +92,20 @@ void Parser::ParseLine(Ogre::String const & line)
 	}
 	else
 	{
-		if (boost::regex_search(line, line_type_result, Regexes::IDENTIFY_LINE_TYPE))
+		Tokenizer::LineType line_type = IdentifyLineType(line);
+		if (line_type == Tokenizer::LINE_BLOCK_COMMENT_START)
 		{
-			if (line_type_result[1].matched) /* Block comment start */
-			{
-				m_in_block_comment = true;
-				line_finished = true;
-			}
-			else if (line_type_result[2].matched || line_type_result[3].matched || line_type_result[4].matched) /* Comment line || blank line */
-			{
-				m_num_contiguous_blank_lines++;
-				line_finished = true;
-			}
-			else /* Line has content */
-			{
-				m_num_contiguous_blank_lines = 0;
-			}
+			m_in_block_comment = true;
+			line_finished = true;
+		}
+		else if (line_type == Tokenizer::LINE_COMMENT || line_type == Tokenizer::LINE_BLANK)
+		{
+			m_num_contiguous_blank_lines++;
+			line_finished = true;
+		}
+		else /* Line has content */
+		{
+			m_num_contiguous_blank_lines = 0;
 		}
 	}
 
@@ -2254,22 +2252,43 @@ void Parser::ParseSubmesh(Ogre::String const & line)
 {
 	if (m_current_subsection == File::SUBSECTION__SUBMESH__CAB)
 	{
-		boost::smatch results;
-		if (! boost::regex_search(line, results, Regexes::SUBMESH_SUBSECTION_CAB))
+		Cab cab;
+		bool has_options = false;
+		std::string options_str;
+
+		Tokenizer tokenizer;
+		if (! m_use_regex_tokenizer && tokenizer.TokenizeSubmeshCab(line))
 		{
-			AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
-			return;
+			cab.nodes[0] = _ParseNodeId(tokenizer.GetToken(0));
+			cab.nodes[1] = _ParseNodeId(tokenizer.GetToken(1));
+			cab.nodes[2] = _ParseNodeId(tokenizer.GetToken(2));
+
+			has_options = tokenizer.GetNumTokens() > 3;
+			if (has_options)
+			{
+				options_str = tokenizer.GetToken(3).ToString();
+			}
 		}
-		/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
+		else
+		{
+			boost::smatch results;
+			if (! boost::regex_search(line, results, Regexes::SUBMESH_SUBSECTION_CAB))
+			{
+				AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
+				return;
+			}
+			/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
 
-		Cab cab;
-		cab.nodes[0] = _ParseNodeId(results[1]);
-		cab.nodes[1] = _ParseNodeId(results[2]);
-		cab.nodes[2] = _ParseNodeId(results[3]);
+			cab.nodes[0] = _ParseNodeId(results[1]);
+			cab.nodes[1] = _ParseNodeId(results[2]);
+			cab.nodes[2] = _ParseNodeId(results[3]);
 
-		if (results[5].matched)
+			has_options = results[5].matched;
+			options_str = results[5].str();
+		}
+
+		if (has_options)
 		{
-			std::string options_str = results[5].str();
 			for (unsigned int i = 0; i < options_str.length(); i++)
 			{
 				switch(options_str.at(i))
@@ -2309,18 +2328,29 @@ void Parser::ParseSubmesh(Ogre::String const & line)
 	}
 	else if (m_current_subsection == File::SUBSECTION__SUBMESH__TEXCOORDS)
 	{
-		boost::smatch results;
-		if (! boost::regex_search(line, results, Regexes::SUBMESH_SUBSECTION_TEXCOORDS))
+		Texcoord texcoord;
+
+		Tokenizer tokenizer;
+		if (! m_use_regex_tokenizer && tokenizer.TokenizeSubmeshTexcoords(line))
 		{
-			AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
-			return;
+			texcoord.node = _ParseNodeId(tokenizer.GetToken(0));
+			texcoord.u = Tokenizer::ParseReal(tokenizer.GetToken(1));
+			texcoord.v = Tokenizer::ParseReal(tokenizer.GetToken(2));
 		}
-		/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
+		else
+		{
+			boost::smatch results;
+			if (! boost::regex_search(line, results, Regexes::SUBMESH_SUBSECTION_TEXCOORDS))
+			{
+				AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
+				return;
+			}
+			/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
 
-		Texcoord texcoord;
-		texcoord.node = _ParseNodeId(results[1]);
-		texcoord.u = STR_PARSE_REAL(results[2]);
-		texcoord.v = STR_PARSE_REAL(results[3]);
+			texcoord.node = _ParseNodeId(results[1]);
+			texcoord.u = STR_PARSE_REAL(results[2]);
+			texcoord.v = STR_PARSE_REAL(results[3]);
+		}
 
 		m_current_submesh->texcoords.push_back(texcoord);
 	}
@@ -4102,6 +4132,16 @@ void Parser::_CheckInvalidTrailingText(Ogre::String const & line, boost::smatch
 	}
 }
 
+Node::Id Parser::_ParseNodeId(Tokenizer::Token const & token)
+{
+	unsigned int number;
+	if (Tokenizer::ParseNodeNumber(token, number))
+	{
+		return Node::Id(number); /* Numbered node */
+	}
+	return _ParseNodeId(token.ToString());
+}
+
 Node::Id Parser::_ParseNodeId(std::string const & node_id_str)
 {
 	boost::smatch results;
@@ -4621,34 +4661,68 @@ void Parser::ParseNode2(Ogre::String const & line)
 
 void Parser::_ParseSectionsNodesNodes2(Ogre::String const & line)
 {
-	// Parse line
-	boost::smatch results;
-	if (! boost::regex_search(line, results, Regexes::SECTION_NODES_N2))
-	{
-		AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
-		return;
-	}
-	/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
-
 	Node node;
 	node.node_defaults = m_user_node_defaults;
 	node.beam_defaults = m_user_beam_defaults;
 	node.detacher_group = m_current_detacher_group;
 
-	node.id = _ParseNodeId(results[1]);	
-	node.position.x = STR_PARSE_REAL(results[3]);
-	node.position.y = STR_PARSE_REAL(results[5]);
-	node.position.z = STR_PARSE_REAL(results[7]);
+	bool has_options = false;
+	std::string options_str;
+	bool has_load_weight = false;
+	float load_weight = 0;
 
-	if (results[10].matched) /* Has options? */
+	Tokenizer tokenizer;
+	if (! m_use_regex_tokenizer && tokenizer.TokenizeNodes(line))
 	{
-		_ParseNodeOptions(node.options, results[10]);
+		node.id = _ParseNodeId(tokenizer.GetToken(0));
+		node.position.x = Tokenizer::ParseReal(tokenizer.GetToken(1));
+		node.position.y = Tokenizer::ParseReal(tokenizer.GetToken(2));
+		node.position.z = Tokenizer::ParseReal(tokenizer.GetToken(3));
 
-		if (results[13].matched) /* Has load weight override? */
+		has_options = tokenizer.GetNumTokens() > 4;
+		if (has_options)
+		{
+			options_str = tokenizer.GetToken(4).ToString();
+		}
+		has_load_weight = tokenizer.GetNumTokens() > 5;
+		if (has_load_weight)
+		{
+			load_weight = Tokenizer::ParseReal(tokenizer.GetToken(5));
+		}
+	}
+	else
+	{
+		boost::smatch results;
+		if (! boost::regex_search(line, results, Regexes::SECTION_NODES_N2))
+		{
+			AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
+			return;
+		}
+		/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
+
+		node.id = _ParseNodeId(results[1]);	
+		node.position.x = STR_PARSE_REAL(results[3]);
+		node.position.y = STR_PARSE_REAL(results[5]);
+		node.position.z = STR_PARSE_REAL(results[7]);
+
+		has_options = results[10].matched;
+		options_str = results[10];
+		has_load_weight = results[13].matched;
+		if (has_load_weight)
+		{
+			load_weight = STR_PARSE_REAL(results[13]);
+		}
+	}
+
+	if (has_options)
+	{
+		_ParseNodeOptions(node.options, options_str);
+
+		if (has_load_weight) /* Has load weight override? */
 		{
 			if (node.options & Node::OPTION_l_LOAD_WEIGHT)
 			{
-				node.load_weight_override = STR_PARSE_REAL(results[13]);
+				node.load_weight_override = load_weight;
 				node._has_load_weight_override = true;
 			}
 			else
@@ -5014,25 +5088,58 @@ void Parser::ParseBeams(Ogre::String const & _line)
 		line = line.substr(0, semicolon_index);
 	}
 
+	Beam beam;
+	beam.defaults = m_user_beam_defaults;
+	beam.detacher_group = m_current_detacher_group;
+
+	bool has_flags = false;
+	std::string flags_str;
+	bool has_extension_break_limit = false;
+	float extension_break_limit = 0;
+
 	// Parse arguments
-	boost::smatch results;
-	if (! boost::regex_search(line, results, Regexes::SECTION_BEAMS))
+	Tokenizer tokenizer;
+	if (! m_use_regex_tokenizer && tokenizer.TokenizeBeams(line))
 	{
-		AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
-		return;
+		beam.nodes[0] = _ParseNodeId(tokenizer.GetToken(0));
+		beam.nodes[1] = _ParseNodeId(tokenizer.GetToken(1));
+
+		has_flags = tokenizer.GetNumTokens() > 2;
+		if (has_flags)
+		{
+			flags_str = tokenizer.GetToken(2).ToString();
+		}
+		has_extension_break_limit = tokenizer.GetNumTokens() > 3;
+		if (has_extension_break_limit)
+		{
+			extension_break_limit = Tokenizer::ParseReal(tokenizer.GetToken(3));
+		}
 	}
-	/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
+	else
+	{
+		boost::smatch results;
+		if (! boost::regex_search(line, results, Regexes::SECTION_BEAMS))
+		{
+			AddMessage(line, Message::TYPE_ERROR, "Invalid line, ignoring...");
+			return;
+		}
+		/* NOTE: Positions in 'results' array match E_CAPTURE*() positions (starting with 1) in the respective regex. */
 
-	Beam beam;
-	beam.defaults = m_user_beam_defaults;
-	beam.detacher_group = m_current_detacher_group;
-	beam.nodes[0] = _ParseNodeId(results[1]);
-	beam.nodes[1] = _ParseNodeId(results[3]);
+		beam.nodes[0] = _ParseNodeId(results[1]);
+		beam.nodes[1] = _ParseNodeId(results[3]);
+
+		has_flags = results[6].matched;
+		flags_str = results[6];
+		has_extension_break_limit = results[9].matched;
+		if (has_extension_break_limit)
+		{
+			extension_break_limit = STR_PARSE_REAL(results[9]);
+		}
+	}
 
 	/* Flags */
-	if (results[6].matched)
+	if (has_flags)
 	{
-		std::string const & flags_str = results[6];
 		for (unsigned int i = 0; i < flags_str.length(); i++)
 		{
 			if (flags_str[i] == 'i') 
@@ -5046,10 +5153,10 @@ void Parser::ParseBeams(Ogre::String const & _line)
 			else if (flags_str[i] == 's')
 			{
 				beam.options |= Beam::OPTION_s_SUPPORT;
-				if (results[9].matched)
+				if (has_extension_break_limit)
 				{
 					beam._has_extension_break_limit = true;
-					beam.extension_break_limit = STR_PARSE_REAL(results[9]);
+					beam.extension_break_limit = extension_break_limit;
 				}
 			}
 			else
@@ -5262,6 +5369,12 @@ void Parser::AddMessage(std::string const & line, Message::Type type, std::strin
 
 File::Keyword Parser::IdentifyKeyword(Ogre::String const & line)
 {
+	File::Keyword keyword;
+	if (! m_use_regex_tokenizer && Tokenizer::IdentifyKeyword(line, keyword))
+	{
+		return keyword;
+	}
+
 	boost::smatch results;
 	if (boost::regex_search(line, results, Regexes::IDENTIFY_KEYWORD))
 	{
@@ -5282,6 +5395,49 @@ File::Keyword Parser::IdentifyKeyword(Ogre::String const & line)
 	return File::KEYWORD_INVALID;
 }
 
+Tokenizer::LineType Parser::IdentifyLineType(Ogre::String const & line)
+{
+	if (! m_use_regex_tokenizer)
+	{
+		Tokenizer::LineType line_type = Tokenizer::IdentifyLineType(line);
+		if (line_type != Tokenizer::LINE_UNKNOWN)
+		{
+			return line_type;
+		}
+	}
+
+	boost::smatch results;
+	if (boost::regex_search(line, results, Regexes::IDENTIFY_LINE_TYPE))
+	{
+		if (results[1].matched) /* Block comment start */
+		{
+			return Tokenizer::LINE_BLOCK_COMMENT_START;
+		}
+		else if (results[2].matched || results[3].matched) /* Comment line */
+		{
+			return Tokenizer::LINE_COMMENT;
+		}
+		else if (results[4].matched) /* Blank line */
+		{
+			return Tokenizer::LINE_BLANK;
+		}
+	}
+	return Tokenizer::LINE_CONTENT;
+}
+
+bool Parser::IsBlockKeywordLine(Ogre::String const & line, const char* keyword, boost::regex const & regex)
+{
+	if (! m_use_regex_tokenizer)
+	{
+		int result = Tokenizer::MatchBlockKeyword(line, keyword);
+		if (result != -1)
+		{
+			return result == 1;
+		}
+	}
+	return boost::regex_match(line, regex);
+}
+
 void Parser::Prepare()
 {
 	m_current_section = File::SECTION_TRUCK_NAME;
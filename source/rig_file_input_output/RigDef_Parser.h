@@ -28,6 +28,7 @@
 #pragma once
 
 #include "RigDef_File.h"
+#include "RigDef_Tokenizer.h"
 
 #include <string>
 #include <boost/regex.hpp>
@@ -119,6 +120,14 @@ public:
 		return m_definition;
 	}
 
+	/** Disables the Tokenizer fast paths; every line is then parsed by regexes only.
+	* The output is the same either way, this is meant for cross-checking and benchmarking.
+	*/
+	void SetUseRegexTokenizer(bool use_regex)
+	{
+		m_use_regex_tokenizer = use_regex;
+	}
+
 protected:
 
 /* -------------------------------------------------------------------------- */
@@ -304,6 +313,14 @@ protected:
 	*/
 	File::Keyword IdentifyKeyword(Ogre::String const & line);
 
+	/** Line type scan; result matches Tokenizer::LineType (never LINE_UNKNOWN).
+	*/
+	Tokenizer::LineType IdentifyLineType(Ogre::String const & line);
+
+	/** Equivalent of boost::regex_match(line, regex), where 'regex' is "^" keyword E_TRAILING_WHITESPACE.
+	*/
+	bool IsBlockKeywordLine(Ogre::String const & line, const char* keyword, boost::regex const & regex);
+
 	/** Adds a message to parser report.
 	*/
 	void AddMessage(std::string const & line, Message::Type type, std::string const & message);
@@ -322,6 +339,10 @@ protected:
 
 	Node::Id _ParseNodeId(std::string const & node_id_str);
 
+	/** Tokenizer variant; plain node numbers are converted in place, anything else goes through the regex variant.
+	*/
+	Node::Id _ParseNodeId(Tokenizer::Token const & token);
+
 	Node::Id _ParseOptionalNodeId(std::string const & node_id_str);
 
 	void _ParseDirectiveAddAnimationMode(Animation & animation, Ogre::String mode_string);
@@ -382,6 +403,7 @@ protected:
 	unsigned int                         m_current_line_number; ///< Only for reports. Initialised to 1
 	boost::shared_ptr<RigDef::File>      m_definition;
 	std::list<Message>                   m_messages;
+	bool                                 m_use_regex_tokenizer; ///< Skip Tokenizer fast paths. Default: false
 };
 
 } // namespace RigDef
@@ -0,0 +1,703 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   RigDef_Tokenizer.cpp
+*/
+
+#include "RigDef_Tokenizer.h"
+
+#include <OgreStringConverter.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace RigDef
+{
+
+/* -------------------------------------------------------------------------- */
+/* Keyword table                                                              */
+/* -------------------------------------------------------------------------- */
+
+enum KeywordType
+{
+	KEYWORD_TYPE_BLOCK,           ///< E_KEYWORD_BLOCK
+	KEYWORD_TYPE_INLINE,          ///< E_KEYWORD_INLINE
+	KEYWORD_TYPE_INLINE_TOLERANT  ///< E_KEYWORD_INLINE_TOLERANT
+};
+
+struct KeywordEntry
+{
+	const char*   name;
+	KeywordType   type;
+	File::Keyword keyword;
+};
+
+/* IMPORTANT! Must be kept in sync with Regexes::IDENTIFY_KEYWORD (same names, same types) */
+static const KeywordEntry KEYWORD_TABLE[] =
+{
+	{ "add_animation",                KEYWORD_TYPE_INLINE_TOLERANT,  File::KEYWORD_ADD_ANIMATION },
+	{ "airbrakes",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_AIRBRAKES },
+	{ "animators",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_ANIMATORS },
+	{ "AntiLockBrakes",               KEYWORD_TYPE_INLINE,           File::KEYWORD_ANTI_LOCK_BRAKES },
+	{ "axles",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_AXLES },
+	{ "author",                       KEYWORD_TYPE_INLINE,           File::KEYWORD_AUTHOR },
+	{ "backmesh",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_BACKMESH },
+	{ "beams",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_BEAMS },
+	{ "brakes",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_BRAKES },
+	{ "cab",                          KEYWORD_TYPE_BLOCK,            File::KEYWORD_CAB },
+	{ "camerarail",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_CAMERARAIL },
+	{ "cameras",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_CAMERAS },
+	{ "cinecam",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_CINECAM },
+	{ "collisionboxes",               KEYWORD_TYPE_BLOCK,            File::KEYWORD_COLLISIONBOXES },
+	{ "commands",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_COMMANDS },
+	{ "commands2",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_COMMANDS2 },
+	{ "contacters",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_CONTACTERS },
+	{ "cruisecontrol",                KEYWORD_TYPE_INLINE,           File::KEYWORD_CRUISECONTROL },
+	{ "description",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_DESCRIPTION },
+	{ "detacher_group",               KEYWORD_TYPE_INLINE,           File::KEYWORD_DETACHER_GROUP },
+	{ "disabledefaultsounds",         KEYWORD_TYPE_BLOCK,            File::KEYWORD_DISABLEDEFAULTSOUNDS },
+	{ "enable_advanced_deformation",  KEYWORD_TYPE_BLOCK,            File::KEYWORD_ENABLE_ADVANCED_DEFORMATION },
+	{ "end",                          KEYWORD_TYPE_BLOCK,            File::KEYWORD_END },
+	{ "end_section",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_END_SECTION },
+	{ "engine",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_ENGINE },
+	{ "engoption",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_ENGOPTION },
+	{ "envmap",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_ENVMAP },
+	{ "exhausts",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_EXHAUSTS },
+	{ "extcamera",                    KEYWORD_TYPE_INLINE,           File::KEYWORD_EXTCAMERA },
+	{ "fileformatversion",            KEYWORD_TYPE_INLINE,           File::KEYWORD_FILEFORMATVERSION },
+	{ "fileinfo",                     KEYWORD_TYPE_INLINE,           File::KEYWORD_FILEINFO },
+	{ "fixes",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_FIXES },
+	{ "flares",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_FLARES },
+	{ "flares2",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_FLARES2 },
+	{ "flexbodies",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_FLEXBODIES },
+	{ "flexbody_camera_mode",         KEYWORD_TYPE_INLINE,           File::KEYWORD_FLEXBODY_CAMERA_MODE },
+	{ "flexbodywheels",               KEYWORD_TYPE_BLOCK,            File::KEYWORD_FLEXBODYWHEELS },
+	{ "forwardcommands",              KEYWORD_TYPE_BLOCK,            File::KEYWORD_FORWARDCOMMANDS },
+	{ "fusedrag",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_FUSEDRAG },
+	{ "globals",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_GLOBALS },
+	{ "guid",                         KEYWORD_TYPE_INLINE,           File::KEYWORD_GUID },
+	{ "guisettings",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_GUISETTINGS },
+	{ "help",                         KEYWORD_TYPE_BLOCK,            File::KEYWORD_HELP },
+	{ "hideInChooser",                KEYWORD_TYPE_BLOCK,            File::KEYWORD_HIDE_IN_CHOOSER },
+	{ "hookgroup",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_HOOKGROUP },
+	{ "hooks",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_HOOKS },
+	{ "hydros",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_HYDROS },
+	{ "importcommands",               KEYWORD_TYPE_BLOCK,            File::KEYWORD_IMPORTCOMMANDS },
+	{ "lockgroups",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_LOCKGROUPS },
+	{ "lockgroup_default_nolock",     KEYWORD_TYPE_BLOCK,            File::KEYWORD_LOCKGROUP_DEFAULT_NOLOCK },
+	{ "managedmaterials",             KEYWORD_TYPE_BLOCK,            File::KEYWORD_MANAGEDMATERIALS },
+	{ "materialflarebindings",        KEYWORD_TYPE_BLOCK,            File::KEYWORD_MATERIALFLAREBINDINGS },
+	{ "meshwheels",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_MESHWHEELS },
+	{ "meshwheels2",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_MESHWHEELS2 },
+	{ "minimass",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_MINIMASS },
+	{ "nodecollision",                KEYWORD_TYPE_BLOCK,            File::KEYWORD_NODECOLLISION },
+	{ "nodes",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_NODES },
+	{ "nodes2",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_NODES2 },
+	{ "particles",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_PARTICLES },
+	{ "pistonprops",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_PISTONPROPS },
+	{ "prop_camera_mode",             KEYWORD_TYPE_INLINE,           File::KEYWORD_PROP_CAMERA_MODE },
+	{ "props",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_PROPS },
+	{ "railgroups",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_RAILGROUPS },
+	{ "rescuer",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_RESCUER },
+	{ "rigidifiers",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_RIGIDIFIERS },
+	{ "rollon",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_ROLLON },
+	{ "ropables",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_ROPABLES },
+	{ "ropes",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_ROPES },
+	{ "rotators",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_ROTATORS },
+	{ "rotators2",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_ROTATORS2 },
+	{ "screwprops",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_SCREWPROPS },
+	{ "section",                      KEYWORD_TYPE_INLINE,           File::KEYWORD_SECTION },
+	{ "sectionconfig",                KEYWORD_TYPE_INLINE,           File::KEYWORD_SECTIONCONFIG },
+	{ "set_beam_defaults",            KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_BEAM_DEFAULTS },
+	{ "set_beam_defaults_scale",      KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_BEAM_DEFAULTS_SCALE },
+	{ "set_collision_range",          KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_COLLISION_RANGE },
+	{ "set_inertia_defaults",         KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_INERTIA_DEFAULTS },
+	{ "set_managedmaterials_options", KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_MANAGEDMATERIALS_OPTIONS },
+	{ "set_node_defaults",            KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_NODE_DEFAULTS },
+	{ "set_shadows",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_SET_SHADOWS },
+	{ "set_skeleton_settings",        KEYWORD_TYPE_INLINE,           File::KEYWORD_SET_SKELETON_SETTINGS },
+	{ "shocks",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_SHOCKS },
+	{ "shocks2",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_SHOCKS2 },
+	{ "slidenode_connect_instantly",  KEYWORD_TYPE_BLOCK,            File::KEYWORD_SLIDENODE_CONNECT_INSTANTLY },
+	{ "slidenodes",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_SLIDENODES },
+	{ "SlopeBrake",                   KEYWORD_TYPE_INLINE,           File::KEYWORD_SLOPE_BRAKE },
+	{ "soundsources",                 KEYWORD_TYPE_BLOCK,            File::KEYWORD_SOUNDSOURCES },
+	{ "soundsources2",                KEYWORD_TYPE_BLOCK,            File::KEYWORD_SOUNDSOURCES2 },
+	{ "speedlimiter",                 KEYWORD_TYPE_INLINE,           File::KEYWORD_SPEEDLIMITER },
+	{ "submesh",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_SUBMESH },
+	{ "submesh_groundmodel",          KEYWORD_TYPE_INLINE,           File::KEYWORD_SUBMESH_GROUNDMODEL },
+	{ "texcoords",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_TEXCOORDS },
+	{ "ties",                         KEYWORD_TYPE_BLOCK,            File::KEYWORD_TIES },
+	{ "torquecurve",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_TORQUECURVE },
+	{ "TractionControl",              KEYWORD_TYPE_INLINE,           File::KEYWORD_TRACTION_CONTROL },
+	{ "triggers",                     KEYWORD_TYPE_BLOCK,            File::KEYWORD_TRIGGERS },
+	{ "turbojets",                    KEYWORD_TYPE_BLOCK,            File::KEYWORD_TURBOJETS },
+	{ "turboprops",                   KEYWORD_TYPE_BLOCK,            File::KEYWORD_TURBOPROPS },
+	{ "turboprops2",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_TURBOPROPS2 },
+	{ "videocamera",                  KEYWORD_TYPE_BLOCK,            File::KEYWORD_VIDEOCAMERA },
+	{ "wheels",                       KEYWORD_TYPE_BLOCK,            File::KEYWORD_WHEELS },
+	{ "wheels2",                      KEYWORD_TYPE_BLOCK,            File::KEYWORD_WHEELS2 },
+	{ "wings",                        KEYWORD_TYPE_BLOCK,            File::KEYWORD_WINGS },
+};
+
+static const unsigned int KEYWORD_TABLE_SIZE = sizeof(KEYWORD_TABLE) / sizeof(KeywordEntry);
+
+/** Keyword table sorted by name for binary search. */
+class KeywordIndex
+{
+public:
+
+	KeywordIndex()
+	{
+		for (unsigned int i = 0; i < KEYWORD_TABLE_SIZE; i++)
+		{
+			m_entries[i] = &KEYWORD_TABLE[i];
+		}
+		std::sort(m_entries, m_entries + KEYWORD_TABLE_SIZE, &KeywordIndex::IsLess);
+	}
+
+	KeywordEntry const * Find(const char* word, unsigned int length) const
+	{
+		unsigned int first = 0;
+		unsigned int last = KEYWORD_TABLE_SIZE;
+		while (first < last)
+		{
+			unsigned int middle = (first + last) / 2;
+			int result = Compare(m_entries[middle]->name, word, length);
+			if (result == 0)
+			{
+				return m_entries[middle];
+			}
+			else if (result < 0)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
+		}
+		return nullptr;
+	}
+
+private:
+
+	static bool IsLess(KeywordEntry const * a, KeywordEntry const * b)
+	{
+		return strcmp(a->name, b->name) < 0;
+	}
+
+	/** strcmp() of a C-string and a non-terminated word */
+	static int Compare(const char* name, const char* word, unsigned int length)
+	{
+		int result = strncmp(name, word, length);
+		if (result != 0)
+		{
+			return result;
+		}
+		return (name[length] == '\0') ? 0 : 1;
+	}
+
+	KeywordEntry const * m_entries[KEYWORD_TABLE_SIZE];
+};
+
+/* Built during static initialization, before any thread can parse; a function-local static
+   would be built on first use, which isn't thread-safe with older compilers */
+static const KeywordIndex KEYWORD_INDEX;
+
+/* -------------------------------------------------------------------------- */
+/* Character classes (ASCII, as the regexes are compiled in "C" locale)       */
+/* -------------------------------------------------------------------------- */
+
+static inline bool IsBlank(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool IsAlphaChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool IsAlnum(char c)
+{
+	return IsAlphaChar(c) || IsDigit(c);
+}
+
+/** Characters of E_NODE_ID, E_REAL_NUMBER and option strings */
+static inline bool IsTokenChar(char c)
+{
+	return IsAlnum(c) || c == '_' || c == '-' || c == '.' || c == '+';
+}
+
+/** Boost treats these as line separators: they affect '^', '$' and '.', so such lines are left to regexes. */
+static inline bool IsLineSeparator(char c)
+{
+	return c == '\n' || c == '\r' || c == '\f' || static_cast<unsigned char>(c) == 0x85;
+}
+
+static bool HasLineSeparator(std::string const & line)
+{
+	const char* end = line.data() + line.length();
+	for (const char* pos = line.data(); pos != end; ++pos)
+	{
+		if (IsLineSeparator(*pos))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool IsBlankRange(const char* start, const char* end)
+{
+	for (const char* pos = start; pos != end; ++pos)
+	{
+		if (! IsBlank(*pos))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Equivalent of "^" keyword E_TRAILING_WHITESPACE */
+static bool IsBlockKeywordLine(std::string const & line, const char* keyword)
+{
+	size_t keyword_length = strlen(keyword);
+	if (line.compare(0, keyword_length, keyword) != 0)
+	{
+		return false;
+	}
+	const char* start = line.data();
+	return IsBlankRange(start + keyword_length, start + line.length());
+}
+
+/* -------------------------------------------------------------------------- */
+/* Line classification                                                        */
+/* -------------------------------------------------------------------------- */
+
+Tokenizer::LineType Tokenizer::IdentifyLineType(std::string const & line)
+{
+	if (HasLineSeparator(line))
+	{
+		return LINE_UNKNOWN;
+	}
+
+	const char* start = line.data();
+	const char* end = start + line.length();
+
+	if (IsBlockKeywordLine(line, "comment"))
+	{
+		return LINE_BLOCK_COMMENT_START;
+	}
+
+	const char* pos = start;
+	while (pos != end && IsBlank(*pos))
+	{
+		++pos;
+	}
+	if (pos == end)
+	{
+		return LINE_BLANK;
+	}
+	if (*pos == ';' || *pos == '/')
+	{
+		return LINE_COMMENT;
+	}
+	return LINE_CONTENT;
+}
+
+int Tokenizer::MatchBlockKeyword(std::string const & line, const char* keyword)
+{
+	if (HasLineSeparator(line))
+	{
+		return -1;
+	}
+
+	return IsBlockKeywordLine(line, keyword) ? 1 : 0;
+}
+
+bool Tokenizer::IdentifyKeyword(std::string const & line, File::Keyword & keyword)
+{
+	if (HasLineSeparator(line))
+	{
+		return false;
+	}
+
+	/* All keywords are anchored at line start and followed by blank, comma or line end,
+	   so the only candidate is the leading word */
+	const char* start = line.data();
+	const char* end = start + line.length();
+	const char* pos = start;
+	while (pos != end && (IsAlnum(*pos) || *pos == '_'))
+	{
+		++pos;
+	}
+
+	keyword = File::KEYWORD_INVALID;
+	KeywordEntry const * entry = (pos == start) ? nullptr : KEYWORD_INDEX.Find(start, pos - start);
+	if (entry == nullptr)
+	{
+		return true;
+	}
+
+	bool matched = false;
+	switch (entry->type)
+	{
+		case KEYWORD_TYPE_BLOCK:
+			matched = IsBlankRange(pos, end);
+			break;
+		case KEYWORD_TYPE_INLINE:
+			matched = (pos != end) && IsBlank(*pos);
+			break;
+		case KEYWORD_TYPE_INLINE_TOLERANT:
+			matched = (pos != end) && (IsBlank(*pos) || *pos == ',');
+			break;
+	}
+	if (matched)
+	{
+		keyword = entry->keyword;
+	}
+	return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Sections                                                                   */
+/* -------------------------------------------------------------------------- */
+
+bool Tokenizer::TokenizeNodes(std::string const & line)
+{
+	if (HasLineSeparator(line))
+	{
+		return false;
+	}
+
+	/* E_2xCAPTURE_TRAILING_COMMENT; neither ';' nor '/' can appear in the fields */
+	const char* start = line.data();
+	const char* end = start + line.length();
+	const char* comment = start;
+	while (comment != end && *comment != ';' && ! (*comment == '/' && comment + 1 != end && comment[1] == '/'))
+	{
+		++comment;
+	}
+
+	if (! Tokenize(start, comment) || m_num_tokens < 4 || m_num_tokens > 6)
+	{
+		return false;
+	}
+	/* "id, x, y, z," is valid: empty options */
+	if (m_trailing_delimiter && m_num_tokens != 4)
+	{
+		return false;
+	}
+	if (! IsNodeId(m_tokens[0]) || ! IsRealNumber(m_tokens[1]) || ! IsRealNumber(m_tokens[2]) || ! IsRealNumber(m_tokens[3]))
+	{
+		return false;
+	}
+	if (m_num_tokens >= 5 && ! ConsistsOf(m_tokens[4], "lnmfxychebpL"))
+	{
+		return false;
+	}
+	return m_num_tokens < 6 || IsRealNumber(m_tokens[5]);
+}
+
+bool Tokenizer::TokenizeBeams(std::string const & line)
+{
+	const char* start = line.data();
+	if (! Tokenize(start, start + line.length()) || m_num_tokens < 2 || m_num_tokens > 4 || m_trailing_delimiter)
+	{
+		return false;
+	}
+	if (! IsNodeId(m_tokens[0]) || ! IsNodeId(m_tokens[1]))
+	{
+		return false;
+	}
+	/* Options are E_STRING_ALNUM_COMMAS_USCORES_ONLY, same as E_NODE_ID */
+	if (m_num_tokens >= 3 && ! IsNodeId(m_tokens[2]))
+	{
+		return false;
+	}
+	return m_num_tokens < 4 || IsRealNumber(m_tokens[3]);
+}
+
+bool Tokenizer::TokenizeSubmeshCab(std::string const & line)
+{
+	const char* start = line.data();
+	if (! Tokenize(start, start + line.length()) || m_num_tokens < 3 || m_num_tokens > 4 || ! m_comma_delimiters_only)
+	{
+		return false;
+	}
+	/* "n1, n2, n3," is valid: empty options */
+	if (m_trailing_delimiter && m_num_tokens != 3)
+	{
+		return false;
+	}
+	if (! IsNodeId(m_tokens[0]) || ! IsNodeId(m_tokens[1]) || ! IsNodeId(m_tokens[2]))
+	{
+		return false;
+	}
+	return m_num_tokens < 4 || IsAlpha(m_tokens[3]);
+}
+
+bool Tokenizer::TokenizeSubmeshTexcoords(std::string const & line)
+{
+	const char* start = line.data();
+	if (! Tokenize(start, start + line.length()) || m_num_tokens != 3 || ! m_comma_delimiters_only || m_trailing_delimiter)
+	{
+		return false;
+	}
+	return IsNodeId(m_tokens[0]) && IsRealNumber(m_tokens[1]) && IsRealNumber(m_tokens[2]);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Tokens                                                                     */
+/* -------------------------------------------------------------------------- */
+
+bool Tokenizer::Tokenize(const char* start, const char* end)
+{
+	m_num_tokens = 0;
+	m_trailing_delimiter = false;
+	m_comma_delimiters_only = true;
+
+	/* E_LEADING_WHITESPACE */
+	const char* pos = start;
+	while (pos != end && IsBlank(*pos))
+	{
+		++pos;
+	}
+
+	while (pos != end)
+	{
+		const char* token_start = pos;
+		while (pos != end && IsTokenChar(*pos))
+		{
+			++pos;
+		}
+		if (pos == token_start || m_num_tokens == MAX_TOKENS)
+		{
+			return false; /* Leading comma, invalid character or too many tokens */
+		}
+		m_tokens[m_num_tokens].start = token_start;
+		m_tokens[m_num_tokens].length = static_cast<unsigned int>(pos - token_start);
+		++m_num_tokens;
+
+		/* E_DELIMITER: blanks with at most one comma */
+		const char* delimiter_start = pos;
+		unsigned int num_commas = 0;
+		while (pos != end && (IsBlank(*pos) || *pos == ','))
+		{
+			if (*pos == ',')
+			{
+				++num_commas;
+			}
+			++pos;
+		}
+		if (num_commas > 1)
+		{
+			return false;
+		}
+		if (pos == end)
+		{
+			/* Trailing whitespace is not a delimiter, a trailing comma is */
+			m_trailing_delimiter = (num_commas == 1);
+			break;
+		}
+		if (pos == delimiter_start)
+		{
+			return false; /* Invalid character right after token */
+		}
+		if (num_commas == 0)
+		{
+			m_comma_delimiters_only = false;
+		}
+	}
+	return true;
+}
+
+bool Tokenizer::IsNodeId(Token const & token)
+{
+	const char* end = token.start + token.length;
+	for (const char* pos = token.start; pos != end; ++pos)
+	{
+		if (! IsAlnum(*pos) && *pos != '_' && *pos != '-')
+		{
+			return false;
+		}
+	}
+	return token.length != 0;
+}
+
+bool Tokenizer::IsRealNumber(Token const & token)
+{
+	/* E_REAL_NUMBER_WITH_EXPONENT | E_REAL_NUMBER_SIMPLE | E_DECIMAL_NUMBER */
+	const char* pos = token.start;
+	const char* end = token.start + token.length;
+
+	if (pos != end && *pos == '-')
+	{
+		++pos;
+	}
+	const char* int_start = pos;
+	while (pos != end && IsDigit(*pos))
+	{
+		++pos;
+	}
+	if (pos == end)
+	{
+		return pos != int_start;
+	}
+	if (*pos != '.')
+	{
+		return false;
+	}
+	++pos;
+	const char* fraction_start = pos;
+	while (pos != end && IsDigit(*pos))
+	{
+		++pos;
+	}
+	if (pos == fraction_start)
+	{
+		return false;
+	}
+	if (pos == end)
+	{
+		return true;
+	}
+	if (*pos != 'e' && *pos != 'E')
+	{
+		return false;
+	}
+	++pos;
+	if (pos != end && (*pos == '-' || *pos == '+'))
+	{
+		++pos;
+	}
+	const char* exponent_start = pos;
+	while (pos != end && IsDigit(*pos))
+	{
+		++pos;
+	}
+	return pos == end && pos != exponent_start;
+}
+
+bool Tokenizer::ConsistsOf(Token const & token, const char* allowed_chars)
+{
+	const char* end = token.start + token.length;
+	for (const char* pos = token.start; pos != end; ++pos)
+	{
+		if (strchr(allowed_chars, *pos) == nullptr)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Tokenizer::IsAlpha(Token const & token)
+{
+	const char* end = token.start + token.length;
+	for (const char* pos = token.start; pos != end; ++pos)
+	{
+		if (! IsAlphaChar(*pos))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+float Tokenizer::ParseReal(Token const & token)
+{
+	/* Powers of ten which are exact in a float */
+	static const float POWERS_OF_10[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	static const unsigned int MAX_EXACT_MANTISSA = 1u << 24;
+
+	/* Plain decimals like "-12.3456" whose digits fit into a float exactly: one correctly rounded
+	   division gives the same value as Ogre. Not strtof(), the C locale may use a decimal comma (see Language.cpp). */
+	const char* pos = token.start;
+	const char* end = token.start + token.length;
+	bool negative = false;
+	if (pos != end && (*pos == '-' || *pos == '+'))
+	{
+		negative = (*pos == '-');
+		++pos;
+	}
+	unsigned int mantissa = 0;
+	int decimals = -1; /* -1 = no decimal point yet */
+	bool has_digits = false;
+	for (; pos != end; ++pos)
+	{
+		if (IsDigit(*pos) && mantissa <= MAX_EXACT_MANTISSA)
+		{
+			mantissa = (mantissa * 10) + (*pos - '0');
+			has_digits = true;
+			if (decimals >= 0)
+			{
+				++decimals;
+			}
+		}
+		else if (*pos == '.' && decimals < 0)
+		{
+			decimals = 0;
+		}
+		else
+		{
+			break;
+		}
+	}
+	if (pos == end && has_digits && mantissa <= MAX_EXACT_MANTISSA && decimals <= 10)
+	{
+		float value = static_cast<float>(mantissa) / POWERS_OF_10[std::max(decimals, 0)];
+		return negative ? -value : value;
+	}
+	/* Exponents, long mantissas: leave the corner cases to Ogre */
+	return Ogre::StringConverter::parseReal(token.ToString());
+}
+
+bool Tokenizer::ParseNodeNumber(Token const & token, unsigned int & number)
+{
+	if (token.length == 0 || token.length > 9)
+	{
+		return false;
+	}
+	unsigned int value = 0;
+	const char* end = token.start + token.length;
+	for (const char* pos = token.start; pos != end; ++pos)
+	{
+		if (! IsDigit(*pos))
+		{
+			return false;
+		}
+		value = (value * 10) + (*pos - '0');
+	}
+	number = value;
+	return true;
+}
+
+} // namespace RigDef
@@ -0,0 +1,154 @@
+/*
+	This source file is part of Rigs of Rods
+	Copyright 2005-2012 Pierre-Michel Ricordel
+	Copyright 2007-2012 Thomas Fischer
+	Copyright 2013-2014 Petr Ohlidal
+
+	For more information, see http://www.rigsofrods.com/
+
+	Rigs of Rods is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License version 3, as
+	published by the Free Software Foundation.
+
+	Rigs of Rods is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+	@file   RigDef_Tokenizer.h
+	@brief  Regex-free line scanner for the frequent lines of rig-def files.
+*/
+
+#pragma once
+
+#include "RigDef_File.h"
+
+#include <string>
+
+namespace RigDef
+{
+
+/**
+	@class  Tokenizer
+
+	@brief Splits rig-def lines into fields without using regexes.
+
+	Only used by Parser for the lines which make up the bulk of a file: line type,
+	keywords and the sections nodes/nodes2, beams, submesh/cab and submesh/texcoords.
+
+	PRINCIPLE:
+		The tokenizer is conservative. Every Tokenize*() function accepts a line only if
+		the respective regex in RigDef_Regexes.h would match it with the very same captures.
+		Anything unusual (double commas, stray characters, line separators...) is rejected
+		and Parser falls back to the regex, so the resulting RigDef::File and parser
+		messages are identical in both cases.
+
+	Tokens point into the parsed line, nothing is copied. The line must outlive the tokenizer.
+*/
+class Tokenizer
+{
+
+public:
+
+	/** A slice of the tokenized line. */
+	struct Token
+	{
+		const char*  start;
+		unsigned int length;
+
+		std::string ToString() const
+		{
+			return std::string(start, length);
+		}
+	};
+
+	enum LineType
+	{
+		LINE_CONTENT,
+		LINE_BLOCK_COMMENT_START,
+		LINE_COMMENT,
+		LINE_BLANK,
+
+		LINE_UNKNOWN ///< Line contains characters the tokenizer doesn't handle; use regex.
+	};
+
+	static const unsigned int MAX_TOKENS = 8;
+
+	Tokenizer():
+		m_num_tokens(0),
+		m_trailing_delimiter(false),
+		m_comma_delimiters_only(true)
+	{}
+
+	/** Equivalent of Regexes::IDENTIFY_LINE_TYPE */
+	static LineType IdentifyLineType(std::string const & line);
+
+	/** Equivalent of boost::regex_match(line, "^" keyword E_TRAILING_WHITESPACE)
+	* @return 1 = match, 0 = no match, -1 = unknown, use regex.
+	*/
+	static int MatchBlockKeyword(std::string const & line, const char* keyword);
+
+	/** Keyword table lookup, equivalent of Regexes::IDENTIFY_KEYWORD
+	* @param keyword [out] Found keyword or File::KEYWORD_INVALID
+	* @return False if unknown, use regex.
+	*/
+	static bool IdentifyKeyword(std::string const & line, File::Keyword & keyword);
+
+	/** Fast path of Regexes::SECTION_NODES_N2; tokens: id, x, y, z [, options [, load weight]] */
+	bool TokenizeNodes(std::string const & line);
+
+	/** Fast path of Regexes::SECTION_BEAMS (trailing comment must be already cut off); tokens: node, node [, options [, extension break limit]] */
+	bool TokenizeBeams(std::string const & line);
+
+	/** Fast path of Regexes::SUBMESH_SUBSECTION_CAB; tokens: node, node, node [, options] */
+	bool TokenizeSubmeshCab(std::string const & line);
+
+	/** Fast path of Regexes::SUBMESH_SUBSECTION_TEXCOORDS; tokens: node, u, v */
+	bool TokenizeSubmeshTexcoords(std::string const & line);
+
+	unsigned int GetNumTokens() const
+	{
+		return m_num_tokens;
+	}
+
+	Token const & GetToken(unsigned int index) const
+	{
+		return m_tokens[index];
+	}
+
+	/** Converts a token matching E_REAL_NUMBER; same result as Ogre::StringConverter::parseReal(), independent of the C locale */
+	static float ParseReal(Token const & token);
+
+	/** Converts a plain numeric node id (E_POSITIVE_DECIMAL_NUMBER, up to 9 digits)
+	* @return False if the token is something else.
+	*/
+	static bool ParseNodeNumber(Token const & token, unsigned int & number);
+
+protected:
+
+	/** Splits the range by E_DELIMITER; leading and trailing whitespace is skipped.
+	* @return False if the range contains characters not allowed in tokens, leading comma,
+	*         more commas in one delimiter or too many tokens.
+	*/
+	bool Tokenize(const char* start, const char* end);
+
+	static bool IsNodeId(Token const & token);
+
+	static bool IsRealNumber(Token const & token);
+
+	static bool ConsistsOf(Token const & token, const char* allowed_chars);
+
+	static bool IsAlpha(Token const & token);
+
+	Token        m_tokens[MAX_TOKENS];
+	unsigned int m_num_tokens;
+	bool         m_trailing_delimiter;    ///< Line ends with a delimiter containing a comma.
+	bool         m_comma_delimiters_only; ///< All delimiters (including trailing one) contain a comma.
+};
+
+} // namespace RigDef
@@ -0,0 +1,384 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// rig_parser_benchmark: measures RigDef::Parser on a set of rig-def files
+// and cross-checks the Tokenizer fast paths against the regex-only parser.
+// It also compares parsing+validation with loading from the binary rig cache.
+
+#include "RigDef_BinarySerializer.h"
+#include "RigDef_File.h"
+#include "RigDef_Parser.h"
+#include "RigDef_Serializer.h"
+#include "RigDef_Validator.h"
+
+#include <OgreArchive.h>
+#include <OgreFileSystem.h>
+#include <OgreStringConverter.h>
+#include <OgreTimer.h>
+#include <OgreZip.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <vector>
+
+struct rig_file_t
+{
+	Ogre::String name;
+	std::vector<Ogre::String> lines;
+};
+
+static const char *rig_extensions[] = { "truck", "load", "fixed", "airplane", "boat", "car", "train", "trailer", "machine" };
+
+// reads all rig-def files of the archive; lines are read like the game does (DataStream::getLine())
+void loadRigFiles(Ogre::ArchiveFactory &factory, const Ogre::String &path, std::vector<rig_file_t> &files)
+{
+	Ogre::Archive *archive = factory.createInstance(path);
+	archive->load();
+
+	for (size_t i = 0; i < sizeof(rig_extensions) / sizeof(*rig_extensions); i++)
+	{
+		Ogre::StringVectorPtr names = archive->find("*." + Ogre::String(rig_extensions[i]), true);
+		for (Ogre::StringVector::iterator it = names->begin(); it != names->end(); ++it)
+		{
+			Ogre::DataStreamPtr ds = archive->open(*it);
+			if (ds.isNull())
+				continue;
+
+			rig_file_t file;
+			file.name = path + "/" + *it;
+			while (!ds->eof())
+			{
+				file.lines.push_back(ds->getLine());
+			}
+			files.push_back(file);
+		}
+	}
+
+	factory.destroyInstance(archive);
+}
+
+// reads all rig-def files of a zip or below a directory, including the zips in it (vehicles are shipped as zips)
+void loadRigFiles(const Ogre::String &path, std::vector<rig_file_t> &files)
+{
+	Ogre::FileSystemArchiveFactory dir_factory;
+	Ogre::ZipArchiveFactory zip_factory;
+
+	if (Ogre::StringUtil::endsWith(path, ".zip"))
+	{
+		loadRigFiles(zip_factory, path, files);
+		return;
+	}
+
+	loadRigFiles(dir_factory, path, files);
+
+	Ogre::Archive *dir = static_cast<Ogre::ArchiveFactory &>(dir_factory).createInstance(path);
+	dir->load();
+	Ogre::StringVectorPtr zips = dir->find("*.zip", true);
+	for (Ogre::StringVector::iterator it = zips->begin(); it != zips->end(); ++it)
+	{
+		loadRigFiles(zip_factory, path + "/" + *it, files);
+	}
+	dir_factory.destroyInstance(dir);
+}
+
+boost::shared_ptr<RigDef::File> parseRigFile(const rig_file_t &file, bool use_regex, std::list<RigDef::Parser::Message> *messages)
+{
+	RigDef::Parser parser;
+	parser.SetUseRegexTokenizer(use_regex);
+	parser.Prepare();
+	for (std::vector<Ogre::String>::const_iterator it = file.lines.begin(); it != file.lines.end(); ++it)
+	{
+		parser.ParseLine(*it);
+	}
+	parser.Finalize();
+
+	if (messages)
+		*messages = parser.GetMessages();
+	return parser.GetFile();
+}
+
+// what the game does when the rig isn't cached
+boost::shared_ptr<RigDef::File> parseAndValidateRigFile(const rig_file_t &file)
+{
+	boost::shared_ptr<RigDef::File> rig_def = parseRigFile(file, false, 0);
+	RigDef::Validator validator;
+	validator.Setup(rig_def);
+	validator.Validate();
+	return rig_def;
+}
+
+// returns the average time of parsing all files once, in milliseconds
+double benchmark(const std::vector<rig_file_t> &files, bool use_regex, int iterations)
+{
+	Ogre::Timer timer;
+	for (int i = 0; i < iterations; i++)
+	{
+		for (std::vector<rig_file_t>::const_iterator it = files.begin(); it != files.end(); ++it)
+		{
+			parseRigFile(*it, use_regex, 0);
+		}
+	}
+	return timer.getMicroseconds() / 1000.0 / iterations;
+}
+
+// the serializer groups entries by their defaults (pointers), so only the sorted lines are comparable
+std::vector<Ogre::String> serialize(boost::shared_ptr<RigDef::File> rig_def, const Ogre::String &tmp_file)
+{
+	std::vector<Ogre::String> lines;
+	try
+	{
+		RigDef::Serializer serializer(rig_def, tmp_file);
+		serializer.Serialize();
+	}
+	catch (std::exception &e)
+	{
+		// the serializer refuses some definitions, it's enough when both parsers produce the same error
+		lines.push_back(e.what());
+		std::remove(tmp_file.c_str());
+		return lines;
+	}
+
+	std::ifstream in(tmp_file.c_str());
+	Ogre::String line;
+	while (std::getline(in, line))
+	{
+		lines.push_back(line);
+	}
+	in.close();
+	std::remove(tmp_file.c_str());
+
+	std::sort(lines.begin(), lines.end());
+	return lines;
+}
+
+// exact, ordered comparison of the sections which have a tokenizer fast path
+bool compareModules(RigDef::File::Module *a, RigDef::File::Module *b)
+{
+	if (a->nodes.size() != b->nodes.size() || a->beams.size() != b->beams.size() || a->submeshes.size() != b->submeshes.size())
+		return false;
+
+	for (size_t i = 0; i < a->nodes.size(); i++)
+	{
+		RigDef::Node &x = a->nodes[i], &y = b->nodes[i];
+		if (x.id != y.id || x.position != y.position || x.options != y.options || x.detacher_group != y.detacher_group
+			|| x._has_load_weight_override != y._has_load_weight_override || x.load_weight_override != y.load_weight_override)
+			return false;
+	}
+	for (size_t i = 0; i < a->beams.size(); i++)
+	{
+		RigDef::Beam &x = a->beams[i], &y = b->beams[i];
+		if (x.nodes[0] != y.nodes[0] || x.nodes[1] != y.nodes[1] || x.options != y.options || x.detacher_group != y.detacher_group
+			|| x._has_extension_break_limit != y._has_extension_break_limit || x.extension_break_limit != y.extension_break_limit)
+			return false;
+	}
+	for (size_t i = 0; i < a->submeshes.size(); i++)
+	{
+		RigDef::Submesh &x = a->submeshes[i], &y = b->submeshes[i];
+		if (x.cab_triangles.size() != y.cab_triangles.size() || x.texcoords.size() != y.texcoords.size())
+			return false;
+		for (size_t j = 0; j < x.cab_triangles.size(); j++)
+		{
+			RigDef::Cab &c = x.cab_triangles[j], &d = y.cab_triangles[j];
+			if (c.nodes[0] != d.nodes[0] || c.nodes[1] != d.nodes[1] || c.nodes[2] != d.nodes[2] || c.options != d.options)
+				return false;
+		}
+		for (size_t j = 0; j < x.texcoords.size(); j++)
+		{
+			RigDef::Texcoord &t = x.texcoords[j], &u = y.texcoords[j];
+			if (t.node != u.node || t.u != u.u || t.v != u.v)
+				return false;
+		}
+	}
+	return true;
+}
+
+// parses the file with and without the tokenizer, compares messages and serialized results
+bool crossCheck(const rig_file_t &file)
+{
+	std::list<RigDef::Parser::Message> regex_messages, tokenizer_messages;
+	boost::shared_ptr<RigDef::File> regex_def     = parseRigFile(file, true,  &regex_messages);
+	boost::shared_ptr<RigDef::File> tokenizer_def = parseRigFile(file, false, &tokenizer_messages);
+
+	bool ok = true;
+	if (regex_messages.size() != tokenizer_messages.size())
+	{
+		printf("  %s: %d parser messages with regexes, %d with tokenizer\n", file.name.c_str(), (int)regex_messages.size(), (int)tokenizer_messages.size());
+		ok = false;
+	}
+	else
+	{
+		std::list<RigDef::Parser::Message>::iterator a = regex_messages.begin(), b = tokenizer_messages.begin();
+		for (; a != regex_messages.end(); ++a, ++b)
+		{
+			if (a->line_number != b->line_number || a->type != b->type || a->message != b->message)
+			{
+				printf("  %s:%u: parser message differs: '%s' / '%s'\n", file.name.c_str(), a->line_number, a->message.c_str(), b->message.c_str());
+				ok = false;
+			}
+		}
+	}
+
+	bool same_modules = regex_def->modules.size() == tokenizer_def->modules.size() && compareModules(regex_def->root_module.get(), tokenizer_def->root_module.get());
+	std::map<Ogre::String, boost::shared_ptr<RigDef::File::Module> >::iterator a = regex_def->modules.begin(), b = tokenizer_def->modules.begin();
+	for (; same_modules && a != regex_def->modules.end(); ++a, ++b)
+	{
+		same_modules = a->first == b->first && compareModules(a->second.get(), b->second.get());
+	}
+
+	if (!same_modules || serialize(regex_def, "rig_parser_benchmark.tmp") != serialize(tokenizer_def, "rig_parser_benchmark.tmp"))
+	{
+		printf("  %s: parsed data differ\n", file.name.c_str());
+		ok = false;
+	}
+	return ok;
+}
+
+// saves the validated rig to the binary format, loads it back and compares
+bool binaryCheck(const rig_file_t &file, std::vector<char> &buffer)
+{
+	boost::shared_ptr<RigDef::File> rig_def = parseAndValidateRigFile(file);
+	buffer.clear();
+	RigDef::BinarySerializer::Serialize(rig_def, file.name, buffer);
+
+	boost::shared_ptr<RigDef::File> loaded = RigDef::BinarySerializer::Deserialize(&buffer[0], buffer.size(), file.name);
+	if (!loaded)
+	{
+		printf("  %s: binary data rejected\n", file.name.c_str());
+		return false;
+	}
+
+	// saving the loaded data again must give the very same bytes (covers all fields and shared defaults)
+	std::vector<char> again;
+	RigDef::BinarySerializer::Serialize(loaded, file.name, again);
+
+	bool ok = again == buffer && loaded->modules.size() == rig_def->modules.size() && compareModules(rig_def->root_module.get(), loaded->root_module.get());
+	if (!ok || serialize(rig_def, "rig_parser_benchmark.tmp") != serialize(loaded, "rig_parser_benchmark.tmp"))
+	{
+		printf("  %s: binary round trip differs\n", file.name.c_str());
+		return false;
+	}
+
+	// truncated data must be rejected, not crash
+	if (RigDef::BinarySerializer::Deserialize(&buffer[0], buffer.size() / 2, file.name) || RigDef::BinarySerializer::Deserialize(&buffer[0], buffer.size(), "other"))
+	{
+		printf("  %s: invalid binary data accepted\n", file.name.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool compareLineCount(const rig_file_t *a, const rig_file_t *b)
+{
+	return a->lines.size() > b->lines.size();
+}
+
+// parse+validate vs. binary load for the largest files
+void benchmarkBinary(const std::vector<rig_file_t> &files, int iterations)
+{
+	std::vector<const rig_file_t *> largest;
+	for (std::vector<rig_file_t>::const_iterator it = files.begin(); it != files.end(); ++it)
+	{
+		largest.push_back(&*it);
+	}
+	std::sort(largest.begin(), largest.end(), compareLineCount);
+	largest.resize(std::min(largest.size(), (size_t)5));
+
+	printf("binary cache (largest files):\n");
+	for (std::vector<const rig_file_t *>::iterator it = largest.begin(); it != largest.end(); ++it)
+	{
+		const rig_file_t &file = **it;
+		std::vector<char> buffer;
+		RigDef::BinarySerializer::Serialize(parseAndValidateRigFile(file), file.name, buffer);
+
+		Ogre::Timer timer;
+		for (int i = 0; i < iterations; i++)
+		{
+			parseAndValidateRigFile(file);
+		}
+		double parse_time = timer.getMicroseconds() / 1000.0 / iterations;
+
+		timer.reset();
+		for (int i = 0; i < iterations; i++)
+		{
+			RigDef::BinarySerializer::Deserialize(&buffer[0], buffer.size(), file.name);
+		}
+		double load_time = timer.getMicroseconds() / 1000.0 / iterations;
+
+		printf("  %-60s %6d lines, %8d bytes: parse+validate %8.3f ms, binary %8.3f ms (%.1fx)\n",
+			file.name.c_str(), (int)file.lines.size(), (int)buffer.size(), parse_time, load_time, load_time > 0 ? parse_time / load_time : 0.0);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = 10;
+	std::vector<rig_file_t> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-n") && i + 1 < argc)
+			iterations = std::max(1, Ogre::StringConverter::parseInt(argv[++i]));
+		else
+			loadRigFiles(argv[i], files);
+	}
+
+	if (files.empty())
+	{
+		printf("usage: %s [-n <iterations>] <directory or zip> [<directory or zip> ...]\n", argv[0]);
+		printf("  parses all rig-def files (.truck, .load, .fixed, ...) in the directories and zips, for example bin/resources\n");
+		return 1;
+	}
+
+	size_t num_lines = 0;
+	for (std::vector<rig_file_t>::iterator it = files.begin(); it != files.end(); ++it)
+	{
+		num_lines += it->lines.size();
+	}
+	printf("%d files, %d lines, %d iterations\n", (int)files.size(), (int)num_lines, iterations);
+
+	int mismatches = 0;
+	for (std::vector<rig_file_t>::iterator it = files.begin(); it != files.end(); ++it)
+	{
+		if (!crossCheck(*it))
+			mismatches++;
+	}
+	printf("cross-check: %d of %d files differ\n", mismatches, (int)files.size());
+
+	int binary_mismatches = 0;
+	std::vector<char> buffer;
+	for (std::vector<rig_file_t>::iterator it = files.begin(); it != files.end(); ++it)
+	{
+		if (!binaryCheck(*it, buffer))
+			binary_mismatches++;
+	}
+	printf("binary round trip: %d of %d files differ\n", binary_mismatches, (int)files.size());
+
+	double regex_time     = benchmark(files, true, iterations);
+	double tokenizer_time = benchmark(files, false, iterations);
+	printf("regex:     %10.2f ms\n", regex_time);
+	printf("tokenizer: %10.2f ms (%.1fx)\n", tokenizer_time, tokenizer_time > 0 ? regex_time / tokenizer_time : 0.0);
+
+	benchmarkBinary(files, iterations);
+
+	return (mismatches || binary_mismatches) ? 1 : 0;
+}